@@ -50,28 +50,72 @@ void Contour::print_contour()
 	std::cout << std::endl;
 }
 
-void Contour::doug_peuck(float epsilon, bool /*closed*/)
+void PolylineSimplifier::simplify(std::vector<Point>& pts, float epsilon)
 {
-	if (n > 2)
+	unsigned int n = (unsigned int)pts.size();
+	if (n <= 2)
+		return;
+
+	_keep.assign(n, 0);
+	_keep[0] = 1;
+	_keep[n - 1] = 1;
+
+	_stack.clear();
+	_stack.push_back(std::make_pair(0u, n - 1));
+	while (!_stack.empty())
 	{
-		std::vector<bool> v1;
-		v1.resize(n);
+		unsigned int p1 = _stack.back().first;
+		unsigned int p2 = _stack.back().second;
+		_stack.pop_back();
+		if (p2 <= p1 + 1)
+			continue;
 
-		for (unsigned int i = 0; i < n; i++)
-			v1[i] = false;
-		v1[0] = true;
-		v1[n - 1] = true;
-		doug_peuck_sub(epsilon, 0, n - 1, &v1);
+		float dv, l;
+		float max_dist = 0;
+		Point SIJ, SIV;
+		unsigned int max_pos = p1;
 
-		auto it = plist.begin();
-		for (unsigned int i = 0; i < n; i++)
+		SIJ.px = pts[p2].px - pts[p1].px;
+		SIJ.py = pts[p2].py - pts[p1].py;
+
+		l = dist(&SIJ);
+
+		for (unsigned int i = p1 + 1; i < p2; i++)
 		{
-			if (!v1[i])
-				it = plist.erase(it);
-			else
-				it++;
+			SIV.px = pts[i].px - pts[p1].px;
+			SIV.py = pts[i].py - pts[p1].py;
+			dv = cross(&SIV, &SIJ) / l;
+			if (dv > max_dist)
+			{
+				max_dist = dv;
+				max_pos = i;
+			}
+		}
+
+		if (max_dist > epsilon)
+		{
+			_keep[max_pos] = 1;
+			_stack.push_back(std::make_pair(max_pos, p2));
+			_stack.push_back(std::make_pair(p1, max_pos));
 		}
+	}
 
+	// compact in place, instead of erasing point by point
+	unsigned int k = 0;
+	for (unsigned int i = 0; i < n; i++)
+	{
+		if (_keep[i])
+			pts[k++] = pts[i];
+	}
+	pts.resize(k);
+}
+
+void Contour::doug_peuck(float epsilon, bool /*closed*/)
+{
+	if (n > 2)
+	{
+		PolylineSimplifier simplifier;
+		simplifier.simplify(plist, epsilon);
 		n = (unsigned)plist.size();
 	}
 }
@@ -117,40 +161,6 @@ void Contour::return_contour(std::vector<Point>* Pt_vec)
 		(*Pt_vec).push_back(plist[i]);
 }
 
-void Contour::doug_peuck_sub(float epsilon, const unsigned int p1, const unsigned int p2, std::vector<bool>* v1_p)
-{
-	if (p2 <= p1 + 1)
-		return;
-	float dv, l;
-	float max_dist = 0;
-	Point SIJ, SIV;
-	unsigned int max_pos = p1;
-
-	SIJ.px = plist[p2].px - plist[p1].px;
-	SIJ.py = plist[p2].py - plist[p1].py;
-
-	l = dist(&SIJ);
-
-	for (unsigned int i = p1 + 1; i < p2; i++)
-	{
-		SIV.px = plist[i].px - plist[p1].px;
-		SIV.py = plist[i].py - plist[p1].py;
-		dv = cross(&SIV, &SIJ) / l;
-		if (dv > max_dist)
-		{
-			max_dist = dv;
-			max_pos = i;
-		}
-	}
-
-	if (max_dist > epsilon)
-	{
-		(*v1_p)[max_pos] = true;
-		doug_peuck_sub(epsilon, p1, max_pos, v1_p);
-		doug_peuck_sub(epsilon, max_pos, p2, v1_p);
-	}
-}
-
 void Contour2::doug_peuck(float epsilon, std::vector<Point>* Pt_vec,
 		std::vector<unsigned>* Meetings_vec,
 		std::vector<Point>* Result_vec)
@@ -165,43 +175,59 @@ void Contour2::doug_peuck(float epsilon, std::vector<Point>* Pt_vec,
 
 	if (n > m)
 	{
-		std::vector<bool> v1;
-		v1.resize(n);
-
-		for (unsigned int i = 0; i < n; i++)
-			v1[i] = false;
+		const std::vector<Point>& pts = *Pt_vec;
+		marks.assign(n, false);
 		for (unsigned int i = 0; i < m; i++)
-			v1[(*Meetings_vec)[i]] = true;
+			marks[(*Meetings_vec)[i]] = true;
 
-		for (unsigned int i = 0; i + 1 < m; i++)
+		stack.clear();
+		Segment last = {(*Meetings_vec)[m - 1], (*Meetings_vec)[0], true};
+		stack.push_back(last);
+		for (unsigned int i = m - 1; i > 0; i--)
 		{
-			doug_peuck_sub(epsilon, Pt_vec, (*Meetings_vec)[i],
-					(*Meetings_vec)[i + 1], &v1);
+			Segment s = {(*Meetings_vec)[i - 1], (*Meetings_vec)[i], false};
+			stack.push_back(s);
+		}
+
+		unsigned int max_pos;
+		while (!stack.empty())
+		{
+			Segment s = stack.back();
+			stack.pop_back();
+			bool found = s.wraps ? split_wrapped(epsilon, pts, s.p1, s.p2, max_pos)
+								 : split(epsilon, pts, s.p1, s.p2, max_pos);
+			if (!found)
+				continue;
+
+			marks[max_pos] = true;
+			// a wrapped segment splits into a wrapped and a plain part
+			Segment first = {s.p1, max_pos, s.wraps && max_pos < s.p2};
+			Segment second = {max_pos, s.p2, s.wraps && max_pos >= s.p2};
+			stack.push_back(second);
+			stack.push_back(first);
 		}
-		doug_peuck_sub2(epsilon, Pt_vec, (*Meetings_vec)[m - 1],
-				(*Meetings_vec)[0], &v1);
 
 		Result_vec->clear();
 		for (unsigned int i = 0; i < n; i++)
 		{
-			if (v1[i])
-				Result_vec->push_back((*Pt_vec)[i]);
+			if (marks[i])
+				Result_vec->push_back(pts[i]);
 		}
 	}
 }
 
-void Contour2::doug_peuck_sub(float epsilon, std::vector<Point>* Pt_vec,
-		unsigned short p1, unsigned short p2, std::vector<bool>* v1_p)
+bool Contour2::split(float epsilon, const std::vector<Point>& pts,
+		unsigned int p1, unsigned int p2, unsigned int& max_pos) const
 {
 	if (p2 <= p1 + 1)
-		return;
+		return false;
 	float dv, l;
 	float max_dist = 0;
 	Point SIJ, SIV;
-	unsigned int max_pos = p1;
+	max_pos = p1;
 
-	SIJ.px = (*Pt_vec)[p2].px - (*Pt_vec)[p1].px;
-	SIJ.py = (*Pt_vec)[p2].py - (*Pt_vec)[p1].py;
+	SIJ.px = pts[p2].px - pts[p1].px;
+	SIJ.py = pts[p2].py - pts[p1].py;
 
 	l = dist(&SIJ);
 
@@ -209,8 +235,8 @@ void Contour2::doug_peuck_sub(float epsilon, std::vector<Point>* Pt_vec,
 	{
 		for (unsigned int i = p1 + 1; i < p2; i++)
 		{
-			SIV.px = (*Pt_vec)[i].px - (*Pt_vec)[p1].px;
-			SIV.py = (*Pt_vec)[i].py - (*Pt_vec)[p1].py;
+			SIV.px = pts[i].px - pts[p1].px;
+			SIV.py = pts[i].py - pts[p1].py;
 			dv = cross(&SIV, &SIJ) / l;
 			//		if(dv>=max_dist-0.001) {max_dist=dv; max_pos=i;}
 			if (dv > max_dist + 0.001)
@@ -224,8 +250,8 @@ void Contour2::doug_peuck_sub(float epsilon, std::vector<Point>* Pt_vec,
 	{
 		for (unsigned int i = p2 - 1; i > p1; i--)
 		{
-			SIV.px = (*Pt_vec)[i].px - (*Pt_vec)[p1].px;
-			SIV.py = (*Pt_vec)[i].py - (*Pt_vec)[p1].py;
+			SIV.px = pts[i].px - pts[p1].px;
+			SIV.py = pts[i].py - pts[p1].py;
 			dv = cross(&SIV, &SIJ) / l;
 			//		if(dv>=max_dist-0.001) {max_dist=dv; max_pos=i;}
 			if (dv > max_dist + 0.001)
@@ -236,19 +262,14 @@ void Contour2::doug_peuck_sub(float epsilon, std::vector<Point>* Pt_vec,
 		}
 	}
 
-	if (max_dist > epsilon)
-	{
-		(*v1_p)[max_pos] = true;
-		doug_peuck_sub(epsilon, Pt_vec, p1, max_pos, v1_p);
-		doug_peuck_sub(epsilon, Pt_vec, max_pos, p2, v1_p);
-	}
+	return max_dist > epsilon;
 }
 
-void Contour2::doug_peuck_sub2(float epsilon, std::vector<Point>* Pt_vec,
-		unsigned short p1, unsigned short p2, std::vector<bool>* v1_p)
+bool Contour2::split_wrapped(float epsilon, const std::vector<Point>& pts,
+		unsigned int p1, unsigned int p2, unsigned int& max_pos)
 {
 	if ((p2 == 0 && p1 + 1 == n) || p1 < p2)
-		return;
+		return false;
 
 	float dv, l;
 	float max_dist = 0;
@@ -258,8 +279,8 @@ void Contour2::doug_peuck_sub2(float epsilon, std::vector<Point>* Pt_vec,
 	{
 		if (n > 2)
 		{
-			unsigned short p3, p4;
-			if ((unsigned int)(p1 + 1) < n)
+			unsigned int p3, p4;
+			if (p1 + 1 < n)
 				p3 = p1 + 1;
 			else
 				p3 = 0;
@@ -267,17 +288,17 @@ void Contour2::doug_peuck_sub2(float epsilon, std::vector<Point>* Pt_vec,
 				p4 = n - 1;
 			else
 				p4 = p1 - 1;
-			unsigned int max_pos = p1;
+			max_pos = p1;
 			float epsilon1 = epsilon * epsilon;
 
-			SIJ.px = (*Pt_vec)[p4].px - (*Pt_vec)[p3].px;
-			SIJ.py = (*Pt_vec)[p4].py - (*Pt_vec)[p3].py;
+			SIJ.px = pts[p4].px - pts[p3].px;
+			SIJ.py = pts[p4].py - pts[p3].py;
 			if (SIJ.px > 0 || (SIJ.px == 0 && SIJ.py > 0))
 			{
 				for (unsigned int i = p1 + 1; i < n; i++)
 				{
-					SIV.px = (*Pt_vec)[i].px - (*Pt_vec)[p1].px;
-					SIV.py = (*Pt_vec)[i].py - (*Pt_vec)[p1].py;
+					SIV.px = pts[i].px - pts[p1].px;
+					SIV.py = pts[i].py - pts[p1].py;
 					dv = float(SIV.px * SIV.px + SIV.py * SIV.py);
 					//			if(dv>=max_dist-0.001) {max_dist=dv; max_pos=i;}
 					if (dv > max_dist + 0.001)
@@ -288,8 +309,8 @@ void Contour2::doug_peuck_sub2(float epsilon, std::vector<Point>* Pt_vec,
 				}
 				for (unsigned int i = 0; i < p2; i++)
 				{
-					SIV.px = (*Pt_vec)[i].px - (*Pt_vec)[p1].px;
-					SIV.py = (*Pt_vec)[i].py - (*Pt_vec)[p1].py;
+					SIV.px = pts[i].px - pts[p1].px;
+					SIV.py = pts[i].py - pts[p1].py;
 					dv = float(SIV.px * SIV.px + SIV.py * SIV.py);
 					//			if(dv>=max_dist-0.001) {max_dist=dv; max_pos=i;}
 					if (dv > max_dist + 0.001)
@@ -305,8 +326,8 @@ void Contour2::doug_peuck_sub2(float epsilon, std::vector<Point>* Pt_vec,
 				{
 					for (unsigned int i = p2 - 1; i > 0; i--)
 					{
-						SIV.px = (*Pt_vec)[i].px - (*Pt_vec)[p1].px;
-						SIV.py = (*Pt_vec)[i].py - (*Pt_vec)[p1].py;
+						SIV.px = pts[i].px - pts[p1].px;
+						SIV.py = pts[i].py - pts[p1].py;
 						dv = float(SIV.px * SIV.px + SIV.py * SIV.py);
 						//			if(dv>=max_dist-0.001) {max_dist=dv; max_pos=i;}
 						if (dv > max_dist + 0.001)
@@ -315,8 +336,8 @@ void Contour2::doug_peuck_sub2(float epsilon, std::vector<Point>* Pt_vec,
 							max_pos = i;
 						}
 					}
-					SIV.px = (*Pt_vec)[0].px - (*Pt_vec)[p1].px;
-					SIV.py = (*Pt_vec)[0].py - (*Pt_vec)[p1].py;
+					SIV.px = pts[0].px - pts[p1].px;
+					SIV.py = pts[0].py - pts[p1].py;
 					dv = float(SIV.px * SIV.px + SIV.py * SIV.py);
 					//			if(dv>=max_dist-0.001) {max_dist=dv; max_pos=i;}
 					if (dv > max_dist + 0.001)
@@ -327,8 +348,8 @@ void Contour2::doug_peuck_sub2(float epsilon, std::vector<Point>* Pt_vec,
 				}
 				for (unsigned int i = n - 1; i > p1; i--)
 				{
-					SIV.px = (*Pt_vec)[i].px - (*Pt_vec)[p1].px;
-					SIV.py = (*Pt_vec)[i].py - (*Pt_vec)[p1].py;
+					SIV.px = pts[i].px - pts[p1].px;
+					SIV.py = pts[i].py - pts[p1].py;
 					dv = float(SIV.px * SIV.px + SIV.py * SIV.py);
 					//			if(dv>=max_dist-0.001) {max_dist=dv; max_pos=i;}
 					if (dv > max_dist + 0.001)
@@ -339,52 +360,36 @@ void Contour2::doug_peuck_sub2(float epsilon, std::vector<Point>* Pt_vec,
 				}
 			}
 
-			if (max_dist > epsilon1)
-			{
-				if (max_pos < p2)
-				{
-					(*v1_p)[max_pos] = true;
-					doug_peuck_sub2(epsilon, Pt_vec, p1, max_pos, v1_p);
-					doug_peuck_sub(epsilon, Pt_vec, max_pos, p2, v1_p);
-				}
-				else
-				{
-					(*v1_p)[max_pos] = true;
-					doug_peuck_sub(epsilon, Pt_vec, p1, max_pos, v1_p);
-					doug_peuck_sub2(epsilon, Pt_vec, max_pos, p2, v1_p);
-				}
-			}
-
-			return;
+			return max_dist > epsilon1;
 		}
 		else
 		{
 			float epsilon1 = epsilon * epsilon;
 			if (p2 > 0)
 			{
-				SIV.px = (*Pt_vec)[0].px - (*Pt_vec)[p1].px;
-				SIV.py = (*Pt_vec)[0].py - (*Pt_vec)[p1].py;
+				SIV.px = pts[0].px - pts[p1].px;
+				SIV.py = pts[0].py - pts[p1].py;
 				dv = float(SIV.px * SIV.px + SIV.py * SIV.py);
 				if (dv > epsilon1)
-					(*v1_p)[0] = true;
+					marks[0] = true;
 			}
 			else
 			{
-				SIV.px = (*Pt_vec)[1].px - (*Pt_vec)[p1].px;
-				SIV.py = (*Pt_vec)[1].py - (*Pt_vec)[p1].py;
+				SIV.px = pts[1].px - pts[p1].px;
+				SIV.py = pts[1].py - pts[p1].py;
 				dv = float(SIV.px * SIV.px + SIV.py * SIV.py);
 				if (dv > epsilon1)
-					(*v1_p)[1] = true;
+					marks[1] = true;
 			}
-			return;
+			return false;
 		}
 	}
 
 	max_dist = 0;
-	unsigned int max_pos = p1;
+	max_pos = p1;
 
-	SIJ.px = (*Pt_vec)[p2].px - (*Pt_vec)[p1].px;
-	SIJ.py = (*Pt_vec)[p2].py - (*Pt_vec)[p1].py;
+	SIJ.px = pts[p2].px - pts[p1].px;
+	SIJ.py = pts[p2].py - pts[p1].py;
 
 	l = dist(&SIJ);
 
@@ -392,8 +397,8 @@ void Contour2::doug_peuck_sub2(float epsilon, std::vector<Point>* Pt_vec,
 	{
 		for (unsigned int i = p1 + 1; i < n; i++)
 		{
-			SIV.px = (*Pt_vec)[i].px - (*Pt_vec)[p1].px;
-			SIV.py = (*Pt_vec)[i].py - (*Pt_vec)[p1].py;
+			SIV.px = pts[i].px - pts[p1].px;
+			SIV.py = pts[i].py - pts[p1].py;
 			dv = cross(&SIV, &SIJ) / l;
 			//		if(dv>=max_dist-0.001) {max_dist=dv; max_pos=i;}
 			if (dv > max_dist + 0.001)
@@ -404,8 +409,8 @@ void Contour2::doug_peuck_sub2(float epsilon, std::vector<Point>* Pt_vec,
 		}
 		for (unsigned int i = 0; i < p2; i++)
 		{
-			SIV.px = (*Pt_vec)[i].px - (*Pt_vec)[p1].px;
-			SIV.py = (*Pt_vec)[i].py - (*Pt_vec)[p1].py;
+			SIV.px = pts[i].px - pts[p1].px;
+			SIV.py = pts[i].py - pts[p1].py;
 			dv = cross(&SIV, &SIJ) / l;
 			//		if(dv>=max_dist-0.001) {max_dist=dv; max_pos=i;}
 			if (dv > max_dist + 0.001)
@@ -421,8 +426,8 @@ void Contour2::doug_peuck_sub2(float epsilon, std::vector<Point>* Pt_vec,
 		{
 			for (unsigned int i = p2 - 1; i > 0; i--)
 			{
-				SIV.px = (*Pt_vec)[i].px - (*Pt_vec)[p1].px;
-				SIV.py = (*Pt_vec)[i].py - (*Pt_vec)[p1].py;
+				SIV.px = pts[i].px - pts[p1].px;
+				SIV.py = pts[i].py - pts[p1].py;
 				dv = cross(&SIV, &SIJ) / l;
 				//		if(dv>=max_dist-0.001) {max_dist=dv; max_pos=i;}
 				if (dv > max_dist + 0.001)
@@ -431,8 +436,8 @@ void Contour2::doug_peuck_sub2(float epsilon, std::vector<Point>* Pt_vec,
 					max_pos = i;
 				}
 			}
-			SIV.px = (*Pt_vec)[0].px - (*Pt_vec)[p1].px;
-			SIV.py = (*Pt_vec)[0].py - (*Pt_vec)[p1].py;
+			SIV.px = pts[0].px - pts[p1].px;
+			SIV.py = pts[0].py - pts[p1].py;
 			dv = cross(&SIV, &SIJ) / l;
 			//		if(dv>=max_dist-0.001) {max_dist=dv; max_pos=i;}
 			if (dv > max_dist + 0.001)
@@ -443,8 +448,8 @@ void Contour2::doug_peuck_sub2(float epsilon, std::vector<Point>* Pt_vec,
 		}
 		for (unsigned int i = n - 1; i > p1; i--)
 		{
-			SIV.px = (*Pt_vec)[i].px - (*Pt_vec)[p1].px;
-			SIV.py = (*Pt_vec)[i].py - (*Pt_vec)[p1].py;
+			SIV.px = pts[i].px - pts[p1].px;
+			SIV.py = pts[i].py - pts[p1].py;
 			dv = cross(&SIV, &SIJ) / l;
 			//		if(dv>=max_dist-0.001) {max_dist=dv; max_pos=i;}
 			if (dv > max_dist + 0.001)
@@ -455,21 +460,7 @@ void Contour2::doug_peuck_sub2(float epsilon, std::vector<Point>* Pt_vec,
 		}
 	}
 
-	if (max_dist > epsilon)
-	{
-		if (max_pos < p2)
-		{
-			(*v1_p)[max_pos] = true;
-			doug_peuck_sub2(epsilon, Pt_vec, p1, max_pos, v1_p);
-			doug_peuck_sub(epsilon, Pt_vec, max_pos, p2, v1_p);
-		}
-		else
-		{
-			(*v1_p)[max_pos] = true;
-			doug_peuck_sub(epsilon, Pt_vec, p1, max_pos, v1_p);
-			doug_peuck_sub2(epsilon, Pt_vec, max_pos, p2, v1_p);
-		}
-	}
+	return max_dist > epsilon;
 }
 
 } // namespace iseg
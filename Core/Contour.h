@@ -14,10 +14,28 @@
 #include "Data/Point.h"
 
 #include <iostream>
+#include <utility>
 #include <vector>
 
 namespace iseg {
 
+/** \brief Douglas-Peucker simplification of an open polyline
+
+	The first and last point are always kept. The segments are split
+	with an explicit stack instead of recursion, and the stack and
+	marks are kept between calls, so a simplifier which is reused for
+	many lines does not allocate once its buffers have grown.
+*/
+class ISEG_CORE_API PolylineSimplifier
+{
+public:
+	void simplify(std::vector<Point>& pts, float epsilon);
+
+private:
+	std::vector<unsigned char> _keep;
+	std::vector<std::pair<unsigned int, unsigned int>> _stack;
+};
+
 class ISEG_CORE_API Contour
 {
 public:
@@ -36,8 +54,6 @@ public:
 private:
 	unsigned int n;
 	std::vector<Point> plist;
-	void doug_peuck_sub(float epsilon, const unsigned int p1,
-						const unsigned int p2, std::vector<bool>* v1_p);
 };
 
 class ISEG_CORE_API Contour2
@@ -49,13 +65,21 @@ public:
 					std::vector<Point>* Result_vec);
 
 private:
+	struct Segment
+	{
+		unsigned int p1, p2;
+		/// segment runs from p1 over the end of the contour to p2
+		bool wraps;
+	};
+
 	unsigned int n;
 	unsigned int m;
-	void doug_peuck_sub(float epsilon, std::vector<Point>* Pt_vec,
-						unsigned short p1, unsigned short p2,
-						std::vector<bool>* v1_p);
-	void doug_peuck_sub2(float epsilon, std::vector<Point>* Pt_vec,
-						 unsigned short p1, unsigned short p2,
-						 std::vector<bool>* v1_p);
+	/// buffers are kept between calls, see PolylineSimplifier
+	std::vector<bool> marks;
+	std::vector<Segment> stack;
+	bool split(float epsilon, const std::vector<Point>& pts,
+			unsigned int p1, unsigned int p2, unsigned int& max_pos) const;
+	bool split_wrapped(float epsilon, const std::vector<Point>& pts,
+			unsigned int p1, unsigned int p2, unsigned int& max_pos);
 };
 } // namespace iseg
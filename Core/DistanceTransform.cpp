@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include "Precompiled.h"
+
+#include "DistanceTransform.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace iseg {
+
+namespace {
+class DistanceTransform1D
+{
+public:
+	explicit DistanceTransform1D(size_t n) : _f(n), _v(n), _z(n + 1), _nearest(n) {}
+
+	float* data() { return _f.data(); }
+
+	/// sample of the nearest finite input value after execute, -1 if there is none
+	const int* nearest() const { return _nearest.data(); }
+
+	/// transforms the n values in data() in place
+	void execute(int n, double spacing)
+	{
+		const float inf = std::numeric_limits<float>::infinity();
+		const double dinf = std::numeric_limits<double>::infinity();
+		float* f = _f.data();
+		int* v = _v.data();
+		double* z = _z.data();
+
+		// lower envelope of the parabolas rooted at the finite samples
+		int k = -1;
+		for (int q = 0; q < n; q++)
+		{
+			if (f[q] == inf)
+				continue;
+
+			const double xq = q * spacing;
+			const double hq = f[q] + xq * xq;
+			double s = -dinf;
+			while (k >= 0)
+			{
+				const double xv = v[k] * spacing;
+				s = (hq - (f[v[k]] + xv * xv)) / (2 * (xq - xv));
+				if (s > z[k])
+					break;
+				k--;
+			}
+			k++;
+			v[k] = q;
+			z[k] = (k == 0) ? -dinf : s;
+			z[k + 1] = dinf;
+		}
+
+		if (k < 0)
+		{
+			std::fill_n(_nearest.begin(), n, -1);
+			return;
+		}
+
+		// the envelope is evaluated into a copy, since it refers to the input samples
+		_d.resize(n);
+		k = 0;
+		for (int q = 0; q < n; q++)
+		{
+			const double xq = q * spacing;
+			while (z[k + 1] < xq)
+				k++;
+			const double dx = xq - v[k] * spacing;
+			_d[q] = static_cast<float>(dx * dx + f[v[k]]);
+			_nearest[q] = v[k];
+		}
+		std::copy(_d.begin(), _d.end(), f);
+	}
+
+private:
+	std::vector<float> _f;
+	std::vector<float> _d;
+	std::vector<int> _v;
+	std::vector<double> _z;
+	std::vector<int> _nearest;
+};
+} // namespace
+
+void squared_distance_transform(const std::vector<float*>& slices,
+		unsigned short width, unsigned short height, const float spacing[3])
+{
+	const int w = width;
+	const int h = height;
+	const int nz = static_cast<int>(slices.size());
+	if (w == 0 || h == 0 || nz == 0)
+		return;
+
+	// along x, the rows are transformed in place
+	const int nrows = nz * h;
+#pragma omp parallel
+	{
+		DistanceTransform1D dt(w);
+#pragma omp for
+		for (int r = 0; r < nrows; r++)
+		{
+			float* row = slices[r / h] + static_cast<size_t>(r % h) * w;
+			std::copy(row, row + w, dt.data());
+			dt.execute(w, spacing[0]);
+			std::copy(dt.data(), dt.data() + w, row);
+		}
+	}
+
+	// along y, column by column within a slice
+	if (h > 1)
+	{
+#pragma omp parallel
+		{
+			DistanceTransform1D dt(h);
+#pragma omp for
+			for (int z = 0; z < nz; z++)
+			{
+				float* slice = slices[z];
+				for (int x = 0; x < w; x++)
+				{
+					float* f = dt.data();
+					for (int y = 0; y < h; y++)
+						f[y] = slice[static_cast<size_t>(y) * w + x];
+					dt.execute(h, spacing[1]);
+					for (int y = 0; y < h; y++)
+						slice[static_cast<size_t>(y) * w + x] = f[y];
+				}
+			}
+		}
+	}
+
+	// along z, a row of every slice is gathered so the slices are read contiguously
+	if (nz > 1)
+	{
+#pragma omp parallel
+		{
+			DistanceTransform1D dt(nz);
+			std::vector<float> block(static_cast<size_t>(nz) * w);
+#pragma omp for
+			for (int y = 0; y < h; y++)
+			{
+				const size_t offset = static_cast<size_t>(y) * w;
+				for (int z = 0; z < nz; z++)
+					std::copy(slices[z] + offset, slices[z] + offset + w, block.begin() + static_cast<size_t>(z) * w);
+
+				for (int x = 0; x < w; x++)
+				{
+					float* f = dt.data();
+					for (int z = 0; z < nz; z++)
+						f[z] = block[static_cast<size_t>(z) * w + x];
+					dt.execute(nz, spacing[2]);
+					for (int z = 0; z < nz; z++)
+						block[static_cast<size_t>(z) * w + x] = f[z];
+				}
+
+				for (int z = 0; z < nz; z++)
+					std::copy(block.begin() + static_cast<size_t>(z) * w, block.begin() + static_cast<size_t>(z + 1) * w, slices[z] + offset);
+			}
+		}
+	}
+}
+
+void squared_distance_transform(float* image, unsigned short width, unsigned short height, unsigned* nearest)
+{
+	const int w = width;
+	const int h = height;
+	if (w == 0 || h == 0)
+		return;
+	const unsigned area = static_cast<unsigned>(w) * h;
+
+	// nearest feature pixel of each pixel within its row
+	std::vector<unsigned> row_nearest(nearest ? area : 0);
+
+#pragma omp parallel
+	{
+		DistanceTransform1D dt(w);
+#pragma omp for
+		for (int y = 0; y < h; y++)
+		{
+			float* row = image + static_cast<size_t>(y) * w;
+			std::copy(row, row + w, dt.data());
+			dt.execute(w, 1.0);
+			std::copy(dt.data(), dt.data() + w, row);
+			if (nearest)
+			{
+				const unsigned offset = static_cast<unsigned>(y) * w;
+				for (int x = 0; x < w; x++)
+					row_nearest[offset + x] = (dt.nearest()[x] < 0) ? area : offset + dt.nearest()[x];
+			}
+		}
+
+		DistanceTransform1D dt_y(h);
+#pragma omp for
+		for (int x = 0; x < w; x++)
+		{
+			float* f = dt_y.data();
+			for (int y = 0; y < h; y++)
+				f[y] = image[static_cast<size_t>(y) * w + x];
+			dt_y.execute(h, 1.0);
+			for (int y = 0; y < h; y++)
+				image[static_cast<size_t>(y) * w + x] = f[y];
+			if (nearest)
+			{
+				for (int y = 0; y < h; y++)
+					nearest[static_cast<unsigned>(y) * w + x] = (dt_y.nearest()[y] < 0) ? area : row_nearest[static_cast<unsigned>(dt_y.nearest()[y]) * w + x];
+			}
+		}
+	}
+}
+
+} // namespace iseg
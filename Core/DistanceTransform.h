@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#pragma once
+
+#include "iSegCore.h"
+
+#include <vector>
+
+namespace iseg {
+
+/** \brief Exact squared Euclidean distance transform of a stack of slices
+
+	Separable lower envelope of parabolas (Felzenszwalb & Huttenlocher),
+	computed along x, y and z in turn. Each pass runs in parallel over the
+	lines of the volume.
+
+	On input, voxels to which the distance is measured must be 0 and all
+	other voxels infinity. On output, each voxel holds the squared distance
+	to the nearest of these voxels, measured with the given voxel spacing
+	(infinity if there is none).
+*/
+ISEG_CORE_API void squared_distance_transform(const std::vector<float*>& slices,
+		unsigned short width, unsigned short height, const float spacing[3]);
+
+/** \brief Exact squared Euclidean distance transform of a single slice with unit spacing
+
+	Same convention as above. If \a nearest is not null, it receives for each
+	pixel the index of its nearest feature pixel (width*height if there is none).
+*/
+ISEG_CORE_API void squared_distance_transform(float* image,
+		unsigned short width, unsigned short height, unsigned* nearest = nullptr);
+
+} // namespace iseg
@@ -0,0 +1,293 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include "Precompiled.h"
+
+#include "HysteresisThreshold.h"
+
+#include <algorithm>
+
+#ifndef NO_OPENMP_SUPPORT
+#	include <omp.h>
+#endif
+
+namespace iseg {
+
+namespace {
+enum eLabel : unsigned char {
+	kOutside = 0,
+	kCandidate = 1,
+	kSeed = 2,
+	kReached = 3
+};
+
+inline bool reachable(unsigned char label)
+{
+	return label == kCandidate || label == kSeed;
+}
+} // namespace
+
+struct HysteresisThreshold::Slab
+{
+	int z0 = 0;
+	int z1 = 0;
+	bool has_prev = false;
+	bool has_next = false;
+	std::vector<unsigned char> labels;
+	// in-plane indices of reached voxels on the first/last slice, to be continued in the neighbor slab
+	std::vector<unsigned> to_prev;
+	std::vector<unsigned> to_next;
+	std::vector<unsigned> from_prev;
+	std::vector<unsigned> from_next;
+};
+
+HysteresisThreshold::HysteresisThreshold(float seed_low, float seed_high, float grow_low, float grow_high)
+		: _seed_low(std::max(seed_low, grow_low)), _seed_high(std::min(seed_high, grow_high)), _grow_low(grow_low), _grow_high(grow_high)
+{
+}
+
+void HysteresisThreshold::flood(Slab& slab, std::vector<size_t>& stack, unsigned short width, unsigned short height) const
+{
+	const size_t area = static_cast<size_t>(width) * height;
+	const size_t nz = static_cast<size_t>(slab.z1 - slab.z0);
+	unsigned char* labels = slab.labels.data();
+
+	auto visit = [&](size_t j) {
+		if (reachable(labels[j]))
+		{
+			labels[j] = kReached;
+			stack.push_back(j);
+		}
+	};
+
+	while (!stack.empty())
+	{
+		const size_t i = stack.back();
+		stack.pop_back();
+
+		const size_t z = i / area;
+		const size_t xy = i - z * area;
+		const size_t y = xy / width;
+		const size_t x = xy - y * width;
+
+		const bool left = x > 0;
+		const bool right = x + 1 < width;
+		const bool down = y > 0;
+		const bool up = y + 1 < height;
+
+		if (left)
+			visit(i - 1);
+		if (right)
+			visit(i + 1);
+		if (down)
+			visit(i - width);
+		if (up)
+			visit(i + width);
+		if (_full_connectivity)
+		{
+			if (left && down)
+				visit(i - width - 1);
+			if (right && down)
+				visit(i - width + 1);
+			if (left && up)
+				visit(i + width - 1);
+			if (right && up)
+				visit(i + width + 1);
+		}
+
+		if (_grow_across_slices)
+		{
+			if (z > 0)
+				visit(i - area);
+			else if (slab.has_prev)
+				slab.to_prev.push_back(static_cast<unsigned>(xy));
+
+			if (z + 1 < nz)
+				visit(i + area);
+			else if (slab.has_next)
+				slab.to_next.push_back(static_cast<unsigned>(xy));
+		}
+	}
+}
+
+void HysteresisThreshold::execute(const std::vector<const float*>& source, const std::vector<float*>& target,
+		unsigned short width, unsigned short height, float set_to) const
+{
+	const int nrslices = static_cast<int>(std::min(source.size(), target.size()));
+	const size_t area = static_cast<size_t>(width) * height;
+	if (nrslices == 0 || area == 0)
+		return;
+
+	// each slab is flooded by one thread, a few slabs per thread balance the load
+	int nrslabs = nrslices;
+	if (_grow_across_slices)
+	{
+#ifdef NO_OPENMP_SUPPORT
+		nrslabs = 1;
+#else
+		nrslabs = std::min(nrslices, 4 * omp_get_max_threads());
+#endif
+	}
+
+	std::vector<Slab> slabs(nrslabs);
+	for (int s = 0; s < nrslabs; s++)
+	{
+		slabs[s].z0 = static_cast<int>(static_cast<long long>(nrslices) * s / nrslabs);
+		slabs[s].z1 = static_cast<int>(static_cast<long long>(nrslices) * (s + 1) / nrslabs);
+		slabs[s].has_prev = _grow_across_slices && s > 0;
+		slabs[s].has_next = _grow_across_slices && s + 1 < nrslabs;
+	}
+
+	const float seed_low = _seed_low, seed_high = _seed_high;
+	const float grow_low = _grow_low, grow_high = _grow_high;
+
+#pragma omp parallel for schedule(dynamic)
+	for (int s = 0; s < nrslabs; s++)
+	{
+		Slab& slab = slabs[s];
+		slab.labels.resize((slab.z1 - slab.z0) * area);
+
+		// classify, written branch free so the compiler can vectorize it
+		for (int z = slab.z0; z < slab.z1; z++)
+		{
+			const float* src = source[z];
+			unsigned char* labels = slab.labels.data() + (z - slab.z0) * area;
+			for (size_t i = 0; i < area; i++)
+			{
+				const float v = src[i];
+				labels[i] = static_cast<unsigned char>((v >= grow_low) & (v <= grow_high)) +
+										static_cast<unsigned char>((v >= seed_low) & (v <= seed_high));
+			}
+		}
+
+		std::vector<size_t> stack;
+		for (size_t i = 0, n = slab.labels.size(); i < n; i++)
+		{
+			if (slab.labels[i] == kSeed)
+			{
+				slab.labels[i] = kReached;
+				stack.push_back(i);
+				flood(slab, stack, width, height);
+			}
+		}
+	}
+
+	// continue growth across slab boundaries until no slab changes
+	bool changed = _grow_across_slices;
+	while (changed)
+	{
+		changed = false;
+		for (int s = 0; s < nrslabs; s++)
+		{
+			if (s > 0)
+			{
+				slabs[s].from_prev.swap(slabs[s - 1].to_next);
+				slabs[s - 1].to_next.clear();
+			}
+			if (s + 1 < nrslabs)
+			{
+				slabs[s].from_next.swap(slabs[s + 1].to_prev);
+				slabs[s + 1].to_prev.clear();
+			}
+			changed |= !slabs[s].from_prev.empty() || !slabs[s].from_next.empty();
+		}
+		if (!changed)
+			break;
+
+#pragma omp parallel for schedule(dynamic)
+		for (int s = 0; s < nrslabs; s++)
+		{
+			Slab& slab = slabs[s];
+			const size_t last = (slab.z1 - slab.z0 - 1) * area;
+
+			std::vector<size_t> stack;
+			for (auto xy : slab.from_prev)
+			{
+				if (reachable(slab.labels[xy]))
+				{
+					slab.labels[xy] = kReached;
+					stack.push_back(xy);
+				}
+			}
+			for (auto xy : slab.from_next)
+			{
+				if (reachable(slab.labels[last + xy]))
+				{
+					slab.labels[last + xy] = kReached;
+					stack.push_back(last + xy);
+				}
+			}
+			slab.from_prev.clear();
+			slab.from_next.clear();
+
+			flood(slab, stack, width, height);
+		}
+	}
+
+#pragma omp parallel for schedule(dynamic)
+	for (int s = 0; s < nrslabs; s++)
+	{
+		const Slab& slab = slabs[s];
+		for (int z = slab.z0; z < slab.z1; z++)
+		{
+			float* dst = target[z];
+			const unsigned char* labels = slab.labels.data() + (z - slab.z0) * area;
+			for (size_t i = 0; i < area; i++)
+			{
+				dst[i] = (labels[i] == kReached) ? set_to : 0.f;
+			}
+		}
+	}
+}
+
+void HysteresisThreshold::threshold(const float* source, float* target, size_t n, const float* thresholds)
+{
+	const unsigned short nrlevels = static_cast<unsigned short>(thresholds[0]);
+	if (nrlevels == 0)
+		return;
+
+	const float leveldiff = 255.0f / nrlevels;
+	const float* t = thresholds + 1;
+
+	if (!std::is_sorted(t, t + nrlevels))
+	{
+		for (size_t i = 0; i < n; i++)
+		{
+			unsigned short j = 0;
+			while (j < nrlevels && source[i] > t[j])
+				j++;
+			target[i] = j * leveldiff;
+		}
+		return;
+	}
+
+	// for sorted thresholds the level is the number of exceeded thresholds
+	const size_t block = 1024;
+	unsigned short count[block];
+	for (size_t i0 = 0; i0 < n; i0 += block)
+	{
+		const size_t len = std::min(block, n - i0);
+		const float* src = source + i0;
+		std::fill(count, count + len, 0);
+		for (unsigned short j = 0; j < nrlevels; j++)
+		{
+			const float tj = t[j];
+			for (size_t i = 0; i < len; i++)
+			{
+				count[i] += static_cast<unsigned short>(src[i] > tj);
+			}
+		}
+		for (size_t i = 0; i < len; i++)
+		{
+			target[i0 + i] = count[i] * leveldiff;
+		}
+	}
+}
+
+} // namespace iseg
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#pragma once
+
+#include "iSegCore.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace iseg {
+
+/** \brief Threshold and hysteresis segmentation of a stack of slices
+
+	Voxels inside the seed band are segmented, and the segmentation grows
+	through voxels inside the growth band. The stack is split into slabs of
+	slices which are flooded in parallel; growth across slab boundaries is
+	exchanged between the slabs until no slab changes anymore.
+*/
+class ISEG_CORE_API HysteresisThreshold
+{
+public:
+	/// seeds: seed_low <= value <= seed_high, growth: grow_low <= value <= grow_high
+	HysteresisThreshold(float seed_low, float seed_high, float grow_low, float grow_high);
+
+	/// if true, also grow across in-plane diagonals
+	void set_connectivity(bool full) { _full_connectivity = full; }
+	/// if false, every slice is segmented on its own
+	void set_grow_across_slices(bool on) { _grow_across_slices = on; }
+
+	/// writes set_to into segmented voxels of target and 0 elsewhere
+	void execute(const std::vector<const float*>& source, const std::vector<float*>& target,
+			unsigned short width, unsigned short height, float set_to) const;
+
+	/// multi-level thresholding, see bmphandler::threshold
+	static void threshold(const float* source, float* target, size_t n, const float* thresholds);
+
+private:
+	struct Slab;
+
+	void flood(Slab& slab, std::vector<size_t>& stack, unsigned short width, unsigned short height) const;
+
+	float _seed_low;
+	float _seed_high;
+	float _grow_low;
+	float _grow_high;
+	bool _full_connectivity = false;
+	bool _grow_across_slices = true;
+};
+
+} // namespace iseg
@@ -11,6 +11,9 @@
 
 #include "IndexPriorityQueue.h"
 
+#include <cstdlib>
+#include <new>
+
 namespace iseg {
 
 IndexPriorityQueue::IndexPriorityQueue(unsigned size2, float* valuemap1)
@@ -307,6 +310,21 @@ void IndexPriorityQueue::print_queue()
 bool IndexPriorityQueue::empty() { return l == 0; }
 bool IndexPriorityQueue::in_queue(unsigned pos) { return indexmap[pos] != -1; }
 
+void IndexPriorityQueue::grow(unsigned size2, float* valuemap1)
+{
+	valuemap = valuemap1;
+	if (size2 > size1)
+	{
+		int* indexmap1 = (int*)realloc(indexmap, size2 * sizeof(int));
+		if (indexmap1 == nullptr)
+			throw std::bad_alloc();
+		indexmap = indexmap1;
+		for (unsigned i = size1; i < size2; i++)
+			indexmap[i] = -1;
+		size1 = size2;
+	}
+}
+
 IndexPriorityQueue::~IndexPriorityQueue()
 {
 	free(indexmap);
@@ -34,6 +34,8 @@ public:
 	bool empty();
 	void clear();
 	bool in_queue(unsigned pos);
+	/// enlarges the range of positions to size2, valuemap1 replaces the value map (e.g. after it was reallocated)
+	void grow(unsigned size2, float* valuemap1);
 	~IndexPriorityQueue();
 
 private:
@@ -11,6 +11,8 @@
 
 #include "Outline.h"
 
+#include "Contour.h"
+
 namespace iseg {
 
 void OutlineLine::add_point(Point_type P)
@@ -80,68 +82,13 @@ FILE* OutlineLine::read(FILE* fp)
 
 void OutlineLine::doug_peuck(float epsilon, bool /*closed*/)
 {
-	unsigned int n = (unsigned int)line.size();
-	if (n > 2)
-	{
-		std::vector<bool> v1;
-		v1.resize(n);
-
-		for (unsigned int i = 0; i < n; i++)
-			v1[i] = false;
-		v1[0] = true;
-		v1[n - 1] = true;
-		doug_peuck_sub(epsilon, 0, n - 1, &v1);
-
-		auto it = line.begin();
-		for (unsigned int i = 0; i < n; i++)
-		{
-			if (!v1[i])
-				it = line.erase(it);
-			else
-				it++;
-		}
-	}
-	return;
+	PolylineSimplifier simplifier;
+	doug_peuck(epsilon, simplifier);
 }
 
-void OutlineLine::doug_peuck_sub(float epsilon, const unsigned int p1,
-		const unsigned int p2, std::vector<bool>* v1_p)
+void OutlineLine::doug_peuck(float epsilon, PolylineSimplifier& simplifier)
 {
-	//	cout << p1<<" "<<p2<<endl;
-	if (p2 <= p1 + 1)
-		return;
-	float dv, l;
-	float max_dist = 0;
-	Point SIJ, SIV;
-	unsigned int max_pos = p1;
-
-	SIJ.px = line[p2].px - line[p1].px;
-	SIJ.py = line[p2].py - line[p1].py;
-
-	l = dist(&SIJ);
-
-	//	cout << l << endl;
-
-	for (unsigned int i = p1 + 1; i < p2; i++)
-	{
-		SIV.px = line[i].px - line[p1].px;
-		SIV.py = line[i].py - line[p1].py;
-		dv = cross(&SIV, &SIJ) / l;
-		//		cout << dv << ":";
-		if (dv > max_dist)
-		{
-			max_dist = dv;
-			max_pos = i;
-		}
-	}
-	//	cout << endl;
-
-	if (max_dist > epsilon)
-	{
-		(*v1_p)[max_pos] = true;
-		doug_peuck_sub(epsilon, p1, max_pos, v1_p);
-		doug_peuck_sub(epsilon, max_pos, p2, v1_p);
-	}
+	simplifier.simplify(line, epsilon);
 }
 
 void OutlineLine::shift_contour(int dx, int dy)
@@ -403,8 +350,9 @@ void OutlineSlice::set_thickness(float thick) { thickness = thick; }
 
 float OutlineSlice::get_thickness() { return thickness; }
 
-void OutlineSlice::doug_peuck(float epsilon, bool closed)
+void OutlineSlice::doug_peuck(float epsilon, bool /*closed*/)
 {
+	PolylineSimplifier simplifier;
 	TissueOutlineMap_type::iterator itTissue;
 	std::vector<OutlineLine>::iterator itOutline;
 	for (itTissue = outer_lines.begin(); itTissue != outer_lines.end();
@@ -413,7 +361,7 @@ void OutlineSlice::doug_peuck(float epsilon, bool closed)
 		for (itOutline = itTissue->second.begin();
 				 itOutline != itTissue->second.end(); ++itOutline)
 		{
-			itOutline->doug_peuck(epsilon, closed);
+			itOutline->doug_peuck(epsilon, simplifier);
 		}
 	}
 	for (itTissue = inner_lines.begin(); itTissue != inner_lines.end();
@@ -422,7 +370,7 @@ void OutlineSlice::doug_peuck(float epsilon, bool closed)
 		for (itOutline = itTissue->second.begin();
 				 itOutline != itTissue->second.end(); ++itOutline)
 		{
-			itOutline->doug_peuck(epsilon, closed);
+			itOutline->doug_peuck(epsilon, simplifier);
 		}
 	}
 }
@@ -694,8 +642,9 @@ Point_type2 OutlineSlices::get_pixelsize()
 
 void OutlineSlices::doug_peuck(float epsilon, bool closed)
 {
-	unsigned n = (unsigned)slices.size();
-	for (unsigned i = 0; i < n; i++)
+	int n = (int)slices.size();
+#pragma omp parallel for
+	for (int i = 0; i < n; i++)
 	{
 		slices[i].doug_peuck(epsilon, closed);
 	}
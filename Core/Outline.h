@@ -23,6 +23,8 @@
 
 namespace iseg {
 
+class PolylineSimplifier;
+
 typedef Point Point_type;
 struct Point_type2
 {
@@ -41,12 +43,12 @@ public:
 	FILE* print(FILE* fp);
 	FILE* read(FILE* fp);
 	void doug_peuck(float epsilon, bool closed);
+	/// reuses the buffers of simplifier, e.g. for all lines of a slice
+	void doug_peuck(float epsilon, PolylineSimplifier& simplifier);
 	void shift_contour(int dx, int dy);
 
 private:
 	std::vector<Point_type> line;
-	void doug_peuck_sub(float epsilon, const unsigned int p1,
-			const unsigned int p2, std::vector<bool>* v1_p);
 };
 
 class ISEG_CORE_API OutlineSlice
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include "Precompiled.h"
+
+#include "SliceResampler.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace iseg {
+
+namespace {
+// a position is inside if it rounds to a pixel of the image
+inline bool inside(double v, int n) { return v > -0.5 && v < n - 0.5; }
+
+struct NearestSampler
+{
+	template<typename T>
+	T operator()(const T* src, int w, int /* h */, double x, double y) const
+	{
+		return src[static_cast<size_t>(y + 0.5) * w + static_cast<int>(x + 0.5)];
+	}
+};
+
+struct LinearSampler
+{
+	float operator()(const float* src, int w, int h, double x, double y) const
+	{
+		x = std::min(std::max(x, 0.0), w - 1.0);
+		y = std::min(std::max(y, 0.0), h - 1.0);
+		const int x0 = static_cast<int>(x), y0 = static_cast<int>(y);
+		const int x1 = std::min(x0 + 1, w - 1), y1 = std::min(y0 + 1, h - 1);
+		const float fx = static_cast<float>(x - x0), fy = static_cast<float>(y - y0);
+
+		const float* r0 = src + static_cast<size_t>(y0) * w;
+		const float* r1 = src + static_cast<size_t>(y1) * w;
+		const float top = r0[x0] + fx * (r0[x1] - r0[x0]);
+		const float bottom = r1[x0] + fx * (r1[x1] - r1[x0]);
+		return top + fy * (bottom - top);
+	}
+};
+
+struct CubicSampler
+{
+	// Catmull-Rom weights
+	static void weights(float t, float wt[4])
+	{
+		const float t2 = t * t, t3 = t2 * t;
+		wt[0] = 0.5f * (-t3 + 2 * t2 - t);
+		wt[1] = 0.5f * (3 * t3 - 5 * t2 + 2);
+		wt[2] = 0.5f * (-3 * t3 + 4 * t2 + t);
+		wt[3] = 0.5f * (t3 - t2);
+	}
+
+	float operator()(const float* src, int w, int h, double x, double y) const
+	{
+		x = std::min(std::max(x, 0.0), w - 1.0);
+		y = std::min(std::max(y, 0.0), h - 1.0);
+		const int x0 = static_cast<int>(x), y0 = static_cast<int>(y);
+		float wx[4], wy[4];
+		weights(static_cast<float>(x - x0), wx);
+		weights(static_cast<float>(y - y0), wy);
+
+		int xi[4];
+		for (int i = 0; i < 4; i++)
+			xi[i] = std::min(std::max(x0 + i - 1, 0), w - 1);
+
+		float result = 0;
+		for (int j = 0; j < 4; j++)
+		{
+			const float* row = src + static_cast<size_t>(std::min(std::max(y0 + j - 1, 0), h - 1)) * w;
+			result += wy[j] * (wx[0] * row[xi[0]] + wx[1] * row[xi[1]] + wx[2] * row[xi[2]] + wx[3] * row[xi[3]]);
+		}
+		return result;
+	}
+};
+} // namespace
+
+SliceResampler::SliceResampler(const double matrix[9], unsigned short width, unsigned short height)
+		: _width(width), _height(height)
+{
+	std::copy(matrix, matrix + 9, _m);
+
+	_affine = (_m[6] == 0.0 && _m[7] == 0.0 && _m[8] != 0.0);
+	if (_affine)
+	{
+		for (int i = 0; i < 6; i++)
+			_m[i] /= _m[8];
+		_m[8] = 1.0;
+	}
+}
+
+template<typename T, typename TSampler>
+void SliceResampler::resample_rows(const T* src, T* dst, const TSampler& sampler) const
+{
+	const int w = _width;
+	const int h = _height;
+#pragma omp parallel
+	{
+		std::vector<double> sx(w), sy(w);
+#pragma omp for
+		for (int y = 0; y < h; y++)
+		{
+			const double a0 = _m[1] * y + _m[2];
+			const double b0 = _m[4] * y + _m[5];
+			if (_affine)
+			{
+				for (int x = 0; x < w; x++)
+				{
+					sx[x] = a0 + _m[0] * x;
+					sy[x] = b0 + _m[3] * x;
+				}
+			}
+			else
+			{
+				const double c0 = _m[7] * y + _m[8];
+				for (int x = 0; x < w; x++)
+				{
+					const double c = c0 + _m[6] * x;
+					sx[x] = (a0 + _m[0] * x) / c;
+					sy[x] = (b0 + _m[3] * x) / c;
+				}
+			}
+
+			T* row = dst + static_cast<size_t>(y) * w;
+			for (int x = 0; x < w; x++)
+			{
+				row[x] = (inside(sx[x], w) && inside(sy[x], h)) ? sampler(src, w, h, sx[x], sy[x]) : T(0);
+			}
+		}
+	}
+}
+
+void SliceResampler::resample(const float* src, float* dst, eInterpolation interpolation) const
+{
+	switch (interpolation)
+	{
+	case kLinear:
+		resample_rows(src, dst, LinearSampler());
+		break;
+	case kCubic:
+		resample_rows(src, dst, CubicSampler());
+		break;
+	default:
+		resample_rows(src, dst, NearestSampler());
+	}
+}
+
+void SliceResampler::resample(const tissues_size_t* src, tissues_size_t* dst) const
+{
+	resample_rows(src, dst, NearestSampler());
+}
+
+} // namespace iseg
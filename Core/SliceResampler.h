@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#pragma once
+
+#include "iSegCore.h"
+
+#include "Data/Types.h"
+
+namespace iseg {
+
+/** \brief Resamples a slice through a 2D homogeneous transform
+
+	The matrix (row major) maps each target pixel (x, y, 1) to its
+	position in the source image. Pixels which map outside of the
+	source image are set to 0. For affine matrices, the source positions
+	are linear along each row and no per-pixel division is needed. The
+	rows are processed in parallel.
+*/
+class ISEG_CORE_API SliceResampler
+{
+public:
+	enum eInterpolation {
+		kNearest = 0,
+		kLinear,
+		kCubic
+	};
+
+	SliceResampler(const double matrix[9], unsigned short width, unsigned short height);
+
+	bool is_affine() const { return _affine; }
+
+	void resample(const float* src, float* dst, eInterpolation interpolation) const;
+	/// labels are always resampled with nearest neighbor interpolation
+	void resample(const tissues_size_t* src, tissues_size_t* dst) const;
+
+private:
+	template<typename T, typename TSampler>
+	void resample_rows(const T* src, T* dst, const TSampler& sampler) const;
+
+	double _m[9];
+	bool _affine;
+	unsigned short _width;
+	unsigned short _height;
+};
+
+} // namespace iseg
@@ -0,0 +1,567 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include "Precompiled.h"
+
+#include "SliceStackStore.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
+
+namespace iseg {
+
+namespace {
+
+enum eCodec {
+	kConstant = 0,
+	kMask = 1,
+	kFloat = 2
+};
+
+inline uint32_t to_bits(float v)
+{
+	uint32_t b;
+	std::memcpy(&b, &v, sizeof(float));
+	return b;
+}
+
+inline float from_bits(uint32_t b)
+{
+	float v;
+	std::memcpy(&v, &b, sizeof(float));
+	return v;
+}
+
+void append_u32(std::vector<char>& out, uint32_t v)
+{
+	const char* p = reinterpret_cast<const char*>(&v);
+	out.insert(out.end(), p, p + sizeof(uint32_t));
+}
+
+uint32_t read_u32(const char* p)
+{
+	uint32_t v;
+	std::memcpy(&v, p, sizeof(uint32_t));
+	return v;
+}
+
+/// PackBits style run-length encoding: control byte c < 128 is followed by c+1 literals, else by one byte repeated c-125 times
+void encode_rle(const unsigned char* in, size_t n, std::vector<char>& out)
+{
+	size_t i = 0;
+	while (i < n)
+	{
+		size_t r = 1;
+		while (i + r < n && r < 130 && in[i + r] == in[i])
+			++r;
+
+		if (r >= 3)
+		{
+			out.push_back(static_cast<char>(125 + r));
+			out.push_back(static_cast<char>(in[i]));
+			i += r;
+		}
+		else
+		{
+			size_t start = i;
+			while (i < n && i - start < 128)
+			{
+				if (i + 2 < n && in[i] == in[i + 1] && in[i] == in[i + 2])
+					break;
+				++i;
+			}
+			out.push_back(static_cast<char>(i - start - 1));
+			out.insert(out.end(), in + start, in + i);
+		}
+	}
+}
+
+bool decode_rle(const char* in, size_t in_size, unsigned char* out, size_t n)
+{
+	size_t i = 0, o = 0;
+	while (i < in_size && o < n)
+	{
+		unsigned c = static_cast<unsigned char>(in[i++]);
+		if (c < 128)
+		{
+			size_t len = c + 1;
+			if (i + len > in_size || o + len > n)
+				return false;
+			std::memcpy(out + o, in + i, len);
+			i += len;
+			o += len;
+		}
+		else
+		{
+			size_t len = c - 125;
+			if (i >= in_size || o + len > n)
+				return false;
+			std::memset(out + o, static_cast<unsigned char>(in[i++]), len);
+			o += len;
+		}
+	}
+	return o == n;
+}
+
+inline int seek(FILE* fp, long long offset)
+{
+#ifdef _WIN32
+	return _fseeki64(fp, offset, SEEK_SET);
+#else
+	return fseeko(fp, static_cast<off_t>(offset), SEEK_SET);
+#endif
+}
+
+} // namespace
+
+std::vector<char> SliceStackStore::encode(const float* bits, size_t n)
+{
+	std::vector<char> code;
+	if (n == 0)
+	{
+		code.push_back(kConstant);
+		append_u32(code, 0);
+		return code;
+	}
+
+	// count distinct bit patterns, up to 3
+	const uint32_t v0 = to_bits(bits[0]);
+	uint32_t v1 = v0;
+	bool binary = true;
+	for (size_t i = 1; i < n; ++i)
+	{
+		uint32_t b = to_bits(bits[i]);
+		if (b != v0)
+		{
+			if (v1 == v0)
+			{
+				v1 = b;
+			}
+			else if (b != v1)
+			{
+				binary = false;
+				break;
+			}
+		}
+	}
+
+	if (binary && v1 == v0)
+	{
+		code.push_back(kConstant);
+		append_u32(code, v0);
+	}
+	else if (binary)
+	{
+		code.push_back(kMask);
+		append_u32(code, v0);
+		append_u32(code, v1);
+
+		std::vector<unsigned char> mask((n + 7) / 8, 0);
+		for (size_t i = 0; i < n; ++i)
+		{
+			if (to_bits(bits[i]) == v1)
+				mask[i / 8] |= static_cast<unsigned char>(1 << (i % 8));
+		}
+		encode_rle(mask.data(), mask.size(), code);
+	}
+	else
+	{
+		code.push_back(kFloat);
+
+		// xor with previous value, then split into byte planes
+		std::vector<unsigned char> planes(4 * n);
+		uint32_t prev = 0;
+		for (size_t i = 0; i < n; ++i)
+		{
+			uint32_t b = to_bits(bits[i]);
+			uint32_t d = b ^ prev;
+			prev = b;
+			planes[i] = static_cast<unsigned char>(d & 0xff);
+			planes[n + i] = static_cast<unsigned char>((d >> 8) & 0xff);
+			planes[2 * n + i] = static_cast<unsigned char>((d >> 16) & 0xff);
+			planes[3 * n + i] = static_cast<unsigned char>((d >> 24) & 0xff);
+		}
+		encode_rle(planes.data(), planes.size(), code);
+	}
+	code.shrink_to_fit();
+	return code;
+}
+
+bool SliceStackStore::decode(const std::vector<char>& code, float* bits, size_t n)
+{
+	if (code.empty())
+		return false;
+
+	switch (code[0])
+	{
+	case kConstant: {
+		if (code.size() < 5)
+			return false;
+		std::fill(bits, bits + n, from_bits(read_u32(&code[1])));
+		return true;
+	}
+	case kMask: {
+		if (code.size() < 9)
+			return false;
+		const float f0 = from_bits(read_u32(&code[1]));
+		const float f1 = from_bits(read_u32(&code[5]));
+		std::vector<unsigned char> mask((n + 7) / 8);
+		if (!decode_rle(&code[9], code.size() - 9, mask.data(), mask.size()))
+			return false;
+		for (size_t i = 0; i < n; ++i)
+		{
+			bits[i] = (mask[i / 8] & (1 << (i % 8))) ? f1 : f0;
+		}
+		return true;
+	}
+	case kFloat: {
+		std::vector<unsigned char> planes(4 * n);
+		if (!decode_rle(&code[1], code.size() - 1, planes.data(), planes.size()))
+			return false;
+		uint32_t prev = 0;
+		for (size_t i = 0; i < n; ++i)
+		{
+			uint32_t d = static_cast<uint32_t>(planes[i]) |
+									 (static_cast<uint32_t>(planes[n + i]) << 8) |
+									 (static_cast<uint32_t>(planes[2 * n + i]) << 16) |
+									 (static_cast<uint32_t>(planes[3 * n + i]) << 24);
+			prev ^= d;
+			bits[i] = from_bits(prev);
+		}
+		return true;
+	}
+	default:
+		return false;
+	}
+}
+
+SliceStackStore::SliceStackStore()
+		: _memory_budget(size_t(1) << 30)
+{
+}
+
+SliceStackStore::~SliceStackStore()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+		_queue.clear();
+	}
+	_queue_changed.notify_all();
+	if (_writer.joinable())
+	{
+		_writer.join();
+	}
+	if (_file)
+	{
+		fclose(_file);
+	}
+}
+
+void SliceStackStore::push(handle_type handle, const float* bits, size_t n, unsigned char mode)
+{
+	// compress outside of lock
+	auto data = std::make_shared<std::vector<char>>(encode(bits, n));
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_entries.count(handle))
+	{
+		erase(handle);
+	}
+
+	Entry& entry = _entries[handle];
+	entry.mode = mode;
+	entry.n = n;
+	entry.last_access = ++_access_counter;
+	entry.size = data->size();
+	entry.data = data;
+	_order.push_back(handle);
+	_memory_usage += entry.size;
+
+	spill();
+}
+
+bool SliceStackStore::get(handle_type handle, float* bits, size_t n, unsigned char& mode)
+{
+	Entry entry;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		auto it = _entries.find(handle);
+		if (it == _entries.end() || it->second.n != n)
+			return false;
+		it->second.last_access = ++_access_counter;
+		entry = it->second;
+	}
+
+	mode = entry.mode;
+	if (entry.data)
+	{
+		return decode(*entry.data, bits, n);
+	}
+
+	std::vector<char> code;
+	return read(entry, code) && decode(code, bits, n);
+}
+
+bool SliceStackStore::pop_back(float* bits, size_t n, unsigned char& mode)
+{
+	handle_type handle;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_order.empty())
+			return false;
+		handle = _order.back();
+	}
+	bool ok = get(handle, bits, n, mode);
+	remove(handle);
+	return ok;
+}
+
+bool SliceStackStore::remove(handle_type handle)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_entries.count(handle) == 0)
+		return false;
+	erase(handle);
+	return true;
+}
+
+bool SliceStackStore::contains(handle_type handle) const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _entries.count(handle) != 0;
+}
+
+bool SliceStackStore::set_mode(handle_type handle, unsigned char mode)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto it = _entries.find(handle);
+	if (it == _entries.end())
+		return false;
+	it->second.mode = mode;
+	return true;
+}
+
+void SliceStackStore::clear()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_queue.clear();
+	_queue_changed.wait(lock, [this] { return !_writing; });
+
+	_entries.clear();
+	_order.clear();
+	_memory_usage = 0;
+
+	if (_file)
+	{
+		std::lock_guard<std::mutex> file_lock(_file_mutex);
+		fclose(_file);
+		_file = nullptr;
+		_file_end = 0;
+		_free_extents.clear();
+	}
+}
+
+void SliceStackStore::set_memory_budget(size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_memory_budget = bytes;
+	spill();
+}
+
+size_t SliceStackStore::memory_usage() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _memory_usage;
+}
+
+size_t SliceStackStore::file_size() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return static_cast<size_t>(_file_end);
+}
+
+void SliceStackStore::flush()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_queue_changed.wait(lock, [this] { return _queue.empty() && !_writing; });
+}
+
+bool SliceStackStore::read(const Entry& entry, std::vector<char>& code)
+{
+	std::lock_guard<std::mutex> file_lock(_file_mutex);
+	if (!_file || entry.offset < 0)
+		return false;
+
+	code.resize(entry.size);
+	return seek(_file, entry.offset) == 0 &&
+				 fread(code.data(), 1, entry.size, _file) == entry.size;
+}
+
+void SliceStackStore::erase(handle_type handle)
+{
+	// called with _mutex locked
+	auto it = _entries.find(handle);
+	if (it->second.data && it->second.offset < 0)
+	{
+		_memory_usage -= it->second.size;
+	}
+	if (it->second.offset >= 0)
+	{
+		// a pending write to this extent is queued before any later write to it
+		release_extent(it->second.offset, it->second.size);
+	}
+	_entries.erase(it);
+	_order.erase(std::find(_order.begin(), _order.end(), handle));
+}
+
+long long SliceStackStore::allocate_extent(size_t size)
+{
+	// called with _mutex locked
+	for (auto it = _free_extents.begin(); it != _free_extents.end(); ++it)
+	{
+		if (it->second >= size)
+		{
+			long long offset = it->first;
+			size_t remaining = it->second - size;
+			_free_extents.erase(it);
+			if (remaining > 0)
+			{
+				_free_extents[offset + static_cast<long long>(size)] = remaining;
+			}
+			return offset;
+		}
+	}
+	long long offset = _file_end;
+	_file_end += static_cast<long long>(size);
+	return offset;
+}
+
+void SliceStackStore::release_extent(long long offset, size_t size)
+{
+	// called with _mutex locked
+	if (size == 0)
+		return;
+
+	auto next = _free_extents.lower_bound(offset);
+	if (next != _free_extents.end() && offset + static_cast<long long>(size) == next->first)
+	{
+		size += next->second;
+		next = _free_extents.erase(next);
+	}
+	if (next != _free_extents.begin())
+	{
+		auto prev = std::prev(next);
+		if (prev->first + static_cast<long long>(prev->second) == offset)
+		{
+			offset = prev->first;
+			size += prev->second;
+			_free_extents.erase(prev);
+		}
+	}
+
+	if (offset + static_cast<long long>(size) == _file_end)
+	{
+		// the file is not truncated, but the tail is reused first
+		_file_end = offset;
+	}
+	else
+	{
+		_free_extents[offset] = size;
+	}
+}
+
+void SliceStackStore::spill()
+{
+	// called with _mutex locked
+	while (_memory_usage > _memory_budget)
+	{
+		// least recently used entry, which is still in memory and not queued for writing
+		auto victim = _entries.end();
+		for (auto it = _entries.begin(); it != _entries.end(); ++it)
+		{
+			if (it->second.data && it->second.offset < 0 &&
+					(victim == _entries.end() || it->second.last_access < victim->second.last_access))
+			{
+				victim = it;
+			}
+		}
+		if (victim == _entries.end())
+			break;
+
+		if (!_file)
+		{
+			std::lock_guard<std::mutex> file_lock(_file_mutex);
+			_file = std::tmpfile();
+			_file_end = 0;
+			if (!_file)
+				break;
+		}
+		if (!_writer.joinable())
+		{
+			_writer = std::thread(&SliceStackStore::writer_loop, this);
+		}
+
+		Entry& entry = victim->second;
+		entry.offset = allocate_extent(entry.size);
+		_memory_usage -= entry.size;
+
+		WriteRequest request = {victim->first, entry.data, entry.offset};
+		_queue.push_back(request);
+		_queue_changed.notify_all();
+	}
+}
+
+void SliceStackStore::writer_loop()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (true)
+	{
+		_queue_changed.wait(lock, [this] { return _stop || !_queue.empty(); });
+		if (_stop)
+			break;
+
+		WriteRequest request = _queue.front();
+		_queue.pop_front();
+		_writing = true;
+		lock.unlock();
+
+		bool ok = false;
+		{
+			std::lock_guard<std::mutex> file_lock(_file_mutex);
+			ok = _file && seek(_file, request.offset) == 0 &&
+					 fwrite(request.data->data(), 1, request.data->size(), _file) == request.data->size();
+		}
+
+		lock.lock();
+		_writing = false;
+		auto it = _entries.find(request.handle);
+		if (it != _entries.end() && it->second.data == request.data)
+		{
+			if (ok)
+			{
+				// entry is now only on disk
+				it->second.data.reset();
+			}
+			else
+			{
+				// keep it in memory
+				release_extent(it->second.offset, it->second.size);
+				it->second.offset = -1;
+				_memory_usage += it->second.size;
+			}
+		}
+		_queue_changed.notify_all();
+	}
+}
+
+} // namespace iseg
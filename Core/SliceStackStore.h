@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#pragma once
+
+#include "iSegCore.h"
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace iseg {
+
+/** \brief Compressed store for the image stack (bitstack) entries
+
+	Entries are addressed by a handle and compressed losslessly on push:
+	constant images and binary masks (e.g. pushed tissues) are stored as
+	a value plus a run-length encoded bit mask, other images as xor-delta,
+	byte-shuffled and run-length encoded floats.
+
+	If the compressed entries exceed the memory budget, the least recently
+	used entries are written to a temporary file by a background thread.
+	Extents of removed entries are reused (first fit), so the file does not
+	grow beyond the largest amount of spilled data plus fragmentation.
+*/
+class ISEG_CORE_API SliceStackStore
+{
+public:
+	using handle_type = unsigned;
+
+	SliceStackStore();
+	~SliceStackStore();
+
+	/// compresses and stores a copy of bits, an existing entry with the same handle is replaced
+	void push(handle_type handle, const float* bits, size_t n, unsigned char mode);
+	/// decompresses entry into bits (which must hold n values)
+	bool get(handle_type handle, float* bits, size_t n, unsigned char& mode);
+	/// decompresses last pushed entry into bits and removes it
+	bool pop_back(float* bits, size_t n, unsigned char& mode);
+	bool remove(handle_type handle);
+	bool contains(handle_type handle) const;
+	bool set_mode(handle_type handle, unsigned char mode);
+	void clear();
+
+	bool empty() const { return _order.empty(); }
+	size_t size() const { return _order.size(); }
+	/// handles in order of insertion
+	const std::deque<handle_type>& handles() const { return _order; }
+
+	/// maximum size of the compressed entries kept in memory
+	void set_memory_budget(size_t bytes);
+	size_t memory_budget() const { return _memory_budget; }
+	/// size of the compressed entries currently held in memory
+	size_t memory_usage() const;
+	/// size of the spill file, including free extents
+	size_t file_size() const;
+
+	/// wait until pending writes to the spill file are done
+	void flush();
+
+	static std::vector<char> encode(const float* bits, size_t n);
+	static bool decode(const std::vector<char>& code, float* bits, size_t n);
+
+private:
+	using buffer_type = std::shared_ptr<std::vector<char>>;
+
+	struct Entry
+	{
+		unsigned char mode = 0;
+		size_t n = 0;
+		size_t last_access = 0;
+		buffer_type data; // nullptr if spilled
+		long long offset = -1;
+		size_t size = 0;
+	};
+
+	struct WriteRequest
+	{
+		handle_type handle;
+		buffer_type data;
+		long long offset;
+	};
+
+	bool read(const Entry& entry, std::vector<char>& code);
+	void erase(handle_type handle);
+	long long allocate_extent(size_t size);
+	void release_extent(long long offset, size_t size);
+	void spill();
+	void writer_loop();
+
+	std::map<handle_type, Entry> _entries;
+	std::deque<handle_type> _order;
+	size_t _access_counter = 0;
+	size_t _memory_usage = 0;
+	size_t _memory_budget;
+
+	mutable std::mutex _mutex;
+	std::mutex _file_mutex;
+	std::condition_variable _queue_changed;
+	std::deque<WriteRequest> _queue;
+	bool _writing = false;
+	bool _stop = false;
+	FILE* _file = nullptr;
+	long long _file_end = 0;
+	std::map<long long, size_t> _free_extents; // offset -> size
+	std::thread _writer;
+};
+
+} // namespace iseg
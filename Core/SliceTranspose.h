@@ -0,0 +1,368 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <utility>
+#include <vector>
+
+#ifdef _OPENMP
+#	include <omp.h>
+#endif
+
+namespace iseg {
+
+/// transposes a width x height image into dst (height x width), tile by tile
+template<typename T>
+void transpose_slice(const T* src, T* dst, unsigned width, unsigned height)
+{
+	const unsigned tile = 32;
+	for (unsigned y0 = 0; y0 < height; y0 += tile)
+	{
+		const unsigned y1 = std::min(height, y0 + tile);
+		for (unsigned x0 = 0; x0 < width; x0 += tile)
+		{
+			const unsigned x1 = std::min(width, x0 + tile);
+			for (unsigned y = y0; y < y1; y++)
+			{
+				const T* s = src + static_cast<size_t>(y) * width;
+				for (unsigned x = x0; x < x1; x++)
+				{
+					dst[static_cast<size_t>(x) * height + y] = s[x];
+				}
+			}
+		}
+	}
+}
+
+/// allocation function for reoriented slices, replaceable to test the recovery from allocation failures
+inline void* (*&slice_allocator())(size_t)
+{
+	static void* (*allocator)(size_t) = &malloc;
+	return allocator;
+}
+
+/// scratch memory for transpose_slices, one slice per thread
+template<typename T>
+std::vector<T> transpose_scratch(unsigned width, unsigned height)
+{
+#ifdef _OPENMP
+	const size_t threads = static_cast<size_t>(omp_get_max_threads());
+#else
+	const size_t threads = 1;
+#endif
+	return std::vector<T>(threads * width * height);
+}
+
+/// transposes x and y of every slice in place, the slices are processed in parallel
+template<typename T>
+void transpose_slices(const std::vector<T*>& slices, unsigned width, unsigned height, std::vector<T>& scratch)
+{
+	const size_t area = static_cast<size_t>(width) * height;
+	const int n = static_cast<int>(slices.size());
+#pragma omp parallel for
+	for (int z = 0; z < n; z++)
+	{
+#ifdef _OPENMP
+		T* buffer = scratch.data() + omp_get_thread_num() * area;
+#else
+		T* buffer = scratch.data();
+#endif
+		std::copy(slices[z], slices[z] + area, buffer);
+		transpose_slice(buffer, slices[z], width, height);
+	}
+}
+
+template<typename T>
+void transpose_slices(const std::vector<T*>& slices, unsigned width, unsigned height)
+{
+	auto scratch = transpose_scratch<T>(width, height);
+	transpose_slices(slices, width, height, scratch);
+}
+
+/// workspace for permute_rows, allocated before any row is moved
+template<typename T>
+struct RowPermutationWorkspace
+{
+	/// cycles longer than segment_length rows are split, 0 for about four segments per thread
+	RowPermutationWorkspace(size_t nrows, unsigned width, size_t segment_length = 0) : segment_length(segment_length), moved(nrows)
+	{
+#ifdef _OPENMP
+		threads = static_cast<size_t>(omp_get_max_threads());
+#else
+		threads = 1;
+#endif
+		if (segment_length == 0)
+			this->segment_length = std::max<size_t>(64, nrows / (4 * threads) + 1);
+		max_segments = 2 * (nrows / this->segment_length) + 1;
+		rows.reserve(nrows);
+		cycles.reserve(nrows / 2 + 1);
+		segments.reserve(max_segments);
+		buffer.resize((max_segments + threads) * width);
+	}
+
+	/// rows [begin,end) of a cycle, next is the position of the row following end in the cycle
+	struct Segment
+	{
+		size_t begin;
+		size_t end;
+		size_t next;
+	};
+
+	size_t segment_length;
+	size_t threads;
+	size_t max_segments;
+	std::vector<bool> moved;
+	std::vector<size_t> rows; // the rows of all cycles, each cycle in permutation order
+	std::vector<std::pair<size_t, size_t>> cycles; // cycles of at most segment_length rows
+	std::vector<Segment> segments; // parts of the longer cycles
+	std::vector<T> buffer; // one row per segment, then one row per thread
+};
+
+/** \brief Permutes the rows of a stack in place
+
+	Row r is moved to r*factor mod (nrows-1) by following the cycles of
+	the permutation. Rows are moved as a whole, i.e. every move copies a
+	contiguous row. The cycles are listed first. Short cycles are moved in
+	parallel, each with one buffered row. Long cycles are split into
+	segments, which are shifted in parallel after the first row of every
+	segment has been buffered. Does not allocate, so it cannot fail.
+*/
+template<typename T>
+void permute_rows(const std::vector<T*>& slices, unsigned width, unsigned height, size_t factor, RowPermutationWorkspace<T>& workspace)
+{
+	const size_t nrows = slices.size() * height;
+	if (nrows < 3)
+		return;
+
+	auto row = [&](size_t r) {
+		return slices[r / height] + (r % height) * width;
+	};
+
+	const size_t modulus = nrows - 1;
+	auto& moved = workspace.moved;
+	auto& rows = workspace.rows;
+	auto& cycles = workspace.cycles;
+	auto& segments = workspace.segments;
+	std::fill(moved.begin(), moved.end(), false);
+	rows.clear();
+	cycles.clear();
+	segments.clear();
+	for (size_t start = 1; start < modulus; start++)
+	{
+		if (moved[start])
+			continue;
+
+		const size_t begin = rows.size();
+		size_t r = start;
+		do
+		{
+			rows.push_back(r);
+			moved[r] = true;
+			r = (r * factor) % modulus;
+		} while (r != start);
+		const size_t end = rows.size();
+
+		if (end - begin == 1)
+		{
+			rows.pop_back();
+		}
+		else if (end - begin <= workspace.segment_length)
+		{
+			cycles.push_back(std::make_pair(begin, end));
+		}
+		else
+		{
+			for (size_t b = begin; b < end; b += workspace.segment_length)
+			{
+				const size_t e = std::min(end, b + workspace.segment_length);
+				segments.push_back({b, e, (e == end) ? begin : e});
+			}
+		}
+	}
+
+	const int nsegments = static_cast<int>(segments.size());
+	const int ncycles = static_cast<int>(cycles.size());
+	T* buffer = workspace.buffer.data();
+#pragma omp parallel
+	{
+		// the first row of a segment is overwritten by the previous segment
+#pragma omp for
+		for (int k = 0; k < nsegments; k++)
+		{
+			const T* first = row(rows[segments[k].begin]);
+			std::copy(first, first + width, buffer + k * width);
+		}
+
+		// new row(rows[i]) is old row(rows[i-1]), the segments are shifted back to front
+#pragma omp for schedule(dynamic)
+		for (int k = 0; k < nsegments; k++)
+		{
+			const auto& segment = segments[k];
+			for (size_t i = segment.end; i > segment.begin + 1; i--)
+			{
+				const T* src = row(rows[i - 1]);
+				std::copy(src, src + width, row(rows[i == segment.end ? segment.next : i]));
+			}
+			std::copy(buffer + k * width, buffer + (k + 1) * width, row(rows[segment.begin + 1 == segment.end ? segment.next : segment.begin + 1]));
+		}
+
+#ifdef _OPENMP
+		T* last = buffer + (workspace.max_segments + omp_get_thread_num()) * width;
+#else
+		T* last = buffer + workspace.max_segments * width;
+#endif
+#pragma omp for schedule(dynamic, 16)
+		for (int k = 0; k < ncycles; k++)
+		{
+			const size_t begin = cycles[k].first, end = cycles[k].second;
+			std::copy(row(rows[end - 1]), row(rows[end - 1]) + width, last);
+			for (size_t i = end - 1; i > begin; i--)
+			{
+				const T* src = row(rows[i - 1]);
+				std::copy(src, src + width, row(rows[i]));
+			}
+			std::copy(last, last + width, row(rows[begin]));
+		}
+	}
+}
+
+/** \brief Transposes the rows of a stack in place
+
+	The nrslices x height rows of width elements, stored height rows per
+	slice, are reordered to height x nrslices. The rows remain stored height
+	rows per slice, see repage_rows. Permuting with factor 'height' instead
+	of 'nrslices' is the inverse.
+*/
+template<typename T>
+void transpose_rows(const std::vector<T*>& slices, unsigned width, unsigned height)
+{
+	RowPermutationWorkspace<T> workspace(slices.size() * height, width);
+	permute_rows(slices, width, height, slices.size(), workspace);
+}
+
+/** \brief Regroups the rows of a stack into slices of another height
+
+	The slices are reallocated and the old slices are freed as soon as all
+	their rows are copied, so at most about two slices are allocated in
+	addition to the stack. Throws std::bad_alloc on failure, after restoring
+	the input slices: the restore walks back through the same allocation
+	sizes which already succeeded during the regrouping.
+*/
+template<typename T>
+std::vector<T*> repage_rows(std::vector<T*>& slices, unsigned width, unsigned height, unsigned new_height)
+{
+	const size_t nrows = slices.size() * height;
+	const size_t new_count = new_height ? nrows / new_height : 0;
+	std::vector<T*> result(new_count, nullptr);
+
+	size_t r = 0;
+	for (size_t k = 0; k < new_count; k++)
+	{
+		result[k] = static_cast<T*>(slice_allocator()(sizeof(T) * width * new_height));
+		if (result[k] == nullptr)
+		{
+			// rows [0,r) are in result[0,k), the old slices holding them are freed
+			for (size_t j = 0; j < slices.size() && slices[j] == nullptr; j++)
+			{
+				slices[j] = static_cast<T*>(slice_allocator()(sizeof(T) * width * height));
+				if (slices[j] == nullptr)
+				{
+					throw std::bad_alloc();
+				}
+				for (unsigned i = 0; i < height; i++)
+				{
+					size_t q = j * height + i;
+					memcpy(slices[j] + static_cast<size_t>(i) * width, result[q / new_height] + (q % new_height) * width, sizeof(T) * width);
+					if ((q + 1) % new_height == 0)
+					{
+						free(result[q / new_height]);
+						result[q / new_height] = nullptr;
+					}
+				}
+			}
+			for (size_t j = 0; j < k; j++)
+				free(result[j]);
+			throw std::bad_alloc();
+		}
+
+		for (unsigned i = 0; i < new_height; i++, r++)
+		{
+			memcpy(result[k] + static_cast<size_t>(i) * width, slices[r / height] + (r % height) * width, sizeof(T) * width);
+			if ((r + 1) % height == 0)
+			{
+				free(slices[r / height]);
+				slices[r / height] = nullptr;
+			}
+		}
+	}
+	slices.clear();
+	return result;
+}
+
+/** \brief Swaps two axes (0 for x, 1 for y, 2 for z) of a stack in place
+
+	Swapping x and z is done as x-y, y-z, x-y. On return, slices contains
+	the reoriented stack; if the number of slices or their size changes,
+	the slices are reallocated, see repage_rows.
+
+	All scratch memory is allocated before the stack is modified. If the
+	reallocation fails, the stack is restored and std::bad_alloc is thrown.
+*/
+template<typename T>
+void swap_axes(std::vector<T*>& slices, unsigned width, unsigned height, int axis1, int axis2)
+{
+	const unsigned nrslices = static_cast<unsigned>(slices.size());
+	switch (axis1 + axis2)
+	{
+	case 1: // x <-> y
+		transpose_slices(slices, width, height);
+		break;
+	case 3: // y <-> z
+	{
+		RowPermutationWorkspace<T> workspace(static_cast<size_t>(nrslices) * height, width);
+		permute_rows(slices, width, height, nrslices, workspace);
+		try
+		{
+			slices = repage_rows(slices, width, height, nrslices);
+		}
+		catch (std::bad_alloc&)
+		{
+			permute_rows(slices, width, height, height, workspace);
+			throw;
+		}
+		break;
+	}
+	case 2: // x <-> z
+	{
+		auto scratch = transpose_scratch<T>(height, std::max(width, nrslices));
+		RowPermutationWorkspace<T> workspace(static_cast<size_t>(nrslices) * width, height);
+		transpose_slices(slices, width, height, scratch);
+		permute_rows(slices, height, width, nrslices, workspace);
+		try
+		{
+			slices = repage_rows(slices, height, width, nrslices);
+		}
+		catch (std::bad_alloc&)
+		{
+			permute_rows(slices, height, width, width, workspace);
+			transpose_slices(slices, height, width, scratch);
+			throw;
+		}
+		transpose_slices(slices, height, nrslices, scratch);
+		break;
+	}
+	}
+}
+
+} // namespace iseg
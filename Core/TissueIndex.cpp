@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include "Precompiled.h"
+
+#include "TissueIndex.h"
+
+#include <algorithm>
+
+namespace iseg {
+
+void TissueIndex::build(const tissues_size_t* tissues, unsigned short width, unsigned short height)
+{
+	_entries.clear();
+	_valid = true;
+
+	const size_t area = static_cast<size_t>(width) * height;
+	if (area == 0)
+		return;
+
+	// dense tables over the range of tissue indices, compacted afterwards
+	const tissues_size_t max_tissue = *std::max_element(tissues, tissues + area);
+	std::vector<Entry> table(static_cast<size_t>(max_tissue) + 1);
+	for (auto& e : table)
+	{
+		e.count = 0;
+	}
+
+	for (unsigned short y = 0; y < height; y++)
+	{
+		const tissues_size_t* row = tissues + static_cast<size_t>(y) * width;
+		for (unsigned short x = 0; x < width; x++)
+		{
+			Entry& e = table[row[x]];
+			if (e.count++ == 0)
+			{
+				e.extent[0][0] = e.extent[0][1] = x;
+				e.extent[1][0] = e.extent[1][1] = y;
+			}
+			else
+			{
+				// rows are visited in order, so only x can decrease
+				e.extent[0][0] = std::min(e.extent[0][0], x);
+				e.extent[0][1] = std::max(e.extent[0][1], x);
+				e.extent[1][1] = y;
+			}
+		}
+	}
+
+	for (size_t t = 0; t < table.size(); t++)
+	{
+		if (table[t].count != 0)
+		{
+			table[t].tissue = static_cast<tissues_size_t>(t);
+			_entries.push_back(table[t]);
+		}
+	}
+}
+
+const TissueIndex::Entry* TissueIndex::find(tissues_size_t tissue) const
+{
+	auto it = std::lower_bound(_entries.begin(), _entries.end(), tissue,
+			[](const Entry& e, tissues_size_t t) { return e.tissue < t; });
+	return (it != _entries.end() && it->tissue == tissue) ? &(*it) : nullptr;
+}
+
+unsigned long TissueIndex::count(tissues_size_t tissue) const
+{
+	auto e = find(tissue);
+	return e ? e->count : 0;
+}
+
+bool TissueIndex::extent(tissues_size_t tissue, unsigned short extent[2][2]) const
+{
+	auto e = find(tissue);
+	if (e == nullptr)
+		return false;
+
+	extent[0][0] = e->extent[0][0];
+	extent[0][1] = e->extent[0][1];
+	extent[1][0] = e->extent[1][0];
+	extent[1][1] = e->extent[1][1];
+	return true;
+}
+
+std::vector<tissues_size_t> TissueIndex::tissues() const
+{
+	std::vector<tissues_size_t> result;
+	result.reserve(_entries.size());
+	for (const auto& e : _entries)
+	{
+		result.push_back(e.tissue);
+	}
+	return result;
+}
+
+void TissueIndex::replace(unsigned short x, unsigned short y, tissues_size_t old_value, tissues_size_t new_value)
+{
+	if (!_valid || old_value == new_value)
+		return;
+
+	auto old_entry = const_cast<Entry*>(find(old_value));
+	if (old_entry == nullptr)
+	{
+		_valid = false;
+		return;
+	}
+	if (--old_entry->count == 0)
+	{
+		_entries.erase(_entries.begin() + (old_entry - _entries.data()));
+	}
+	else if (x == old_entry->extent[0][0] || x == old_entry->extent[0][1] ||
+					 y == old_entry->extent[1][0] || y == old_entry->extent[1][1])
+	{
+		// the bounding box might shrink, which is only known after a rebuild
+		_valid = false;
+		return;
+	}
+
+	auto it = std::lower_bound(_entries.begin(), _entries.end(), new_value,
+			[](const Entry& e, tissues_size_t t) { return e.tissue < t; });
+	if (it != _entries.end() && it->tissue == new_value)
+	{
+		it->count++;
+		it->extent[0][0] = std::min(it->extent[0][0], x);
+		it->extent[0][1] = std::max(it->extent[0][1], x);
+		it->extent[1][0] = std::min(it->extent[1][0], y);
+		it->extent[1][1] = std::max(it->extent[1][1], y);
+	}
+	else
+	{
+		Entry e;
+		e.tissue = new_value;
+		e.count = 1;
+		e.extent[0][0] = e.extent[0][1] = x;
+		e.extent[1][0] = e.extent[1][1] = y;
+		_entries.insert(it, e);
+	}
+}
+
+} // namespace iseg
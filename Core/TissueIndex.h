@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#pragma once
+
+#include "iSegCore.h"
+
+#include "Data/Types.h"
+
+#include <vector>
+
+namespace iseg {
+
+/** \brief Voxel count and bounding box of each tissue present in a slice
+
+	Only tissues which occur in the slice are stored, sorted by tissue
+	index, so queries are a binary search. The index is built with a
+	single pass over the slice and can follow single voxel changes; any
+	other modification of the slice must invalidate it.
+*/
+class ISEG_CORE_API TissueIndex
+{
+public:
+	void build(const tissues_size_t* tissues, unsigned short width, unsigned short height);
+	void invalidate() { _valid = false; }
+	bool valid() const { return _valid; }
+
+	bool contains(tissues_size_t tissue) const { return find(tissue) != nullptr; }
+	unsigned long count(tissues_size_t tissue) const;
+	/// bounding box as extent[x|y][min|max], false if the tissue is not present
+	bool extent(tissues_size_t tissue, unsigned short extent[2][2]) const;
+	/// tissues with at least one voxel, in increasing order
+	std::vector<tissues_size_t> tissues() const;
+
+	/// updates the index for a voxel which changes from old_value to new_value
+	void replace(unsigned short x, unsigned short y, tissues_size_t old_value, tissues_size_t new_value);
+
+private:
+	struct Entry
+	{
+		tissues_size_t tissue;
+		unsigned long count;
+		unsigned short extent[2][2];
+	};
+
+	const Entry* find(tissues_size_t tissue) const;
+
+	std::vector<Entry> _entries;
+	bool _valid = false;
+};
+
+} // namespace iseg
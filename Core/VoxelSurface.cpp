@@ -15,26 +15,21 @@
 #include "Data/ImageToITK.h"
 
 #include <vtkBoundingBox.h>
-#include <vtkCutter.h>
-#include <vtkImageData.h>
-#include <vtkImageStencil.h>
-#include <vtkLinearExtrusionFilter.h>
+#include <vtkCellArray.h>
 #include <vtkNew.h>
-#include <vtkPlane.h>
-#include <vtkPointData.h>
 #include <vtkPoints.h>
 #include <vtkPolyData.h>
-#include <vtkPolyDataToImageStencil.h>
 #include <vtkSTLReader.h>
-#include <vtkStripper.h>
 #include <vtkTransform.h>
 #include <vtkTriangle.h>
-#include <vtkUnsignedCharArray.h>
 
 #include <itkPolyLineParametricPath.h>
 #include <itkPathIterator.h>
 #include <itkImage.h>
 
+#include <algorithm>
+#include <cmath>
+
 namespace iseg {
 
 namespace {
@@ -45,20 +40,10 @@ std::vector<double> to_double(const Transform& transform)
 	return std::vector<double>(begin, begin + 16);
 }
 
-float round_me_up(float n, const float to_what)
+/// floor(v) clamped to [lo, hi], also for v outside of the int range
+int floor_clamped(double v, int lo, int hi)
 {
-	n *= (1 / to_what);
-	n = ceil(n);
-	n /= (1 / to_what);
-	return n;
-}
-
-float round_me_dn(float n, const float to_what)
-{
-	n *= (1 / to_what);
-	n = floor(n);
-	n /= (1 / to_what);
-	return n;
+	return static_cast<int>(std::min(std::max(std::floor(v), double(lo)), double(hi)));
 }
 
 template<typename TImage>
@@ -133,9 +118,9 @@ VoxelSurface::eSurfaceImageOverlap voxelPolyline(const std::vector<itk::Point<do
 	return ret;
 }
 
-VoxelSurface::eSurfaceImageOverlap voxelSurface(vtkPolyData* surface, float** slices, const unsigned dims[3],
+VoxelSurface::eSurfaceImageOverlap triangulateSurface(vtkPolyData* surface, const unsigned dims[3],
 		const float spacing[3], const Transform& transform,
-		float label, unsigned startslice, unsigned endslice)
+		std::vector<double>& coords, std::vector<unsigned int>& triangles)
 {
 	// instead of applying the transform to the image, we inverse transform the surface
 	auto m = to_double(transform);
@@ -167,135 +152,38 @@ VoxelSurface::eSurfaceImageOverlap voxelSurface(vtkPolyData* surface, float** sl
 		return VoxelSurface::eSurfaceImageOverlap::kNone;
 	}
 
-	vtkNew<vtkPolyData> surface_inverse_transformed;
-	surface_inverse_transformed->CopyStructure(surface);
-	surface_inverse_transformed->SetPoints(points.Get());
-	surface_inverse_transformed->BuildCells();
-
-	// loop through all the slices in the dataset
-	int zbegin = static_cast<int>(startslice);
-	int zend = static_cast<int>(endslice);
-
-	//#pragma omp parallel for -> leads to crashes, because input->GetBounds is called in Cutter
-	for (int z = zbegin; z < zend; z++)
+	vtkIdType const num_points = points->GetNumberOfPoints();
+	coords.resize(3 * num_points);
+	for (vtkIdType i = 0; i < num_points; ++i)
 	{
-		// REMEMBER: image is NOT transformed
-		auto zPos = z * spacing[2];
-
-		// do not even try cutting if we are out of the surface bounding box
-		if (zPos < surface_bb.GetBound(4) || zPos > surface_bb.GetBound(5))
-			continue;
-
-		// place the cutter plane
-		vtkNew<vtkPlane> plane;
-		plane->SetNormal(0, 0, 1);
-		plane->SetOrigin(0, 0, zPos);
-
-		// cut the surface with the plane
-		vtkNew<vtkCutter> cutter;
-		cutter->SetCutFunction(plane.Get());
-		cutter->SetInputData(surface_inverse_transformed.Get());
-
-		// extract the contour from the plane
-		vtkNew<vtkStripper> stripper;
-		stripper->SetInputConnection(cutter->GetOutputPort()); // valid circle
-		stripper->Update();
-
-		vtkPolyData* contour = stripper->GetOutput();
+		points->GetPoint(i, &coords[3 * i]);
+	}
 
-		// check whether there is any contour
-		auto c_numberOfLines = contour->GetNumberOfLines();
-		if (c_numberOfLines > 0)
+	// polygons are split into triangle fans
+	vtkIdType npts, *pts;
+	vtkCellArray* polys = surface->GetPolys();
+	triangles.clear();
+	for (polys->InitTraversal(); polys->GetNextCell(npts, pts);)
+	{
+		for (vtkIdType i = 2; i < npts; ++i)
 		{
-			// create a 2D black image of the same size of the contour
-			vtkNew<vtkImageData> imageData;
-
-			vtkBoundingBox ct_bounds;
-			{
-				// enlarge the bounding box of the contour to fit the indices of the dataset
-				double bb[6];
-				contour->GetBounds(bb);
-				bb[0] = round_me_dn(bb[0], spacing[0]);
-				bb[1] = round_me_up(bb[1], spacing[0]);
-				bb[2] = round_me_dn(bb[2], spacing[1]);
-				bb[3] = round_me_up(bb[3], spacing[1]);
-				ct_bounds.SetBounds(bb);
-			}
-			// crop if surface is partially outside image
-			ct_bounds.IntersectBox(image_bb);
-			int ct_dim[3] = {};
-			for (int d = 0; d < 3; d++)
-			{
-				ct_dim[d] = static_cast<int>(std::ceil(ct_bounds.GetLength(d) / spacing[d])) + 1;
-			}
-			const double* ct_origin = ct_bounds.GetMinPoint();
-
-			imageData->SetDimensions(ct_dim[0], ct_dim[1], 1);
-			imageData->SetSpacing(spacing[0], spacing[1], spacing[2]);
-			imageData->SetOrigin(ct_origin[0], ct_origin[1], ct_origin[2]);
-			imageData->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
-			vtkUnsignedCharArray* scalars = vtkUnsignedCharArray::SafeDownCast(imageData->GetPointData()->GetScalars());
-
-			// Fill the image with foreground voxel values
-			unsigned char inval = 255;
-			unsigned char outval = 0;
-			scalars->FillComponent(0, inval);
-
-			// Take the Contour PolyData and fill it
-			// Sweep polygonal data (this is the important thing with contours!)
-			vtkNew<vtkLinearExtrusionFilter> extruder;
-			extruder->SetInputData(contour);
-			extruder->SetScaleFactor(1.);
-			extruder->SetExtrusionTypeToNormalExtrusion();
-			extruder->SetVector(0, 0, 1);
-			extruder->Update();
-
-			// polygonal data --> image stencil:
-			vtkNew<vtkPolyDataToImageStencil> pol2stenc;
-			pol2stenc->SetTolerance(0); // important if extruder->SetVector(0, 0, 1) !!!
-			pol2stenc->SetInputConnection(extruder->GetOutputPort());
-			pol2stenc->SetOutputOrigin(imageData->GetOrigin());
-			pol2stenc->SetOutputSpacing(imageData->GetSpacing());
-			pol2stenc->SetOutputWholeExtent(imageData->GetExtent());
-			pol2stenc->Update();
-
-			// Paste the Contour PolyData on the black image
-			// Cut the corresponding white image and set the background:
-			vtkNew<vtkImageStencil> imgstenc;
-			imgstenc->SetInputData(imageData.Get());
-			imgstenc->SetStencilConnection(pol2stenc->GetOutputPort());
-			imgstenc->ReverseStencilOff();
-			imgstenc->SetBackgroundValue(outval);
-			imgstenc->Update();
-
-			// Add or overwrite the white pixels in the working array
-			vtkImageData* out = imgstenc->GetOutput();
-			float* workBits = slices[z];
-			if (out->GetNumberOfPoints() > 0)
-			{
-				int offset_x = (int)floor(abs(ct_origin[0] / spacing[0]) + 0.5);
-				int offset_y = (int)floor(abs(ct_origin[1] / spacing[1]) + 0.5);
-
-				for (int ct_y = 0; ct_y < ct_dim[1] - 1; ct_y++)
-				{
-					for (int ct_x = 0; ct_x < ct_dim[0] - 1; ct_x++)
-					{
-						unsigned char* pixel_val = static_cast<unsigned char*>(out->GetScalarPointer(ct_x, ct_y, 0));
-						if (pixel_val[0] == inval)
-						{
-							// Convert the relative x,y from the contour to the x,y of the dataset
-							int ds_x = offset_x + ct_x;
-							int ds_y = offset_y + ct_y;
-
-							int index = ds_x + ds_y * (dims[0]);
-							workBits[index] = label;
-						}
-					}
-				}
-			}
+			triangles.push_back(static_cast<unsigned int>(pts[0]));
+			triangles.push_back(static_cast<unsigned int>(pts[i - 1]));
+			triangles.push_back(static_cast<unsigned int>(pts[i]));
 		}
 	}
 
+	// triangle strips, the orientation does not matter for the even-odd rule
+	vtkCellArray* strips = surface->GetStrips();
+	for (strips->InitTraversal(); strips->GetNextCell(npts, pts);)
+	{
+		for (vtkIdType i = 2; i < npts; ++i)
+		{
+			triangles.push_back(static_cast<unsigned int>(pts[i - 2]));
+			triangles.push_back(static_cast<unsigned int>(pts[i - 1]));
+			triangles.push_back(static_cast<unsigned int>(pts[i]));
+		}
+	}
 	return result;
 }
 
@@ -307,9 +195,15 @@ VoxelSurface::eSurfaceImageOverlap VoxelSurface::Voxelize(vtkPolyData* polydata,
 		unsigned startslice, unsigned endslice) const
 {
 	eSurfaceImageOverlap res = kNone;
-	if (polydata->GetNumberOfPolys() != 0)
+	if (polydata->GetNumberOfPolys() != 0 || polydata->GetNumberOfStrips() != 0)
 	{
-		return voxelSurface(polydata, all_slices.data(), dims, spacing.v, transform, m_ForeGroundValue, startslice, endslice);
+		std::vector<double> points;
+		std::vector<unsigned int> triangles;
+		res = triangulateSurface(polydata, dims, spacing.v, transform, points, triangles);
+		if (res != kNone)
+		{
+			VoxelizeTriangles(points, triangles, all_slices, dims, spacing, startslice, endslice);
+		}
 	}
 	else if (polydata->GetNumberOfLines() != 0)
 	{
@@ -331,6 +225,160 @@ VoxelSurface::eSurfaceImageOverlap VoxelSurface::Voxelize(vtkPolyData* polydata,
 	return res;
 }
 
+void VoxelSurface::VoxelizeTriangles(const std::vector<double>& points,
+		const std::vector<unsigned int>& triangles,
+		std::vector<float*>& all_slices, const unsigned dims[3],
+		const Vec3& spacing, unsigned startslice, unsigned endslice) const
+{
+	// segment where a triangle crosses the slice plane, with y0 <= y1
+	struct Segment
+	{
+		double x0, y0, x1, y1;
+	};
+
+	int const zbegin = static_cast<int>(startslice);
+	int const zend = std::min(static_cast<int>(endslice), static_cast<int>(dims[2]));
+	int const width = static_cast<int>(dims[0]);
+	int const height = static_cast<int>(dims[1]);
+	double const dx = spacing[0], dy = spacing[1], dz = spacing[2];
+	if (zbegin >= zend || width == 0 || height == 0)
+		return;
+
+	// bin the triangles by the slices they may cross (compressed rows)
+	size_t const num_triangles = triangles.size() / 3;
+	std::vector<int> tri_range(2 * num_triangles);
+	std::vector<size_t> slice_offset(zend - zbegin + 1, 0);
+	for (size_t t = 0; t < num_triangles; ++t)
+	{
+		double zmin = points[3 * triangles[3 * t] + 2], zmax = zmin;
+		for (int k = 1; k < 3; ++k)
+		{
+			double const z = points[3 * triangles[3 * t + k] + 2];
+			zmin = std::min(zmin, z);
+			zmax = std::max(zmax, z);
+		}
+		// conservative, the exact test is done per slice
+		int const k0 = floor_clamped(zmin / dz, zbegin, zend);
+		int const k1 = floor_clamped(zmax / dz + 1, zbegin - 1, zend - 1);
+		tri_range[2 * t] = k0;
+		tri_range[2 * t + 1] = k1;
+		for (int k = k0; k <= k1; ++k)
+			slice_offset[k - zbegin + 1]++;
+	}
+	for (size_t i = 1; i < slice_offset.size(); ++i)
+		slice_offset[i] += slice_offset[i - 1];
+
+	std::vector<unsigned int> slice_triangles(slice_offset.back());
+	{
+		std::vector<size_t> fill(slice_offset.begin(), slice_offset.end() - 1);
+		for (size_t t = 0; t < num_triangles; ++t)
+		{
+			for (int k = tri_range[2 * t]; k <= tri_range[2 * t + 1]; ++k)
+				slice_triangles[fill[k - zbegin]++] = static_cast<unsigned int>(t);
+		}
+	}
+
+	float const label = m_ForeGroundValue;
+
+#pragma omp parallel
+	{
+		std::vector<Segment> segments;
+		std::vector<size_t> row_offset;
+		std::vector<unsigned int> row_segments;
+		std::vector<double> crossings;
+
+#pragma omp for schedule(dynamic)
+		for (int z = zbegin; z < zend; ++z)
+		{
+			double const zpos = z * dz;
+
+			// a vertex with z >= zpos is above the plane. The intersection with
+			// an edge is computed from its lower point index, so neighboring
+			// triangles produce the same end points.
+			segments.clear();
+			for (size_t i = slice_offset[z - zbegin]; i < slice_offset[z - zbegin + 1]; ++i)
+			{
+				const unsigned int* tri = &triangles[3 * slice_triangles[i]];
+				double cut[2][2];
+				int ncut = 0;
+				for (int k = 0; k < 3; ++k)
+				{
+					unsigned int a = tri[k], b = tri[(k + 1) % 3];
+					if ((points[3 * a + 2] >= zpos) == (points[3 * b + 2] >= zpos))
+						continue;
+					if (b < a)
+						std::swap(a, b);
+					const double* pa = &points[3 * a];
+					const double* pb = &points[3 * b];
+					double const s = (zpos - pa[2]) / (pb[2] - pa[2]);
+					cut[ncut][0] = pa[0] + s * (pb[0] - pa[0]);
+					cut[ncut][1] = pa[1] + s * (pb[1] - pa[1]);
+					ncut++;
+				}
+				if (ncut == 2)
+				{
+					int const lo = (cut[0][1] <= cut[1][1]) ? 0 : 1;
+					Segment seg = {cut[lo][0], cut[lo][1], cut[1 - lo][0], cut[1 - lo][1]};
+					segments.push_back(seg);
+				}
+			}
+			if (segments.empty())
+				continue;
+
+			// bin the segments by the rows they may cross
+			row_offset.assign(height + 1, 0);
+			for (const auto& seg : segments)
+			{
+				int const j0 = floor_clamped(seg.y0 / dy, 0, height);
+				int const j1 = floor_clamped(seg.y1 / dy + 1, -1, height - 1);
+				for (int j = j0; j <= j1; ++j)
+					row_offset[j + 1]++;
+			}
+			for (int j = 0; j < height; ++j)
+				row_offset[j + 1] += row_offset[j];
+			row_segments.resize(row_offset[height]);
+			for (size_t i = 0; i < segments.size(); ++i)
+			{
+				int const j0 = floor_clamped(segments[i].y0 / dy, 0, height);
+				int const j1 = floor_clamped(segments[i].y1 / dy + 1, -1, height - 1);
+				for (int j = j0; j <= j1; ++j)
+					row_segments[row_offset[j]++] = static_cast<unsigned int>(i);
+			}
+			// row_offset[j] now points to the end of row j
+			for (int j = height; j > 0; --j)
+				row_offset[j] = row_offset[j - 1];
+			row_offset[0] = 0;
+
+			float* slice = all_slices[z];
+			for (int j = 0; j < height; ++j)
+			{
+				double const ypos = j * dy;
+				crossings.clear();
+				for (size_t i = row_offset[j]; i < row_offset[j + 1]; ++i)
+				{
+					const Segment& seg = segments[row_segments[i]];
+					// half-open, so a row through a shared end point is counted once
+					if (seg.y0 < ypos && ypos <= seg.y1)
+					{
+						crossings.push_back(seg.x0 + (ypos - seg.y0) * (seg.x1 - seg.x0) / (seg.y1 - seg.y0));
+					}
+				}
+				std::sort(crossings.begin(), crossings.end());
+
+				// even-odd rule: fill voxel centers in [crossings[2k], crossings[2k+1])
+				float* row = slice + static_cast<size_t>(j) * width;
+				for (size_t c = 0; c + 1 < crossings.size(); c += 2)
+				{
+					int const i0 = -floor_clamped(-crossings[c] / dx, -width, 0);
+					int const i1 = -floor_clamped(-crossings[c + 1] / dx, -width, 0);
+					for (int i = i0; i < i1; ++i)
+						row[i] = label;
+				}
+			}
+		}
+	}
+}
+
 VoxelSurface::eSurfaceImageOverlap VoxelSurface::Intersect(vtkPolyData* surface, 
 		std::vector<float*>& all_slices, const unsigned dims[3], 
 		const Vec3& spacing, const Transform& transform, 
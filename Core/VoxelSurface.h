@@ -37,6 +37,20 @@ public:
 			const Vec3& spacing, const Transform& transform,
 			unsigned startslice, unsigned endslice) const;
 
+	/** \brief Fills the voxels whose center is inside a closed triangle mesh
+
+		The points (x,y,z interleaved) are given in image coordinates, i.e.
+		without the image transform, and each triangle is given by three
+		point indices. The even-odd rule is used, so nested shells leave
+		holes. Triangles are binned by slice and the intersection segments
+		by row, so each slice only touches the triangles which cross it.
+		The slices are filled in parallel.
+	*/
+	void VoxelizeTriangles(const std::vector<double>& points,
+			const std::vector<unsigned int>& triangles,
+			std::vector<float*>& all_slices, const unsigned dims[3],
+			const Vec3& spacing, unsigned startslice, unsigned endslice) const;
+
 	eSurfaceImageOverlap Intersect(vtkPolyData* surface, 
 			std::vector<float*>& all_slices, const unsigned dims[3],
 			const Vec3& spacing, const Transform& transform,
@@ -0,0 +1,419 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include "Precompiled.h"
+
+#include "WatershedMergeTree.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+#ifndef NO_OPENMP_SUPPORT
+#	include <omp.h>
+#endif
+
+namespace iseg {
+
+namespace {
+const unsigned unvisited_basin = std::numeric_limits<unsigned>::max();
+
+inline unsigned find_root(std::vector<unsigned>& parent, unsigned k)
+{
+	while (parent[k] != k)
+	{
+		parent[k] = parent[parent[k]];
+		k = parent[k];
+	}
+	return k;
+}
+
+/// position of a voxel in the flooding order, i.e. by grey level and then by index
+inline unsigned long long flood_key(unsigned char g, size_t p)
+{
+	return (static_cast<unsigned long long>(g) << 32) | p;
+}
+
+struct MergeEvent
+{
+	unsigned k;
+	unsigned a;
+	unsigned char g;
+	unsigned long long key; // voxel at which the basins meet
+};
+
+/// basins and merges of a slab of slices [z0, z1), flooded without its neighbor slabs
+struct Slab
+{
+	int z0;
+	int z1;
+	std::vector<unsigned long long> basin_key; // key of the first voxel, in order of creation
+	std::vector<unsigned char> depth;
+	std::vector<MergeEvent> merges; // with local basin ids
+	std::vector<unsigned> global_id;
+};
+
+void flood_slab(Slab& slab, const std::vector<unsigned char>& level, unsigned* basin,
+		unsigned short width, unsigned short height, bool connectivity)
+{
+	const size_t area = static_cast<size_t>(width) * height;
+	const size_t begin = slab.z0 * area;
+	const size_t n = (slab.z1 - slab.z0) * area;
+
+	// counting sort, stable so voxels of equal level stay in index order
+	size_t offsets[256] = {0};
+	for (size_t i = begin; i < begin + n; i++)
+		offsets[level[i]]++;
+	size_t offset = 0;
+	for (int g = 0; g < 256; g++)
+	{
+		size_t count = offsets[g];
+		offsets[g] = offset;
+		offset += count;
+	}
+	std::vector<unsigned> sorted(n);
+	for (size_t i = begin; i < begin + n; i++)
+		sorted[offsets[level[i]]++] = static_cast<unsigned>(i);
+
+	// flood in order of increasing grey level, the basins are joined by union-find
+	std::fill(basin + begin, basin + begin + n, unvisited_basin);
+	std::vector<unsigned> parent;
+	unsigned roots[26], raw[26];
+	int nroots = 0;
+
+	auto consider = [&](size_t q) {
+		unsigned b = basin[q];
+		if (b != unvisited_basin)
+		{
+			unsigned r = find_root(parent, b);
+			for (int j = 0; j < nroots; j++)
+			{
+				if (roots[j] == r)
+					return;
+			}
+			roots[nroots] = r;
+			raw[nroots] = b;
+			nroots++;
+		}
+	};
+
+	const size_t z0 = slab.z0, z1 = slab.z1;
+	for (size_t s = 0; s < n; s++)
+	{
+		const size_t p = sorted[s];
+		const unsigned char g = level[p];
+		const size_t z = p / area;
+		const size_t xy = p - z * area;
+		const size_t y = xy / width;
+		const size_t x = xy - y * width;
+
+		nroots = 0;
+		if (connectivity)
+		{
+			for (int dz = -1; dz <= 1; dz++)
+			{
+				if ((dz < 0 && z == z0) || (dz > 0 && z + 1 == z1))
+					continue;
+				for (int dy = -1; dy <= 1; dy++)
+				{
+					if ((dy < 0 && y == 0) || (dy > 0 && y + 1 == height))
+						continue;
+					for (int dx = -1; dx <= 1; dx++)
+					{
+						if ((dx < 0 && x == 0) || (dx > 0 && x + 1 == width) || (dx == 0 && dy == 0 && dz == 0))
+							continue;
+						consider(p + dx + static_cast<ptrdiff_t>(dy) * width + static_cast<ptrdiff_t>(dz) * static_cast<ptrdiff_t>(area));
+					}
+				}
+			}
+		}
+		else
+		{
+			if (x > 0)
+				consider(p - 1);
+			if (x + 1 < width)
+				consider(p + 1);
+			if (y > 0)
+				consider(p - width);
+			if (y + 1 < height)
+				consider(p + width);
+			if (z > z0)
+				consider(p - area);
+			if (z + 1 < z1)
+				consider(p + area);
+		}
+
+		if (nroots == 0)
+		{
+			unsigned b = static_cast<unsigned>(slab.depth.size());
+			slab.depth.push_back(g);
+			slab.basin_key.push_back(flood_key(g, p));
+			parent.push_back(b);
+			basin[p] = b;
+		}
+		else
+		{
+			// join the deepest adjacent basin, the others merge into it
+			int best = 0;
+			for (int j = 1; j < nroots; j++)
+			{
+				if (slab.depth[roots[j]] < slab.depth[roots[best]] ||
+						(slab.depth[roots[j]] == slab.depth[roots[best]] && roots[j] < roots[best]))
+					best = j;
+			}
+			basin[p] = raw[best];
+			for (int j = 0; j < nroots; j++)
+			{
+				if (j != best)
+				{
+					parent[roots[j]] = roots[best];
+					MergeEvent m;
+					m.k = raw[j];
+					m.a = raw[best];
+					m.g = g;
+					m.key = flood_key(g, p);
+					slab.merges.push_back(m);
+				}
+			}
+		}
+	}
+}
+} // namespace
+
+void WatershedMergeTree::clear()
+{
+	_basin.clear();
+	_depth.clear();
+	_merges.clear();
+}
+
+void WatershedMergeTree::build(const std::vector<const float*>& slices, unsigned short width, unsigned short height, bool connectivity)
+{
+	clear();
+	_width = width;
+	_height = height;
+
+	const int nz = static_cast<int>(slices.size());
+	const size_t area = static_cast<size_t>(width) * height;
+	const size_t n = area * nz;
+	if (n == 0)
+		return;
+	if (n >= unvisited_basin)
+		throw std::length_error("volume is too large for the watershed");
+
+	// quantize to grey levels over the range of the image
+	std::vector<float> slice_min(nz), slice_max(nz);
+#pragma omp parallel for
+	for (int z = 0; z < nz; z++)
+	{
+		auto range = std::minmax_element(slices[z], slices[z] + area);
+		slice_min[z] = *range.first;
+		slice_max[z] = *range.second;
+	}
+	const float low = *std::min_element(slice_min.begin(), slice_min.end());
+	const float high = *std::max_element(slice_max.begin(), slice_max.end());
+	const float scale = (high > low) ? 255.0f / (high - low) : 0.0f;
+
+	std::vector<unsigned char> level(n);
+#pragma omp parallel for
+	for (int z = 0; z < nz; z++)
+	{
+		const float* bits = slices[z];
+		unsigned char* lev = level.data() + z * area;
+		for (size_t i = 0; i < area; i++)
+		{
+			lev[i] = static_cast<unsigned char>(std::min(255.0f, std::floor((bits[i] - low) * scale + 0.5f)));
+		}
+	}
+
+	// each slab is flooded by one thread
+	int nslabs = _number_of_slabs;
+	if (nslabs <= 0)
+	{
+#ifdef NO_OPENMP_SUPPORT
+		nslabs = 1;
+#else
+		nslabs = omp_get_max_threads();
+#endif
+		nslabs = std::min(nslabs, nz / k_minimum_slab_thickness);
+	}
+	nslabs = std::max(1, std::min(nslabs, nz));
+
+	std::vector<Slab> slabs(nslabs);
+	for (int s = 0; s < nslabs; s++)
+	{
+		slabs[s].z0 = static_cast<int>(static_cast<long long>(nz) * s / nslabs);
+		slabs[s].z1 = static_cast<int>(static_cast<long long>(nz) * (s + 1) / nslabs);
+	}
+
+	_basin.resize(n);
+#pragma omp parallel for schedule(dynamic, 1)
+	for (int s = 0; s < nslabs; s++)
+	{
+		flood_slab(slabs[s], level, _basin.data(), width, height, connectivity);
+	}
+
+	// the basins are numbered in flooding order of their first voxel, as in a single flood
+	std::vector<std::pair<unsigned long long, unsigned>> basins;
+	for (int s = 0; s < nslabs; s++)
+	{
+		for (auto key : slabs[s].basin_key)
+			basins.push_back(std::make_pair(key, static_cast<unsigned>(s)));
+	}
+	std::sort(basins.begin(), basins.end());
+	_depth.resize(basins.size());
+	std::vector<unsigned> next_local(nslabs, 0);
+	for (unsigned b = 0; b < basins.size(); b++)
+	{
+		auto& slab = slabs[basins[b].second];
+		_depth[b] = slab.depth[next_local[basins[b].second]++];
+		slab.global_id.push_back(b);
+	}
+
+#pragma omp parallel for
+	for (int s = 0; s < nslabs; s++)
+	{
+		const auto& global_id = slabs[s].global_id;
+		for (size_t i = slabs[s].z0 * area; i < slabs[s].z1 * area; i++)
+			_basin[i] = global_id[_basin[i]];
+	}
+
+	// The merges within the slabs and the neighbors across slab borders are
+	// replayed in flooding order. A border voxel which started a basin of its
+	// own, although an earlier voxel of the next slab is adjacent, joins that
+	// basin at its own depth, i.e. for every flooding height.
+	std::vector<MergeEvent> events;
+	for (int s = 0; s < nslabs; s++)
+	{
+		for (const auto& m : slabs[s].merges)
+		{
+			MergeEvent e = m;
+			e.k = slabs[s].global_id[m.k];
+			e.a = slabs[s].global_id[m.a];
+			events.push_back(e);
+		}
+		std::vector<MergeEvent>().swap(slabs[s].merges);
+
+		if (s + 1 == nslabs)
+			continue;
+
+		const size_t plane = (slabs[s].z1 - 1) * area;
+		for (size_t y = 0; y < height; y++)
+		{
+			for (size_t x = 0; x < width; x++)
+			{
+				const size_t p = plane + y * width + x;
+				for (int dy = -1; dy <= 1; dy++)
+				{
+					if ((dy < 0 && y == 0) || (dy > 0 && y + 1 == height) || (!connectivity && dy != 0))
+						continue;
+					for (int dx = -1; dx <= 1; dx++)
+					{
+						if ((dx < 0 && x == 0) || (dx > 0 && x + 1 == width) || (!connectivity && dx != 0))
+							continue;
+						const size_t q = p + area + dx + static_cast<ptrdiff_t>(dy) * width;
+						const auto key_p = flood_key(level[p], p), key_q = flood_key(level[q], q);
+						MergeEvent e;
+						e.k = (key_p < key_q) ? _basin[q] : _basin[p];
+						e.a = (key_p < key_q) ? _basin[p] : _basin[q];
+						e.g = std::max(level[p], level[q]);
+						e.key = std::max(key_p, key_q);
+						events.push_back(e);
+					}
+				}
+			}
+		}
+	}
+	if (nslabs > 1)
+	{
+		std::stable_sort(events.begin(), events.end(), [](const MergeEvent& l, const MergeEvent& r) { return l.key < r.key; });
+	}
+
+	// the younger basin (larger number) merges into the older one
+	std::vector<unsigned> parent(_depth.size());
+	std::iota(parent.begin(), parent.end(), 0);
+	for (const auto& e : events)
+	{
+		unsigned rk = find_root(parent, e.k);
+		unsigned ra = find_root(parent, e.a);
+		if (rk == ra)
+			continue;
+
+		Merge m;
+		m.k = e.k;
+		m.a = e.a;
+		m.g = e.g;
+		if (rk < ra)
+		{
+			std::swap(rk, ra);
+			std::swap(m.k, m.a);
+		}
+		parent[rk] = ra;
+		_merges.push_back(m);
+	}
+}
+
+std::vector<unsigned> WatershedMergeTree::relabel(unsigned h, const std::vector<marker_type>& markers) const
+{
+	const size_t nbasins = _depth.size();
+	std::vector<unsigned> parent(nbasins);
+	std::iota(parent.begin(), parent.end(), 0);
+	std::vector<unsigned> label(nbasins, 0);
+
+	for (const auto& m : markers)
+	{
+		if (m.first < _basin.size())
+			label[_basin[m.first]] = m.second;
+	}
+
+	for (const auto& m : _merges)
+	{
+		unsigned k = find_root(parent, m.k);
+		unsigned a = find_root(parent, m.a);
+		if (h + _depth[k] >= m.g)
+		{
+			if (label[a] == 0 || label[k] == 0 || label[a] == label[k])
+			{
+				parent[k] = a;
+			}
+			if (label[a] == 0)
+			{
+				label[a] = label[k];
+			}
+		}
+	}
+
+	for (unsigned b = 0; b < nbasins; b++)
+	{
+		if (label[b] == 0)
+			label[b] = label[find_root(parent, b)];
+	}
+	return label;
+}
+
+void WatershedMergeTree::apply(const std::vector<unsigned>& basin_labels, const std::vector<float*>& target, float scale) const
+{
+	const size_t area = static_cast<size_t>(_width) * _height;
+	const int nz = static_cast<int>(std::min(target.size(), area ? _basin.size() / area : 0));
+
+#pragma omp parallel for
+	for (int z = 0; z < nz; z++)
+	{
+		const unsigned* basin = _basin.data() + z * area;
+		float* bits = target[z];
+		for (size_t i = 0; i < area; i++)
+		{
+			bits[i] = scale * basin_labels[basin[i]];
+		}
+	}
+}
+
+} // namespace iseg
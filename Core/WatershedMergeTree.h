@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#pragma once
+
+#include "iSegCore.h"
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace iseg {
+
+/** \brief Watershed of a stack of slices with the hierarchy of basin merges
+
+	The image is quantized to 256 grey levels and flooded once, recording
+	for every voxel its basin and for every basin the level at which it
+	merges into a deeper one. Merging the basins for a flooding height is
+	then a relabelling of the basins, which does not touch the voxels.
+
+	The slabs of slices are flooded in parallel, each on its own. Then the
+	merges of all slabs and the voxel pairs across the slab borders are
+	replayed in flooding order, which gives the merge levels of a single
+	flood. A slab border can cut off extra basins. These merge at their own
+	depth, so they merge for every height unless their markers differ.
+	Voxels on a watershed line next to a slab border can also be assigned
+	to a different neighboring basin than in a single flood.
+*/
+class ISEG_CORE_API WatershedMergeTree
+{
+public:
+	enum { k_minimum_slab_thickness = 16 };
+
+	/// voxel index within the stack and marker label
+	using marker_type = std::pair<size_t, unsigned>;
+
+	/// floods the image (e.g. a gradient magnitude), connectivity selects 26- instead of 6-neighborhood
+	void build(const std::vector<const float*>& slices, unsigned short width, unsigned short height, bool connectivity);
+	void clear();
+
+	/// number of slabs flooded in parallel, 0 (default) for one per thread with at least k_minimum_slab_thickness slices
+	void set_number_of_slabs(int n) { _number_of_slabs = n; }
+
+	bool empty() const { return _basin.empty(); }
+	size_t number_of_basins() const { return _depth.size(); }
+	size_t number_of_merges() const { return _merges.size(); }
+	unsigned basin(size_t voxel) const { return _basin[voxel]; }
+
+	/// label of each basin, after merging basins whose merge level is at most h above their depth; basins with different markers are not merged
+	std::vector<unsigned> relabel(unsigned h, const std::vector<marker_type>& markers) const;
+
+	/// writes scale times the basin label of each voxel into the target slices
+	void apply(const std::vector<unsigned>& basin_labels, const std::vector<float*>& target, float scale) const;
+
+private:
+	struct Merge
+	{
+		unsigned k; // basin which merges
+		unsigned a; // basin it merges into
+		unsigned char g;
+	};
+
+	int _number_of_slabs = 0;
+	unsigned short _width = 0;
+	unsigned short _height = 0;
+	std::vector<unsigned> _basin;
+	std::vector<unsigned char> _depth;
+	std::vector<Merge> _merges;
+};
+
+} // namespace iseg
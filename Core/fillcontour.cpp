@@ -11,20 +11,8 @@
 
 #include "fillcontour.h"
 
-#include <list>
+#include <algorithm>
 #include <math.h>
-#include <vector>
-
-namespace {
-
-struct transition
-{
-	bool to_inside;
-	float pos;
-	inline bool operator<(const transition& a) const { return pos < a.pos; }
-};
-
-} // namespace
 
 namespace iseg { namespace fillcontours {
 
@@ -141,281 +129,299 @@ bool is_hole(float** points, unsigned int* nrpoints, unsigned int nrcontours,
 	return nrinside % 2;
 }
 
-void fill_contour(bool* array, unsigned short* pixel_extents, float* origin,
-				  float* pixel_size, float* direction_cosines, float** points,
-				  unsigned int* nrpoints, unsigned int nrcontours,
-				  bool clockwisefill)
+void ScanlineFiller::add_edge(float x0, float y0, float x1, float y1, bool clockwisefill, unsigned structure,
+		const float* origin, const float* pixel_size, int height, eFillRule rule)
 {
-	float tol = 0.1 * pixel_size[0];
-	std::vector<std::list<transition>> inouts;
-	inouts.resize(pixel_extents[1]);
-
-	//FILE *fp3=fopen("C:\\test.txt","a");
-	//for(unsigned int i=0;i<nrcontours;i++){
-	//	fprintf(fp3,"c ");
-	//	for(unsigned int j=0;j<nrpoints[i];j++)
-	//		fprintf(fp3,"(%f %f %f)",points[i][3*j],points[i][3*j+1],points[i][3*j+2]);
-	//	fprintf(fp3,"\n");
-	//}
-	//fclose(fp3);
-
-	float x0, x1, y0, y1;
-	unsigned short begin_h, end_h;
-	float swap_x = direction_cosines[0];
-	float swap_y = direction_cosines[4];
+	if (y0 == y1)
+		return;
+
+	// the crossings are computed from the lower end point
+	const bool down = y0 > y1;
+	const float xl = down ? x1 : x0;
+	const float yl = down ? y1 : y0;
+	const float yh = down ? y0 : y1;
+
+	// nested contours include crossings on both end rows, the winding rules are half open
+	const float first = ceil((yl - origin[1]) / pixel_size[1]);
+	const float last = (rule == kNested) ? floor((yh - origin[1]) / pixel_size[1])
+																			 : ceil((yh - origin[1]) / pixel_size[1]) - 1;
+
+	Edge edge;
+	edge.begin = (first > 0) ? (first < height ? static_cast<int>(first) : height) : 0;
+	edge.end = (last < height - 1) ? (last > -1 ? static_cast<int>(last) : -1) : height - 1;
+	if (edge.begin > edge.end)
+		return;
+
+	edge.slope = (x0 - x1) / (y0 - y1);
+	edge.offset = origin[1] - yl;
+	edge.winding = down ? -1 : 1;
+	edge.to_inside = (down != clockwisefill);
+	edge.structure = structure;
+	if (rule == kNested)
+	{
+		const float tol = 0.1 * pixel_size[0];
+		edge.base = edge.to_inside ? (xl - origin[0]) - tol : (xl - origin[0]) + tol;
+	}
+	else
+	{
+		edge.base = xl - origin[0];
+	}
+	_edges.push_back(edge);
+}
+
+namespace {
+
+/// first pixel w with pos < w * spacing, or width
+inline int first_pixel(float pos, float spacing, int width)
+{
+	const float f = floor(pos / spacing) + 1;
+	int w = (f > 0) ? (f < width ? static_cast<int>(f) : width) : 0;
+	while (w > 0 && pos < (w - 1) * spacing)
+		w--;
+	while (w < width && !(pos < w * spacing))
+		w++;
+	return w;
+}
+
+} // namespace
+
+void ScanlineFiller::add_contours(float** points, unsigned int* nrpoints, unsigned int nrcontours, unsigned structure,
+		const float* origin, const float* pixel_size, const float* direction_cosines, int height, eFillRule rule)
+{
+	const float swap_x = direction_cosines[0];
+	const float swap_y = direction_cosines[4];
+	const float swapped_origin[2] = {swap_x * origin[0], swap_y * origin[1]};
+
+	// edges in the order of the contour points
 	for (unsigned int i = 0; i < nrcontours; i++)
 	{
-		bool clockwisefill1 = (get_area(points[i], nrpoints[i]) > 0);
-		bool clockwisefill2 = is_hole(points, nrpoints, nrcontours, i);
-		clockwisefill = (clockwisefill1 != clockwisefill2);
-		if (swap_x * swap_y < 0)
-			clockwisefill = !clockwisefill;
-		if (clockwisefill)
+		const unsigned int n = nrpoints[i];
+		if (n == 0)
+			continue;
+
+		bool clockwisefill = false;
+		if (rule == kNested)
 		{
-			for (unsigned long pos = 0; pos + 3 < 3 * nrpoints[i]; pos += 3)
-			{
-				x0 = swap_x * points[i][pos];
-				y0 = swap_y * points[i][pos + 1];
-				x1 = swap_x * points[i][pos + 3];
-				y1 = swap_y * points[i][pos + 4];
-				if (y0 != y1)
-				{
-					transition trans;
-					float slope = (x0 - x1) / (y0 - y1);
-					if (y0 > y1)
-					{
-						trans.to_inside = false;
-						begin_h = (unsigned short)ceil(
-							(y1 - swap_y * origin[1]) / pixel_size[1]);
-						end_h = (unsigned short)floor(
-							(y0 - swap_y * origin[1]) / pixel_size[1]);
-						if (end_h >= pixel_extents[1])
-							end_h = pixel_extents[1] - 1;
-						for (unsigned short h = begin_h; h <= end_h; h++)
-						{
-							trans.pos = (x1 - swap_x * origin[0]) + tol +
-										(pixel_size[1] * h +
-										 (swap_y * origin[1] - y1)) *
-											slope;
-							inouts.at(h).push_back(trans);
-						}
-					}
-					else
-					{
-						trans.to_inside = true;
-						begin_h = (unsigned short)ceil(
-							(y0 - swap_y * origin[1]) / pixel_size[1]);
-						end_h = (unsigned short)floor(
-							(y1 - swap_y * origin[1]) / pixel_size[1]);
-						if (end_h >= pixel_extents[1])
-							end_h = pixel_extents[1] - 1;
-						for (unsigned short h = begin_h; h <= end_h; h++)
-						{
-							trans.pos = (x0 - swap_x * origin[0]) - tol +
-										(pixel_size[1] * h +
-										 (swap_y * origin[1] - y0)) *
-											slope;
-							inouts.at(h).push_back(trans);
-						}
-					}
-				}
-			}
-			x0 = swap_x * points[i][0];
-			y0 = swap_y * points[i][1];
-			x1 = swap_x * points[i][3 * nrpoints[i] - 3];
-			y1 = swap_y * points[i][3 * nrpoints[i] - 2];
-			if (y1 != y0)
+			bool clockwisefill1 = (get_area(points[i], n) > 0);
+			bool clockwisefill2 = is_hole(points, nrpoints, nrcontours, i);
+			clockwisefill = (clockwisefill1 != clockwisefill2);
+			if (swap_x * swap_y < 0)
+				clockwisefill = !clockwisefill;
+		}
+
+		const float* pts = points[i];
+		for (unsigned int k = 0; k + 1 < n; k++)
+		{
+			add_edge(swap_x * pts[3 * k], swap_y * pts[3 * k + 1],
+					swap_x * pts[3 * k + 3], swap_y * pts[3 * k + 4],
+					clockwisefill, structure, swapped_origin, pixel_size, height, rule);
+		}
+		add_edge(swap_x * pts[3 * n - 3], swap_y * pts[3 * n - 2],
+				swap_x * pts[0], swap_y * pts[1],
+				clockwisefill, structure, swapped_origin, pixel_size, height, rule);
+	}
+}
+
+void ScanlineFiller::sort_edges()
+{
+	_order.resize(_edges.size());
+	for (unsigned e = 0; e < _order.size(); e++)
+		_order[e] = e;
+	std::stable_sort(_order.begin(), _order.end(),
+			[this](unsigned a, unsigned b) { return _edges[a].begin < _edges[b].begin; });
+	_active.clear();
+}
+
+void ScanlineFiller::update_crossings(int h, size_t& next, float pixel_size)
+{
+	// update the active edges
+	_active.erase(std::remove_if(_active.begin(), _active.end(),
+										[this, h](unsigned e) { return _edges[e].end < h; }),
+			_active.end());
+	while (next < _order.size() && _edges[_order[next]].begin <= h)
+		_active.push_back(_order[next++]);
+
+	// crossings with equal position stay in the order of the contour points
+	_crossings.clear();
+	for (auto e : _active)
+	{
+		const Edge& edge = _edges[e];
+		Crossing c;
+		c.pos = edge.base + (pixel_size * h + edge.offset) * edge.slope;
+		c.index = e;
+		_crossings.push_back(c);
+	}
+	std::sort(_crossings.begin(), _crossings.end());
+}
+
+template<typename F>
+void ScanlineFiller::sweep(size_t begin, size_t end, int width, float pixel_size, eFillRule rule, F fill_span) const
+{
+	// pixel w lies at w * pixel_size
+	size_t k = begin;
+	bool status = false;
+	int winding = 0;
+	while (k < end && _crossings[k].pos < 0)
+	{
+		const Edge& edge = _edges[_crossings[k++].index];
+		status = edge.to_inside;
+		winding += edge.winding;
+	}
+	if (rule != kNested)
+		status = (rule == kEvenOdd) ? (winding & 1) != 0 : winding != 0;
+
+	for (int w = 0; w < width;)
+	{
+		const int w1 = (k < end) ? first_pixel(_crossings[k].pos, pixel_size, width) : width;
+		if (status && w < w1)
+			fill_span(w, w1);
+		w = w1;
+
+		const float x = w * pixel_size;
+		if (rule == kNested)
+		{
+			// a crossing to the outside is ignored, if followed by another one
+			while (k < end && _crossings[k].pos < x)
 			{
-				transition trans;
-				float slope = (x1 - x0) / (y1 - y0);
-				if (y1 > y0)
+				if (status && !_edges[_crossings[k].index].to_inside)
 				{
-					trans.to_inside = false;
-					begin_h = (unsigned short)ceil((y0 - swap_y * origin[1]) /
-												   pixel_size[1]);
-					end_h = (unsigned short)floor((y1 - swap_y * origin[1]) /
-												  pixel_size[1]);
-					if (end_h >= pixel_extents[1])
-						end_h = pixel_extents[1] - 1;
-					for (unsigned short h = begin_h; h <= end_h; h++)
-					{
-						trans.pos =
-							(x0 - swap_x * origin[0]) + tol +
-							(pixel_size[1] * h + (swap_y * origin[1] - y0)) *
-								slope;
-						inouts.at(h).push_back(trans);
-					}
+					k++;
+					if (k == end || _edges[_crossings[k].index].to_inside)
+						status = false;
 				}
 				else
 				{
-					trans.to_inside = true;
-					begin_h = (unsigned short)ceil((y1 - swap_y * origin[1]) /
-												   pixel_size[1]);
-					end_h = (unsigned short)floor((y0 - swap_y * origin[1]) /
-												  pixel_size[1]);
-					if (end_h >= pixel_extents[1])
-						end_h = pixel_extents[1] - 1;
-					for (unsigned short h = begin_h; h <= end_h; h++)
-					{
-						trans.pos =
-							(x1 - swap_x * origin[0]) - tol +
-							(pixel_size[1] * h + (swap_y * origin[1] - y1)) *
-								slope;
-						inouts.at(h).push_back(trans);
-					}
+					status = _edges[_crossings[k].index].to_inside;
+					k++;
 				}
 			}
 		}
 		else
 		{
-			for (unsigned long pos = 0; pos + 3 < 3 * nrpoints[i]; pos += 3)
-			{
-				x0 = swap_x * points[i][pos];
-				y0 = swap_y * points[i][pos + 1];
-				x1 = swap_x * points[i][pos + 3];
-				y1 = swap_y * points[i][pos + 4];
-				if (y0 != y1)
-				{
-					transition trans;
-					float slope = (x0 - x1) / (y0 - y1);
-					if (y0 > y1)
-					{
-						trans.to_inside = true;
-						begin_h = (unsigned short)ceil(
-							(y1 - swap_y * origin[1]) / pixel_size[1]);
-						end_h = (unsigned short)floor(
-							(y0 - swap_y * origin[1]) / pixel_size[1]);
-						if (end_h >= pixel_extents[1])
-							end_h = pixel_extents[1] - 1;
-						for (unsigned short h = begin_h; h <= end_h; h++)
-						{
-							trans.pos = (x1 - swap_x * origin[0]) - tol +
-										(pixel_size[1] * h +
-										 (swap_y * origin[1] - y1)) *
-											slope;
-							inouts.at(h).push_back(trans);
-						}
-					}
-					else
-					{
-						trans.to_inside = false;
-						begin_h = (unsigned short)ceil(
-							(y0 - swap_y * origin[1]) / pixel_size[1]);
-						end_h = (unsigned short)floor(
-							(y1 - swap_y * origin[1]) / pixel_size[1]);
-						if (end_h >= pixel_extents[1])
-							end_h = pixel_extents[1] - 1;
-						for (unsigned short h = begin_h; h <= end_h; h++)
-						{
-							trans.pos = (x0 - swap_x * origin[0]) + tol +
-										(pixel_size[1] * h +
-										 (swap_y * origin[1] - y0)) *
-											slope;
-							inouts.at(h).push_back(trans);
-						}
-					}
-				}
-			}
-			x0 = swap_x * points[i][0];
-			y0 = swap_y * points[i][1];
-			x1 = swap_x * points[i][3 * nrpoints[i] - 3];
-			y1 = swap_y * points[i][3 * nrpoints[i] - 2];
-			if (y1 != y0)
-			{
-				transition trans;
-				float slope = (x1 - x0) / (y1 - y0);
-				if (y1 > y0)
-				{
-					trans.to_inside = true;
-					begin_h = (unsigned short)ceil((y0 - swap_y * origin[1]) /
-												   pixel_size[1]);
-					end_h = (unsigned short)floor((y1 - swap_y * origin[1]) /
-												  pixel_size[1]);
-					if (end_h >= pixel_extents[1])
-						end_h = pixel_extents[1] - 1;
-					for (unsigned short h = begin_h; h <= end_h; h++)
-					{
-						trans.pos =
-							(x0 - swap_x * origin[0]) - tol +
-							(pixel_size[1] * h + (swap_y * origin[1] - y0)) *
-								slope;
-						inouts.at(h).push_back(trans);
-					}
-				}
-				else
-				{
-					trans.to_inside = false;
-					begin_h = (unsigned short)ceil((y1 - swap_y * origin[1]) /
-												   pixel_size[1]);
-					end_h = (unsigned short)floor((y0 - swap_y * origin[1]) /
-												  pixel_size[1]);
-					if (end_h >= pixel_extents[1])
-						end_h = pixel_extents[1] - 1;
-					for (unsigned short h = begin_h; h <= end_h; h++)
-					{
-						trans.pos =
-							(x1 - swap_x * origin[0]) + tol +
-							(pixel_size[1] * h + (swap_y * origin[1] - y1)) *
-								slope;
-						inouts.at(h).push_back(trans);
-					}
-				}
-			}
+			while (k < end && _crossings[k].pos < x)
+				winding += _edges[_crossings[k++].index].winding;
+			status = (rule == kEvenOdd) ? (winding & 1) != 0 : winding != 0;
 		}
 	}
+}
+
+void ScanlineFiller::fill(bool* array, const unsigned short* pixel_extents,
+		const float* origin, const float* pixel_size,
+		const float* direction_cosines, float** points,
+		unsigned int* nrpoints, unsigned int nrcontours, eFillRule rule)
+{
+	const int width = pixel_extents[0];
+	const int height = pixel_extents[1];
+
+	_edges.clear();
+	add_contours(points, nrpoints, nrcontours, 0, origin, pixel_size, direction_cosines, height, rule);
+	sort_edges();
 
-	for (unsigned short h = 0; h < pixel_extents[1]; h++)
+	size_t next = 0;
+	bool* row = array + static_cast<size_t>(width) * (height - 1);
+	for (int h = 0; h < height; h++, row -= width)
 	{
-		inouts.at(h).sort();
+		update_crossings(h, next, pixel_size[1]);
+
+		std::fill(row, row + width, false);
+		sweep(0, _crossings.size(), width, pixel_size[0], rule,
+				[row](int w0, int w1) { std::fill(row + w0, row + w1, true); });
 	}
+}
+
+void ScanlineFiller::fill_labels(tissues_size_t* labels, const unsigned short* pixel_extents,
+		const float* origin, const float* pixel_size,
+		const float* direction_cosines, const std::vector<Structure>& structures,
+		const std::vector<bool>& locked, eFillRule rule)
+{
+	const int width = pixel_extents[0];
+	const int height = pixel_extents[1];
+	const unsigned nstructures = static_cast<unsigned>(structures.size());
+
+	auto is_locked = [&locked](tissues_size_t label) {
+		return label < locked.size() && locked[label];
+	};
+
+	// one edge table for all structures
+	_edges.clear();
+	for (unsigned s = 0; s < nstructures; s++)
+	{
+		add_contours(structures[s].points, structures[s].nrpoints, structures[s].nrcontours, s,
+				origin, pixel_size, direction_cosines, height, rule);
+	}
+	sort_edges();
 
-	unsigned long position =
-		pixel_extents[0] * (unsigned long)(pixel_extents[1] - 1);
-	for (unsigned short h = 0; h < pixel_extents[1]; h++)
+	size_t next = 0;
+	tissues_size_t* row = labels + static_cast<size_t>(width) * (height - 1);
+	for (int h = 0; h < height; h++, row -= width)
 	{
-		bool initialstatus = false;
-		bool status = false;
-		std::list<transition>::iterator it = inouts.at(h).begin();
-		while (it != inouts.at(h).end() && it->pos < 0)
+		update_crossings(h, next, pixel_size[1]);
+		if (_crossings.empty())
+			continue;
+
+		// the spans of each structure are found from its own crossings
+		std::stable_sort(_crossings.begin(), _crossings.end(),
+				[this](const Crossing& a, const Crossing& b) { return _edges[a.index].structure < _edges[b.index].structure; });
+		_span_ends.clear();
+		for (size_t k0 = 0, n = _crossings.size(); k0 < n;)
 		{
-			//status=!status;
-			status = it->to_inside;
-			it++;
+			const unsigned s = _edges[_crossings[k0].index].structure;
+			size_t k1 = k0 + 1;
+			while (k1 < n && _edges[_crossings[k1].index].structure == s)
+				k1++;
+			sweep(k0, k1, width, pixel_size[0], rule, [this, s](int w0, int w1) {
+				_span_ends.push_back({w0, s, 1});
+				_span_ends.push_back({w1, s, -1});
+			});
+			k0 = k1;
 		}
-		for (unsigned short w = 0; w < pixel_extents[0]; w++)
+		std::sort(_span_ends.begin(), _span_ends.end(),
+				[](const SpanEnd& a, const SpanEnd& b) { return a.pos < b.pos; });
+
+		// filled in order, the first locked label or else the last structure wins
+		_covering.assign(nstructures, 0);
+		for (size_t k = 0, n = _span_ends.size(); k < n;)
 		{
-			while (it != inouts.at(h).end() && it->pos < w * pixel_size[0])
+			const int w0 = _span_ends[k].pos;
+			while (k < n && _span_ends[k].pos == w0)
 			{
-				//status=!status;
-				if (status && !it->to_inside)
-				{
-					it++;
-					if (it == inouts.at(h).end() || it->to_inside)
-						status = false;
-				}
-				else
+				_covering[_span_ends[k].structure] += _span_ends[k].delta;
+				k++;
+			}
+			if (k == n)
+				break;
+
+			int winner = -1;
+			for (unsigned s = 0; s < nstructures; s++)
+			{
+				if (_covering[s] > 0)
 				{
-					status = it->to_inside;
-					it++;
+					winner = s;
+					if (is_locked(structures[s].label))
+						break;
 				}
 			}
-			array[position] = status;
-			position++;
+			if (winner < 0)
+				continue;
+
+			const tissues_size_t label = structures[winner].label;
+			for (int w = w0, w1 = _span_ends[k].pos; w < w1; w++)
+			{
+				if (!is_locked(row[w]))
+					row[w] = label;
+			}
 		}
-		position -= 2 * pixel_extents[0];
 	}
+}
 
-	//FILE *fp3=fopen("D:\\test100.txt","a");
-	//for(unsigned short h=0;h<height;h++) {
-	//	fprintf(fp3,"%i: ",h);
-	//	std::list<transition>::iterator it=inouts[h].begin();
-	//	while(it!=inouts[h].end())  {
-	//		fprintf(fp3,"%f %i, ",it->pos,(int)it->to_inside);
-	//		it++;
-	//	}
-	//	fprintf(fp3,"\n");
-	//}
-	//fclose(fp3);
+void fill_contour(bool* array, unsigned short* pixel_extents, float* origin,
+				  float* pixel_size, float* direction_cosines, float** points,
+				  unsigned int* nrpoints, unsigned int nrcontours,
+				  bool /* clockwisefill */)
+{
+	ScanlineFiller filler;
+	filler.fill(array, pixel_extents, origin, pixel_size, direction_cosines,
+			points, nrpoints, nrcontours, kNested);
 }
 
 }} // namespace iseg::fillcontours
@@ -11,12 +11,106 @@
 
 #include "iSegCore.h"
 
+#include "Data/Types.h"
+
+#include <cstddef>
+#include <vector>
+
 namespace iseg { namespace fillcontours {
 
+enum eFillRule {
+	kNested = 0, ///< outlines and holes by nesting, outlines are widened by 0.1 pixel (RTSTRUCT)
+	kEvenOdd,
+	kNonZero
+};
+
+/** \brief Active edge table scanline rasterizer for planar contours
+
+	All contours of a slice are entered into one edge table, which is swept
+	row by row and filled span by span. The edge and crossing buffers are
+	kept, so a filler can be reused for many slices without reallocation.
+	The mask rows are stored bottom up, as by fill_contour.
+*/
+class ISEG_CORE_API ScanlineFiller
+{
+public:
+	/// contours of one structure, for fill_labels
+	struct Structure
+	{
+		tissues_size_t label;
+		float** points;
+		unsigned int* nrpoints;
+		unsigned int nrcontours;
+	};
+
+	void fill(bool* array, const unsigned short* pixel_extents,
+			const float* origin, const float* pixel_size,
+			const float* direction_cosines, float** points,
+			unsigned int* nrpoints, unsigned int nrcontours,
+			eFillRule rule = kNested);
+
+	/** \brief Fills several structures into a label slice in one sweep
+
+		The edges of all structures are entered into one edge table. A pixel
+		gets the label of the last structure containing it, as if the
+		structures were filled one after the other, except that locked labels
+		(locked[label]) are not overwritten. Pixels outside all structures keep
+		their label, and every pixel is written at most once.
+	*/
+	void fill_labels(tissues_size_t* labels, const unsigned short* pixel_extents,
+			const float* origin, const float* pixel_size,
+			const float* direction_cosines, const std::vector<Structure>& structures,
+			const std::vector<bool>& locked, eFillRule rule = kNested);
+
+private:
+	struct Edge
+	{
+		int begin, end; // first and last row
+		float base, offset, slope;
+		bool to_inside;
+		int winding;
+		unsigned structure;
+	};
+	struct Crossing
+	{
+		float pos;
+		unsigned index;
+		inline bool operator<(const Crossing& a) const { return pos < a.pos || (pos == a.pos && index < a.index); }
+	};
+	struct SpanEnd
+	{
+		int pos;
+		unsigned structure;
+		int delta;
+	};
+
+	void add_contours(float** points, unsigned int* nrpoints, unsigned int nrcontours, unsigned structure,
+			const float* origin, const float* pixel_size, const float* direction_cosines, int height, eFillRule rule);
+	void add_edge(float x0, float y0, float x1, float y1, bool clockwisefill, unsigned structure,
+			const float* origin, const float* pixel_size, int height, eFillRule rule);
+	void sort_edges();
+	void update_crossings(int h, size_t& next, float pixel_size);
+	template<typename F>
+	void sweep(size_t begin, size_t end, int width, float pixel_size, eFillRule rule, F fill_span) const;
+
+	std::vector<Edge> _edges;
+	std::vector<unsigned> _order;
+	std::vector<unsigned> _active;
+	std::vector<Crossing> _crossings;
+	std::vector<SpanEnd> _span_ends;
+	std::vector<int> _covering;
+};
+
 ISEG_CORE_API bool pointinpoly(float* pt, unsigned int cnt, float* polypts);
 ISEG_CORE_API int whichquad(float* pt, float* orig);
 ISEG_CORE_API bool is_hole(float** points, unsigned int* nrpoints,
 						  unsigned int nrcontours, unsigned int contournr);
+/** \brief Fills the contours with the kNested rule
+
+	The fill rule decides which side of an edge is inside: outlines and holes
+	are found by nesting and their orientation is derived from the signed area.
+	clockwisefill is unused and only kept for source compatibility.
+*/
 ISEG_CORE_API void fill_contour(bool* array, unsigned short* pixel_extents,
 							   float* origin, float* pixel_size,
 							   float* direction_cosines, float** points,
@@ -16,8 +16,286 @@
 //#define ENABLE_DUMP_IMAGE
 #include "Data/ItkUtils.h"
 
+#include <itkBinaryThinningImageFilter3D.h>
+#include <itkImageRegionConstIterator.h>
+#include <itkImageRegionIteratorWithIndex.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <queue>
+
 namespace iseg {
 
+namespace {
+using mask_type = itk::Image<unsigned char, 3>;
+
+// the test images are cubes of n^3 voxels, the buffers are padded by one voxel
+const std::ptrdiff_t n = 40;
+const std::ptrdiff_t s = n + 2;
+
+// Sequential [Lee94] thinning, with the simple border points of each
+// subiteration re-checked and deleted in subfield order
+class ThinningReference : public itk::BinaryThinningImageFilter3D<mask_type, mask_type>
+{
+public:
+	using Self = ThinningReference;
+	using Pointer = itk::SmartPointer<Self>;
+	itkNewMacro(Self);
+
+	void Thin(std::vector<unsigned char>& image) const
+	{
+		std::ptrdiff_t offsets[27];
+		for (int i = 0; i < 27; i++)
+		{
+			offsets[i] = (i % 3 - 1) + (i / 3 % 3 - 1) * s + (i / 9 - 1) * s * s;
+		}
+		const int border_neighbor[6] = {10, 16, 14, 12, 22, 4};
+		int euler_lut[256];
+		fillEulerLUT(euler_lut);
+
+		int unchanged_borders = 0;
+		while (unchanged_borders < 6)
+		{
+			unchanged_borders = 0;
+			for (int border = 0; border < 6; border++)
+			{
+				std::vector<std::ptrdiff_t> subfield[8];
+				for (std::ptrdiff_t z = 1; z <= n; z++)
+				{
+					for (std::ptrdiff_t y = 1; y <= n; y++)
+					{
+						for (std::ptrdiff_t x = 1; x <= n; x++)
+						{
+							const std::ptrdiff_t p = x + y * s + z * s * s;
+							if (!image[p] || image[p + offsets[border_neighbor[border]]])
+							{
+								continue;
+							}
+							int neighbors[27];
+							int count = -1;
+							for (int i = 0; i < 27; i++)
+							{
+								neighbors[i] = image[p + offsets[i]];
+								count += neighbors[i];
+							}
+							if (count != 1 && isEulerInvariant(neighbors, euler_lut) && isSimplePoint(neighbors))
+							{
+								subfield[(x & 1) + 2 * (y & 1) + 4 * (z & 1)].push_back(p);
+							}
+						}
+					}
+				}
+
+				bool changed = false;
+				for (const auto& points : subfield)
+				{
+					for (auto p : points)
+					{
+						int neighbors[27];
+						for (int i = 0; i < 27; i++)
+						{
+							neighbors[i] = image[p + offsets[i]];
+						}
+						if (isSimplePoint(neighbors))
+						{
+							image[p] = 0;
+							changed = true;
+						}
+					}
+				}
+				if (!changed)
+				{
+					unchanged_borders++;
+				}
+			}
+		}
+	}
+};
+
+mask_type::Pointer make_mask(const std::function<bool(double, double, double)>& inside)
+{
+	auto mask = mask_type::New();
+	itk::Index<3> start = {0, 0, 0};
+	itk::Size<3> size = {n, n, n};
+	mask->SetRegions(itk::ImageRegion<3>(start, size));
+	mask->Allocate();
+
+	itk::ImageRegionIteratorWithIndex<mask_type> it(mask, mask->GetBufferedRegion());
+	for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+	{
+		auto idx = it.GetIndex();
+		it.Set(inside(idx[0], idx[1], idx[2]) ? 1 : 0);
+	}
+	return mask;
+}
+
+std::vector<unsigned char> to_buffer(const mask_type* mask)
+{
+	std::vector<unsigned char> image(s * s * s, 0);
+	itk::ImageRegionConstIterator<mask_type> it(mask, mask->GetBufferedRegion());
+	for (std::ptrdiff_t z = 1; z <= n; z++)
+	{
+		for (std::ptrdiff_t y = 1; y <= n; y++)
+		{
+			for (std::ptrdiff_t x = 1; x <= n; x++, ++it)
+			{
+				image[x + y * s + z * s * s] = (it.Get() != 0) ? 1 : 0;
+			}
+		}
+	}
+	return image;
+}
+
+// distance of (x,y,z) to the segment from a to b
+double segment_distance(double x, double y, double z, const double* a, const double* b)
+{
+	double v[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+	double t = ((x - a[0]) * v[0] + (y - a[1]) * v[1] + (z - a[2]) * v[2]) / (v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+	t = std::max(0.0, std::min(1.0, t));
+	double dx = x - a[0] - t * v[0];
+	double dy = y - a[1] - t * v[1];
+	double dz = z - a[2] - t * v[2];
+	return std::sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+// number of 26-connected foreground or 6-connected background components
+int count_components(const std::vector<unsigned char>& image, unsigned char value)
+{
+	std::vector<bool> visited(image.size(), false);
+	int components = 0;
+	for (std::ptrdiff_t start = 0; start < static_cast<std::ptrdiff_t>(image.size()); start++)
+	{
+		if (visited[start] || image[start] != value)
+		{
+			continue;
+		}
+		components++;
+
+		std::queue<std::ptrdiff_t> queue;
+		queue.push(start);
+		visited[start] = true;
+		while (!queue.empty())
+		{
+			const std::ptrdiff_t p = queue.front();
+			queue.pop();
+			const std::ptrdiff_t x = p % s, y = p / s % s, z = p / (s * s);
+			for (int dz = -1; dz <= 1; dz++)
+			{
+				for (int dy = -1; dy <= 1; dy++)
+				{
+					for (int dx = -1; dx <= 1; dx++)
+					{
+						if (value == 0 && std::abs(dx) + std::abs(dy) + std::abs(dz) != 1)
+						{
+							continue;
+						}
+						if (x + dx < 0 || x + dx >= s || y + dy < 0 || y + dy >= s || z + dz < 0 || z + dz >= s)
+						{
+							continue;
+						}
+						const std::ptrdiff_t q = p + dx + dy * s + dz * s * s;
+						if (!visited[q] && image[q] == value)
+						{
+							visited[q] = true;
+							queue.push(q);
+						}
+					}
+				}
+			}
+		}
+	}
+	return components;
+}
+
+// Euler characteristic V - E + F - C of the union of the closed foreground voxels
+int euler_characteristic(const std::vector<unsigned char>& image)
+{
+	auto fg = [&image](std::ptrdiff_t x, std::ptrdiff_t y, std::ptrdiff_t z) {
+		return image[x + y * s + z * s * s] != 0;
+	};
+
+	// (x,y,z) is the lowest vertex of voxel (x,y,z), the cells are counted at their lowest vertex
+	int vertices = 0, edges = 0, faces = 0, cubes = 0;
+	for (std::ptrdiff_t z = 1; z < s; z++)
+	{
+		for (std::ptrdiff_t y = 1; y < s; y++)
+		{
+			for (std::ptrdiff_t x = 1; x < s; x++)
+			{
+				vertices += fg(x - 1, y - 1, z - 1) || fg(x, y - 1, z - 1) || fg(x - 1, y, z - 1) || fg(x, y, z - 1) ||
+										fg(x - 1, y - 1, z) || fg(x, y - 1, z) || fg(x - 1, y, z) || fg(x, y, z);
+				edges += fg(x, y - 1, z - 1) || fg(x, y, z - 1) || fg(x, y - 1, z) || fg(x, y, z);
+				edges += fg(x - 1, y, z - 1) || fg(x, y, z - 1) || fg(x - 1, y, z) || fg(x, y, z);
+				edges += fg(x - 1, y - 1, z) || fg(x, y - 1, z) || fg(x - 1, y, z) || fg(x, y, z);
+				faces += fg(x - 1, y, z) || fg(x, y, z);
+				faces += fg(x, y - 1, z) || fg(x, y, z);
+				faces += fg(x, y, z - 1) || fg(x, y, z);
+				cubes += fg(x, y, z);
+			}
+		}
+	}
+	return vertices - edges + faces - cubes;
+}
+
+// foreground voxels with exactly one 26-neighbor
+std::vector<std::ptrdiff_t> end_points(const std::vector<unsigned char>& image)
+{
+	std::vector<std::ptrdiff_t> ends;
+	for (std::ptrdiff_t z = 1; z <= n; z++)
+	{
+		for (std::ptrdiff_t y = 1; y <= n; y++)
+		{
+			for (std::ptrdiff_t x = 1; x <= n; x++)
+			{
+				const std::ptrdiff_t p = x + y * s + z * s * s;
+				if (!image[p])
+				{
+					continue;
+				}
+				int count = -1;
+				for (int i = 0; i < 27; i++)
+				{
+					count += image[p + (i % 3 - 1) + (i / 3 % 3 - 1) * s + (i / 9 - 1) * s * s];
+				}
+				if (count == 1)
+				{
+					ends.push_back(p);
+				}
+			}
+		}
+	}
+	return ends;
+}
+
+// thins the mask and checks the topology and the end points against the input, and the skeleton against the serial reference
+std::vector<unsigned char> check_thinning(mask_type* mask, int euler)
+{
+	auto input = to_buffer(mask);
+	BOOST_REQUIRE_EQUAL(euler_characteristic(input), euler);
+
+	auto thinning_filter = itk::BinaryThinningImageFilter3D<mask_type, mask_type>::New();
+	thinning_filter->SetInput(mask);
+	BOOST_REQUIRE_NO_THROW(thinning_filter->Update());
+	auto output = to_buffer(thinning_filter->GetOutput());
+
+	auto reference = input;
+	ThinningReference::New()->Thin(reference);
+	BOOST_CHECK(output == reference);
+
+	BOOST_CHECK_EQUAL(count_components(output, 1), count_components(input, 1));
+	BOOST_CHECK_EQUAL(count_components(output, 0), count_components(input, 0));
+	BOOST_CHECK_EQUAL(euler_characteristic(output), euler);
+	for (auto p : end_points(input))
+	{
+		BOOST_CHECK(output[p] != 0);
+	}
+	return output;
+}
+} // namespace
+
 BOOST_AUTO_TEST_SUITE(iSeg_suite);
 BOOST_AUTO_TEST_SUITE(BinaryThinning_suite);
 
@@ -81,6 +359,90 @@ BOOST_AUTO_TEST_CASE(BinaryThinning_test)
 	//dump_image(thinning_filter->GetOutput(), "E:/temp/thinned.mha");
 }
 
+// TestRunner.exe --run_test=iSeg_suite/BinaryThinning_suite/BinaryThinning3D_test --log_level=message
+BOOST_AUTO_TEST_CASE(BinaryThinning3D_test)
+{
+	// tube along y, the arc must reach the ends of the tube
+	{
+		const double a[3] = {20, 5, 20}, b[3] = {20, 34, 20};
+		auto tube = make_mask([&](double x, double y, double z) { return segment_distance(x, y, z, a, b) <= 3.5; });
+		auto skeleton = check_thinning(tube, 1);
+		auto ends = end_points(skeleton);
+		BOOST_REQUIRE_EQUAL(ends.size(), 2);
+		const std::ptrdiff_t y0 = ends[0] / s % s - 1, y1 = ends[1] / s % s - 1;
+		BOOST_CHECK_LE(std::min(y0, y1), 5 + 4);
+		BOOST_CHECK_GE(std::max(y0, y1), 34 - 4);
+	}
+
+	// three branches
+	{
+		const double c[3] = {20, 20, 20}, a[3] = {20, 4, 20}, b[3] = {6, 30, 20}, d[3] = {34, 30, 26};
+		auto branches = make_mask([&](double x, double y, double z) {
+			return segment_distance(x, y, z, c, a) <= 3 || segment_distance(x, y, z, c, b) <= 3 || segment_distance(x, y, z, c, d) <= 3;
+		});
+		auto skeleton = check_thinning(branches, 1);
+		BOOST_CHECK_EQUAL(end_points(skeleton).size(), 3);
+	}
+
+	// hollow ball with a cavity
+	{
+		auto hollow = make_mask([](double x, double y, double z) {
+			double r = std::sqrt((x - 20) * (x - 20) + (y - 20) * (y - 20) + (z - 20) * (z - 20));
+			return r >= 7 && r <= 13;
+		});
+		check_thinning(hollow, 2);
+	}
+
+	// torus with a tunnel
+	{
+		auto torus = make_mask([](double x, double y, double z) {
+			double r = std::sqrt((x - 20) * (x - 20) + (y - 20) * (y - 20)) - 11;
+			return r * r + (z - 20) * (z - 20) <= 16;
+		});
+		check_thinning(torus, 0);
+	}
+
+	// an arc is already thin and is not modified
+	{
+		auto arc = make_mask([](double, double, double) { return false; });
+		const int moves[4][3] = {{1, 0, 0}, {1, 1, 0}, {0, 1, 1}, {1, 0, 1}};
+		itk::Index<3> idx = {5, 5, 5};
+		for (int i = 0; i <= 20; i++)
+		{
+			arc->SetPixel(idx, 1);
+			for (int k = 0; k < 3; k++)
+			{
+				idx[k] += moves[i % 4][k];
+			}
+		}
+		auto skeleton = check_thinning(arc, 1);
+		BOOST_CHECK(skeleton == to_buffer(arc));
+	}
+
+	// random blobs
+	srand(5);
+	for (int trial = 0; trial < 10; ++trial)
+	{
+		std::vector<std::array<double, 4>> balls(2 + rand() % 6);
+		for (auto& ball : balls)
+		{
+			ball = {4.0 + rand() % 32, 4.0 + rand() % 32, 4.0 + rand() % 32, 2.0 + rand() % 8};
+		}
+		auto blobs = make_mask([&](double x, double y, double z) {
+			for (const auto& ball : balls)
+			{
+				double dx = x - ball[0], dy = y - ball[1], dz = z - ball[2];
+				if (dx * dx + dy * dy + dz * dz <= ball[3] * ball[3])
+				{
+					return true;
+				}
+			}
+			return false;
+		});
+		check_thinning(blobs, euler_characteristic(to_buffer(blobs)));
+	}
+}
+
 // TestRunner.exe --run_test=iSeg_suite/BinaryThinning_suite/ImageConnectivityGraph_test --log_level=message
 BOOST_AUTO_TEST_CASE(ImageConnectivityGraph_test)
 {
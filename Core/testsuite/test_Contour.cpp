@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include <boost/test/unit_test.hpp>
+
+#include "../Contour.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+namespace iseg {
+
+namespace {
+Point make_point(short x, short y)
+{
+	Point p;
+	p.px = x;
+	p.py = y;
+	return p;
+}
+
+// the recursive implementation which PolylineSimplifier replaced
+void reference_doug_peuck_sub(float epsilon, const unsigned int p1, const unsigned int p2,
+		std::vector<Point>& plist, std::vector<bool>* v1_p)
+{
+	if (p2 <= p1 + 1)
+		return;
+	float dv, l;
+	float max_dist = 0;
+	Point SIJ, SIV;
+	unsigned int max_pos = p1;
+
+	SIJ.px = plist[p2].px - plist[p1].px;
+	SIJ.py = plist[p2].py - plist[p1].py;
+
+	l = dist(&SIJ);
+
+	for (unsigned int i = p1 + 1; i < p2; i++)
+	{
+		SIV.px = plist[i].px - plist[p1].px;
+		SIV.py = plist[i].py - plist[p1].py;
+		dv = cross(&SIV, &SIJ) / l;
+		if (dv > max_dist)
+		{
+			max_dist = dv;
+			max_pos = i;
+		}
+	}
+
+	if (max_dist > epsilon)
+	{
+		(*v1_p)[max_pos] = true;
+		reference_doug_peuck_sub(epsilon, p1, max_pos, plist, v1_p);
+		reference_doug_peuck_sub(epsilon, max_pos, p2, plist, v1_p);
+	}
+}
+
+std::vector<Point> reference_doug_peuck(std::vector<Point> plist, float epsilon)
+{
+	unsigned int n = (unsigned int)plist.size();
+	if (n <= 2)
+		return plist;
+
+	std::vector<bool> v1(n, false);
+	v1[0] = true;
+	v1[n - 1] = true;
+	reference_doug_peuck_sub(epsilon, 0, n - 1, plist, &v1);
+
+	std::vector<Point> result;
+	for (unsigned int i = 0; i < n; i++)
+	{
+		if (v1[i])
+			result.push_back(plist[i]);
+	}
+	return result;
+}
+
+// random walk with steps of up to 2 pixels
+std::vector<Point> random_open_contour(unsigned n)
+{
+	std::vector<Point> pts;
+	short x = 100, y = 100;
+	for (unsigned i = 0; i < n; i++)
+	{
+		pts.push_back(make_point(x, y));
+		x += short(rand() % 5 - 2);
+		y += short(rand() % 5 - 2);
+	}
+	return pts;
+}
+
+// star shaped outline, the first point is repeated at the end
+std::vector<Point> random_closed_contour(unsigned n)
+{
+	std::vector<Point> pts;
+	for (unsigned i = 0; i < n; i++)
+	{
+		float phi = 6.2831853f * i / n;
+		float r = 20.f + 30.f * rand() / RAND_MAX;
+		pts.push_back(make_point(short(100 + r * std::cos(phi)), short(100 + r * std::sin(phi))));
+	}
+	pts.push_back(pts.front());
+	return pts;
+}
+
+void check_same_points(const std::vector<Point>& a, const std::vector<Point>& b)
+{
+	BOOST_REQUIRE_EQUAL(a.size(), b.size());
+	for (size_t i = 0; i < a.size(); i++)
+	{
+		BOOST_REQUIRE_EQUAL(a[i].px, b[i].px);
+		BOOST_REQUIRE_EQUAL(a[i].py, b[i].py);
+	}
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(iSeg_suite);
+BOOST_AUTO_TEST_SUITE(Contour_suite);
+
+// TestRunner.exe --run_test=iSeg_suite/Contour_suite/Simplify_test --log_level=message
+BOOST_AUTO_TEST_CASE(Simplify_test)
+{
+	// a staircase along a line with one spike, the spike must survive
+	std::vector<Point> line;
+	for (short i = 0; i < 1000; i++)
+	{
+		line.push_back(make_point(i, i / 2));
+	}
+	line[500] = make_point(500, 300);
+
+	PolylineSimplifier simplifier;
+	std::vector<Point> simplified = line;
+	simplifier.simplify(simplified, 2.f);
+
+	BOOST_REQUIRE(simplified.size() >= 3);
+	BOOST_CHECK(simplified.size() < 20);
+	BOOST_CHECK_EQUAL(simplified.front().px, 0);
+	BOOST_CHECK_EQUAL(simplified.back().px, 999);
+	bool has_spike = false;
+	for (auto p : simplified)
+		has_spike |= (p.px == 500 && p.py == 300);
+	BOOST_CHECK(has_spike);
+
+	// reusing the simplifier gives the same result
+	std::vector<Point> again = line;
+	simplifier.simplify(again, 2.f);
+	BOOST_REQUIRE_EQUAL(again.size(), simplified.size());
+
+	// the Contour wrapper is unchanged
+	Contour contour(&line);
+	contour.doug_peuck(2.f, false);
+	BOOST_CHECK_EQUAL(contour.return_n(), simplified.size());
+}
+
+// TestRunner.exe --run_test=iSeg_suite/Contour_suite/SimplifyReference_test --log_level=message
+BOOST_AUTO_TEST_CASE(SimplifyReference_test)
+{
+	srand(11);
+
+	// one simplifier for all lines, to cover the reuse of its buffers
+	PolylineSimplifier simplifier;
+	for (int k = 0; k < 200; k++)
+	{
+		bool closed = (k % 2) != 0;
+		unsigned n = 2 + rand() % 400;
+		std::vector<Point> line = closed ? random_closed_contour(n) : random_open_contour(n);
+
+		for (float epsilon : {0.f, 0.5f, 1.f, 2.5f, 10.f})
+		{
+			std::vector<Point> expected = reference_doug_peuck(line, epsilon);
+
+			std::vector<Point> simplified = line;
+			simplifier.simplify(simplified, epsilon);
+			check_same_points(simplified, expected);
+
+			std::vector<Point> line_copy = line;
+			Contour contour(&line_copy);
+			contour.doug_peuck(epsilon, closed);
+			std::vector<Point> result;
+			contour.return_contour(&result);
+			check_same_points(result, expected);
+		}
+	}
+}
+
+// TestRunner.exe --run_test=iSeg_suite/Contour_suite/Closed_test --log_level=message
+BOOST_AUTO_TEST_CASE(Closed_test)
+{
+	// closed square outline with 4 points per side
+	std::vector<Point> square;
+	for (short i = 0; i < 4; i++)
+		square.push_back(make_point(i, 0));
+	for (short i = 0; i < 4; i++)
+		square.push_back(make_point(4, i));
+	for (short i = 4; i > 0; i--)
+		square.push_back(make_point(i, 4));
+	for (short i = 4; i > 0; i--)
+		square.push_back(make_point(0, i));
+
+	std::vector<unsigned> meetings;
+	std::vector<Point> result;
+	Contour2 cc2;
+	cc2.doug_peuck(0.5f, &square, &meetings, &result);
+
+	// only the corners are kept
+	BOOST_CHECK_EQUAL(result.size(), 4);
+	for (auto p : result)
+	{
+		BOOST_CHECK(p.px == 0 || p.px == 4);
+		BOOST_CHECK(p.py == 0 || p.py == 4);
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_AUTO_TEST_SUITE_END();
+
+} // namespace iseg
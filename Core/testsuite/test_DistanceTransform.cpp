@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include <boost/test/unit_test.hpp>
+
+#include "../DistanceTransform.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+namespace iseg {
+
+namespace {
+// the 8-neighbor dead reckoning of bmphandler::dead_reckoning, which the exact transform replaces
+void dead_reckoning_reference(std::vector<float>& d, unsigned short width, unsigned short height)
+{
+	const unsigned area = unsigned(width) * height;
+	std::vector<unsigned> P(area, area);
+	for (unsigned i = 0; i < area; i++)
+	{
+		if (d[i] == 0)
+			P[i] = i;
+		else
+			d[i] = float((width + height) * (width + height));
+	}
+
+	const float d1 = 1;
+	const float d2 = std::sqrt(2.0f);
+	auto propagate = [&](unsigned j, unsigned q, int l, int k, float step) {
+		if (d[q] + step < d[j])
+		{
+			P[j] = P[q];
+			const float dx = float(l - int(P[j] % width));
+			const float dy = float(k - int(P[j] / width));
+			d[j] = std::sqrt(dx * dx + dy * dy);
+		}
+	};
+	auto forward = [&]() {
+		unsigned j = 0;
+		for (int k = 0; k < height; k++)
+		{
+			for (int l = 0; l < width; l++, j++)
+			{
+				if (k > 0)
+				{
+					if (l > 0)
+						propagate(j, j - 1 - width, l, k, d2);
+					propagate(j, j - width, l, k, d1);
+					if (l + 1 != width)
+						propagate(j, j + 1 - width, l, k, d2);
+				}
+				if (l > 0)
+					propagate(j, j - 1, l, k, d1);
+			}
+		}
+	};
+
+	forward();
+	unsigned j = area - 1;
+	for (int k = height - 1; k >= 0; k--)
+	{
+		for (int l = width - 1; l >= 0; l--, j--)
+		{
+			if (l + 1 != width)
+				propagate(j, j + 1, l, k, d1);
+			if (k + 1 != height)
+			{
+				if (l > 0)
+					propagate(j, j - 1 + width, l, k, d2);
+				propagate(j, j + width, l, k, d1);
+				if (l + 1 != width)
+					propagate(j, j + 1 + width, l, k, d2);
+			}
+		}
+	}
+	forward();
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(iSeg_suite);
+BOOST_AUTO_TEST_SUITE(DistanceTransform_suite);
+
+// TestRunner.exe --run_test=iSeg_suite/DistanceTransform_suite/Anisotropic_test --log_level=message
+BOOST_AUTO_TEST_CASE(Anisotropic_test)
+{
+	const int w = 19, h = 13, d = 11;
+	const size_t area = w * h;
+	const float spacing[3] = {0.5f, 1.25f, 2.f};
+	const float inf = std::numeric_limits<float>::infinity();
+
+	std::vector<int> features;
+	for (int i = 0; i < static_cast<int>(area) * d; i += 97)
+		features.push_back(i);
+
+	std::vector<float> image(area * d, inf);
+	for (auto i : features)
+		image[i] = 0.f;
+
+	std::vector<float*> slices(d);
+	for (int z = 0; z < d; z++)
+		slices[z] = image.data() + z * area;
+
+	squared_distance_transform(slices, w, h, spacing);
+
+	for (int z = 0; z < d; z++)
+	{
+		for (int y = 0; y < h; y++)
+		{
+			for (int x = 0; x < w; x++)
+			{
+				double best = inf;
+				for (auto i : features)
+				{
+					double dx = (x - i % w) * spacing[0];
+					double dy = (y - (i / w) % h) * spacing[1];
+					double dz = (z - i / static_cast<int>(area)) * spacing[2];
+					best = std::min(best, dx * dx + dy * dy + dz * dz);
+				}
+				BOOST_REQUIRE_CLOSE(image[z * area + y * w + x] + 1.0, best + 1.0, 1e-4);
+			}
+		}
+	}
+}
+
+// TestRunner.exe --run_test=iSeg_suite/DistanceTransform_suite/Empty_test --log_level=message
+BOOST_AUTO_TEST_CASE(Empty_test)
+{
+	const float inf = std::numeric_limits<float>::infinity();
+	const float spacing[3] = {1.f, 1.f, 1.f};
+
+	std::vector<float> image(5 * 4 * 3, inf);
+	std::vector<float*> slices = {image.data(), image.data() + 20, image.data() + 40};
+	squared_distance_transform(slices, 5, 4, spacing);
+
+	for (auto v : image)
+		BOOST_CHECK_EQUAL(v, inf);
+}
+
+// TestRunner.exe --run_test=iSeg_suite/DistanceTransform_suite/DeadReckoning_test --log_level=message
+BOOST_AUTO_TEST_CASE(DeadReckoning_test)
+{
+	const unsigned short w = 73, h = 58;
+	const unsigned area = unsigned(w) * h;
+	const float inf = std::numeric_limits<float>::infinity();
+
+	srand(3);
+	for (int trial = 0; trial < 20; trial++)
+	{
+		// features on the boundary of random discs, like the contours used by bmphandler
+		std::vector<float> image(area, inf);
+		for (int disc = 0; disc < 1 + trial % 4; disc++)
+		{
+			const int cx = rand() % w, cy = rand() % h, r = 2 + rand() % 20;
+			for (int y = 0; y < h; y++)
+			{
+				for (int x = 0; x < w; x++)
+				{
+					const int d2 = (x - cx) * (x - cx) + (y - cy) * (y - cy);
+					if (d2 <= r * r && d2 > (r - 1) * (r - 1))
+						image[y * w + x] = 0.f;
+				}
+			}
+		}
+
+		std::vector<float> reference(image);
+		dead_reckoning_reference(reference, w, h);
+
+		std::vector<unsigned> nearest(area);
+		squared_distance_transform(image.data(), w, h, nearest.data());
+
+		for (unsigned i = 0; i < area; i++)
+		{
+			const float distance = std::sqrt(image[i]);
+
+			// the nearest feature is at the computed distance
+			BOOST_REQUIRE_LT(nearest[i], area);
+			const float dx = float(int(i % w) - int(nearest[i] % w));
+			const float dy = float(int(i / w) - int(nearest[i] / w));
+			BOOST_REQUIRE_CLOSE(std::sqrt(dx * dx + dy * dy) + 1.f, distance + 1.f, 1e-4);
+
+			// dead reckoning overestimates the exact distance by less than a pixel
+			BOOST_REQUIRE_GE(reference[i] + 1e-4f, distance);
+			BOOST_REQUIRE_LE(reference[i], distance + 1.f);
+		}
+	}
+
+	// without features, the nearest pixel is reported as none
+	std::vector<float> empty(area, inf);
+	std::vector<unsigned> nearest(area, 0);
+	squared_distance_transform(empty.data(), w, h, nearest.data());
+	BOOST_CHECK_EQUAL(std::count(nearest.begin(), nearest.end(), area), area);
+	BOOST_CHECK_EQUAL(std::count(empty.begin(), empty.end(), inf), area);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_AUTO_TEST_SUITE_END();
+
+} // namespace iseg
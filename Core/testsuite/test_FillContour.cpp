@@ -0,0 +1,321 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include <boost/test/unit_test.hpp>
+
+#include "../fillcontour.h"
+
+#include <boost/chrono.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <list>
+#include <memory>
+#include <vector>
+
+namespace iseg {
+
+namespace {
+
+struct Transition
+{
+	bool to_inside;
+	float pos;
+	bool operator<(const Transition& a) const { return pos < a.pos; }
+};
+
+// the filler before the active edge table: a sorted list of transitions per row
+void reference_fill(bool* array, unsigned short* extents, float* origin, float* pixel_size,
+		float* dc, float** points, unsigned int* nrpoints, unsigned int nrcontours)
+{
+	float tol = 0.1 * pixel_size[0];
+	std::vector<std::list<Transition>> inouts(extents[1]);
+	float swap_x = dc[0], swap_y = dc[4];
+	for (unsigned int i = 0; i < nrcontours; i++)
+	{
+		float area = 0;
+		unsigned n = nrpoints[i];
+		for (unsigned k = 0; k < n; k++)
+		{
+			unsigned l = (k + 1) % n;
+			area += (points[i][3 * k + 1] + points[i][3 * l + 1]) * (points[i][3 * l] - points[i][3 * k]);
+		}
+		bool clockwisefill = ((area / 2 > 0) != fillcontours::is_hole(points, nrpoints, nrcontours, i));
+		if (swap_x * swap_y < 0)
+			clockwisefill = !clockwisefill;
+
+		for (unsigned k = 0; k < n; k++)
+		{
+			unsigned l = (k + 1) % n;
+			float x0 = swap_x * points[i][3 * k], y0 = swap_y * points[i][3 * k + 1];
+			float x1 = swap_x * points[i][3 * l], y1 = swap_y * points[i][3 * l + 1];
+			if (y0 == y1)
+				continue;
+			float slope = (x0 - x1) / (y0 - y1);
+			bool down = y0 > y1;
+			float xl = down ? x1 : x0, yl = down ? y1 : y0, yh = down ? y0 : y1;
+			Transition trans;
+			trans.to_inside = (down != clockwisefill);
+			int begin_h = (int)std::ceil((yl - swap_y * origin[1]) / pixel_size[1]);
+			int end_h = (int)std::floor((yh - swap_y * origin[1]) / pixel_size[1]);
+			end_h = std::min(end_h, extents[1] - 1);
+			for (int h = std::max(begin_h, 0); h <= end_h; h++)
+			{
+				if (trans.to_inside)
+					trans.pos = (xl - swap_x * origin[0]) - tol + (pixel_size[1] * h + (swap_y * origin[1] - yl)) * slope;
+				else
+					trans.pos = (xl - swap_x * origin[0]) + tol + (pixel_size[1] * h + (swap_y * origin[1] - yl)) * slope;
+				inouts[h].push_back(trans);
+			}
+		}
+	}
+
+	for (auto& l : inouts)
+		l.sort();
+
+	unsigned long position = extents[0] * (unsigned long)(extents[1] - 1);
+	for (unsigned short h = 0; h < extents[1]; h++)
+	{
+		bool status = false;
+		auto it = inouts[h].begin();
+		while (it != inouts[h].end() && it->pos < 0)
+		{
+			status = it->to_inside;
+			it++;
+		}
+		for (unsigned short w = 0; w < extents[0]; w++)
+		{
+			while (it != inouts[h].end() && it->pos < w * pixel_size[0])
+			{
+				if (status && !it->to_inside)
+				{
+					it++;
+					if (it == inouts[h].end() || it->to_inside)
+						status = false;
+				}
+				else
+				{
+					status = it->to_inside;
+					it++;
+				}
+			}
+			array[position++] = status;
+		}
+		position -= 2 * extents[0];
+	}
+}
+
+// star shaped random polygon around (cx, cy), in either orientation
+std::vector<float> random_contour(float cx, float cy, float radius, unsigned n, float z)
+{
+	std::vector<float> pts;
+	bool reverse = rand() % 2 != 0;
+	for (unsigned k = 0; k < n; k++)
+	{
+		float a = 6.2831853f * (reverse ? n - k : k) / n;
+		float r = radius * (0.3f + 0.7f * rand() / RAND_MAX);
+		pts.push_back(cx + r * std::cos(a));
+		pts.push_back(cy + r * std::sin(a));
+		pts.push_back(z);
+	}
+	return pts;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(iSeg_suite);
+BOOST_AUTO_TEST_SUITE(FillContour_suite);
+
+// TestRunner.exe --run_test=iSeg_suite/FillContour_suite/Nested_test --log_level=message
+BOOST_AUTO_TEST_CASE(Nested_test)
+{
+	unsigned short extents[2] = {97, 83};
+	float pixel_size[2] = {0.5f, 0.75f};
+	float origin[3] = {-10.f, -20.f, 0.f};
+
+	srand(7);
+	for (int trial = 0; trial < 200; trial++)
+	{
+		float dc[6] = {1, 0, 0, 0, 1, 0};
+		if (trial % 3 == 1)
+		{
+			dc[0] = -1;
+			origin[0] = 10.f;
+		}
+		else
+		{
+			origin[0] = -10.f;
+		}
+
+		// an outline with a hole, and a second outline which may overlap
+		std::vector<std::vector<float>> contours;
+		float cx = dc[0] * (-10.f + 24.f), cy = -20.f + 31.f;
+		contours.push_back(random_contour(cx, cy, 12.f, 3 + rand() % 30, 0.f));
+		contours.push_back(random_contour(cx, cy, 2.f, 3 + rand() % 10, 0.f));
+		contours.push_back(random_contour(cx + dc[0] * 10.f, cy + 15.f, 8.f, 3 + rand() % 20, 0.f));
+
+		std::vector<float*> points;
+		std::vector<unsigned int> nrpoints;
+		for (auto& c : contours)
+		{
+			points.push_back(c.data());
+			nrpoints.push_back(static_cast<unsigned>(c.size() / 3));
+		}
+
+		std::unique_ptr<bool[]> expected(new bool[extents[0] * extents[1]]);
+		std::unique_ptr<bool[]> mask(new bool[extents[0] * extents[1]]);
+		reference_fill(expected.get(), extents, origin, pixel_size, dc, points.data(), nrpoints.data(), 3);
+		fillcontours::fill_contour(mask.get(), extents, origin, pixel_size, dc, points.data(), nrpoints.data(), 3, false);
+
+		for (int i = 0; i < extents[0] * extents[1]; i++)
+		{
+			BOOST_REQUIRE_EQUAL(mask[i], expected[i]);
+		}
+	}
+}
+
+// TestRunner.exe --run_test=iSeg_suite/FillContour_suite/Winding_test --log_level=message
+BOOST_AUTO_TEST_CASE(Winding_test)
+{
+	unsigned short extents[2] = {64, 48};
+	float pixel_size[2] = {1.f, 1.f};
+	float origin[3] = {0.f, 0.f, 0.f};
+	float dc[6] = {1, 0, 0, 0, 1, 0};
+
+	// two overlapping squares with the same orientation, and a third one reversed
+	float square1[] = {10.3f, 10.3f, 0, 40.3f, 10.3f, 0, 40.3f, 30.3f, 0, 10.3f, 30.3f, 0};
+	float square2[] = {20.3f, 20.3f, 0, 50.3f, 20.3f, 0, 50.3f, 40.3f, 0, 20.3f, 40.3f, 0};
+	float square3[] = {25.3f, 5.3f, 0, 25.3f, 15.3f, 0, 35.3f, 15.3f, 0, 35.3f, 5.3f, 0};
+	float* points[] = {square1, square2, square3};
+	unsigned int nrpoints[] = {4, 4, 4};
+
+	fillcontours::ScanlineFiller filler;
+	for (auto rule : {fillcontours::kEvenOdd, fillcontours::kNonZero})
+	{
+		std::unique_ptr<bool[]> mask(new bool[extents[0] * extents[1]]);
+		filler.fill(mask.get(), extents, origin, pixel_size, dc, points, nrpoints, 3, rule);
+
+		for (int y = 0; y < extents[1]; y++)
+		{
+			for (int x = 0; x < extents[0]; x++)
+			{
+				auto in = [x, y](float* s) { return x > s[0] && x < s[6] && y > s[1] && y < s[7]; };
+				int winding = (in(square1) ? 1 : 0) + (in(square2) ? 1 : 0) - (x > 25.3f && x < 35.3f && y > 5.3f && y < 15.3f ? 1 : 0);
+				bool expected = (rule == fillcontours::kEvenOdd) ? (winding & 1) != 0 : winding != 0;
+				BOOST_REQUIRE_EQUAL(mask[(extents[1] - 1 - y) * extents[0] + x], expected);
+			}
+		}
+	}
+}
+
+// TestRunner.exe --run_test=iSeg_suite/FillContour_suite/Labels_test --log_level=message
+BOOST_AUTO_TEST_CASE(Labels_test)
+{
+	unsigned short extents[2] = {80, 70};
+	const size_t area = extents[0] * extents[1];
+	float pixel_size[2] = {0.5f, 0.5f};
+	float origin[3] = {0.f, 0.f, 0.f};
+	float dc[6] = {1, 0, 0, 0, 1, 0};
+
+	// labels 4 and 7 are locked, structure 2 has a locked label
+	const tissues_size_t structure_labels[] = {1, 2, 4, 3, 2};
+	const std::vector<bool> locked = {false, false, false, false, true, false, false, true};
+
+	srand(11);
+	for (int trial = 0; trial < 20; trial++)
+	{
+		std::vector<std::vector<float>> contours;
+		std::vector<std::vector<float*>> points(5);
+		std::vector<std::vector<unsigned int>> nrpoints(5);
+		for (int s = 0; s < 5; s++)
+		{
+			// a structure with an outline and a hole
+			const float cx = 10.f + 20.f * rand() / RAND_MAX, cy = 10.f + 15.f * rand() / RAND_MAX;
+			contours.push_back(random_contour(cx, cy, 9.f, 3 + rand() % 20, 0.f));
+			contours.push_back(random_contour(cx, cy, 1.5f, 3 + rand() % 8, 0.f));
+		}
+		for (int s = 0; s < 5; s++)
+		{
+			for (int c = 0; c < 2; c++)
+			{
+				points[s].push_back(contours[2 * s + c].data());
+				nrpoints[s].push_back(static_cast<unsigned>(contours[2 * s + c].size() / 3));
+			}
+		}
+
+		std::vector<tissues_size_t> initial(area);
+		for (auto& v : initial)
+			v = (rand() % 4 == 0) ? 7 : rand() % 3;
+
+		// filled one structure after the other
+		fillcontours::ScanlineFiller filler;
+		std::vector<tissues_size_t> expected = initial;
+		std::unique_ptr<bool[]> mask(new bool[area]);
+		std::vector<fillcontours::ScanlineFiller::Structure> structures;
+		for (int s = 0; s < 5; s++)
+		{
+			filler.fill(mask.get(), extents, origin, pixel_size, dc, points[s].data(), nrpoints[s].data(), 2);
+			for (size_t i = 0; i < area; i++)
+			{
+				if (mask[i] && !locked[expected[i]])
+					expected[i] = structure_labels[s];
+			}
+			structures.push_back({structure_labels[s], points[s].data(), nrpoints[s].data(), 2});
+		}
+
+		std::vector<tissues_size_t> labels = initial;
+		filler.fill_labels(labels.data(), extents, origin, pixel_size, dc, structures, locked);
+		BOOST_REQUIRE(labels == expected);
+	}
+}
+
+// TestRunner.exe --run_test=iSeg_suite/FillContour_suite/Benchmark_test --log_level=message
+BOOST_AUTO_TEST_CASE(Benchmark_test)
+{
+	unsigned short extents[2] = {512, 512};
+	float pixel_size[2] = {1.f, 1.f};
+	float origin[3] = {0.f, 0.f, 0.f};
+	float dc[6] = {1, 0, 0, 0, 1, 0};
+
+	srand(3);
+	std::vector<std::vector<float>> contours;
+	for (int i = 0; i < 20; i++)
+		contours.push_back(random_contour(50.f + 20.f * i, 60.f + 19.f * i, 40.f, 200, 0.f));
+	std::vector<float*> points;
+	std::vector<unsigned int> nrpoints;
+	for (auto& c : contours)
+	{
+		points.push_back(c.data());
+		nrpoints.push_back(static_cast<unsigned>(c.size() / 3));
+	}
+
+	std::unique_ptr<bool[]> expected(new bool[extents[0] * extents[1]]);
+	std::unique_ptr<bool[]> mask(new bool[extents[0] * extents[1]]);
+	const int repetitions = 20;
+
+	auto before = boost::chrono::high_resolution_clock::now();
+	for (int i = 0; i < repetitions; i++)
+		reference_fill(expected.get(), extents, origin, pixel_size, dc, points.data(), nrpoints.data(), 20);
+	auto middle = boost::chrono::high_resolution_clock::now();
+	fillcontours::ScanlineFiller filler;
+	for (int i = 0; i < repetitions; i++)
+		filler.fill(mask.get(), extents, origin, pixel_size, dc, points.data(), nrpoints.data(), 20);
+	auto after = boost::chrono::high_resolution_clock::now();
+
+	BOOST_CHECK(std::equal(mask.get(), mask.get() + extents[0] * extents[1], expected.get()));
+
+	BOOST_TEST_MESSAGE("Transition lists " << boost::chrono::duration_cast<boost::chrono::milliseconds>(middle - before).count() << "[ms]");
+	BOOST_TEST_MESSAGE("Active edge table " << boost::chrono::duration_cast<boost::chrono::milliseconds>(after - middle).count() << "[ms]");
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_AUTO_TEST_SUITE_END();
+
+} // namespace iseg
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include <boost/test/unit_test.hpp>
+
+#include "../HysteresisThreshold.h"
+
+#include <cmath>
+#include <vector>
+
+namespace iseg {
+
+namespace {
+// straightforward 3D flood fill, used as reference
+std::vector<float> reference_hysteresis(const std::vector<float>& img, int w, int h, int d,
+		float seed, float low, bool connectivity)
+{
+	std::vector<float> out(img.size(), 0.f);
+	std::vector<size_t> stack;
+	for (size_t i = 0; i < img.size(); i++)
+	{
+		if (img[i] >= seed)
+		{
+			out[i] = 255.f;
+			stack.push_back(i);
+		}
+	}
+	while (!stack.empty())
+	{
+		size_t i = stack.back();
+		stack.pop_back();
+		int x = static_cast<int>(i % w), y = static_cast<int>((i / w) % h), z = static_cast<int>(i / (w * h));
+		for (int dz = -1; dz <= 1; dz++)
+			for (int dy = -1; dy <= 1; dy++)
+				for (int dx = -1; dx <= 1; dx++)
+				{
+					int nb = std::abs(dx) + std::abs(dy) + std::abs(dz);
+					if (nb == 0 || (dz != 0 && nb > 1) || (!connectivity && nb > 1))
+						continue;
+					int xn = x + dx, yn = y + dy, zn = z + dz;
+					if (xn < 0 || yn < 0 || zn < 0 || xn >= w || yn >= h || zn >= d)
+						continue;
+					size_t j = (static_cast<size_t>(zn) * h + yn) * w + xn;
+					if (out[j] == 0.f && img[j] >= low)
+					{
+						out[j] = 255.f;
+						stack.push_back(j);
+					}
+				}
+	}
+	return out;
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(iSeg_suite);
+BOOST_AUTO_TEST_SUITE(HysteresisThreshold_suite);
+
+// TestRunner.exe --run_test=iSeg_suite/HysteresisThreshold_suite/Hysteresis_test --log_level=message
+BOOST_AUTO_TEST_CASE(Hysteresis_test)
+{
+	const int w = 37, h = 23, d = 41;
+	const size_t area = w * h;
+
+	std::vector<float> img(area * d);
+	for (size_t i = 0; i < img.size(); i++)
+	{
+		img[i] = 100.f * std::sin(0.37f * (i % w)) * std::cos(0.21f * ((i / w) % h)) * std::sin(0.13f * (i / area) + 0.5f);
+	}
+
+	for (bool connectivity : {false, true})
+	{
+		std::vector<float> out(img.size(), -1.f);
+		std::vector<const float*> src(d);
+		std::vector<float*> dst(d);
+		for (int z = 0; z < d; z++)
+		{
+			src[z] = img.data() + z * area;
+			dst[z] = out.data() + z * area;
+		}
+
+		HysteresisThreshold hysteresis(90.f, INFINITY, 20.f, INFINITY);
+		hysteresis.set_connectivity(connectivity);
+		hysteresis.execute(src, dst, w, h, 255.f);
+
+		BOOST_CHECK(out == reference_hysteresis(img, w, h, d, 90.f, 20.f, connectivity));
+	}
+}
+
+// TestRunner.exe --run_test=iSeg_suite/HysteresisThreshold_suite/Threshold_test --log_level=message
+BOOST_AUTO_TEST_CASE(Threshold_test)
+{
+	std::vector<float> img(3000);
+	for (size_t i = 0; i < img.size(); i++)
+		img[i] = static_cast<float>(i % 100);
+
+	for (auto thresholds : {std::vector<float>{2.f, 10.f, 50.f}, std::vector<float>{2.f, 50.f, 10.f}})
+	{
+		std::vector<float> out(img.size());
+		HysteresisThreshold::threshold(img.data(), out.data(), img.size(), thresholds.data());
+
+		for (size_t i = 0; i < img.size(); i++)
+		{
+			unsigned short j = 0;
+			while (j < 2 && img[i] > thresholds[j + 1])
+				j++;
+			BOOST_REQUIRE_EQUAL(out[i], j * (255.0f / 2));
+		}
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_AUTO_TEST_SUITE_END();
+
+} // namespace iseg
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include <boost/test/unit_test.hpp>
+
+#include "../SliceResampler.h"
+
+#include <cmath>
+#include <vector>
+
+namespace iseg {
+
+BOOST_AUTO_TEST_SUITE(iSeg_suite);
+BOOST_AUTO_TEST_SUITE(SliceResampler_suite);
+
+// TestRunner.exe --run_test=iSeg_suite/SliceResampler_suite/Nearest_test --log_level=message
+BOOST_AUTO_TEST_CASE(Nearest_test)
+{
+	const int w = 41, h = 29;
+	std::vector<tissues_size_t> src(w * h), dst(w * h);
+	for (int i = 0; i < w * h; i++)
+		src[i] = static_cast<tissues_size_t>(i % 251);
+
+	// rotation about the center, once affine and once with a projective part
+	const double c = std::cos(0.3), s = std::sin(0.3);
+	const double affine[9] = {c, s, 20 - 20 * c - 14 * s, -s, c, 14 + 20 * s - 14 * c, 0, 0, 1};
+	const double projective[9] = {c, s, 20 - 20 * c - 14 * s, -s, c, 14 + 20 * s - 14 * c, 0.001, -0.002, 1.1};
+
+	for (auto m : {affine, projective})
+	{
+		SliceResampler resampler(m, w, h);
+		BOOST_CHECK_EQUAL(resampler.is_affine(), m == affine);
+		resampler.resample(src.data(), dst.data());
+
+		for (int y = 0; y < h; y++)
+		{
+			for (int x = 0; x < w; x++)
+			{
+				double a = m[0] * x + m[1] * y + m[2];
+				double b = m[3] * x + m[4] * y + m[5];
+				double d = m[6] * x + m[7] * y + m[8];
+				long xs = std::lround(a / d), ys = std::lround(b / d);
+				// positions within rounding error of a pixel boundary may go either way
+				if (std::abs(std::abs(a / d - std::floor(a / d)) - 0.5) < 1e-9 ||
+						std::abs(std::abs(b / d - std::floor(b / d)) - 0.5) < 1e-9)
+					continue;
+				tissues_size_t expected = (xs >= 0 && ys >= 0 && xs < w && ys < h) ? src[ys * w + xs] : 0;
+				BOOST_REQUIRE_EQUAL(dst[y * w + x], expected);
+			}
+		}
+	}
+}
+
+// TestRunner.exe --run_test=iSeg_suite/SliceResampler_suite/Interpolation_test --log_level=message
+BOOST_AUTO_TEST_CASE(Interpolation_test)
+{
+	const int w = 16, h = 12;
+	std::vector<float> src(w * h), dst(w * h);
+	for (int y = 0; y < h; y++)
+		for (int x = 0; x < w; x++)
+			src[y * w + x] = 2.f * x + 3.f * y;
+
+	// shift by half a pixel: linear and cubic interpolation reproduce the ramp
+	const double shift[9] = {1, 0, 0.5, 0, 1, 0.25, 0, 0, 1};
+	for (auto interpolation : {SliceResampler::kLinear, SliceResampler::kCubic})
+	{
+		SliceResampler(shift, w, h).resample(src.data(), dst.data(), interpolation);
+		for (int y = 1; y + 2 < h; y++)
+		{
+			for (int x = 1; x + 2 < w; x++)
+			{
+				BOOST_REQUIRE_CLOSE(dst[y * w + x], 2.f * (x + 0.5f) + 3.f * (y + 0.25f), 1e-3);
+			}
+		}
+		// pixels which map outside are cleared
+		BOOST_CHECK_EQUAL(dst[w - 1], 0.f);
+	}
+
+	const double identity[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+	SliceResampler(identity, w, h).resample(src.data(), dst.data(), SliceResampler::kCubic);
+	BOOST_CHECK(dst == src);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_AUTO_TEST_SUITE_END();
+
+} // namespace iseg
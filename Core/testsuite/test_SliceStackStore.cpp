@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include <boost/test/unit_test.hpp>
+
+#include "../SliceStackStore.h"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace iseg {
+
+namespace {
+std::vector<float> make_image(size_t n, int seed)
+{
+	std::vector<float> img(n);
+	for (size_t i = 0; i < n; ++i)
+	{
+		img[i] = std::sin(0.01f * i + seed) * 1000.f + (i % 7) * 0.125f;
+	}
+	return img;
+}
+
+bool bitwise_equal(const std::vector<float>& a, const std::vector<float>& b)
+{
+	return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0;
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(iSeg_suite);
+BOOST_AUTO_TEST_SUITE(SliceStackStore_suite);
+
+// TestRunner.exe --run_test=iSeg_suite/SliceStackStore_suite/Codec_test --log_level=message
+BOOST_AUTO_TEST_CASE(Codec_test)
+{
+	const size_t n = 257 * 131;
+
+	std::vector<std::vector<float>> images;
+	images.push_back(std::vector<float>(n, 0.f));
+	images.push_back(std::vector<float>(n, -0.f));
+	images.push_back(make_image(n, 3));
+
+	std::vector<float> mask(n, 0.f);
+	for (size_t i = n / 3; i < n / 2; ++i)
+		mask[i] = 255.f;
+	images.push_back(mask);
+
+	for (auto& img : images)
+	{
+		auto code = SliceStackStore::encode(img.data(), n);
+		std::vector<float> decoded(n, 42.f);
+		BOOST_REQUIRE(SliceStackStore::decode(code, decoded.data(), n));
+		BOOST_CHECK(bitwise_equal(img, decoded));
+	}
+
+	// masks should compress well
+	auto code = SliceStackStore::encode(mask.data(), n);
+	BOOST_CHECK_LT(code.size(), n / 8);
+}
+
+// TestRunner.exe --run_test=iSeg_suite/SliceStackStore_suite/Spill_test --log_level=message
+BOOST_AUTO_TEST_CASE(Spill_test)
+{
+	const size_t n = 128 * 128;
+
+	SliceStackStore store;
+	store.set_memory_budget(n); // roughly one compressed image
+
+	for (unsigned h = 1; h <= 10; ++h)
+	{
+		auto img = make_image(n, h);
+		store.push(h, img.data(), n, static_cast<unsigned char>(h % 3));
+	}
+	store.flush();
+
+	BOOST_CHECK_EQUAL(store.size(), 10);
+	BOOST_CHECK_LE(store.memory_usage(), n);
+
+	for (unsigned h = 1; h <= 10; ++h)
+	{
+		std::vector<float> img(n);
+		unsigned char mode = 0;
+		BOOST_REQUIRE(store.get(h, img.data(), n, mode));
+		BOOST_CHECK_EQUAL(mode, h % 3);
+		BOOST_CHECK(bitwise_equal(img, make_image(n, h)));
+	}
+
+	BOOST_CHECK(store.remove(4));
+	BOOST_CHECK(!store.contains(4));
+
+	std::vector<float> img(n);
+	unsigned char mode = 0;
+	BOOST_CHECK(store.pop_back(img.data(), n, mode));
+	BOOST_CHECK(bitwise_equal(img, make_image(n, 10)));
+	BOOST_CHECK_EQUAL(store.size(), 8);
+
+	store.clear();
+	BOOST_CHECK(store.empty());
+}
+
+// TestRunner.exe --run_test=iSeg_suite/SliceStackStore_suite/SpillFileReuse_test --log_level=message
+BOOST_AUTO_TEST_CASE(SpillFileReuse_test)
+{
+	const size_t n = 128 * 128;
+
+	SliceStackStore store;
+	store.set_memory_budget(n);
+
+	// keep at most 4 entries, replacing and removing the others as a long session would
+	size_t max_file_size = 0;
+	for (unsigned h = 1; h <= 100; ++h)
+	{
+		auto img = make_image(n, h);
+		store.push(h, img.data(), n, 0);
+		if (h > 4)
+		{
+			BOOST_REQUIRE(store.remove(h - 4));
+		}
+		if (h % 10 == 0)
+		{
+			// overwrite an existing entry
+			auto other = make_image(n, 1000 + h);
+			store.push(h - 1, other.data(), n, 1);
+		}
+		store.flush();
+		if (h == 20)
+		{
+			max_file_size = store.file_size();
+		}
+	}
+	BOOST_CHECK_GT(max_file_size, 0);
+	BOOST_CHECK_LE(store.file_size(), 2 * max_file_size);
+
+	for (unsigned h = 97; h <= 100; ++h)
+	{
+		std::vector<float> img(n);
+		unsigned char mode = 0;
+		BOOST_REQUIRE(store.get(h, img.data(), n, mode));
+		BOOST_CHECK(bitwise_equal(img, h == 99 ? make_image(n, 1100) : make_image(n, h)));
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_AUTO_TEST_SUITE_END();
+
+} // namespace iseg
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include <boost/test/unit_test.hpp>
+
+#include "../SliceTranspose.h"
+
+#include <cstdlib>
+#include <vector>
+
+namespace iseg {
+
+namespace {
+int allocations_left = 0;
+
+/// fails once, after allocations_left successful allocations
+void* failing_malloc(size_t size)
+{
+	return (allocations_left-- == 0) ? nullptr : malloc(size);
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(iSeg_suite);
+BOOST_AUTO_TEST_SUITE(SliceTranspose_suite);
+
+// TestRunner.exe --run_test=iSeg_suite/SliceTranspose_suite/SwapAxes_test --log_level=message
+BOOST_AUTO_TEST_CASE(SwapAxes_test)
+{
+	const unsigned dims[3] = {37, 5, 11};
+
+	for (int axis1 = 0; axis1 < 3; axis1++)
+	{
+		for (int axis2 = axis1 + 1; axis2 < 3; axis2++)
+		{
+			std::vector<unsigned*> slices(dims[2]);
+			for (unsigned z = 0; z < dims[2]; z++)
+			{
+				slices[z] = static_cast<unsigned*>(malloc(sizeof(unsigned) * dims[0] * dims[1]));
+				for (unsigned i = 0; i < dims[0] * dims[1]; i++)
+					slices[z][i] = z * dims[0] * dims[1] + i;
+			}
+
+			swap_axes(slices, dims[0], dims[1], axis1, axis2);
+
+			unsigned new_dims[3] = {dims[0], dims[1], dims[2]};
+			std::swap(new_dims[axis1], new_dims[axis2]);
+			BOOST_REQUIRE_EQUAL(slices.size(), new_dims[2]);
+
+			unsigned p[3];
+			for (p[2] = 0; p[2] < new_dims[2]; p[2]++)
+			{
+				for (p[1] = 0; p[1] < new_dims[1]; p[1]++)
+				{
+					for (p[0] = 0; p[0] < new_dims[0]; p[0]++)
+					{
+						unsigned q[3] = {p[0], p[1], p[2]};
+						std::swap(q[axis1], q[axis2]);
+						BOOST_REQUIRE_EQUAL(slices[p[2]][p[1] * new_dims[0] + p[0]],
+								(q[2] * dims[1] + q[1]) * dims[0] + q[0]);
+					}
+				}
+			}
+
+			for (auto s : slices)
+				free(s);
+		}
+	}
+}
+
+// TestRunner.exe --run_test=iSeg_suite/SliceTranspose_suite/SwapAxesFailure_test --log_level=message
+BOOST_AUTO_TEST_CASE(SwapAxesFailure_test)
+{
+	const unsigned dims[3] = {7, 5, 11};
+	const unsigned n = dims[0] * dims[1];
+
+	for (int axis1 = 0; axis1 < 3; axis1++)
+	{
+		for (int axis2 = axis1 + 1; axis2 < 3; axis2++)
+		{
+			// fail at every allocation of the reallocated slices
+			for (int fail_at = 0; fail_at < 12; fail_at++)
+			{
+				std::vector<unsigned*> slices(dims[2]);
+				for (unsigned z = 0; z < dims[2]; z++)
+				{
+					slices[z] = static_cast<unsigned*>(malloc(sizeof(unsigned) * n));
+					for (unsigned i = 0; i < n; i++)
+						slices[z][i] = z * n + i;
+				}
+
+				allocations_left = fail_at;
+				slice_allocator() = &failing_malloc;
+				bool failed = false;
+				try
+				{
+					swap_axes(slices, dims[0], dims[1], axis1, axis2);
+				}
+				catch (std::bad_alloc&)
+				{
+					failed = true;
+				}
+				slice_allocator() = &malloc;
+
+				if (failed)
+				{
+					// the stack is unchanged
+					BOOST_REQUIRE_EQUAL(slices.size(), dims[2]);
+					for (unsigned z = 0; z < dims[2]; z++)
+					{
+						BOOST_REQUIRE(slices[z] != nullptr);
+						for (unsigned i = 0; i < n; i++)
+							BOOST_REQUIRE_EQUAL(slices[z][i], z * n + i);
+					}
+				}
+				else
+				{
+					BOOST_CHECK(axis1 + axis2 == 1 || fail_at >= static_cast<int>(dims[axis1]));
+				}
+
+				for (auto s : slices)
+					free(s);
+			}
+		}
+	}
+}
+
+// TestRunner.exe --run_test=iSeg_suite/SliceTranspose_suite/PermuteRows_test --log_level=message
+BOOST_AUTO_TEST_CASE(PermuteRows_test)
+{
+	const unsigned width = 3, height = 67, nrslices = 131;
+	const size_t nrows = static_cast<size_t>(height) * nrslices;
+
+	std::vector<std::vector<unsigned>> data(nrslices, std::vector<unsigned>(width * height));
+	std::vector<unsigned*> slices;
+	for (unsigned z = 0; z < nrslices; z++)
+	{
+		for (unsigned i = 0; i < width * height; i++)
+			data[z][i] = z * width * height + i;
+		slices.push_back(data[z].data());
+	}
+
+	// long cycles are split into segments of a few rows, and into no segments at all
+	for (size_t segment_length : {1, 4, 100, 0})
+	{
+		RowPermutationWorkspace<unsigned> workspace(nrows, width, segment_length);
+		permute_rows(slices, width, height, nrslices, workspace);
+		for (size_t r = 0; r + 1 < nrows; r++)
+		{
+			const size_t q = (r * nrslices) % (nrows - 1);
+			for (unsigned x = 0; x < width; x++)
+				BOOST_REQUIRE_EQUAL(slices[q / height][(q % height) * width + x], r * width + x);
+		}
+
+		permute_rows(slices, width, height, height, workspace);
+		for (unsigned z = 0; z < nrslices; z++)
+		{
+			for (unsigned i = 0; i < width * height; i++)
+				BOOST_REQUIRE_EQUAL(slices[z][i], z * width * height + i);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_AUTO_TEST_SUITE_END();
+
+} // namespace iseg
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include <boost/test/unit_test.hpp>
+
+#include "../TissueIndex.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+namespace iseg {
+
+namespace {
+
+void check_index(const TissueIndex& index, const std::vector<tissues_size_t>& slice, unsigned short w, unsigned short h)
+{
+	for (tissues_size_t t = 0; t < 8; t++)
+	{
+		unsigned long count = 0;
+		unsigned short expected[2][2] = {{w, 0}, {h, 0}};
+		for (unsigned short y = 0; y < h; y++)
+		{
+			for (unsigned short x = 0; x < w; x++)
+			{
+				if (slice[y * w + x] == t)
+				{
+					count++;
+					expected[0][0] = std::min(expected[0][0], x);
+					expected[0][1] = std::max(expected[0][1], x);
+					expected[1][0] = std::min(expected[1][0], y);
+					expected[1][1] = std::max(expected[1][1], y);
+				}
+			}
+		}
+
+		BOOST_REQUIRE_EQUAL(index.count(t), count);
+		BOOST_REQUIRE_EQUAL(index.contains(t), count != 0);
+		unsigned short extent[2][2];
+		BOOST_REQUIRE_EQUAL(index.extent(t, extent), count != 0);
+		if (count != 0)
+		{
+			BOOST_CHECK_EQUAL(extent[0][0], expected[0][0]);
+			BOOST_CHECK_EQUAL(extent[0][1], expected[0][1]);
+			BOOST_CHECK_EQUAL(extent[1][0], expected[1][0]);
+			BOOST_CHECK_EQUAL(extent[1][1], expected[1][1]);
+		}
+	}
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(iSeg_suite);
+BOOST_AUTO_TEST_SUITE(TissueIndex_suite);
+
+// TestRunner.exe --run_test=iSeg_suite/TissueIndex_suite/Build_test --log_level=message
+BOOST_AUTO_TEST_CASE(Build_test)
+{
+	const unsigned short w = 23, h = 17;
+	std::vector<tissues_size_t> slice(w * h, 0);
+	for (unsigned short y = 3; y < 9; y++)
+		for (unsigned short x = 5; x < 12; x++)
+			slice[y * w + x] = 2;
+	slice[16 * w + 22] = 7;
+
+	TissueIndex index;
+	BOOST_CHECK(!index.valid());
+	index.build(slice.data(), w, h);
+	BOOST_CHECK(index.valid());
+	check_index(index, slice, w, h);
+
+	auto present = index.tissues();
+	BOOST_REQUIRE_EQUAL(present.size(), 3);
+	BOOST_CHECK_EQUAL(present[0], 0);
+	BOOST_CHECK_EQUAL(present[1], 2);
+	BOOST_CHECK_EQUAL(present[2], 7);
+}
+
+// TestRunner.exe --run_test=iSeg_suite/TissueIndex_suite/Replace_test --log_level=message
+BOOST_AUTO_TEST_CASE(Replace_test)
+{
+	const unsigned short w = 19, h = 13;
+	std::vector<tissues_size_t> slice(w * h);
+	srand(42);
+	for (auto& v : slice)
+		v = static_cast<tissues_size_t>(rand() % 4);
+
+	TissueIndex index;
+	index.build(slice.data(), w, h);
+	for (int i = 0; i < 2000; i++)
+	{
+		unsigned short x = rand() % w, y = rand() % h;
+		tissues_size_t value = static_cast<tissues_size_t>(rand() % 8);
+		index.replace(x, y, slice[y * w + x], value);
+		slice[y * w + x] = value;
+		if (!index.valid())
+			index.build(slice.data(), w, h);
+		check_index(index, slice, w, h);
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_AUTO_TEST_SUITE_END();
+
+} // namespace iseg
@@ -0,0 +1,372 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include <boost/test/unit_test.hpp>
+
+#include "../VoxelSurface.h"
+
+#include "Data/Transform.h"
+
+#include <vtkBoundingBox.h>
+#include <vtkCellArray.h>
+#include <vtkCutter.h>
+#include <vtkImageData.h>
+#include <vtkImageStencil.h>
+#include <vtkLinearExtrusionFilter.h>
+#include <vtkNew.h>
+#include <vtkPlane.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkPolyDataToImageStencil.h>
+#include <vtkSmartPointer.h>
+#include <vtkStripper.h>
+#include <vtkUnsignedCharArray.h>
+
+#include <boost/chrono.hpp>
+
+#include <cmath>
+#include <vector>
+
+namespace iseg {
+
+namespace {
+
+/// UV sphere, closed and consistently oriented
+void make_sphere(double cx, double cy, double cz, double r, int nu, int nv,
+		std::vector<double>& points, std::vector<unsigned int>& triangles)
+{
+	const double pi = 3.14159265358979323846;
+	unsigned int const offset = static_cast<unsigned int>(points.size() / 3);
+	points.insert(points.end(), {cx, cy, cz - r});
+	for (int v = 1; v < nv; v++)
+	{
+		double theta = pi * v / nv;
+		for (int u = 0; u < nu; u++)
+		{
+			double phi = 2 * pi * u / nu;
+			points.insert(points.end(), {cx + r * std::sin(theta) * std::cos(phi),
+																			cy + r * std::sin(theta) * std::sin(phi),
+																			cz - r * std::cos(theta)});
+		}
+	}
+	points.insert(points.end(), {cx, cy, cz + r});
+
+	unsigned int const top = offset + 1 + (nv - 1) * nu;
+	auto ring = [&](int v, int u) { return offset + 1 + (v - 1) * nu + (u % nu); };
+	for (int u = 0; u < nu; u++)
+	{
+		triangles.insert(triangles.end(), {offset, ring(1, u + 1), ring(1, u)});
+		triangles.insert(triangles.end(), {top, ring(nv - 1, u), ring(nv - 1, u + 1)});
+		for (int v = 1; v + 1 < nv; v++)
+		{
+			triangles.insert(triangles.end(), {ring(v, u), ring(v, u + 1), ring(v + 1, u + 1)});
+			triangles.insert(triangles.end(), {ring(v, u), ring(v + 1, u + 1), ring(v + 1, u)});
+		}
+	}
+}
+
+/// reference: even-odd count of triangles hit by a ray along +x (serial, brute force)
+bool inside_reference(const std::vector<double>& points, const std::vector<unsigned int>& triangles,
+		double px, double py, double pz)
+{
+	int hits = 0;
+	for (size_t t = 0; t < triangles.size(); t += 3)
+	{
+		const double* a = &points[3 * triangles[t]];
+		const double* b = &points[3 * triangles[t + 1]];
+		const double* c = &points[3 * triangles[t + 2]];
+		// barycentric coordinates of (py, pz) in the projected triangle
+		double det = (b[1] - a[1]) * (c[2] - a[2]) - (c[1] - a[1]) * (b[2] - a[2]);
+		if (det == 0)
+			continue;
+		double s = ((py - a[1]) * (c[2] - a[2]) - (c[1] - a[1]) * (pz - a[2])) / det;
+		double r = ((b[1] - a[1]) * (pz - a[2]) - (py - a[1]) * (b[2] - a[2])) / det;
+		if (s < 0 || r < 0 || s + r > 1)
+			continue;
+		double x = a[0] + s * (b[0] - a[0]) + r * (c[0] - a[0]);
+		if (x > px)
+			hits++;
+	}
+	return (hits % 2) == 1;
+}
+
+vtkSmartPointer<vtkPolyData> make_polydata(const std::vector<double>& points, const std::vector<unsigned int>& triangles)
+{
+	auto pts = vtkSmartPointer<vtkPoints>::New();
+	for (size_t i = 0; i < points.size(); i += 3)
+		pts->InsertNextPoint(points[i], points[i + 1], points[i + 2]);
+	auto polys = vtkSmartPointer<vtkCellArray>::New();
+	for (size_t t = 0; t < triangles.size(); t += 3)
+	{
+		vtkIdType ids[3] = {triangles[t], triangles[t + 1], triangles[t + 2]};
+		polys->InsertNextCell(3, ids);
+	}
+	auto surface = vtkSmartPointer<vtkPolyData>::New();
+	surface->SetPoints(pts);
+	surface->SetPolys(polys);
+	return surface;
+}
+
+float round_me_up(float n, const float to_what)
+{
+	return std::ceil(n / to_what) * to_what;
+}
+
+float round_me_dn(float n, const float to_what)
+{
+	return std::floor(n / to_what) * to_what;
+}
+
+/// reference: the previous serial implementation (cutter, extrusion and stencil per slice), without transform
+void voxelize_vtk_reference(vtkPolyData* surface, float** slices, const unsigned dims[3],
+		const float spacing[3], float label, unsigned startslice, unsigned endslice)
+{
+	vtkBoundingBox surface_bb(surface->GetBounds());
+	vtkBoundingBox image_bb(0, (dims[0] - 1) * spacing[0], 0,
+			(dims[1] - 1) * spacing[1], 0,
+			(dims[2] - 1) * spacing[2]);
+
+	for (int z = static_cast<int>(startslice); z < static_cast<int>(endslice); z++)
+	{
+		auto z_pos = z * spacing[2];
+		if (z_pos < surface_bb.GetBound(4) || z_pos > surface_bb.GetBound(5))
+			continue;
+
+		vtkNew<vtkPlane> plane;
+		plane->SetNormal(0, 0, 1);
+		plane->SetOrigin(0, 0, z_pos);
+
+		vtkNew<vtkCutter> cutter;
+		cutter->SetCutFunction(plane.Get());
+		cutter->SetInputData(surface);
+
+		vtkNew<vtkStripper> stripper;
+		stripper->SetInputConnection(cutter->GetOutputPort());
+		stripper->Update();
+
+		vtkPolyData* contour = stripper->GetOutput();
+		if (contour->GetNumberOfLines() == 0)
+			continue;
+
+		vtkBoundingBox ct_bounds;
+		{
+			double bb[6];
+			contour->GetBounds(bb);
+			bb[0] = round_me_dn(bb[0], spacing[0]);
+			bb[1] = round_me_up(bb[1], spacing[0]);
+			bb[2] = round_me_dn(bb[2], spacing[1]);
+			bb[3] = round_me_up(bb[3], spacing[1]);
+			ct_bounds.SetBounds(bb);
+		}
+		ct_bounds.IntersectBox(image_bb);
+		int ct_dim[3] = {};
+		for (int d = 0; d < 3; d++)
+			ct_dim[d] = static_cast<int>(std::ceil(ct_bounds.GetLength(d) / spacing[d])) + 1;
+		const double* ct_origin = ct_bounds.GetMinPoint();
+
+		vtkNew<vtkImageData> image_data;
+		image_data->SetDimensions(ct_dim[0], ct_dim[1], 1);
+		image_data->SetSpacing(spacing[0], spacing[1], spacing[2]);
+		image_data->SetOrigin(ct_origin[0], ct_origin[1], ct_origin[2]);
+		image_data->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+		vtkUnsignedCharArray::SafeDownCast(image_data->GetPointData()->GetScalars())->FillComponent(0, 255);
+
+		vtkNew<vtkLinearExtrusionFilter> extruder;
+		extruder->SetInputData(contour);
+		extruder->SetScaleFactor(1.);
+		extruder->SetExtrusionTypeToNormalExtrusion();
+		extruder->SetVector(0, 0, 1);
+		extruder->Update();
+
+		vtkNew<vtkPolyDataToImageStencil> pol2stenc;
+		pol2stenc->SetTolerance(0);
+		pol2stenc->SetInputConnection(extruder->GetOutputPort());
+		pol2stenc->SetOutputOrigin(image_data->GetOrigin());
+		pol2stenc->SetOutputSpacing(image_data->GetSpacing());
+		pol2stenc->SetOutputWholeExtent(image_data->GetExtent());
+		pol2stenc->Update();
+
+		vtkNew<vtkImageStencil> imgstenc;
+		imgstenc->SetInputData(image_data.Get());
+		imgstenc->SetStencilConnection(pol2stenc->GetOutputPort());
+		imgstenc->ReverseStencilOff();
+		imgstenc->SetBackgroundValue(0);
+		imgstenc->Update();
+
+		vtkImageData* out = imgstenc->GetOutput();
+		if (out->GetNumberOfPoints() > 0)
+		{
+			int offset_x = static_cast<int>(std::floor(std::abs(ct_origin[0] / spacing[0]) + 0.5));
+			int offset_y = static_cast<int>(std::floor(std::abs(ct_origin[1] / spacing[1]) + 0.5));
+			for (int ct_y = 0; ct_y < ct_dim[1] - 1; ct_y++)
+			{
+				for (int ct_x = 0; ct_x < ct_dim[0] - 1; ct_x++)
+				{
+					auto pixel_val = static_cast<unsigned char*>(out->GetScalarPointer(ct_x, ct_y, 0));
+					if (pixel_val[0] == 255)
+						slices[z][(offset_x + ct_x) + (offset_y + ct_y) * dims[0]] = label;
+				}
+			}
+		}
+	}
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(iSeg_suite);
+BOOST_AUTO_TEST_SUITE(VoxelSurface_suite);
+
+// TestRunner.exe --run_test=iSeg_suite/VoxelSurface_suite/Spheres_test --log_level=message
+BOOST_AUTO_TEST_CASE(Spheres_test)
+{
+	const unsigned dims[3] = {40, 36, 30};
+	const Vec3 spacing(0.5f, 0.6f, 0.7f);
+
+	// a hollow sphere (two shells) and a sphere which is partially outside
+	std::vector<double> points;
+	std::vector<unsigned int> triangles;
+	make_sphere(9.1, 10.3, 10.2, 7.3, 37, 23, points, triangles);
+	make_sphere(9.1, 10.3, 10.2, 3.9, 29, 17, points, triangles);
+	make_sphere(18.7, 2.2, 16.9, 4.1, 31, 19, points, triangles);
+
+	std::vector<float> image(dims[0] * dims[1] * dims[2], 0.f);
+	std::vector<float*> slices(dims[2]);
+	for (unsigned z = 0; z < dims[2]; z++)
+		slices[z] = &image[z * dims[0] * dims[1]];
+
+	VoxelSurface voxeler(1.f);
+	voxeler.VoxelizeTriangles(points, triangles, slices, dims, spacing, 0, dims[2]);
+
+	size_t count = 0, mismatch = 0;
+	for (unsigned z = 0; z < dims[2]; z++)
+	{
+		for (unsigned y = 0; y < dims[1]; y++)
+		{
+			for (unsigned x = 0; x < dims[0]; x++)
+			{
+				bool in = slices[z][x + y * dims[0]] != 0.f;
+				count += in ? 1 : 0;
+				if (in != inside_reference(points, triangles, x * spacing[0], y * spacing[1], z * spacing[2]))
+					mismatch++;
+			}
+		}
+	}
+	BOOST_CHECK(count > 0);
+	BOOST_CHECK_EQUAL(mismatch, 0);
+
+	// a sub-range of slices only touches these slices
+	std::vector<float> image2(image.size(), 0.f);
+	for (unsigned z = 0; z < dims[2]; z++)
+		slices[z] = &image2[z * dims[0] * dims[1]];
+	voxeler.VoxelizeTriangles(points, triangles, slices, dims, spacing, 10, 20);
+	for (size_t i = 0; i < image.size(); i++)
+	{
+		unsigned z = static_cast<unsigned>(i / (dims[0] * dims[1]));
+		BOOST_REQUIRE_EQUAL(image2[i], (z >= 10 && z < 20) ? image[i] : 0.f);
+	}
+}
+
+// TestRunner.exe --run_test=iSeg_suite/VoxelSurface_suite/VtkReference_test --log_level=message
+BOOST_AUTO_TEST_CASE(VtkReference_test)
+{
+	const unsigned dims[3] = {48, 44, 40};
+	const Vec3 spacing(0.5f, 0.6f, 0.7f);
+	const double center[3] = {12.1, 13.3, 13.9};
+	const double radius = 8.3;
+
+	std::vector<double> points;
+	std::vector<unsigned int> triangles;
+	make_sphere(center[0], center[1], center[2], radius, 64, 40, points, triangles);
+	auto surface = make_polydata(points, triangles);
+
+	// the same surface as triangle strips only
+	vtkNew<vtkStripper> stripper;
+	stripper->SetInputData(surface);
+	stripper->Update();
+	vtkPolyData* strips = stripper->GetOutput();
+	BOOST_REQUIRE(strips->GetNumberOfStrips() != 0);
+
+	const size_t slice_size = dims[0] * dims[1];
+	std::vector<float> image(slice_size * dims[2], 0.f), image_strips(image.size(), 0.f), reference(image.size(), 0.f);
+	std::vector<float*> slices(dims[2]), slices_strips(dims[2]), slices_reference(dims[2]);
+	for (unsigned z = 0; z < dims[2]; z++)
+	{
+		slices[z] = &image[z * slice_size];
+		slices_strips[z] = &image_strips[z * slice_size];
+		slices_reference[z] = &reference[z * slice_size];
+	}
+
+	VoxelSurface voxeler(1.f);
+	Transform identity;
+	BOOST_CHECK_EQUAL(voxeler.Voxelize(surface, slices, dims, spacing, identity, 0, dims[2]), VoxelSurface::kContained);
+	BOOST_CHECK_EQUAL(voxeler.Voxelize(strips, slices_strips, dims, spacing, identity, 0, dims[2]), VoxelSurface::kContained);
+	BOOST_CHECK(image_strips == image);
+
+	voxelize_vtk_reference(surface, slices_reference.data(), dims, spacing.v, 1.f, 0, dims[2]);
+
+	// the stencil rounds voxels on the surface differently, so only voxels further than a voxel from it must agree
+	const double margin = std::sqrt(spacing[0] * spacing[0] + spacing[1] * spacing[1] + spacing[2] * spacing[2]);
+	size_t count = 0, mismatch = 0, near_surface_mismatch = 0;
+	for (unsigned z = 0; z < dims[2]; z++)
+	{
+		for (unsigned y = 0; y < dims[1]; y++)
+		{
+			for (unsigned x = 0; x < dims[0]; x++)
+			{
+				size_t i = z * slice_size + y * dims[0] + x;
+				count += (image[i] != 0.f) ? 1 : 0;
+				if (image[i] == reference[i])
+					continue;
+				double dx = x * spacing[0] - center[0], dy = y * spacing[1] - center[1], dz = z * spacing[2] - center[2];
+				if (std::abs(std::sqrt(dx * dx + dy * dy + dz * dz) - radius) > margin)
+					mismatch++;
+				else
+					near_surface_mismatch++;
+			}
+		}
+	}
+	BOOST_CHECK(count > 0);
+	BOOST_CHECK_EQUAL(mismatch, 0);
+	BOOST_TEST_MESSAGE("Voxels differing from the VTK pipeline near the surface: " << near_surface_mismatch << " of " << count);
+}
+
+// TestRunner.exe --run_test=iSeg_suite/VoxelSurface_suite/Benchmark_test --log_level=message
+BOOST_AUTO_TEST_CASE(Benchmark_test)
+{
+	const unsigned dims[3] = {256, 256, 256};
+	const Vec3 spacing(1.f, 1.f, 1.f);
+
+	std::vector<double> points;
+	std::vector<unsigned int> triangles;
+	make_sphere(128.3, 127.9, 128.1, 100.0, 1000, 500, points, triangles);
+
+	std::vector<float> image(dims[0] * dims[1] * dims[2], 0.f);
+	std::vector<float*> slices(dims[2]);
+	for (unsigned z = 0; z < dims[2]; z++)
+		slices[z] = &image[z * dims[0] * dims[1]];
+
+	auto start = boost::chrono::high_resolution_clock::now();
+	VoxelSurface(1.f).VoxelizeTriangles(points, triangles, slices, dims, spacing, 0, dims[2]);
+	auto stop = boost::chrono::high_resolution_clock::now();
+
+	size_t count = 0;
+	for (auto v : image)
+		count += (v != 0.f) ? 1 : 0;
+	double const expected = 4.0 / 3.0 * 3.14159265358979323846 * 1e6;
+	BOOST_CHECK_CLOSE(static_cast<double>(count), expected, 1.0);
+
+	BOOST_TEST_MESSAGE("Voxelized " << triangles.size() / 3 << " triangles in "
+																	<< boost::chrono::duration_cast<boost::chrono::milliseconds>(stop - start));
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_AUTO_TEST_SUITE_END();
+
+} // namespace iseg
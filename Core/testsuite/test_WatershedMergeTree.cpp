@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include <boost/test/unit_test.hpp>
+
+#include "../WatershedMergeTree.h"
+
+#include <cmath>
+#include <vector>
+
+namespace iseg {
+
+BOOST_AUTO_TEST_SUITE(iSeg_suite);
+BOOST_AUTO_TEST_SUITE(WatershedMergeTree_suite);
+
+// TestRunner.exe --run_test=iSeg_suite/WatershedMergeTree_suite/Relabel_test --log_level=message
+BOOST_AUTO_TEST_CASE(Relabel_test)
+{
+	// two valleys along x, separated by a ridge at x=4
+	const float profile[] = {1, 0, 1, 2, 8, 3, 2, 3, 4};
+	const unsigned short w = 9, h = 3, d = 4;
+	const size_t area = w * h;
+
+	std::vector<float> image(area * d);
+	for (size_t i = 0; i < image.size(); i++)
+		image[i] = profile[i % w];
+
+	std::vector<const float*> slices;
+	std::vector<float*> target_slices;
+	std::vector<float> target(image.size());
+	for (int z = 0; z < d; z++)
+	{
+		slices.push_back(image.data() + z * area);
+		target_slices.push_back(target.data() + z * area);
+	}
+
+	for (int slabs : {1, 2, 4})
+	for (bool connectivity : {false, true})
+	{
+		WatershedMergeTree tree;
+		tree.set_number_of_slabs(slabs);
+		tree.build(slices, w, h, connectivity);
+		if (slabs == 1)
+			BOOST_CHECK_EQUAL(tree.number_of_basins(), 2);
+		BOOST_CHECK_NE(tree.basin(1), tree.basin(6));
+
+		// the right valley (depth 64) merges at the ridge (255)
+		std::vector<WatershedMergeTree::marker_type> markers = {{area + 1, 1}};
+		auto labels = tree.relabel(100, markers);
+		BOOST_CHECK_EQUAL(labels[tree.basin(1)], 1);
+		BOOST_CHECK_EQUAL(labels[tree.basin(6)], 0);
+
+		labels = tree.relabel(200, markers);
+		BOOST_CHECK_EQUAL(labels[tree.basin(6)], 1);
+
+		// differently marked basins never merge
+		markers.push_back({2 * area + w + 7, 2});
+		labels = tree.relabel(255, markers);
+		tree.apply(labels, target_slices, 10.f);
+		for (size_t i = 0; i < target.size(); i++)
+		{
+			BOOST_REQUIRE_EQUAL(target[i], (i % w) <= 4 ? 10.f : 20.f);
+		}
+	}
+}
+
+// TestRunner.exe --run_test=iSeg_suite/WatershedMergeTree_suite/Slabs_test --log_level=message
+BOOST_AUTO_TEST_CASE(Slabs_test)
+{
+	// distance to the nearest of four tips, which lie in different slabs
+	const unsigned short w = 24, h = 20, d = 40;
+	const size_t area = w * h;
+	const int tips[4][3] = {{5, 5, 4}, {18, 6, 15}, {6, 15, 26}, {17, 14, 35}};
+
+	// below half the distance to the next tip, a voxel is reached only from its own tip
+	float saddle[4];
+	for (int i = 0; i < 4; i++)
+	{
+		saddle[i] = 1e10f;
+		for (int j = 0; j < 4; j++)
+		{
+			if (j != i)
+			{
+				const int dx = tips[i][0] - tips[j][0], dy = tips[i][1] - tips[j][1], dz = tips[i][2] - tips[j][2];
+				saddle[i] = std::min(saddle[i], 0.5f * std::sqrt(float(dx * dx + dy * dy + dz * dz)));
+			}
+		}
+	}
+
+	std::vector<float> image(area * d);
+	std::vector<unsigned> expected(area * d, 0);
+	for (int z = 0; z < d; z++)
+	{
+		for (int y = 0; y < h; y++)
+		{
+			for (int x = 0; x < w; x++)
+			{
+				const size_t i = z * area + y * w + x;
+				image[i] = 1e10f;
+				for (int t = 0; t < 4; t++)
+				{
+					const int dx = x - tips[t][0], dy = y - tips[t][1], dz = z - tips[t][2];
+					const float f = std::sqrt(float(dx * dx + dy * dy + dz * dz));
+					if (f < image[i])
+					{
+						image[i] = f;
+						expected[i] = (f + 1.f < saddle[t]) ? t + 1 : 0;
+					}
+				}
+			}
+		}
+	}
+
+	std::vector<const float*> slices;
+	for (int z = 0; z < d; z++)
+		slices.push_back(image.data() + z * area);
+
+	std::vector<WatershedMergeTree::marker_type> markers;
+	for (const auto& t : tips)
+		markers.push_back({t[2] * area + t[1] * w + t[0], static_cast<unsigned>(markers.size() + 1)});
+
+	for (bool connectivity : {false, true})
+	{
+		WatershedMergeTree single;
+		single.set_number_of_slabs(1);
+		single.build(slices, w, h, connectivity);
+		const auto single_labels = single.relabel(255, markers);
+
+		for (int slabs : {1, 2, 3, 5})
+		{
+			WatershedMergeTree tree;
+			tree.set_number_of_slabs(slabs);
+			tree.build(slices, w, h, connectivity);
+			BOOST_CHECK_GE(tree.number_of_basins(), single.number_of_basins());
+
+			// the extra basins at the slab borders join the marked basins
+			const auto labels = tree.relabel(255, markers);
+			size_t differ = 0;
+			for (size_t i = 0; i < image.size(); i++)
+			{
+				const unsigned label = labels[tree.basin(i)];
+				BOOST_REQUIRE_NE(label, 0);
+				if (expected[i] != 0)
+					BOOST_REQUIRE_EQUAL(label, expected[i]);
+				if (label != single_labels[single.basin(i)])
+					differ++;
+			}
+			// above the saddles the voxels follow the neighbor which was flooded first, also in a single flood
+			BOOST_TEST_MESSAGE("slabs " << slabs << ", connectivity " << connectivity << ": " << differ << " voxels differ from a single flood");
+			if (slabs == 1)
+				BOOST_CHECK_EQUAL(differ, 0);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_AUTO_TEST_SUITE_END();
+
+} // namespace iseg
@@ -15,6 +15,7 @@
 #include <itkImage.h>
 #include <itkSliceContiguousImage.h>
 
+#include <type_traits>
 #include <vector>
 
 namespace iseg {
@@ -27,6 +28,119 @@ inline void copyToITK(const Transform& transform,
 	transform.getOffset(origin);
 }
 
+namespace detail {
+
+/// Access to the buffer of an image as one pointer per buffered slice
+template<typename TImage>
+struct SliceBuffers
+{
+	enum { value = false };
+};
+
+template<typename T>
+struct SliceBuffers<itk::Image<T, 3>>
+{
+	enum { value = true };
+
+	static std::vector<T*> get(const itk::Image<T, 3>* image)
+	{
+		auto size = image->GetBufferedRegion().GetSize();
+		auto buffer = const_cast<T*>(image->GetBufferPointer());
+		std::vector<T*> slices(size[2]);
+		for (size_t z = 0; z < size[2]; z++)
+		{
+			slices[z] = buffer + z * size[0] * size[1];
+		}
+		return slices;
+	}
+};
+
+template<typename T>
+struct SliceBuffers<itk::SliceContiguousImage<T>>
+{
+	enum { value = true };
+
+	static std::vector<T*> get(const itk::SliceContiguousImage<T>* image)
+	{
+		return *image->GetPixelContainer()->GetSlices();
+	}
+};
+
+} // namespace detail
+
+/** \brief Copies region between two slice stacks
+
+	The stacks are given as slice pointers plus the region they hold
+	(i.e. slice 0 is at index src_buffer.GetIndex(2)). The rows are copied
+	with a plain loop and in parallel, instead of one iterator step per voxel.
+*/
+template<typename TIn, typename TOut>
+void copyRegion(const std::vector<TIn*>& src, const itk::ImageRegion<3>& src_buffer,
+		const std::vector<TOut*>& dst, const itk::ImageRegion<3>& dst_buffer,
+		const itk::ImageRegion<3>& region)
+{
+	auto const size = region.GetSize();
+	auto const start = region.GetIndex();
+	auto const src_start = src_buffer.GetIndex();
+	auto const dst_start = dst_buffer.GetIndex();
+	size_t const src_width = src_buffer.GetSize(0);
+	size_t const dst_width = dst_buffer.GetSize(0);
+
+	int const num_rows = static_cast<int>(size[1] * size[2]);
+#pragma omp parallel for
+	for (int r = 0; r < num_rows; r++)
+	{
+		auto const y = start[1] + static_cast<itk::IndexValueType>(r % size[1]);
+		auto const z = start[2] + static_cast<itk::IndexValueType>(r / size[1]);
+		const TIn* in = src[z - src_start[2]] + (y - src_start[1]) * src_width + (start[0] - src_start[0]);
+		TOut* out = dst[z - dst_start[2]] + (y - dst_start[1]) * dst_width + (start[0] - dst_start[0]);
+		for (size_t x = 0; x < size[0]; x++)
+		{
+			out[x] = static_cast<TOut>(in[x]);
+		}
+	}
+}
+
+template<class TInputImage, class TOutputImage>
+bool copyRegion(const TInputImage* source, TOutputImage* destination, const itk::ImageRegion<3>& region, std::true_type)
+{
+	copyRegion(detail::SliceBuffers<TInputImage>::get(source), source->GetBufferedRegion(),
+			detail::SliceBuffers<TOutputImage>::get(destination), destination->GetBufferedRegion(), region);
+	return true;
+}
+
+template<class TInputImage, class TOutputImage, class TRegion>
+bool copyRegion(const TInputImage*, TOutputImage*, const TRegion&, std::false_type)
+{
+	return false;
+}
+
+/// Copies region from source to destination if both expose their slice buffers, otherwise returns false
+template<class TInputImage, class TOutputImage>
+bool copyRegion(const TInputImage* source, TOutputImage* destination, const typename TInputImage::RegionType& region)
+{
+	return copyRegion(source, destination, region,
+			std::integral_constant<bool, detail::SliceBuffers<TInputImage>::value && detail::SliceBuffers<TOutputImage>::value>());
+}
+
+template<typename T>
+typename itk::Image<T, 3>::Pointer allocateImage(const itk::ImageRegion<3>& region,
+		const Vec3& spacing, const Transform& transform)
+{
+	typename itk::Image<T, 3>::PointType origin;
+	typename itk::Image<T, 3>::DirectionType direction;
+	copyToITK(transform, origin, direction);
+
+	// the region keeps its start index, so physical positions are those of the full volume
+	auto image = itk::Image<T, 3>::New();
+	image->SetRegions(region);
+	image->SetSpacing(spacing.v);
+	image->SetOrigin(origin);
+	image->SetDirection(direction);
+	image->Allocate();
+	return image;
+}
+
 template<typename T>
 typename itk::Image<T, 3>::Pointer allocateImage(const unsigned dimensions[3],
 		unsigned start_slice, unsigned end_slice,
@@ -39,23 +153,24 @@ typename itk::Image<T, 3>::Pointer allocateImage(const unsigned dimensions[3],
 	start[1] = 0;						// first index on Y
 	start[2] = start_slice; // first index on Z
 	typename ImageType::SizeType size;
-	size[0] = dimensions[0]; // size along X
-	size[1] = dimensions[1]; // size along Y
-	size[2] = dimensions[2]; // size along Z
-	typename ImageType::RegionType region;
-	region.SetSize(size);
-	region.SetIndex(start);
+	size[0] = dimensions[0];					 // size along X
+	size[1] = dimensions[1];					 // size along Y
+	size[2] = end_slice - start_slice; // size along Z
 
-	typename ImageType::PointType origin;
-	typename ImageType::DirectionType direction;
-	toITK(transform, origin, direction);
+	return allocateImage<T>(typename ImageType::RegionType(start, size), spacing, transform);
+}
 
-	auto image = itk::Image<T, 3>::New();
-	image->SetRegions(region);
-	image->SetSpacing(spacing);
-	image->SetOrigin(origin);
-	image->SetDirection(direction);
-	image->Allocate();
+/// Copies region of the slices into a new image, the rows are copied in parallel
+template<typename T>
+typename itk::Image<T, 3>::Pointer copyToITK(const std::vector<T*>& all_slices, const unsigned dimensions[3],
+		const itk::ImageRegion<3>& region,
+		const Vec3& spacing, const Transform& transform)
+{
+	auto image = allocateImage<T>(region, spacing, transform);
+
+	itk::Size<3> all_size = {dimensions[0], dimensions[1], dimensions[2]};
+	itk::ImageRegion<3> all_region(all_size);
+	copyRegion(all_slices, all_region, detail::SliceBuffers<itk::Image<T, 3>>::get(image), region, region);
 	return image;
 }
 
@@ -64,28 +179,9 @@ typename itk::Image<T, 3>::Pointer copyToITK(const std::vector<T*>& all_slices,
 		unsigned start_slice, unsigned end_slice,
 		const Vec3& spacing, const Transform& transform)
 {
-	auto image = allocateImage<T>(dimensions, start_slice, end_slice, spacing, transform);
-
-	typename itk::Image<T, 3>::IndexType pi;
-	auto size = image->GetLargestPossibleRegion().GetSize();
-
-	// \todo copy using std::copy per slice
-	for (unsigned z = 0; z < size[2]; z++)
-	{
-		const T* slice = all_slices[start_slice + z];
-		pi.SetElement(2, z);
-		size_t idx = 0;
-		for (unsigned y = 0; y < size[1]; y++)
-		{
-			pi.SetElement(1, y);
-			for (unsigned x = 0; x < size[0]; x++, idx++)
-			{
-				pi.SetElement(0, x);
-				image->SetPixel(pi, slice[idx]);
-			}
-		}
-	}
-	return image;
+	itk::Index<3> start = {0, 0, static_cast<itk::IndexValueType>(start_slice)};
+	itk::Size<3> size = {dimensions[0], dimensions[1], end_slice - start_slice};
+	return copyToITK(all_slices, dimensions, itk::ImageRegion<3>(start, size), spacing, transform);
 }
 
 template<typename T>
@@ -9,6 +9,7 @@
 */
 #pragma once
 
+#include "ImageToITK.h"
 #include "Logger.h"
 
 #include "itkSliceContiguousImage.h"
@@ -37,16 +38,7 @@ bool Paste(const itk::Image<TInputPixel, 3>* source, itk::SliceContiguousImage<T
 		// copy active slices into destination, starting at startslice
 		auto active_region = itk::ImageBase<3>::RegionType(start, size);
 
-		typedef itk::ImageRegionConstIterator<itk::Image<TInputPixel, 3>> image_iterator;
-		typedef itk::ImageRegionIterator<itk::SliceContiguousImage<TOutputPixel>> slice_image_iterator;
-		image_iterator sit(source, active_region);
-		slice_image_iterator dit(destination, active_region);
-
-		for (sit.GoToBegin(), dit.GoToBegin(); !sit.IsAtEnd() && !dit.IsAtEnd(); ++sit, ++dit)
-		{
-			dit.Set(static_cast<TOutputPixel>(sit.Get()));
-		}
-		return true;
+		return copyRegion(source, destination, active_region);
 	}
 	return false;
 }
@@ -56,6 +48,11 @@ bool Paste(const TInputImage* source, TOutputImage* destination)
 {
 	using OutputPixel = typename TOutputImage::PixelType;
 
+	if (source->GetBufferedRegion() == destination->GetBufferedRegion() &&
+			copyRegion(source, destination, source->GetBufferedRegion()))
+	{
+		return true;
+	}
 	if (source->GetBufferedRegion().GetSize() == destination->GetBufferedRegion().GetSize())
 	{
 		itk::ImageRegionConstIterator<TInputImage> sit(source, source->GetBufferedRegion());
@@ -77,6 +74,9 @@ bool Paste(const TInputImage* source, TOutputImage* destination, const typename
 
 	if (source->GetBufferedRegion().IsInside(region) && destination->GetBufferedRegion().IsInside(region))
 	{
+		if (copyRegion(source, destination, region))
+			return true;
+
 		itk::ImageRegionConstIterator<TInputImage> sit(source, region);
 		itk::ImageRegionIterator<TOutputImage> dit(destination, region);
 
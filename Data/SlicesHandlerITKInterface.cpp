@@ -1,7 +1,5 @@
 #include "SlicesHandlerITKInterface.h"
 
-#include <itkCastImageFilter.h>
-
 namespace iseg {
 
 itk::SliceContiguousImage<float>::Pointer SlicesHandlerITKInterface::GetSource(bool active_slices)
@@ -110,6 +108,12 @@ itk::Image<tissues_size_t, 2>::Pointer SlicesHandlerITKInterface::GetTissuesSlic
 	return _GetITKView2D(all_slices.at(slice), dims, spacing);
 }
 
+itk::ImageRegion<3> SlicesHandlerITKInterface::GetVolumeRegion() const
+{
+	itk::Size<3> size = {_handler->width(), _handler->height(), _handler->num_slices()};
+	return itk::ImageRegion<3>(size);
+}
+
 itk::ImageRegion<3> SlicesHandlerITKInterface::GetActiveRegion() const
 {
 	itk::Index<3> start = {0, 0, _handler->start_slice()};
@@ -119,24 +123,26 @@ itk::ImageRegion<3> SlicesHandlerITKInterface::GetActiveRegion() const
 
 itk::Image<float, 3>::Pointer SlicesHandlerITKInterface::GetImageDeprecated(eImageType type, bool active_slices)
 {
-	using input_image = itk::SliceContiguousImage<float>;
-	using output_image = itk::Image<float, 3>;
-
-	auto cast = itk::CastImageFilter<input_image, output_image>::New();
-	cast->SetInput(type == eImageType::kSource ? GetSource(active_slices) : GetTarget(active_slices));
-	cast->Update();
-	return cast->GetOutput();
+	return GetImage(type, active_slices ? GetActiveRegion() : GetVolumeRegion());
 }
 
 itk::Image<tissues_size_t, 3>::Pointer SlicesHandlerITKInterface::GetTissuesDeprecated(bool active_slices)
 {
-	using input_image = itk::SliceContiguousImage<tissues_size_t>;
-	using output_image = itk::Image<tissues_size_t, 3>;
+	return GetTissuesImage(active_slices ? GetActiveRegion() : GetVolumeRegion());
+}
 
-	auto cast = itk::CastImageFilter<input_image, output_image>::New();
-	cast->SetInput(GetTissues(active_slices));
-	cast->Update();
-	return cast->GetOutput();
+itk::Image<float, 3>::Pointer SlicesHandlerITKInterface::GetImage(eImageType type, const itk::ImageRegion<3>& region)
+{
+	unsigned dims[3] = {_handler->width(), _handler->height(), _handler->num_slices()};
+	auto all_slices = (type == eImageType::kSource) ? _handler->source_slices() : _handler->target_slices();
+	return copyToITK(all_slices, dims, region, _handler->spacing(), _handler->transform());
+}
+
+itk::Image<tissues_size_t, 3>::Pointer SlicesHandlerITKInterface::GetTissuesImage(const itk::ImageRegion<3>& region)
+{
+	unsigned dims[3] = {_handler->width(), _handler->height(), _handler->num_slices()};
+	auto all_slices = _handler->tissue_slices(_handler->active_tissuelayer());
+	return copyToITK(all_slices, dims, region, _handler->spacing(), _handler->transform());
 }
 
 } // namespace iseg
@@ -40,12 +40,21 @@ public:
 
 	/// Get region defined by active slices
 	itk::ImageRegion<3> GetActiveRegion() const;
+	/// Get region of all slices
+	itk::ImageRegion<3> GetVolumeRegion() const;
 
 	enum eImageType {
 		kSource,
 		kTarget
 	};
 
+	/// Copy of a region (e.g. a bounding box of the active slices) for filters which
+	/// need an itk::Image, the rows are copied in parallel. The region keeps its index,
+	/// so physical positions match the full volume. Use the Get* views above if the
+	/// filter accepts a SliceContiguousImage, they do not copy.
+	itk::Image<pixel_type, 3>::Pointer GetImage(eImageType type, const itk::ImageRegion<3>& region);
+	itk::Image<tissue_type, 3>::Pointer GetTissuesImage(const itk::ImageRegion<3>& region);
+
 	itk::Image<pixel_type, 3>::Pointer GetImageDeprecated(eImageType type, bool active_slices);
 	itk::Image<tissue_type, 3>::Pointer GetTissuesDeprecated(bool active_slices);
 
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include <boost/test/unit_test.hpp>
+
+#include "../ImageToITK.h"
+#include "../ItkUtils.h"
+
+#include <vector>
+
+namespace iseg {
+
+BOOST_AUTO_TEST_SUITE(iSeg_suite);
+BOOST_AUTO_TEST_SUITE(ImageToITK_suite);
+
+// TestRunner.exe --run_test=iSeg_suite/ImageToITK_suite/CopyRegion_test --log_level=message
+BOOST_AUTO_TEST_CASE(CopyRegion_test)
+{
+	const unsigned dims[3] = {13, 11, 7};
+	std::vector<std::vector<float>> data(dims[2], std::vector<float>(dims[0] * dims[1]));
+	std::vector<float*> slices;
+	for (unsigned z = 0; z < dims[2]; z++)
+	{
+		for (unsigned i = 0; i < dims[0] * dims[1]; i++)
+			data[z][i] = static_cast<float>(z * 1000 + i);
+		slices.push_back(data[z].data());
+	}
+
+	Transform transform;
+	transform.setIdentity();
+	const Vec3 spacing(0.5f, 1.f, 2.f);
+
+	// copy of a bounding box keeps its index
+	itk::Index<3> start = {2, 3, 1};
+	itk::Size<3> size = {7, 5, 4};
+	itk::ImageRegion<3> roi(start, size);
+	auto image = copyToITK(slices, dims, roi, spacing, transform);
+	BOOST_REQUIRE(image->GetBufferedRegion() == roi);
+
+	itk::ImageRegionConstIteratorWithIndex<itk::Image<float, 3>> it(image, roi);
+	for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+	{
+		auto idx = it.GetIndex();
+		BOOST_REQUIRE_EQUAL(it.Get(), data[idx[2]][idx[0] + idx[1] * dims[0]]);
+	}
+
+	// the slice range overload matches a region with full slices
+	auto range = copyToITK(slices, dims, 2, 5, spacing, transform);
+	BOOST_CHECK_EQUAL(range->GetBufferedRegion().GetIndex(2), 2);
+	BOOST_CHECK_EQUAL(range->GetBufferedRegion().GetSize(2), 3);
+	itk::Index<3> pos = {4, 6, 3};
+	BOOST_CHECK_EQUAL(range->GetPixel(pos), data[3][4 + 6 * dims[0]]);
+
+	// paste a modified region back into the slices (without copying them first)
+	itk::ImageRegionIterator<itk::Image<float, 3>> oit(image, roi);
+	for (oit.GoToBegin(); !oit.IsAtEnd(); ++oit)
+		oit.Set(-oit.Get());
+
+	auto view = wrapToITK(slices, dims, 0, dims[2], spacing, transform);
+	BOOST_REQUIRE(Paste<itk::Image<float, 3>, itk::SliceContiguousImage<float>>(image, view, roi));
+	for (int z = 0; z < 7; z++)
+	{
+		for (int y = 0; y < 11; y++)
+		{
+			for (int x = 0; x < 13; x++)
+			{
+				itk::Index<3> idx = {x, y, z};
+				float expected = static_cast<float>(z * 1000 + x + y * dims[0]);
+				BOOST_REQUIRE_EQUAL(data[z][x + y * dims[0]], roi.IsInside(idx) ? -expected : expected);
+			}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_AUTO_TEST_SUITE_END();
+
+} // namespace iseg
@@ -14,10 +14,7 @@
 
 #include <itkBSplineControlPointImageFilter.h>
 #include <itkCommand.h>
-#include <itkDivideImageFilter.h>
-#include <itkExpImageFilter.h>
 #include <itkImage.h>
-#include <itkImageRegionIterator.h>
 #include <itkN4BiasFieldCorrectionImageFilter.h>
 #include <itkShrinkImageFilter.h>
 #include <itkTimeProbe.h>
@@ -27,6 +24,7 @@
 #include <QFormLayout>
 
 #include <algorithm>
+#include <cmath>
 #include <functional>
 #include <sstream>
 
@@ -105,13 +103,118 @@ typename ImageType::Pointer AllocImage(
 	return rval;
 }
 
+template<typename ImageType>
+typename ImageType::Pointer CopyImage(const ImageType* image)
+{
+	typename ImageType::Pointer rval = AllocImage<ImageType>(image);
+	size_t const n = image->GetBufferedRegion().GetNumberOfPixels();
+	std::copy(image->GetBufferPointer(), image->GetBufferPointer() + n, rval->GetBufferPointer());
+	return rval;
+}
+
+/// calls f with each offset into the image buffer, slices are processed in parallel
+template<typename ImageType, typename TFunction>
+void ParallelForEachPixel(const ImageType* image, TFunction f)
+{
+	static const unsigned int dim = ImageType::ImageDimension;
+	auto const size = image->GetBufferedRegion().GetSize();
+	size_t slice_size = 1;
+	for (unsigned int d = 0; d + 1 < dim; d++)
+	{
+		slice_size *= size[d];
+	}
+	int const slices = static_cast<int>(size[dim - 1]);
+
+#pragma omp parallel for
+	for (int z = 0; z < slices; z++)
+	{
+		for (size_t i = z * slice_size, end = i + slice_size; i < end; i++)
+		{
+			f(i);
+		}
+	}
+}
+
+/// hash of the pixel values and geometry, used to detect changes of the source
+template<typename ImageType>
+size_t ComputeFingerprint(const ImageType* image)
+{
+	static const unsigned int dim = ImageType::ImageDimension;
+	auto const size = image->GetBufferedRegion().GetSize();
+	size_t slice_size = 1;
+	for (unsigned int d = 0; d + 1 < dim; d++)
+	{
+		slice_size *= size[d];
+	}
+	int const slices = static_cast<int>(size[dim - 1]);
+
+	auto buffer = image->GetBufferPointer();
+	std::vector<size_t> slice_hash(slices);
+#pragma omp parallel for
+	for (int z = 0; z < slices; z++)
+	{
+		std::hash<typename ImageType::PixelType> hasher;
+		size_t h = 0;
+		for (size_t i = z * slice_size, end = i + slice_size; i < end; i++)
+		{
+			h = h * 31 + hasher(buffer[i]);
+		}
+		slice_hash[z] = h;
+	}
+
+	std::hash<double> hasher;
+	size_t h = slice_size;
+	for (unsigned int d = 0; d < dim; d++)
+	{
+		h = h * 31 + hasher(image->GetSpacing()[d]);
+		h = h * 31 + hasher(image->GetOrigin()[d]);
+	}
+	for (auto sh : slice_hash)
+	{
+		h = h * 31 + sh;
+	}
+	return h;
+}
+
+/// evaluate the B-spline defined by the control point lattice on the grid of an image
+template<typename LatticeType, typename FieldType>
+typename FieldType::Pointer ReconstructField(const LatticeType* lattice,
+		unsigned int splineOrder,
+		const itk::ImageBase<LatticeType::ImageDimension>* grid)
+{
+	typedef itk::BSplineControlPointImageFilter<LatticeType, FieldType> BSplinerType;
+	typename BSplinerType::Pointer bspliner = BSplinerType::New();
+	bspliner->SetInput(lattice);
+	bspliner->SetSplineOrder(splineOrder);
+	bspliner->SetSize(grid->GetLargestPossibleRegion().GetSize());
+	bspliner->SetOrigin(grid->GetOrigin());
+	bspliner->SetDirection(grid->GetDirection());
+	bspliner->SetSpacing(grid->GetSpacing());
+	bspliner->Update();
+	return bspliner->GetOutput();
+}
+
 } // namespace
 
+struct BiasCorrectionWidget::Cache
+{
+	/// fingerprint of the source the shrunken images were computed from
+	size_t m_Fingerprint = 0;
+	int m_ShrinkFactor = 0;
+	itk::DataObject::Pointer m_ShrunkImage;
+	itk::DataObject::Pointer m_ShrunkMask;
+
+	/// log bias field control points of the last run, and the iterations per level it was estimated with
+	itk::DataObject::Pointer m_ControlPoints;
+	unsigned int m_SplineOrder = 0;
+	std::vector<unsigned int> m_NumberOfIterations;
+};
+
 BiasCorrectionWidget::BiasCorrectionWidget(iseg::SlicesHandlerInterface* hand3D,
 		QWidget* parent, const char* name,
 		Qt::WindowFlags wFlags)
 		: WidgetInterface(parent, name, wFlags), handler3D(hand3D),
-			m_CurrentFilter(nullptr)
+			m_CurrentFilter(nullptr), m_Cache(new Cache)
 {
 	setToolTip(Format(
 			"Correct non-uniformity (especially in MRI) using the N4 Bias Correction "
@@ -223,6 +326,7 @@ void BiasCorrectionWidget::init()
 void BiasCorrectionWidget::newloaded()
 {
 	activeslice = handler3D->active_slice();
+	*m_Cache = Cache();
 }
 
 std::string BiasCorrectionWidget::GetName()
@@ -245,13 +349,12 @@ ImagePointer BiasCorrectionWidget::DoBiasCorrection(
 
 	typedef typename ImagePointer::ObjectType ImageType;
 	typedef typename ImagePointer::ObjectType MaskImageType;
-	static const int ImageDimension = ImageType::ImageDimension;
 
 	typedef itk::N4BiasFieldCorrectionImageFilter<ImageType, MaskImageType,
 			ImageType>
 			CorrecterType;
-	typename CorrecterType::Pointer correcter = CorrecterType::New();
-	m_CurrentFilter = correcter;
+	typedef typename CorrecterType::BiasFieldControlPointLatticeType LatticeType;
+	typedef typename CorrecterType::ScalarImageType FieldType;
 
 	QProgressDialog progress("Performing bias correction...", "Cancel", 0, 101,
 			this);
@@ -283,72 +386,167 @@ ImagePointer BiasCorrectionWidget::DoBiasCorrection(
 	}
 
 	/**
-	* convergence options
+	* shrunken images, kept as long as the source and shrink factor
+	* do not change. Runs with a user specified mask are not cached.
 	*/
-	typename CorrecterType::VariableSizeArrayType maximumNumberOfIterations(
-			numIters.size());
-	for (unsigned int d = 0; d < numIters.size(); d++)
+	Cache uncached;
+	Cache& cache = isMaskImageSpecified ? uncached : *m_Cache;
+
+	size_t fingerprint = ComputeFingerprint<ImageType>(inputImage);
+	if (cache.m_Fingerprint != fingerprint || cache.m_ShrinkFactor != shrinkFactor ||
+			!dynamic_cast<ImageType*>(cache.m_ShrunkImage.GetPointer()) ||
+			!dynamic_cast<MaskImageType*>(cache.m_ShrunkMask.GetPointer()))
 	{
-		maximumNumberOfIterations[d] = numIters[d];
+		typedef itk::ShrinkImageFilter<ImageType, ImageType> ShrinkerType;
+		typename ShrinkerType::Pointer shrinker = ShrinkerType::New();
+		shrinker->SetInput(inputImage);
+		shrinker->SetShrinkFactors(shrinkFactor);
+
+		typedef itk::ShrinkImageFilter<MaskImageType, MaskImageType> MaskShrinkerType;
+		typename MaskShrinkerType::Pointer maskshrinker = MaskShrinkerType::New();
+		maskshrinker->SetInput(maskImage);
+		maskshrinker->SetShrinkFactors(shrinkFactor);
+
+		shrinker->Update();
+		maskshrinker->Update();
+
+		cache = Cache();
+		cache.m_Fingerprint = fingerprint;
+		cache.m_ShrinkFactor = shrinkFactor;
+		cache.m_ShrunkImage = shrinker->GetOutput();
+		cache.m_ShrunkImage->DisconnectPipeline();
+		cache.m_ShrunkMask = maskshrinker->GetOutput();
+		cache.m_ShrunkMask->DisconnectPipeline();
 	}
-	correcter->SetMaximumNumberOfIterations(maximumNumberOfIterations);
+	auto shrunkImage = static_cast<ImageType*>(cache.m_ShrunkImage.GetPointer());
+	auto shrunkMask = static_cast<MaskImageType*>(cache.m_ShrunkMask.GetPointer());
 
-	typename CorrecterType::ArrayType numberOfFittingLevels;
-	numberOfFittingLevels.Fill(numIters.size());
-	correcter->SetNumberOfFittingLevels(numberOfFittingLevels);
-	correcter->SetConvergenceThreshold(0.0);
+	itk::TimeProbe timer;
+	timer.Start();
 
-	typedef itk::ShrinkImageFilter<ImageType, ImageType> ShrinkerType;
-	typename ShrinkerType::Pointer shrinker = ShrinkerType::New();
-	shrinker->SetInput(inputImage);
-	shrinker->SetShrinkFactors(shrinkFactor);
+	// returns a copy of the estimated control points, or nullptr if aborted
+	auto runCorrecter = [&](ImageType* image, const std::vector<unsigned int>& iterations) {
+		typename CorrecterType::Pointer correcter = CorrecterType::New();
+		m_CurrentFilter = correcter;
+
+		/**
+		* convergence options
+		*/
+		typename CorrecterType::VariableSizeArrayType maximumNumberOfIterations(
+				iterations.size());
+		for (unsigned int d = 0; d < iterations.size(); d++)
+		{
+			maximumNumberOfIterations[d] = iterations[d];
+		}
+		correcter->SetMaximumNumberOfIterations(maximumNumberOfIterations);
 
-	typedef itk::ShrinkImageFilter<MaskImageType, MaskImageType> MaskShrinkerType;
-	typename MaskShrinkerType::Pointer maskshrinker = MaskShrinkerType::New();
-	maskshrinker->SetInput(maskImage);
-	maskshrinker->SetShrinkFactors(shrinkFactor);
+		typename CorrecterType::ArrayType numberOfFittingLevels;
+		numberOfFittingLevels.Fill(iterations.size());
+		correcter->SetNumberOfFittingLevels(numberOfFittingLevels);
+		correcter->SetConvergenceThreshold(0.0);
 
-	shrinker->Update();
-	maskshrinker->Update();
+		correcter->SetInput(image);
+		correcter->SetMaskImage(shrunkMask);
 
-	itk::TimeProbe timer;
-	timer.Start();
+		typedef CommandIterationUpdate<CorrecterType> CommandType;
+		typename CommandType::Pointer observer = CommandType::New();
+		correcter->AddObserver(itk::IterationEvent(), observer);
+		observer->SetProgressObject(&progress, iterations);
 
-	correcter->SetInput(shrinker->GetOutput());
-	correcter->SetMaskImage(maskshrinker->GetOutput());
+		/**
+		* histogram sharpening options
+		*/
+		//correcter->SetBiasFieldFullWidthAtHalfMaximum(0.15);
+		//correcter->SetWienerFilterNoise(0.01);
+		//correcter->SetNumberOfHistogramBins(200);
 
-	typedef CommandIterationUpdate<CorrecterType> CommandType;
-	typename CommandType::Pointer observer = CommandType::New();
-	correcter->AddObserver(itk::IterationEvent(), observer);
-	observer->SetProgressObject(&progress, numIters);
+		typename LatticeType::Pointer lattice;
+		try
+		{
+			// correcter->DebugOn();
+			correcter->Update();
+		}
+		catch (itk::ExceptionObject& e)
+		{
+			if (verbose)
+			{
+				std::cerr << "Exception caught: " << e << std::endl;
+			}
+			m_CurrentFilter = nullptr;
+			return lattice;
+		}
 
-	/**
-	* histogram sharpening options
-	*/
-	//correcter->SetBiasFieldFullWidthAtHalfMaximum(0.15);
-	//correcter->SetWienerFilterNoise(0.01);
-	//correcter->SetNumberOfHistogramBins(200);
+		m_CurrentFilter = nullptr;
 
-	try
-	{
-		// correcter->DebugOn();
-		correcter->Update();
-	}
-	catch (itk::ExceptionObject& e)
-	{
 		if (verbose)
 		{
-			std::cerr << "Exception caught: " << e << std::endl;
+			correcter->Print(std::cout, 3);
 		}
-		m_CurrentFilter = nullptr;
-		return nullptr;
-	}
 
-	m_CurrentFilter = nullptr;
+		lattice = CopyImage<LatticeType>(correcter->GetLogBiasFieldControlPointLattice());
+		cache.m_SplineOrder = correcter->GetSplineOrder();
+		return lattice;
+	};
 
-	if (verbose)
+	/**
+	* Re-running with the same settings reuses the cached control points. If only
+	* the number of iterations increased, the remaining iterations are run on the
+	* shrunken image corrected by the cached field (warm start). The log bias field
+	* is linear in the control points, so the two lattices are added.
+	*/
+	auto lattice = dynamic_cast<LatticeType*>(cache.m_ControlPoints.GetPointer());
+	bool sameLevels = lattice && cache.m_NumberOfIterations.size() == numIters.size();
+	bool warmStart = sameLevels &&
+									 std::equal(numIters.begin(), numIters.end(),
+											 cache.m_NumberOfIterations.begin(), std::greater<unsigned int>());
+	if (!sameLevels || cache.m_NumberOfIterations != numIters)
 	{
-		correcter->Print(std::cout, 3);
+		typename LatticeType::Pointer estimate;
+		if (warmStart)
+		{
+			auto logField = ReconstructField<LatticeType, FieldType>(lattice, cache.m_SplineOrder, shrunkImage);
+			auto field = logField->GetBufferPointer();
+			auto residual = AllocImage<ImageType>(shrunkImage);
+			auto in = shrunkImage->GetBufferPointer();
+			auto out = residual->GetBufferPointer();
+			ParallelForEachPixel(shrunkImage, [&](size_t i) {
+				out[i] = static_cast<typename ImageType::PixelType>(in[i] / std::exp(field[i][0]));
+			});
+
+			std::vector<unsigned int> remaining(numIters.size());
+			std::transform(numIters.begin(), numIters.end(), cache.m_NumberOfIterations.begin(),
+					remaining.begin(), std::minus<unsigned int>());
+			auto increment = runCorrecter(residual, remaining);
+			if (!increment)
+			{
+				return nullptr;
+			}
+
+			// the lattice geometry only depends on the shrunken image and number of levels
+			if (increment->GetLargestPossibleRegion() == lattice->GetLargestPossibleRegion() &&
+					increment->GetSpacing() == lattice->GetSpacing() &&
+					increment->GetOrigin() == lattice->GetOrigin())
+			{
+				auto sum = increment->GetBufferPointer();
+				auto previous = lattice->GetBufferPointer();
+				ParallelForEachPixel(increment.GetPointer(), [&](size_t i) {
+					sum[i] += previous[i];
+				});
+				estimate = increment;
+			}
+		}
+		if (!estimate)
+		{
+			estimate = runCorrecter(shrunkImage, numIters);
+			if (!estimate)
+			{
+				return nullptr;
+			}
+		}
+
+		cache.m_ControlPoints = estimate.GetPointer();
+		cache.m_NumberOfIterations = numIters;
+		lattice = estimate;
 	}
 
 	timer.Stop();
@@ -362,58 +560,26 @@ ImagePointer BiasCorrectionWidget::DoBiasCorrection(
 	*
 	* Reconstruct the bias field at full image resolution.  Divide
 	* the original input image by the bias field to get the final
-	* corrected image.
+	* corrected image. Outside a specified mask the input is kept.
 	*/
-	typedef itk::BSplineControlPointImageFilter<
-			typename CorrecterType::BiasFieldControlPointLatticeType,
-			typename CorrecterType::ScalarImageType>
-			BSplinerType;
-	typename BSplinerType::Pointer bspliner = BSplinerType::New();
-	bspliner->SetInput(correcter->GetLogBiasFieldControlPointLattice());
-	bspliner->SetSplineOrder(correcter->GetSplineOrder());
-	bspliner->SetSize(inputImage->GetLargestPossibleRegion().GetSize());
-	bspliner->SetOrigin(inputImage->GetOrigin());
-	bspliner->SetDirection(inputImage->GetDirection());
-	bspliner->SetSpacing(inputImage->GetSpacing());
-	bspliner->Update();
-
-	typename ImageType::Pointer logField = AllocImage<ImageType>(inputImage);
-
-	itk::ImageRegionIterator<typename CorrecterType::ScalarImageType> ItB(
-			bspliner->GetOutput(), bspliner->GetOutput()->GetLargestPossibleRegion());
-	itk::ImageRegionIterator<ImageType> ItF(logField,
-			logField->GetLargestPossibleRegion());
-	for (ItB.GoToBegin(), ItF.GoToBegin(); !ItB.IsAtEnd(); ++ItB, ++ItF)
-	{
-		ItF.Set(ItB.Get()[0]);
-	}
-
-	typedef itk::ExpImageFilter<ImageType, ImageType> ExpFilterType;
-	typename ExpFilterType::Pointer expFilter = ExpFilterType::New();
-	expFilter->SetInput(logField);
-	expFilter->Update();
-
-	typedef itk::DivideImageFilter<ImageType, ImageType, ImageType> DividerType;
-	typename DividerType::Pointer divider = DividerType::New();
-	divider->SetInput1(inputImage);
-	divider->SetInput2(expFilter->GetOutput());
-	divider->Update();
-
-	if (isMaskImageSpecified)
-	{
-		itk::ImageRegionIteratorWithIndex<ImageType> ItD(
-				divider->GetOutput(), divider->GetOutput()->GetLargestPossibleRegion());
-		itk::ImageRegionIterator<ImageType> ItI(
-				inputImage, inputImage->GetLargestPossibleRegion());
-		for (ItD.GoToBegin(), ItI.GoToBegin(); !ItD.IsAtEnd(); ++ItD, ++ItI)
+	auto logField = ReconstructField<LatticeType, FieldType>(lattice, cache.m_SplineOrder, inputImage);
+	auto field = logField->GetBufferPointer();
+
+	typename ImageType::Pointer outputImage = AllocImage<ImageType>(inputImage);
+	auto in = inputImage->GetBufferPointer();
+	auto mask = maskImage->GetBufferPointer();
+	auto out = outputImage->GetBufferPointer();
+	auto const zero = itk::NumericTraits<typename MaskImageType::PixelType>::ZeroValue();
+	ParallelForEachPixel(inputImage.GetPointer(), [&](size_t i) {
+		if (isMaskImageSpecified && mask[i] == zero)
 		{
-			if (maskImage->GetPixel(ItD.GetIndex()) ==
-					itk::NumericTraits<typename MaskImageType::PixelType>::ZeroValue())
-			{
-				ItD.Set(ItI.Get());
-			}
+			out[i] = in[i];
 		}
-	}
+		else
+		{
+			out[i] = static_cast<typename ImageType::PixelType>(in[i] / std::exp(field[i][0]));
+		}
+	});
 
-	return divider->GetOutput();
+	return outputImage;
 }
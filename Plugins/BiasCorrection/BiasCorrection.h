@@ -16,6 +16,7 @@
 #include <qpushbutton.h>
 #include <qspinbox.h>
 
+#include <memory>
 #include <vector>
 
 namespace itk {
@@ -38,6 +39,9 @@ public:
 private:
 	void on_slicenr_changed() override;
 
+	/// shrunken images and control points of the last run, see DoBiasCorrection
+	struct Cache;
+
 	template<typename ImagePointer>
 	ImagePointer DoBiasCorrection(ImagePointer inputImage, ImagePointer maskImage,
 			const std::vector<unsigned int>& numIters,
@@ -52,6 +56,7 @@ private:
 	QPushButton* execute;
 
 	itk::ProcessObject* m_CurrentFilter;
+	std::unique_ptr<Cache> m_Cache;
 
 private slots:
 	void do_work();
@@ -14,13 +14,79 @@
 
 #include <itkConfidenceConnectedImageFilter.h>
 #include <itkCurvatureFlowImageFilter.h>
+#include <itkExtractImageFilter.h>
 #include <itkImage.h>
+#include <itkImageRegionConstIterator.h>
 
 #include <QFormLayout>
 
 #include <algorithm>
+#include <functional>
 #include <sstream>
 
+namespace {
+
+/// hash of the source slices [start, end), used to detect changes of the source
+size_t source_key(iseg::SlicesHandlerInterface* handler, unsigned short start, unsigned short end)
+{
+	auto slices = handler->source_slices();
+	size_t const slice_size = static_cast<size_t>(handler->width()) * handler->height();
+
+	std::vector<size_t> slice_hash(end - start);
+#pragma omp parallel for
+	for (int z = start; z < end; z++)
+	{
+		std::hash<float> hasher;
+		size_t h = 0;
+		for (size_t i = 0; i < slice_size; i++)
+		{
+			h = h * 31 + hasher(slices[z][i]);
+		}
+		slice_hash[z - start] = h;
+	}
+
+	size_t h = (static_cast<size_t>(start) << 16) + end;
+	for (auto sh : slice_hash)
+	{
+		h = h * 31 + sh;
+	}
+	return h;
+}
+
+/// true if the image has a foreground pixel on a face of its region which is not on the boundary of 'largest'
+template<class TImage>
+bool touches_inner_border(const TImage* image, const typename TImage::RegionType& largest)
+{
+	auto const& region = image->GetLargestPossibleRegion();
+	for (unsigned int d = 0; d < TImage::ImageDimension; d++)
+	{
+		auto const end = region.GetIndex(d) + static_cast<itk::IndexValueType>(region.GetSize(d));
+		auto const largest_end = largest.GetIndex(d) + static_cast<itk::IndexValueType>(largest.GetSize(d));
+
+		std::vector<itk::IndexValueType> faces;
+		if (region.GetIndex(d) > largest.GetIndex(d))
+			faces.push_back(region.GetIndex(d));
+		if (end < largest_end)
+			faces.push_back(end - 1);
+
+		for (auto f : faces)
+		{
+			auto face = region;
+			face.SetIndex(d, f);
+			face.SetSize(d, 1);
+			itk::ImageRegionConstIterator<TImage> it(image, face);
+			for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+			{
+				if (it.Get() != 0)
+					return true;
+			}
+		}
+	}
+	return false;
+}
+
+} // namespace
+
 ConfidenceWidget::ConfidenceWidget(iseg::SlicesHandlerInterface* hand3D, QWidget* parent,
 		const char* name, Qt::WindowFlags wFlags)
 		: WidgetInterface(parent, name, wFlags), handler3D(hand3D)
@@ -76,6 +142,8 @@ void ConfidenceWidget::init()
 
 void ConfidenceWidget::newloaded()
 {
+	smoothed_slice = SmoothedCache<itk::Image<float, 2>>();
+	smoothed_volume = SmoothedCache<itk::Image<float, 3>>();
 	clearmarks();
 	on_slicenr_changed();
 }
@@ -117,7 +185,7 @@ void ConfidenceWidget::get_seeds(std::vector<itk::Index<2>>& seeds)
 
 void ConfidenceWidget::get_seeds(std::vector<itk::Index<3>>& seeds)
 {
-	auto start_slice = handler3D->start_slice();
+	// the active slices keep their z-index in the images returned by GetSource(true)
 	for (auto slice : vpdyn)
 	{
 		for (auto p : slice.second)
@@ -125,7 +193,7 @@ void ConfidenceWidget::get_seeds(std::vector<itk::Index<3>>& seeds)
 			itk::Index<3> idx;
 			idx[0] = p.px;
 			idx[1] = p.py;
-			idx[2] = slice.first - start_slice;
+			idx[2] = slice.first;
 			seeds.push_back(idx);
 		}
 	}
@@ -139,63 +207,130 @@ void ConfidenceWidget::do_work()
 		using input_type = itk::SliceContiguousImage<float>;
 		auto source = itk_handler.GetSource(true);
 		auto target = itk_handler.GetTarget(true);
-		do_work_nd<input_type>(source, target);
+		do_work_nd<input_type>(source, target, source_key(handler3D, handler3D->start_slice(), handler3D->end_slice()));
 	}
 	else
 	{
 		using input_type = itk::Image<float, 2>;
 		auto source = itk_handler.GetSourceSlice();
 		auto target = itk_handler.GetTargetSlice();
-		do_work_nd<input_type>(source, target);
+		do_work_nd<input_type>(source, target, source_key(handler3D, activeslice, activeslice + 1));
 	}
 }
 
 template<typename TInput>
-void ConfidenceWidget::do_work_nd(TInput* source, TInput* target)
+void ConfidenceWidget::do_work_nd(TInput* source, TInput* target, size_t key)
 {
 	itkStaticConstMacro(ImageDimension, unsigned int, TInput::ImageDimension);
 	using input_type = TInput;
 	using real_type = itk::Image<float, ImageDimension>;
 	using mask_type = itk::Image<unsigned char, ImageDimension>;
+	using region_type = typename real_type::RegionType;
 
-	auto smoothing = itk::CurvatureFlowImageFilter<input_type, real_type>::New();
-	auto confidenceConnected = itk::ConfidenceConnectedImageFilter<real_type, mask_type>::New();
-
-	// connect pipeline
-	smoothing->SetInput(source);
-	confidenceConnected->SetInput(smoothing->GetOutput());
-
-	// set parameters
-	smoothing->SetNumberOfIterations(2);
-	smoothing->SetTimeStep(0.05);
-	confidenceConnected->SetMultiplier(multiplier->text().toDouble());
-	confidenceConnected->SetNumberOfIterations(iterations->value());
-	confidenceConnected->SetInitialNeighborhoodRadius(radius->value());
-	confidenceConnected->SetReplaceValue(255);
+	// smoothing only depends on the source, not on the seeds
+	auto& smoothed = get_smoothed(static_cast<real_type*>(nullptr));
+	if (!smoothed.image || smoothed.key != key)
+	{
+		auto smoothing = itk::CurvatureFlowImageFilter<input_type, real_type>::New();
+		smoothing->SetInput(source);
+		smoothing->SetNumberOfIterations(2);
+		smoothing->SetTimeStep(0.05);
+		smoothing->GetOutput()->SetRequestedRegion(source->GetBufferedRegion());
+		try
+		{
+			smoothing->Update();
+		}
+		catch (itk::ExceptionObject)
+		{
+			return;
+		}
+		smoothed.image = smoothing->GetOutput();
+		smoothed.image->DisconnectPipeline();
+		smoothed.key = key;
+	}
+	// only the active slices are buffered
+	auto const largest = source->GetBufferedRegion();
 
 	std::vector<typename input_type::IndexType> seeds;
 	get_seeds(seeds);
-	for (auto idx : seeds)
-	{
-		confidenceConnected->AddSeed(idx);
-	}
 
-	try
+	// grow the region inside a box around the seeds, which is enlarged
+	// until the region does not touch its border
+	region_type roi = largest;
+	if (!seeds.empty())
 	{
-		confidenceConnected->Update();
+		auto lower = seeds.front(), upper = seeds.front();
+		for (auto idx : seeds)
+		{
+			for (unsigned int d = 0; d < ImageDimension; d++)
+			{
+				lower[d] = std::min(lower[d], idx[d]);
+				upper[d] = std::max(upper[d], idx[d]);
+			}
+		}
+		roi.SetIndex(lower);
+		for (unsigned int d = 0; d < ImageDimension; d++)
+		{
+			roi.SetSize(d, upper[d] - lower[d] + 1);
+		}
 	}
-	catch (itk::ExceptionObject)
+
+	typename mask_type::Pointer roi_mask;
+	region_type region;
+	for (int margin = std::max(32, 2 * radius->value());; margin *= 2)
 	{
-		return;
+		region = roi;
+		region.PadByRadius(margin);
+		if (!region.Crop(largest))
+		{
+			return;
+		}
+
+		auto extract = itk::ExtractImageFilter<real_type, real_type>::New();
+		extract->SetInput(smoothed.image);
+		extract->SetExtractionRegion(region);
+		extract->SetDirectionCollapseToIdentity();
+
+		auto confidenceConnected = itk::ConfidenceConnectedImageFilter<real_type, mask_type>::New();
+		confidenceConnected->SetInput(extract->GetOutput());
+		confidenceConnected->SetMultiplier(multiplier->text().toDouble());
+		confidenceConnected->SetNumberOfIterations(iterations->value());
+		confidenceConnected->SetInitialNeighborhoodRadius(radius->value());
+		confidenceConnected->SetReplaceValue(255);
+		for (auto idx : seeds)
+		{
+			confidenceConnected->AddSeed(idx);
+		}
+
+		try
+		{
+			confidenceConnected->Update();
+		}
+		catch (itk::ExceptionObject)
+		{
+			return;
+		}
+
+		roi_mask = confidenceConnected->GetOutput();
+		if (region == largest || !touches_inner_border(roi_mask.GetPointer(), largest))
+		{
+			break;
+		}
 	}
 
+	auto output = mask_type::New();
+	output->SetRegions(largest);
+	output->Allocate();
+	output->FillBuffer(0);
+	iseg::Paste<mask_type, mask_type>(roi_mask, output, region);
+
 	iseg::DataSelection dataSelection;
 	dataSelection.allSlices = all_slices->isChecked();
 	dataSelection.sliceNr = activeslice;
 	dataSelection.work = true;
 	emit begin_datachange(dataSelection, this);
 
-	iseg::Paste<mask_type, input_type>(confidenceConnected->GetOutput(), target);
+	iseg::Paste<mask_type, input_type>(output, target);
 
 	emit end_datachange(this);
 }
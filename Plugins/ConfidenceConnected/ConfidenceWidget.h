@@ -18,6 +18,7 @@
 #include <qspinbox.h>
 #include <qlineedit.h>
 
+#include <itkImage.h>
 #include <itkIndex.h>
 
 #include <map>
@@ -40,11 +41,22 @@ protected:
 	void on_mouse_clicked(iseg::Point p) override;
 
 	template<typename TInput> 
-	void do_work_nd(TInput* source, TInput* target);
+	void do_work_nd(TInput* source, TInput* target, size_t key);
 
 	void get_seeds(std::vector<itk::Index<2>>&);
 	void get_seeds(std::vector<itk::Index<3>>&);
 
+	/// smoothed source, reused while the source (identified by key) does not change
+	template<class TImage>
+	struct SmoothedCache
+	{
+		typename TImage::Pointer image;
+		size_t key = 0;
+	};
+
+	SmoothedCache<itk::Image<float, 2>>& get_smoothed(itk::Image<float, 2>*) { return smoothed_slice; }
+	SmoothedCache<itk::Image<float, 3>>& get_smoothed(itk::Image<float, 3>*) { return smoothed_volume; }
+
 private:
 	iseg::SlicesHandlerInterface* handler3D;
 	unsigned short activeslice;
@@ -58,6 +70,9 @@ private:
 
 	std::map<unsigned, std::vector<iseg::Point>> vpdyn;
 
+	SmoothedCache<itk::Image<float, 2>> smoothed_slice;
+	SmoothedCache<itk::Image<float, 3>> smoothed_volume;
+
 private slots:
 	void do_work();
 	void clearmarks();
@@ -93,12 +93,19 @@ BoneSegmentationWidget::BoneSegmentationWidget(
 	m_MaxFlowAlgorithm->insertItem(QString("Kohli"));
 	m_MaxFlowAlgorithm->insertItem(QString("PushLabel-Fifo"));
 	m_MaxFlowAlgorithm->insertItem(QString("PushLabel-H_PRF"));
-	m_MaxFlowAlgorithm->setCurrentItem(0);
+	m_MaxFlowAlgorithm->insertItem(QString("Kohli-Parallel"));
+	m_MaxFlowAlgorithm->insertItem(QString("Automatic"));
+	m_MaxFlowAlgorithm->setCurrentItem(4);
 
 	m_6Connectivity = new QCheckBox(QString("6-Connectivity"), m_VGrid);
 	m_6Connectivity->setToolTip(QString("Use fully connected neighborhood or "
 																			"only city-block neighbors (26 vs 6)."));
 
+	m_CropToSeeds = new QCheckBox(QString("Crop to seed region"), m_VGrid);
+	m_CropToSeeds->setChecked(true);
+	m_CropToSeeds->setToolTip(QString("Only compute the cut in the bounding box "
+																		"of the bright (bone) voxels, plus a margin."));
+
 	// TODO: this should re-use active-slices
 	m_UseSliceRange = new QCheckBox(QString("Use Slice Range"), m_VGrid);
 	m_HGrid2 = new Q3HBox(m_VGrid);
@@ -158,7 +165,7 @@ void BoneSegmentationWidget::do_work()
 	iseg::SlicesHandlerITKInterface itk_wrapper(m_Handler3D);
 	auto input = itk_wrapper.GetImageDeprecated(iseg::SlicesHandlerITKInterface::kSource, m_UseSliceRange->isChecked());
 
-	assert(m_MaxFlowAlgorithm->currentItem() > 0);
+	assert(m_MaxFlowAlgorithm->currentItem() >= 0 && m_MaxFlowAlgorithm->currentItem() < m_MaxFlowAlgorithm->count());
 
 	// setup algorithm
 	auto graphCutFilter = GraphCutFilterType::New();
@@ -173,6 +180,7 @@ void BoneSegmentationWidget::do_work()
 
 	if (m_6Connectivity->isChecked())
 		graphCutFilter->SetConnectivity(true);
+	graphCutFilter->SetCropToSeeds(m_CropToSeeds->isChecked());
 
 	// assumes input image is 3D
 	if (input->GetLargestPossibleRegion().GetSize(2) > 1)
@@ -51,6 +51,7 @@ private:
 	QComboBox* m_MaxFlowAlgorithm;
 	QPushButton* m_Execute;
 	QCheckBox* m_6Connectivity;
+	QCheckBox* m_CropToSeeds;
 	QCheckBox* m_UseSliceRange;
 	QSpinBox* m_Start;
 	QSpinBox* m_End;
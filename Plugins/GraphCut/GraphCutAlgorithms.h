@@ -12,28 +12,36 @@
 // ITK
 #include <itkGradientMagnitudeRecursiveGaussianImageFilter.h>
 #include <itkImage.h>
-#include <itkMinimumMaximumImageCalculator.h>
+#include <itkImageRegionConstIteratorWithIndex.h>
+#include <itkImageRegionIterator.h>
 #include <itkProgressReporter.h>
-#include <itkShapedNeighborhoodIterator.h>
 #include <itkTimeProbesCollectorBase.h>
 //#include <itkMultiScaleHessianBasedMeasureImageFilter>
 
 // STL
+#include <algorithm>
 #include <fstream>
+#include <limits>
+#include <memory>
 #include <string>
 #include <vector>
 
 // Gc
+#include "Flow/General/Kohli.h"
 #include "Flow/Grid/Kohli.h"
 #include "Flow/Grid/PushRelabel/Fifo.h"
 #include "Flow/Grid/PushRelabel/HighestLevel.h"
 
+#include "PartitionedGridMaxFlow.h"
+
 namespace itk {
 
 enum eGcMaxFlowAlgorithm {
 	kKohli = 0,
 	kPushLabelFifo = 1,
 	kPushLabelHighestLevel = 2,
+	kParallelKohli = 3,
+	kAutomatic = 4, ///< kParallelKohli if PartitionedGridMaxFlow::IsWorthPartitioning, else kKohli
 };
 enum eGcConnectivity {
 	kFaceNeighbors,
@@ -77,6 +85,9 @@ public:
 
 	void SetUseGradientMagnitude(bool b) { m_UseGradientMagnitude = b; }
 
+	/// solve on a downsampled grid first, then refine a narrow band around the coarse boundary
+	void SetCoarseToFine(bool b) { m_CoarseToFine = b; }
+
 	// image setters
 	void SetMaskInput(InputImageType* image)
 	{
@@ -107,15 +118,50 @@ private:
 
 private:
 	typedef Gc::Flow::IGridMaxFlow<NDimension, Gc::Float32, Gc::Float32, Gc::Float32> GraphType;
+	typedef Gc::Math::Algebra::Vector<NDimension, Gc::Size> GridSizeType;
+
+	enum eNodeLabel : unsigned char {
+		kBackgroundNode = 0,
+		kForegroundNode,
+		kObject1Node,
+		kObject2Node
+	};
+
+	/// labels and edge strength on the grid of the graph
+	struct GridData
+	{
+		GridSizeType dim;
+		std::vector<unsigned char> label;
+		/// rescaled gradient magnitude, empty for uniform arc weights
+		std::vector<float> edge;
+		float scale = 1.f;
+	};
+
+	typename InputImageType::RegionType ComputeMaskRegion(const typename InputImageType::RegionType& region);
 
-	void InitializeGraph(GraphType*, ProgressReporter& progress);
+	void ExtractGrid(const typename InputImageType::RegionType& region, GridData& grid, ProgressReporter& progress);
 
-	void CutGraph(GraphType*, ProgressReporter& progress);
+	/// computes for each node if it belongs to object 1 (source), returns false if aborted
+	bool Solve(const GridData& grid, std::vector<unsigned char>& source);
+
+	bool SolveGrid(const GridData& grid, std::vector<unsigned char>& source);
+
+	/// solves the cut in a band around the boundary of the coarse solution
+	bool Refine(const GridData& grid, const GridData& coarse, const std::vector<unsigned char>& coarse_source, std::vector<unsigned char>& source);
+
+	GridData Coarsen(const GridData& grid) const;
+
+	float Weight(const GridData& grid, Gc::Size p, Gc::Size q) const
+	{
+		return grid.edge.empty() ? grid.scale : grid.scale / (0.01f + grid.edge[p] + grid.edge[q]); // [0.5, 100.0]
+	}
 
 	double m_Sigma = 1.0;
 	bool m_UseGradientMagnitude = false;
+	bool m_CoarseToFine = false;
+	Gc::Energy::Neighbourhood<NDimension, Gc::Int32> m_Neighbourhood;
 	eGcConnectivity m_Connectivity = eGcConnectivity::kNodeNeighbors;
-	eGcMaxFlowAlgorithm m_MaxFlowAlgorithm = eGcMaxFlowAlgorithm::kKohli;
+	eGcMaxFlowAlgorithm m_MaxFlowAlgorithm = eGcMaxFlowAlgorithm::kAutomatic;
 
 	typename InputImageType::PixelType m_BackgroundValue = 0;
 	typename InputImageType::PixelType m_Object1Value = 127;
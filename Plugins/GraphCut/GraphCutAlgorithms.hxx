@@ -19,27 +19,6 @@ struct NeighborInfo
 		static_assert(NDim == 3, "default implementation assumes DNim==3");
 		return (type == eGcConnectivity::kFaceNeighbors) ? 6 : 26;
 	}
-
-	template<class OffsetType>
-	static void buildNeighbors(std::vector<OffsetType>& neighbors, eGcConnectivity connectivity)
-	{
-		auto con = numberOfNeighbors(connectivity);
-
-		Gc::Energy::Neighbourhood<NDim, Gc::Int32> nb;
-		nb.Common(con, false);
-		Gc::System::Algo::Sort::Heap(nb.Begin(), nb.End());
-
-		// Traverses the image adding the following bidirectional edges:
-		// 1. currentPixel <-> pixel below it
-		// 2. currentPixel <-> pixel to the right of it
-		// 3. currentPixel <-> pixel in front of it
-		// This prevents duplicate edges (i.e. we cannot add an edge to all 6-connected neighbors of every pixel or
-		// almost every edge would be duplicated.
-		for (unsigned int i = 0; i < con; ++i)
-		{
-			neighbors.push_back(OffsetType{nb.m_data[i][0], nb.m_data[i][1], nb.m_data[i][2]});
-		}
-	}
 };
 
 template<>
@@ -49,26 +28,67 @@ struct NeighborInfo<2>
 	{
 		return (type == eGcConnectivity::kFaceNeighbors) ? 4 : 8;
 	}
+};
 
-	template<class OffsetType>
-	static void buildNeighbors(std::vector<OffsetType>& neighbors, eGcConnectivity connectivity)
+/// Helpers to traverse a grid graph with node index 'x + dim[0] * (y + dim[1] * z)'
+template<unsigned int NDim>
+struct GridInfo
+{
+	using SizeType = Gc::Math::Algebra::Vector<NDim, Gc::Size>;
+	using OffsetType = Gc::Math::Algebra::Vector<NDim, Gc::Int32>;
+
+	static Gc::Size numberOfNodes(const SizeType& dim)
 	{
-		auto con = numberOfNeighbors(connectivity);
-
-		Gc::Energy::Neighbourhood<2, Gc::Int32> nb;
-		nb.Common(con, false);
-		Gc::System::Algo::Sort::Heap(nb.Begin(), nb.End());
-
-		// Traverses the image adding the following bidirectional edges:
-		// 1. currentPixel <-> pixel below it
-		// 2. currentPixel <-> pixel to the right of it
-		// 3. currentPixel <-> pixel in front of it
-		// This prevents duplicate edges (i.e. we cannot add an edge to all 6-connected neighbors of every pixel or
-		// almost every edge would be duplicated.
-		for (unsigned int i = 0; i < con; ++i)
+		Gc::Size n = 1;
+		for (unsigned int d = 0; d < NDim; ++d)
 		{
-			neighbors.push_back(OffsetType{nb.m_data[i][0], nb.m_data[i][1]});
+			n *= dim[d];
 		}
+		return n;
+	}
+
+	/// calls f(node, position) for each node in order, stops if f returns false
+	template<class TFunction>
+	static bool forEachNode(const SizeType& dim, TFunction f)
+	{
+		SizeType pos(0);
+		Gc::Size const n = numberOfNodes(dim);
+		for (Gc::Size node = 0; node < n; ++node)
+		{
+			if (!f(node, pos))
+			{
+				return false;
+			}
+			for (unsigned int d = 0; d < NDim && ++pos[d] == dim[d]; ++d)
+			{
+				pos[d] = 0;
+			}
+		}
+		return true;
+	}
+
+	static bool isInside(const SizeType& pos, const OffsetType& offset, const SizeType& dim)
+	{
+		for (unsigned int d = 0; d < NDim; ++d)
+		{
+			Gc::Int64 const i = static_cast<Gc::Int64>(pos[d]) + offset[d];
+			if (i < 0 || i >= static_cast<Gc::Int64>(dim[d]))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static Gc::Int64 linearOffset(const OffsetType& offset, const SizeType& dim)
+	{
+		Gc::Int64 ofs = 0, stride = 1;
+		for (unsigned int d = 0; d < NDim; ++d)
+		{
+			ofs += offset[d] * stride;
+			stride *= dim[d];
+		}
+		return ofs;
 	}
 };
 
@@ -84,52 +104,33 @@ void GraphCutLabelSeparator<TInput, TOutput, TInputIntensityImage>::GenerateData
 	itk::TimeProbesCollectorBase timer;
 
 	timer.Start("ITK init");
-	auto input = GetMaskInput();
 	auto output = this->GetOutput();
 	auto output_region = output->GetRequestedRegion();
 
-	// init ITK progress reporter
-	// InitializeGraph() traverses the input image once, but only output requested region
-	// CutGraph() traverses the output image once
-	ProgressReporter progress(this, 0, output_region.GetNumberOfPixels() + output_region.GetNumberOfPixels());
-
 	// allocate output
 	output->SetBufferedRegion(output_region); // \todo Is this correct?
 	output->Allocate();
+	output->FillBuffer(m_BackgroundValue);
 
-	// get the total image size
-	auto size = input->GetLargestPossibleRegion().GetSize();
-	timer.Stop("ITK init");
+	// outside of the bounding box of the mask there are no arcs, all pixels are background
+	auto region = ComputeMaskRegion(output_region);
 
-	// create graph
-	timer.Start("Graph creation");
-	GraphType* graph = nullptr;
-	if (m_MaxFlowAlgorithm == kKohli)
-	{
-		graph = new Gc::Flow::Grid::Kohli<NDimension, Gc::Float32, Gc::Float32, Gc::Float32, false>;
-	}
-	else if (m_MaxFlowAlgorithm == kPushLabelFifo)
-	{
-		graph = new Gc::Flow::Grid::PushRelabel::Fifo<NDimension, Gc::Float32, Gc::Float32, false>;
-	}
-	else if (m_MaxFlowAlgorithm == kPushLabelHighestLevel)
-	{
-		graph = new Gc::Flow::Grid::PushRelabel::HighestLevel<NDimension, Gc::Float32, Gc::Float32, false>;
-	}
+	// init ITK progress reporter
+	// ExtractGrid() traverses the bounding box once, writing the output traverses it once more
+	ProgressReporter progress(this, 0, 2 * region.GetNumberOfPixels());
+
+	m_Neighbourhood.Common(NeighborInfo<NDimension>::numberOfNeighbors(m_Connectivity), false);
+	Gc::System::Algo::Sort::Heap(m_Neighbourhood.Begin(), m_Neighbourhood.End());
+	timer.Stop("ITK init");
 
-	Gc::Math::Algebra::Vector<NDimension, Gc::Size> sizing;
-	for (unsigned int i = 0; i < NDimension; ++i)
+	if (region.GetNumberOfPixels() == 0)
 	{
-		sizing[i] = size[i];
+		return;
 	}
-	Gc::Energy::Neighbourhood<NDimension, Gc::Int32> nb;
-	nb.Common(NeighborInfo<NDimension>::numberOfNeighbors(m_Connectivity), false);
-	Gc::System::Algo::Sort::Heap(nb.Begin(), nb.End());
-	graph->Init(sizing, nb);
-	timer.Stop("Graph creation");
 
 	timer.Start("Graph init");
-	InitializeGraph(graph, progress);
+	GridData grid;
+	ExtractGrid(region, grid, progress);
 	timer.Stop("Graph init");
 
 	if (this->GetAbortGenerateData())
@@ -139,11 +140,26 @@ void GraphCutLabelSeparator<TInput, TOutput, TInputIntensityImage>::GenerateData
 
 	// cut graph
 	timer.Start("Graph cut");
-	graph->FindMaxFlow();
+	std::vector<unsigned char> source;
+	bool ok = Solve(grid, source);
 	timer.Stop("Graph cut");
 
+	if (!ok)
+	{
+		return;
+	}
+
 	timer.Start("Query results");
-	CutGraph(graph, progress); //&
+	itk::ImageRegionIterator<OutputImageType> output_iterator(output, region);
+	Gc::Size node = 0;
+	for (output_iterator.GoToBegin(); !output_iterator.IsAtEnd(); ++output_iterator, ++node)
+	{
+		if (grid.label[node] != kBackgroundNode)
+		{
+			output_iterator.Set(source[node] ? m_Object1Value : m_Object2Value);
+		}
+		progress.CompletedPixel();
+	}
 	timer.Stop("Query results");
 
 	if (m_PrintTimer)
@@ -153,37 +169,66 @@ void GraphCutLabelSeparator<TInput, TOutput, TInputIntensityImage>::GenerateData
 }
 
 template<typename TInput, typename TOutput, typename TInputIntensityImage>
-void GraphCutLabelSeparator<TInput, TOutput, TInputIntensityImage>::InitializeGraph(GraphType* graph, ProgressReporter& progress)
+typename TInput::RegionType GraphCutLabelSeparator<TInput, TOutput, TInputIntensityImage>::ComputeMaskRegion(const typename InputImageType::RegionType& region)
+{
+	using IndexType = typename InputImageType::IndexType;
+	using IndexValueType = typename IndexType::IndexValueType;
+
+	IndexType lower, upper;
+	lower.Fill(std::numeric_limits<IndexValueType>::max());
+	upper.Fill(std::numeric_limits<IndexValueType>::min());
+
+	itk::ImageRegionConstIteratorWithIndex<InputImageType> it(GetMaskInput(), region);
+	for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+	{
+		if (it.Get() != m_BackgroundValue)
+		{
+			auto const& idx = it.GetIndex();
+			for (unsigned int d = 0; d < NDimension; ++d)
+			{
+				lower[d] = std::min(lower[d], idx[d]);
+				upper[d] = std::max(upper[d], idx[d]);
+			}
+		}
+	}
+
+	typename InputImageType::RegionType bbox;
+	if (lower[0] <= upper[0])
+	{
+		typename InputImageType::SizeType size;
+		for (unsigned int d = 0; d < NDimension; ++d)
+		{
+			size[d] = upper[d] - lower[d] + 1;
+		}
+		bbox.SetIndex(lower);
+		bbox.SetSize(size);
+	}
+	return bbox;
+}
+
+template<typename TInput, typename TOutput, typename TInputIntensityImage>
+void GraphCutLabelSeparator<TInput, TOutput, TInputIntensityImage>::ExtractGrid(const typename InputImageType::RegionType& region, GridData& grid, ProgressReporter& progress)
 {
 	using RealImageType = itk::Image<float, NDimension>;
-	using MaskIteratorType = itk::ShapedNeighborhoodIterator<InputImageType>;
-	using GradientMagnitudeIteratorType = itk::ShapedNeighborhoodIterator<RealImageType>;
-	using OffsetType = typename MaskIteratorType::OffsetType;
 	using GradientMagnitudeFilter = itk::GradientMagnitudeRecursiveGaussianImageFilter<IntensityImageType, RealImageType>;
 
+	for (unsigned int d = 0; d < NDimension; ++d)
+	{
+		grid.dim[d] = region.GetSize(d);
+	}
+	grid.label.resize(region.GetNumberOfPixels());
+
 	const bool& abort = this->GetAbortGenerateData(); // use reference (alias) to original flag!
-	auto input = GetMaskInput();
-	auto output = this->GetOutput();
-	auto output_region = output->GetRequestedRegion();
-	OffsetType center;
-	center.Fill(0);
-	itk::Size<NDimension> radius;
-	radius.Fill(1);
-
-	// Setup neighborhood (graph connectivity)
-	std::vector<OffsetType> neighbors;
-	NeighborInfo<NDimension>::buildNeighbors(neighbors, m_Connectivity);
-	auto const num_neighbors = neighbors.size();
-
-	MaskIteratorType iterator(radius, input, output_region);
-	iterator.ClearActiveList();
-	for (size_t i = 0; i < neighbors.size(); ++i)
+	itk::ImageRegionConstIterator<InputImageType> it(GetMaskInput(), region);
+	auto label = grid.label.begin();
+	for (it.GoToBegin(); !it.IsAtEnd() && !abort; ++it, ++label)
 	{
-		iterator.ActivateOffset(neighbors[i]);
+		auto v = it.Get();
+		*label = (v == m_BackgroundValue) ? kBackgroundNode : (v == m_Object1Value) ? kObject1Node : (v == m_Object2Value) ? kObject2Node : kForegroundNode;
+		progress.CompletedPixel();
 	}
-	iterator.ActivateOffset(center);
 
-	if (m_UseGradientMagnitude)
+	if (m_UseGradientMagnitude && !abort)
 	{
 		if (!GetIntensityInput())
 		{
@@ -193,16 +238,21 @@ void GraphCutLabelSeparator<TInput, TOutput, TInputIntensityImage>::InitializeGr
 		auto magnitude_filter = GradientMagnitudeFilter::New();
 		magnitude_filter->SetInput(GetIntensityInput());
 		magnitude_filter->SetSigma(m_Sigma);
-		magnitude_filter->GetOutput()->SetRequestedRegion(output_region);
+		magnitude_filter->GetOutput()->SetRequestedRegion(region);
 		magnitude_filter->Update();
 		auto gradient_magnitude = magnitude_filter->GetOutput();
 
-		auto calculator = itk::MinimumMaximumImageCalculator<RealImageType>::New();
-		calculator->SetImage(gradient_magnitude);
-		calculator->Compute();
+		grid.edge.resize(region.GetNumberOfPixels());
+		itk::ImageRegionConstIterator<RealImageType> git(gradient_magnitude, region);
+		auto edge = grid.edge.begin();
+		for (git.GoToBegin(); !git.IsAtEnd(); ++git, ++edge)
+		{
+			*edge = git.Get();
+		}
 
-		auto min_gm = calculator->GetMinimum();
-		auto max_gm = calculator->GetMaximum();
+		auto min_max = std::minmax_element(grid.edge.begin(), grid.edge.end());
+		auto min_gm = *min_max.first;
+		auto max_gm = *min_max.second;
 
 		// rescale to range [0,1]
 		float scale = 0.f, shift = 0.f;
@@ -216,133 +266,340 @@ void GraphCutLabelSeparator<TInput, TOutput, TInputIntensityImage>::InitializeGr
 		}
 		shift = -min_gm * scale;
 
-		auto rescale = [scale, shift](float v) {
-			return v * scale + shift;
-		};
-
-		if (abort)
+		for (auto& v : grid.edge)
 		{
-			return;
+			v = v * scale + shift;
 		}
+	}
+}
+
+template<typename TInput, typename TOutput, typename TInputIntensityImage>
+bool GraphCutLabelSeparator<TInput, TOutput, TInputIntensityImage>::Solve(const GridData& grid, std::vector<unsigned char>& source)
+{
+	// coarsen while the grid is large in all directions
+	bool coarsen = m_CoarseToFine;
+	for (unsigned int d = 0; d < NDimension; ++d)
+	{
+		coarsen = coarsen && grid.dim[d] >= 64;
+	}
+
+	if (!coarsen)
+	{
+		return SolveGrid(grid, source);
+	}
+
+	auto coarse = Coarsen(grid);
+	std::vector<unsigned char> coarse_source;
+	return Solve(coarse, coarse_source) && Refine(grid, coarse, coarse_source, source);
+}
+
+template<typename TInput, typename TOutput, typename TInputIntensityImage>
+bool GraphCutLabelSeparator<TInput, TOutput, TInputIntensityImage>::SolveGrid(const GridData& grid, std::vector<unsigned char>& source)
+{
+	using GridInfoType = GridInfo<NDimension>;
+
+	const bool& abort = this->GetAbortGenerateData();
+	auto const& nb = m_Neighbourhood;
+	std::vector<Gc::Int64> offsets;
+	for (Gc::Size i = 0; i < nb.Elements(); ++i)
+	{
+		offsets.push_back(GridInfoType::linearOffset(nb[i], grid.dim));
+	}
 
-		GradientMagnitudeIteratorType iterator2(radius, gradient_magnitude, output_region);
-		for (iterator.GoToBegin(), iterator2.GoToBegin(); !iterator.IsAtEnd() && !abort; ++iterator, ++iterator2)
+	auto create_graph = [&grid, &nb](eGcMaxFlowAlgorithm algorithm) -> std::unique_ptr<GraphType> {
+		std::unique_ptr<GraphType> graph;
+		if (algorithm == kAutomatic)
+		{
+			algorithm = PartitionedGridMaxFlow<NDimension, Gc::Float32, Gc::Float32, Gc::Float32>::IsWorthPartitioning(grid.dim, nb) ? kParallelKohli : kKohli;
+		}
+		if (algorithm == kKohli)
+		{
+			graph.reset(new Gc::Flow::Grid::Kohli<NDimension, Gc::Float32, Gc::Float32, Gc::Float32, false>);
+		}
+		else if (algorithm == kPushLabelFifo)
 		{
-			progress.CompletedPixel();
+			graph.reset(new Gc::Flow::Grid::PushRelabel::Fifo<NDimension, Gc::Float32, Gc::Float32, false>);
+		}
+		else if (algorithm == kPushLabelHighestLevel)
+		{
+			graph.reset(new Gc::Flow::Grid::PushRelabel::HighestLevel<NDimension, Gc::Float32, Gc::Float32, false>);
+		}
+		else
+		{
+			graph.reset(new PartitionedGridMaxFlow<NDimension, Gc::Float32, Gc::Float32, Gc::Float32>);
+		}
+		graph->Init(grid.dim, nb);
+		return graph;
+	};
 
-			bool pixelIsValidcenter; // BL TODO, slow
-			auto centerPixel = iterator.GetPixel(center, pixelIsValidcenter);
-			if (!pixelIsValidcenter)
+	auto initialize_graph = [&](GraphType* graph) {
+		return GridInfoType::forEachNode(grid.dim, [&](Gc::Size p, const GridSizeType& pos) {
+			if (grid.label[p] == kBackgroundNode)
 			{
-				continue;
+				return !abort;
 			}
 
-			unsigned int nodeIndex1 = input->ComputeOffset(iterator.GetIndex(center));
-
 			// Set weights on edges
-			for (size_t i = 0; i < num_neighbors; i++)
+			for (Gc::Size i = 0; i < nb.Elements(); ++i)
 			{
-				bool pixelIsValid; // BL TODO, slow
-				auto neighborPixel = iterator.GetPixel(neighbors[i], pixelIsValid);
-				if (!pixelIsValid)
+				if (GridInfoType::isInside(pos, nb[i], grid.dim))
 				{
-					continue;
-				}
-
-				if (centerPixel != m_BackgroundValue && neighborPixel != m_BackgroundValue)
-				{
-					// Compute the edge weight GradientMag-Vector also available
-					bool is_valid; // assume is always valid
-					auto gm1 = rescale(iterator.GetPixel(center, is_valid));
-					auto gm2 = rescale(iterator.GetPixel(neighbors[i], is_valid));
-
-					auto invgm = 1.0 / (0.01 + gm1 + gm2); // [0.5, 100.0]
-					graph->SetArcCap(nodeIndex1, i, invgm);
+					Gc::Size q = p + offsets[i];
+					if (grid.label[q] != kBackgroundNode)
+					{
+						graph->SetArcCap(p, i, Weight(grid, p, q));
+					}
 				}
 			}
 
 			// Set source/sink nodes in graph
-			if (centerPixel == m_Object1Value)
-				graph->SetTerminalArcCap(nodeIndex1, 100000, 0); // source
-			else if (centerPixel == m_Object2Value)
-				graph->SetTerminalArcCap(nodeIndex1, 0, 100000); // sink
-		}
+			if (grid.label[p] == kObject1Node)
+				graph->SetTerminalArcCap(p, 100000, 0); // source
+			else if (grid.label[p] == kObject2Node)
+				graph->SetTerminalArcCap(p, 0, 100000); // sink
+			return !abort;
+		});
+	};
+
+	auto graph = create_graph(m_MaxFlowAlgorithm);
+	if (!initialize_graph(graph.get()))
+	{
+		return false;
 	}
-	else
+	graph->FindMaxFlow();
+
+	source.resize(grid.label.size());
+	for (Gc::Size p = 0; p < source.size(); ++p)
 	{
-		for (iterator.GoToBegin(); !iterator.IsAtEnd() && !abort; ++iterator)
-		{
-			progress.CompletedPixel();
+		source[p] = (grid.label[p] != kBackgroundNode && graph->NodeOrigin(p) == Gc::Flow::Source);
+	}
+	return true;
+}
 
-			bool pixelIsValidcenter; // BL TODO, slow
-			auto centerPixel = iterator.GetPixel(center, pixelIsValidcenter);
-			if (!pixelIsValidcenter)
-			{
-				continue;
-			}
+template<typename TInput, typename TOutput, typename TInputIntensityImage>
+typename GraphCutLabelSeparator<TInput, TOutput, TInputIntensityImage>::GridData GraphCutLabelSeparator<TInput, TOutput, TInputIntensityImage>::Coarsen(const GridData& grid) const
+{
+	using GridInfoType = GridInfo<NDimension>;
 
-			unsigned int nodeIndex1 = input->ComputeOffset(iterator.GetIndex(center));
+	// each coarse node covers 2^N nodes, and its arcs the area of 2^(N-1) arcs
+	GridData coarse;
+	for (unsigned int d = 0; d < NDimension; ++d)
+	{
+		coarse.dim[d] = (grid.dim[d] + 1) / 2;
+	}
+	coarse.scale = grid.scale * (1 << (NDimension - 1));
 
-			// Set weights on edges
-			for (size_t i = 0; i < num_neighbors; i++)
-			{
-				bool pixelIsValid; // BL TODO, slow
-				auto neighborPixel = iterator.GetPixel(neighbors[i], pixelIsValid);
-				if (!pixelIsValid)
-				{
-					continue;
-				}
+	Gc::Size const n = GridInfoType::numberOfNodes(coarse.dim);
+	std::vector<unsigned char> found(n, 0);
+	std::vector<unsigned char> count;
+	if (!grid.edge.empty())
+	{
+		coarse.edge.assign(n, 0.f);
+		count.assign(n, 0);
+	}
 
-				if (centerPixel != m_BackgroundValue && neighborPixel != m_BackgroundValue)
-				{
-					graph->SetArcCap(nodeIndex1, i, 1.0);
-				}
+	GridInfoType::forEachNode(grid.dim, [&](Gc::Size p, const GridSizeType& pos) {
+		if (grid.label[p] != kBackgroundNode)
+		{
+			Gc::Size P = 0;
+			for (int d = NDimension - 1; d >= 0; --d)
+			{
+				P = P * coarse.dim[d] + pos[d] / 2;
+			}
+			found[P] |= 1 << grid.label[p];
+			if (!grid.edge.empty())
+			{
+				coarse.edge[P] += grid.edge[p];
+				count[P]++;
 			}
+		}
+		return true;
+	});
 
-			// Set source/sink nodes in graph
-			if (centerPixel == m_Object1Value)
-				graph->SetTerminalArcCap(nodeIndex1, 100000, 0); // source
-			else if (centerPixel == m_Object2Value)
-				graph->SetTerminalArcCap(nodeIndex1, 0, 100000); // sink
+	// a coarse node is a seed if it only contains seeds of one object
+	coarse.label.resize(n);
+	for (Gc::Size P = 0; P < n; ++P)
+	{
+		bool const object1 = (found[P] & (1 << kObject1Node)) != 0;
+		bool const object2 = (found[P] & (1 << kObject2Node)) != 0;
+		coarse.label[P] = (object1 && !object2) ? kObject1Node : (object2 && !object1) ? kObject2Node : found[P] ? kForegroundNode : kBackgroundNode;
+		if (!count.empty() && count[P] != 0)
+		{
+			coarse.edge[P] /= count[P];
 		}
 	}
+	return coarse;
 }
 
 template<typename TInput, typename TOutput, typename TInputIntensityImage>
-void GraphCutLabelSeparator<TInput, TOutput, TInputIntensityImage>::CutGraph(GraphType* graph, ProgressReporter& progress)
+bool GraphCutLabelSeparator<TInput, TOutput, TInputIntensityImage>::Refine(const GridData& grid, const GridData& coarse, const std::vector<unsigned char>& coarse_source, std::vector<unsigned char>& source)
 {
-	// Iterate over the output image, querying the graph for the association of each pixel
-	auto input = GetMaskInput();
-	auto output = this->GetOutput();
-	auto outputRegion = output->GetRequestedRegion();
-	itk::ImageRegionIterator<InputImageType> input_iterator(input, outputRegion);
-	itk::ImageRegionIterator<OutputImageType> output_iterator(output, outputRegion);
+	using GridInfoType = GridInfo<NDimension>;
+	using BandGraphType = Gc::Flow::General::Kohli<Gc::Float32, Gc::Float32, Gc::Float32>;
 
-	// \todo BL iterate over flat indices to avoid converting ijk to voxelIndex
 	const bool& abort = this->GetAbortGenerateData();
-	output_iterator.GoToBegin();
-	input_iterator.GoToBegin();
-	for (; !output_iterator.IsAtEnd() && !abort; ++input_iterator, ++output_iterator)
+	auto const& nb = m_Neighbourhood;
+	Gc::Size const half = nb.Elements() / 2; // arc i and nb.Elements() - 1 - i are opposite
+	Gc::Size const block_size = Gc::Size(1) << NDimension;
+	Gc::Size const coarse_n = coarse.label.size();
+
+	auto coarse_index = [&coarse](const GridSizeType& pos) {
+		Gc::Size P = 0;
+		for (int d = NDimension - 1; d >= 0; --d)
+		{
+			P = P * coarse.dim[d] + pos[d] / 2;
+		}
+		return P;
+	};
+	auto band_node = [&](Gc::Size band_index, const GridSizeType& pos) {
+		Gc::Size local = 0;
+		for (unsigned int d = 0; d < NDimension; ++d)
+		{
+			local |= (pos[d] & 1) << d;
+		}
+		return band_index * block_size + local;
+	};
+
+	// coarse nodes at the boundary between the objects, or containing seeds of the other object
+	std::vector<unsigned char> boundary(coarse_n, 0);
+	GridInfoType::forEachNode(coarse.dim, [&](Gc::Size P, const GridSizeType& pos) {
+		if (coarse.label[P] != kBackgroundNode)
+		{
+			for (Gc::Size i = 0; i < nb.Elements() && !boundary[P]; ++i)
+			{
+				if (GridInfoType::isInside(pos, nb[i], coarse.dim))
+				{
+					Gc::Size Q = P + GridInfoType::linearOffset(nb[i], coarse.dim);
+					boundary[P] = coarse.label[Q] != kBackgroundNode && coarse_source[Q] != coarse_source[P];
+				}
+			}
+		}
+		return true;
+	});
+	GridInfoType::forEachNode(grid.dim, [&](Gc::Size p, const GridSizeType& pos) {
+		if (grid.label[p] == kObject1Node || grid.label[p] == kObject2Node)
+		{
+			Gc::Size P = coarse_index(pos);
+			boundary[P] |= coarse_source[P] != (grid.label[p] == kObject1Node);
+		}
+		return true;
+	});
+
+	// the band are the boundary nodes and their neighbors
+	std::vector<Gc::Size> band_index(coarse_n, Gc::Size(-1));
+	Gc::Size num_band = 0;
+	GridInfoType::forEachNode(coarse.dim, [&](Gc::Size P, const GridSizeType& pos) {
+		bool in_band = boundary[P] != 0;
+		for (Gc::Size i = 0; i < nb.Elements() && !in_band; ++i)
+		{
+			in_band = GridInfoType::isInside(pos, nb[i], coarse.dim) && boundary[P + GridInfoType::linearOffset(nb[i], coarse.dim)];
+		}
+		if (in_band && coarse.label[P] != kBackgroundNode)
+		{
+			band_index[P] = num_band++;
+		}
+		return true;
+	});
+
+	source.resize(grid.label.size());
+	if (num_band == 0)
+	{
+		GridInfoType::forEachNode(grid.dim, [&](Gc::Size p, const GridSizeType& pos) {
+			source[p] = grid.label[p] != kBackgroundNode && coarse_source[coarse_index(pos)];
+			return true;
+		});
+		return !abort;
+	}
+
+	// graph of the band, arcs to fixed nodes outside the band are added to the terminal arcs
+	Gc::Size const num_nodes = num_band * block_size;
+	std::vector<Gc::Float32> cap_source(num_nodes, 0.f), cap_sink(num_nodes, 0.f);
+	std::vector<Gc::Int64> offsets;
+	for (Gc::Size i = 0; i < nb.Elements(); ++i)
 	{
-		if (input_iterator.Get() == m_BackgroundValue)
+		offsets.push_back(GridInfoType::linearOffset(nb[i], grid.dim));
+	}
+
+	BandGraphType graph;
+	graph.Init(num_nodes, num_nodes * half, num_nodes, num_nodes);
+	bool ok = GridInfoType::forEachNode(grid.dim, [&](Gc::Size p, const GridSizeType& pos) {
+		Gc::Size const P = coarse_index(pos);
+		if (grid.label[p] == kBackgroundNode || band_index[P] == Gc::Size(-1))
 		{
-			output_iterator.Set(m_BackgroundValue);
+			return true;
 		}
-		else
+
+		Gc::Size const node = band_node(band_index[P], pos);
+		for (Gc::Size i = 0; i < nb.Elements(); ++i)
 		{
-			// \warning If we update less than LargestPossibleRegion, this may be incorrect
-			unsigned int voxelIndex = input->ComputeOffset(input_iterator.GetIndex());
-			if (graph->NodeOrigin(voxelIndex) == Gc::Flow::Source)
+			if (!GridInfoType::isInside(pos, nb[i], grid.dim))
 			{
-				output_iterator.Set(m_Object1Value);
+				continue;
+			}
+			Gc::Size const q = p + offsets[i];
+			if (grid.label[q] == kBackgroundNode)
+			{
+				continue;
+			}
+
+			GridSizeType qpos;
+			for (unsigned int d = 0; d < NDimension; ++d)
+			{
+				qpos[d] = pos[d] + nb[i][d];
+			}
+			Gc::Size const Q = coarse_index(qpos);
+			float const w = Weight(grid, p, q);
+			if (band_index[Q] != Gc::Size(-1))
+			{
+				if (i < half)
+				{
+					graph.SetArcCap(node, band_node(band_index[Q], qpos), w, w);
+				}
+			}
+			else if (coarse_source[Q])
+			{
+				cap_source[node] += w;
 			}
 			else
 			{
-				output_iterator.Set(m_Object2Value);
+				cap_sink[node] += w;
 			}
 		}
-		progress.CompletedPixel();
+
+		if (grid.label[p] == kObject1Node)
+			cap_source[node] += 100000;
+		else if (grid.label[p] == kObject2Node)
+			cap_sink[node] += 100000;
+		return !abort;
+	});
+	if (!ok)
+	{
+		return false;
+	}
+
+	for (Gc::Size node = 0; node < num_nodes; ++node)
+	{
+		graph.SetTerminalArcCap(node, cap_source[node], cap_sink[node]);
 	}
+	graph.FindMaxFlow();
+
+	GridInfoType::forEachNode(grid.dim, [&](Gc::Size p, const GridSizeType& pos) {
+		Gc::Size const P = coarse_index(pos);
+		if (grid.label[p] == kBackgroundNode)
+		{
+			source[p] = 0;
+		}
+		else if (band_index[P] == Gc::Size(-1))
+		{
+			source[p] = coarse_source[P];
+		}
+		else
+		{
+			source[p] = graph.NodeOrigin(band_node(band_index[P], pos)) == Gc::Flow::Source;
+		}
+		return true;
+	});
+	return !abort;
 }
 
 } // namespace itk
@@ -15,19 +15,24 @@
 #include <itkGradientMagnitudeImageFilter.h>
 #include <itkImage.h>
 #include <itkImageDuplicator.h>
+#include <itkImageRegionConstIteratorWithIndex.h>
 #include <itkImageRegionIterator.h>
 #include <itkImageRegionIteratorWithIndex.h>
 #include <itkImageToImageFilter.h>
 #include <itkMatrix.h>
 #include <itkProgressReporter.h>
 #include <itkRecursiveGaussianImageFilter.h>
+#include <itkRegionOfInterestImageFilter.h>
 #include <itkShapedNeighborhoodIterator.h>
 #include <itkSymmetricEigenAnalysis.h>
 #include <itkTimeProbesCollectorBase.h>
 //#include <itkMultiScaleHessianBasedMeasureImageFilter>
 
 // STL
+#include <algorithm>
 #include <fstream>
+#include <limits>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -36,6 +41,8 @@
 #include "Flow/Grid/PushRelabel/Fifo.h"
 #include "Flow/Grid/PushRelabel/HighestLevel.h"
 
+#include "PartitionedGridMaxFlow.h"
+
 namespace itk {
 
 template<typename TInput, typename TForeground, typename TBackground, typename TOutput>
@@ -71,6 +78,8 @@ public:
 		kKohli = 0,
 		kPushLabelFifo = 1,
 		kPushLabelHighestLevel = 2,
+		kParallelKohli = 3,
+		kAutomatic = 4, ///< kParallelKohli if PartitionedGridMaxFlow::IsWorthPartitioning, else kKohli
 	};
 
 	using ProcessObject::SetNumberOfRequiredInputs;
@@ -92,6 +101,9 @@ public:
 
 	void SetMaxFlowAlgorithm(eMaxFlowAlgorithm alg) { m_MaxFlowAlgorithm = alg; }
 
+	/// only build the graph in the (padded) bounding box of the foreground seeds, pixels outside are background
+	void SetCropToSeeds(bool b) { m_CropToSeeds = b; }
+
 	void SetForegroundPixelValue(typename OutputImageType::PixelType v)
 	{
 		m_ForegroundPixelValue = v;
@@ -135,6 +147,8 @@ private:
 		typename BackgroundImageType::ConstPointer background;
 		typename OutputImageType::Pointer output;
 		typename InputImageType::RegionType outputRegion;
+		/// region of the graph in the index space of the output
+		typename InputImageType::RegionType graphRegion;
 	};
 	typedef Gc::Flow::IGridMaxFlow<3, Gc::Float32, Gc::Float32, Gc::Float32> GraphType;
 
@@ -142,7 +156,13 @@ private:
 
 	void CutGraph(GraphType*, ImageContainer, ProgressReporter& progress);
 
-	// convert 3d itk indices to a continously numbered indices
+	// padded bounding box of the source seeds, empty if there are none
+	typename InputImageType::RegionType ComputeSeedRegion(const ImageContainer& images) const;
+
+	template<class TCropImage>
+	static typename TCropImage::ConstPointer CropImage(const TCropImage* image, const typename TCropImage::RegionType& region);
+
+	// convert 3d itk indices to a continously numbered indices, relative to the start of region
 	unsigned int ConvertIndexToVertexDescriptor(const itk::Index<3>, typename InputImageType::RegionType);
 
 	// image getters
@@ -156,6 +176,7 @@ private:
 	bool m_UseIntensity;
 	bool m_UseGradientMagnitude;
 	eMaxFlowAlgorithm m_MaxFlowAlgorithm;
+	bool m_CropToSeeds;
 	bool m_6Connected;
 	int m_ForegroundValue;
 	int m_BackgroundValue;
@@ -14,7 +14,7 @@ namespace itk {
 
 template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
 ImageGraphCutFilter<TImage, TForeground, TBackground, TOutput>::ImageGraphCutFilter()
-		: m_Sigma(0.2), m_ForegroundPixelValue(255), m_BackgroundPixelValue(0), m_PrintTimer(true), m_6Connected(false), m_UseForegroundBackground(false), m_UseGradientMagnitude(false), m_MaxFlowAlgorithm(kKohli), m_UseIntensity(false), m_ForegroundValue(400), m_BackgroundValue(-50)
+		: m_Sigma(0.2), m_ForegroundPixelValue(255), m_BackgroundPixelValue(0), m_PrintTimer(true), m_6Connected(false), m_UseForegroundBackground(false), m_UseGradientMagnitude(false), m_MaxFlowAlgorithm(kAutomatic), m_CropToSeeds(true), m_UseIntensity(false), m_ForegroundValue(400), m_BackgroundValue(-50)
 {
 	this->SetNumberOfRequiredInputs(3);
 }
@@ -33,6 +33,35 @@ void ImageGraphCutFilter<TImage, TForeground, TBackground, TOutput>::GenerateDat
 	images.background = this->GetInput(2);
 	images.output = this->GetOutput();
 	images.outputRegion = images.output->GetRequestedRegion();
+	images.graphRegion = images.inputRegion;
+
+	// allocate output
+	images.output->SetBufferedRegion(images.outputRegion);
+	images.output->Allocate();
+	images.output->FillBuffer(m_BackgroundPixelValue);
+
+	if (m_CropToSeeds)
+	{
+		images.graphRegion = ComputeSeedRegion(images);
+		if (images.graphRegion.GetNumberOfPixels() == 0)
+		{
+			// without source seeds all pixels are background
+			return;
+		}
+		if (images.graphRegion != images.inputRegion)
+		{
+			images.input = CropImage<InputImageType>(images.input, images.graphRegion);
+			images.inputRegion = images.input->GetLargestPossibleRegion();
+			if (images.foreground)
+			{
+				images.foreground = CropImage<ForegroundImageType>(images.foreground, images.graphRegion);
+			}
+			if (images.background)
+			{
+				images.background = CropImage<BackgroundImageType>(images.background, images.graphRegion);
+			}
+		}
+	}
 
 	// init ITK progress reporter
 	// InitializeGraph() traverses the input image once
@@ -42,10 +71,6 @@ void ImageGraphCutFilter<TImage, TForeground, TBackground, TOutput>::GenerateDat
 	// since both report to the same ProgressReporter, we add the total amount of pixels
 	ProgressReporter progress(this, 0, numberOfPixelDuringInit + numberOfPixelDuringOutput);
 
-	// allocate output
-	images.output->SetBufferedRegion(images.outputRegion);
-	images.output->Allocate();
-
 	// get the total image size
 	auto size = images.inputRegion.GetSize();
 	timer.Stop("ITK init");
@@ -65,25 +90,37 @@ void ImageGraphCutFilter<TImage, TForeground, TBackground, TOutput>::GenerateDat
 		nb.Common(6, false);
 	}
 	Gc::System::Algo::Sort::Heap(nb.Begin(), nb.End());
-	GraphType* graph = nullptr;
-	if (m_MaxFlowAlgorithm == kKohli)
-	{
-		graph = new Gc::Flow::Grid::Kohli<3, Gc::Float32, Gc::Float32, Gc::Float32, false>;
-	}
-	else if (m_MaxFlowAlgorithm == kPushLabelFifo)
-	{
-		graph = new Gc::Flow::Grid::PushRelabel::Fifo<3, Gc::Float32, Gc::Float32, false>;
-	}
-	else if (m_MaxFlowAlgorithm == kPushLabelHighestLevel)
-	{
-		graph = new Gc::Flow::Grid::PushRelabel::HighestLevel<3, Gc::Float32, Gc::Float32, false>;
-	}
 
-	graph->Init(sizing, nb);
+	auto create_graph = [&sizing, &nb](eMaxFlowAlgorithm algorithm) -> std::unique_ptr<GraphType> {
+		std::unique_ptr<GraphType> graph;
+		if (algorithm == kAutomatic)
+		{
+			algorithm = PartitionedGridMaxFlow<3, Gc::Float32, Gc::Float32, Gc::Float32>::IsWorthPartitioning(sizing, nb) ? kParallelKohli : kKohli;
+		}
+		if (algorithm == kKohli)
+		{
+			graph.reset(new Gc::Flow::Grid::Kohli<3, Gc::Float32, Gc::Float32, Gc::Float32, false>);
+		}
+		else if (algorithm == kPushLabelFifo)
+		{
+			graph.reset(new Gc::Flow::Grid::PushRelabel::Fifo<3, Gc::Float32, Gc::Float32, false>);
+		}
+		else if (algorithm == kPushLabelHighestLevel)
+		{
+			graph.reset(new Gc::Flow::Grid::PushRelabel::HighestLevel<3, Gc::Float32, Gc::Float32, false>);
+		}
+		else
+		{
+			graph.reset(new PartitionedGridMaxFlow<3, Gc::Float32, Gc::Float32, Gc::Float32>);
+		}
+		graph->Init(sizing, nb);
+		return graph;
+	};
+	auto graph = create_graph(m_MaxFlowAlgorithm);
 	timer.Stop("Graph creation");
 
 	timer.Start("Graph init");
-	InitializeGraph(graph, images, progress);
+	InitializeGraph(graph.get(), images, progress);
 	timer.Stop("Graph init");
 
 	if (this->GetAbortGenerateData())
@@ -97,7 +134,7 @@ void ImageGraphCutFilter<TImage, TForeground, TBackground, TOutput>::GenerateDat
 	timer.Stop("Graph cut");
 
 	timer.Start("Query results");
-	CutGraph(graph, images, progress); //&
+	CutGraph(graph.get(), images, progress); //&
 	timer.Stop("Query results");
 
 	std::ofstream ofile("C:/Temp/gc_timer.log");
@@ -117,8 +154,6 @@ void ImageGraphCutFilter<TImage, TForeground, TBackground, TOutput>::InitializeG
 {
 	typename InputImageType::SizeType size = images.inputRegion.GetSize();
 
-	std::vector<double> pixels(size[0] * size[1] * size[2]);
-
 	//compute S field
 	itk::Size<3> radius;
 	radius.Fill(3);
@@ -651,15 +686,21 @@ void ImageGraphCutFilter<TImage, TForeground, TBackground, TOutput>::InitializeG
 template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
 void ImageGraphCutFilter<TImage, TForeground, TBackground, TOutput>::CutGraph(GraphType* graph, ImageContainer images, ProgressReporter& progress)
 {
-	// Iterate over the output image, querying the graph for the association of each pixel
-	itk::ImageRegionIterator<OutputImageType> outputImageIterator(images.output, images.outputRegion);
+	// Iterate over the output image, querying the graph for the association of each pixel.
+	// Pixels outside of the graph are background.
+	auto region = images.graphRegion;
+	if (!region.Crop(images.outputRegion))
+	{
+		return;
+	}
+	itk::ImageRegionIteratorWithIndex<OutputImageType> outputImageIterator(images.output, region);
 	outputImageIterator.GoToBegin();
 
 	// \todo BL iterate over flat indices to avoid convertig ijk to voxelIndex
 	const bool& abort = this->GetAbortGenerateData();
 	while (!outputImageIterator.IsAtEnd() && !abort)
 	{
-		unsigned int voxelIndex = ConvertIndexToVertexDescriptor(outputImageIterator.GetIndex(), images.outputRegion);
+		unsigned int voxelIndex = ConvertIndexToVertexDescriptor(outputImageIterator.GetIndex(), images.graphRegion);
 		if (graph->NodeOrigin(voxelIndex) == Gc::Flow::Source)
 		{
 			outputImageIterator.Set(m_ForegroundPixelValue);
@@ -673,12 +714,81 @@ void ImageGraphCutFilter<TImage, TForeground, TBackground, TOutput>::CutGraph(Gr
 	}
 }
 
+template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
+typename TImage::RegionType ImageGraphCutFilter<TImage, TForeground, TBackground, TOutput>::ComputeSeedRegion(const ImageContainer& images) const
+{
+	using IndexType = typename InputImageType::IndexType;
+	using IndexValueType = typename IndexType::IndexValueType;
+
+	IndexType lower, upper;
+	lower.Fill(std::numeric_limits<IndexValueType>::max());
+	upper.Fill(std::numeric_limits<IndexValueType>::min());
+	auto add_seed = [&lower, &upper](const IndexType& idx) {
+		for (unsigned int i = 0; i < 3; ++i)
+		{
+			lower[i] = std::min(lower[i], idx[i]);
+			upper[i] = std::max(upper[i], idx[i]);
+		}
+	};
+
+	// intensity and sheetness mark bright voxels as source, the foreground image marks values above 4000
+	if (m_UseGradientMagnitude == false)
+	{
+		itk::ImageRegionConstIteratorWithIndex<InputImageType> it(images.input, images.inputRegion);
+		for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+		{
+			if (it.Get() > m_ForegroundValue)
+				add_seed(it.GetIndex());
+		}
+	}
+	if ((m_UseForegroundBackground || m_UseGradientMagnitude) && images.foreground)
+	{
+		itk::ImageRegionConstIteratorWithIndex<ForegroundImageType> it(images.foreground, images.foreground->GetLargestPossibleRegion());
+		for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+		{
+			if ((int)it.Get() > 4000)
+				add_seed(it.GetIndex());
+		}
+	}
+
+	typename InputImageType::RegionType region;
+	if (lower[0] <= upper[0])
+	{
+		typename InputImageType::SizeType size;
+		for (unsigned int i = 0; i < 3; ++i)
+		{
+			size[i] = upper[i] - lower[i] + 1;
+		}
+		region.SetIndex(lower);
+		region.SetSize(size);
+
+		// the source region may grow beyond the seeds, and the Hessian needs some support
+		region.PadByRadius(10);
+		region.Crop(images.inputRegion);
+	}
+	return region;
+}
+
+template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
+template<class TCropImage>
+typename TCropImage::ConstPointer ImageGraphCutFilter<TImage, TForeground, TBackground, TOutput>::CropImage(const TCropImage* image, const typename TCropImage::RegionType& region)
+{
+	auto roi = itk::RegionOfInterestImageFilter<TCropImage, TCropImage>::New();
+	roi->SetInput(image);
+	roi->SetRegionOfInterest(region);
+	roi->Update();
+	typename TCropImage::Pointer cropped = roi->GetOutput();
+	cropped->DisconnectPipeline();
+	return cropped.GetPointer();
+}
+
 template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
 unsigned int ImageGraphCutFilter<TImage, TForeground, TBackground, TOutput>::ConvertIndexToVertexDescriptor(const itk::Index<3> index, typename TImage::RegionType region)
 {
 	typename TImage::SizeType size = region.GetSize();
+	typename TImage::IndexType start = region.GetIndex();
 
-	return index[0] + index[1] * size[0] + index[2] * size[0] * size[1];
+	return (index[0] - start[0]) + (index[1] - start[1]) * size[0] + (index[2] - start[2]) * size[0] * size[1];
 }
 } // namespace itk
 
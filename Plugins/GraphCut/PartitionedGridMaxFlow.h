@@ -0,0 +1,342 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#pragma once
+
+// Gc
+#include "Flow/Grid/Kohli.h"
+#include "System/NotImplementedException.h"
+
+// STL
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#ifndef NO_OPENMP_SUPPORT
+#	include <omp.h>
+#endif
+
+namespace itk {
+
+/** \brief Grid max-flow solved on overlapping slabs in parallel
+
+	The grid is split along its last dimension into slabs, which share one
+	plane with their neighbors, and each slab is solved by its own dynamic
+	(Kohli) solver. The two copies of a shared node are coupled by dual
+	decomposition (Strandmark & Kahl, 'Parallel and distributed graph cuts by
+	dual decomposition', CVPR 2010): the terminal capacities and in-plane arcs
+	of the shared planes are split between the slabs, and a multiplier per
+	shared node moves the copies towards agreement. Once all copies agree,
+	the combined labeling is a minimum cut of the full graph (if the minimum
+	cut is not unique, it may differ from the cut of a serial solver).
+
+	Convergence is not guaranteed. If the copies still disagree after the
+	maximum number of iterations, Converged() returns false and the slabs
+	are reconciled with the same slab graphs: each shared plane is fixed to
+	the labeling of the slab below it, and the slabs above are solved again
+	one after the other. The labeling is then a cut of the full graph, but it
+	may cost more than the minimum cut near the shared planes.
+
+	All state is kept per slab. The slabs hold the nodes and arcs of the grid
+	once, plus one copy of each shared plane, i.e. at most 1/kMinimumSlabThickness
+	more than a single Kohli solver of the grid, and a few values per shared node
+	for the multipliers. No other graph is allocated, also not by the fallback.
+
+	The neighborhood may only connect adjacent planes (e.g. 6 or 26 neighbors).
+*/
+template<Gc::Size N, class TFLOW, class TTCAP, class TCAP>
+class PartitionedGridMaxFlow : public Gc::Flow::IGridMaxFlow<N, TFLOW, TTCAP, TCAP>
+{
+public:
+	using SubGraphType = Gc::Flow::Grid::Kohli<N, TFLOW, TTCAP, TCAP, false>;
+
+	/// slabs are at least this many planes thick
+	static const int kMinimumSlabThickness = 16;
+	/// below this number of nodes, a single Kohli solver is faster than the slab iterations
+	static const Gc::Size kMinimumNodes = Gc::Size(1) << 21;
+
+	/// number of partitions, 0 uses one slab per thread
+	explicit PartitionedGridMaxFlow(int partitions = 0) : m_RequestedPartitions(partitions) {}
+
+	/// number of slabs used for a grid, 1 if the grid cannot be split
+	static int NumberOfPartitions(const Gc::Math::Algebra::Vector<N, Gc::Size>& dim, const Gc::Energy::Neighbourhood<N, Gc::Int32>& nb, int partitions = 0)
+	{
+		int const slices = static_cast<int>(dim[N - 1]);
+		if (partitions <= 0)
+		{
+#ifdef NO_OPENMP_SUPPORT
+			partitions = 1;
+#else
+			partitions = omp_get_max_threads();
+#endif
+		}
+		partitions = std::min(partitions, (slices - 1) / kMinimumSlabThickness);
+		for (Gc::Size i = 0; i < nb.Elements(); ++i)
+		{
+			if (std::abs(nb[i][N - 1]) > 1)
+			{
+				return 1;
+			}
+		}
+		return std::max(partitions, 1);
+	}
+
+	/// true if the grid is large enough and can be split into a slab per thread
+	static bool IsWorthPartitioning(const Gc::Math::Algebra::Vector<N, Gc::Size>& dim, const Gc::Energy::Neighbourhood<N, Gc::Int32>& nb)
+	{
+		Gc::Size nodes = 1;
+		for (Gc::Size i = 0; i < N; ++i)
+		{
+			nodes *= dim[i];
+		}
+		return nodes >= kMinimumNodes && NumberOfPartitions(dim, nb) > 1;
+	}
+
+	void SetMaxIterations(unsigned int n) { m_MaxIterations = n; }
+
+	/// true if the slabs agreed on the shared planes in the last FindMaxFlow(), i.e. the cut is minimal
+	bool Converged() const { return m_Converged; }
+
+	size_t NumberOfPartitions() const { return m_Blocks.size(); }
+
+	void Init(const Gc::Math::Algebra::Vector<N, Gc::Size>& dim, const Gc::Energy::Neighbourhood<N, Gc::Int32>& nb) override
+	{
+		Dispose();
+
+		m_SliceSize = 1;
+		for (Gc::Size i = 0; i + 1 < N; ++i)
+		{
+			m_SliceSize *= dim[i];
+		}
+		int const slices = static_cast<int>(dim[N - 1]);
+		if (slices == 0)
+		{
+			return;
+		}
+
+		for (Gc::Size i = 0; i < nb.Elements(); ++i)
+		{
+			m_ArcOffset.push_back(nb[i][N - 1]);
+		}
+
+		// slab s covers the planes [first(s), first(s+1)], the first plane is shared with slab s-1
+		int const partitions = NumberOfPartitions(dim, nb, m_RequestedPartitions);
+		m_Blocks.resize(partitions);
+		for (int s = 0; s < partitions; ++s)
+		{
+			auto& block = m_Blocks[s];
+			block.m_First = static_cast<Gc::Size>(s) * (slices - 1) / partitions;
+			block.m_Planes = static_cast<Gc::Size>(s + 1) * (slices - 1) / partitions - block.m_First + 1;
+
+			Gc::Math::Algebra::Vector<N, Gc::Size> sub_dim = dim;
+			sub_dim[N - 1] = block.m_Planes;
+			block.m_Graph.reset(new SubGraphType);
+			block.m_Graph->Init(sub_dim, nb);
+			if (s > 0)
+			{
+				block.m_Shared.resize(m_SliceSize);
+			}
+		}
+	}
+
+	void InitMask(const Gc::Math::Algebra::Vector<N, Gc::Size>& /*dim*/, const Gc::Energy::Neighbourhood<N, Gc::Int32>& /*nb*/, const Gc::System::Collection::IArrayMask<N>& /*mask*/) override
+	{
+		throw Gc::System::NotImplementedException(__FUNCTION__, __LINE__, "Masked grids are not supported.");
+	}
+
+	void SetArcCap(Gc::Size node, Gc::Size arc, TCAP cap) override
+	{
+		Gc::Size const z = node / m_SliceSize;
+		Gc::Int32 const dz = m_ArcOffset[arc];
+		Gc::Size const planes = m_Blocks.back().m_First + m_Blocks.back().m_Planes;
+		if ((dz < 0 && z < Gc::Size(-dz)) || (dz > 0 && z + dz >= planes))
+		{
+			return;
+		}
+
+		int s = BlockOf(dz < 0 ? z + dz : z);
+		if (dz == 0 && IsShared(s, z))
+		{
+			// arcs within a shared plane are split between both slabs
+			m_Blocks[s - 1].m_Graph->SetArcCap(node - m_Blocks[s - 1].m_First * m_SliceSize, arc, cap / 2);
+			m_Blocks[s].m_Graph->SetArcCap(node - m_Blocks[s].m_First * m_SliceSize, arc, cap / 2);
+		}
+		else
+		{
+			m_Blocks[s].m_Graph->SetArcCap(node - m_Blocks[s].m_First * m_SliceSize, arc, cap);
+		}
+		m_MaxArcCap = std::max(m_MaxArcCap, cap);
+	}
+
+	void SetTerminalArcCap(Gc::Size node, TTCAP csrc, TTCAP csnk) override
+	{
+		Gc::Size const z = node / m_SliceSize;
+		int s = BlockOf(z);
+		if (IsShared(s, z))
+		{
+			auto& shared = m_Blocks[s].m_Shared[node % m_SliceSize];
+			shared.m_Source = csrc / 2;
+			shared.m_Sink = csnk / 2;
+			SetSharedTerminalArcCap(s, node % m_SliceSize, shared);
+		}
+		else
+		{
+			m_Blocks[s].m_Graph->SetTerminalArcCap(node - m_Blocks[s].m_First * m_SliceSize, csrc, csnk);
+		}
+	}
+
+	/// returns the sum of the slab flows, which is not the flow of the full graph
+	TFLOW FindMaxFlow() override
+	{
+		int const partitions = static_cast<int>(m_Blocks.size());
+		TTCAP const initial_step = m_MaxArcCap > 0 ? m_MaxArcCap : TTCAP(1);
+
+		m_Converged = false;
+		TFLOW flow = 0;
+		for (unsigned int iteration = 0; iteration < m_MaxIterations; ++iteration)
+		{
+			flow = 0;
+#pragma omp parallel for schedule(dynamic) reduction(+ : flow)
+			for (int s = 0; s < partitions; ++s)
+			{
+				flow += m_Blocks[s].m_Graph->FindMaxFlow();
+			}
+
+			// move the multipliers of disagreeing copies, the graphs are not thread-safe.
+			// Each node halves its step when the direction flips. After the last iteration
+			// the graphs are left solved, a node may only be changed once between two solves.
+			bool const last = iteration + 1 == m_MaxIterations;
+			size_t disagreements = 0;
+			for (int s = 1; s < partitions; ++s)
+			{
+				auto& block = m_Blocks[s];
+				Gc::Size const offset = LowerCopyOffset(s);
+				for (Gc::Size i = 0; i < m_SliceSize; ++i)
+				{
+					bool const lower = m_Blocks[s - 1].m_Graph->NodeOrigin(i + offset) == Gc::Flow::Source;
+					bool const upper = block.m_Graph->NodeOrigin(i) == Gc::Flow::Source;
+					if (lower != upper)
+					{
+						disagreements++;
+						if (last)
+						{
+							continue;
+						}
+						auto& shared = block.m_Shared[i];
+						signed char const direction = lower ? 1 : -1;
+						if (shared.m_Direction == 0)
+						{
+							shared.m_Step = initial_step;
+						}
+						else if (shared.m_Direction != direction)
+						{
+							shared.m_Step /= 2;
+						}
+						shared.m_Direction = direction;
+						shared.m_Multiplier += direction * shared.m_Step;
+						SetSharedTerminalArcCap(s, i, shared);
+					}
+				}
+			}
+
+			if (disagreements == 0)
+			{
+				m_Converged = true;
+				return flow;
+			}
+		}
+
+		// fix each shared plane to the labeling of the slab below and solve the slab above again.
+		// A terminal capacity above all arcs of a node cannot be cut.
+		TTCAP const fixed = static_cast<TTCAP>(m_ArcOffset.size() * m_MaxArcCap) + TTCAP(1);
+		for (int s = 1; s < partitions; ++s)
+		{
+			auto& block = m_Blocks[s];
+			Gc::Size const offset = LowerCopyOffset(s);
+			for (Gc::Size i = 0; i < m_SliceSize; ++i)
+			{
+				bool const source = m_Blocks[s - 1].m_Graph->NodeOrigin(i + offset) == Gc::Flow::Source;
+				block.m_Graph->SetTerminalArcCap(i, source ? fixed : TTCAP(0), source ? TTCAP(0) : fixed);
+			}
+			block.m_Graph->FindMaxFlow();
+		}
+		return flow;
+	}
+
+	Gc::Flow::Origin NodeOrigin(Gc::Size node) const override
+	{
+		int s = BlockOf(node / m_SliceSize);
+		return m_Blocks[s].m_Graph->NodeOrigin(node - m_Blocks[s].m_First * m_SliceSize);
+	}
+
+	void Dispose() override
+	{
+		m_Blocks.clear();
+		m_ArcOffset.clear();
+		m_MaxArcCap = 0;
+		m_Converged = false;
+	}
+
+private:
+	struct SharedNode
+	{
+		TTCAP m_Source = 0;
+		TTCAP m_Sink = 0;
+		/// cost added to the lower copy for the source label, and to the upper copy for the sink label
+		TTCAP m_Multiplier = 0;
+		TTCAP m_Step = 0;
+		signed char m_Direction = 0;
+	};
+
+	struct Block
+	{
+		std::unique_ptr<SubGraphType> m_Graph;
+		Gc::Size m_First = 0;
+		Gc::Size m_Planes = 0;
+		/// nodes of the first plane, which is shared with the previous slab (empty for the first slab)
+		std::vector<SharedNode> m_Shared;
+	};
+
+	/// slab owning the plane, a shared plane belongs to the upper slab
+	int BlockOf(Gc::Size z) const
+	{
+		auto it = std::upper_bound(m_Blocks.begin() + 1, m_Blocks.end(), z, [](Gc::Size z, const Block& block) { return z < block.m_First; });
+		return static_cast<int>(it - m_Blocks.begin()) - 1;
+	}
+
+	bool IsShared(int s, Gc::Size z) const
+	{
+		return s > 0 && m_Blocks[s].m_First == z;
+	}
+
+	/// index offset of the shared plane of slab s in slab s-1
+	Gc::Size LowerCopyOffset(int s) const
+	{
+		return (m_Blocks[s].m_First - m_Blocks[s - 1].m_First) * m_SliceSize;
+	}
+
+	void SetSharedTerminalArcCap(int s, Gc::Size i, const SharedNode& shared)
+	{
+		TTCAP const plus = std::max(shared.m_Multiplier, TTCAP(0));
+		TTCAP const minus = std::max(-shared.m_Multiplier, TTCAP(0));
+		m_Blocks[s - 1].m_Graph->SetTerminalArcCap(i + LowerCopyOffset(s), shared.m_Source + minus, shared.m_Sink + plus);
+		m_Blocks[s].m_Graph->SetTerminalArcCap(i, shared.m_Source + plus, shared.m_Sink + minus);
+	}
+
+	int m_RequestedPartitions;
+	unsigned int m_MaxIterations = 200;
+	bool m_Converged = false;
+	TCAP m_MaxArcCap = 0;
+	Gc::Size m_SliceSize = 1;
+	std::vector<Gc::Int32> m_ArcOffset;
+	std::vector<Block> m_Blocks;
+};
+
+} // namespace itk
@@ -39,6 +39,9 @@ TissueSeparatorWidget::TissueSeparatorWidget(
 	all_slices = new QCheckBox;
 	use_source = new QCheckBox;
 	use_source->setToolTip(QString("Use information from Source image, or split purely based on minimum cut through segmentation."));
+	coarse_to_fine = new QCheckBox;
+	coarse_to_fine->setChecked(true);
+	coarse_to_fine->setToolTip(QString("Cut a downsampled image first, then refine only near the coarse boundary. Much faster on large images."));
 	sigma_edit = new QLineEdit(QString::number(1.0));
 	clear_lines = new QPushButton("Clear lines");
 	execute_button = new QPushButton("Execute");
@@ -49,6 +52,7 @@ TissueSeparatorWidget::TissueSeparatorWidget(
 	top_layout->addRow(QString("Apply to all slices"), all_slices);
 	top_layout->addRow(QString("Use source"), use_source);
 	top_layout->addRow(QString("Sigma"), sigma_edit);
+	top_layout->addRow(QString("Coarse to fine"), coarse_to_fine);
 	top_layout->addRow(clear_lines);
 	top_layout->addRow(execute_button);
 
@@ -290,6 +294,7 @@ typename itk::Image<unsigned char, Dim>::Pointer
 	cutter->SetObject2Value(OBJECT_2);
 	cutter->SetVerboseOutput(true);
 	cutter->SetUseGradientMagnitude(use_gradient_magnitude);
+	cutter->SetCoarseToFine(coarse_to_fine->isChecked());
 	if (has_sigma)
 	{
 		cutter->SetSigma(sigma);
@@ -67,6 +67,7 @@ private:
 	QCheckBox* all_slices;
 	QCheckBox* use_source;
 	QLineEdit* sigma_edit;
+	QCheckBox* coarse_to_fine;
 	QPushButton* clear_lines;
 	QPushButton* execute_button;
 };
@@ -0,0 +1,263 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include <boost/test/unit_test.hpp>
+
+#include "../PartitionedGridMaxFlow.h"
+
+#include "System/Algo/Sort/Heap.h"
+
+#include <cstdlib>
+#include <vector>
+
+namespace itk {
+
+namespace {
+using GraphType = Gc::Flow::IGridMaxFlow<3, Gc::Float32, Gc::Float32, Gc::Float32>;
+using KohliType = Gc::Flow::Grid::Kohli<3, Gc::Float32, Gc::Float32, Gc::Float32, false>;
+using PartitionedType = PartitionedGridMaxFlow<3, Gc::Float32, Gc::Float32, Gc::Float32>;
+
+struct RandomGrid
+{
+	Gc::Math::Algebra::Vector<3, Gc::Size> dim;
+	Gc::Energy::Neighbourhood<3, Gc::Int32> nb;
+	std::vector<float> arc;			 // per node and arc
+	std::vector<float> source, sink; // per node
+};
+
+float random_value(float max_value) { return max_value * rand() / RAND_MAX; }
+
+// smooth random terminals with noise, so the cut has structure across the slabs
+RandomGrid make_random_grid(Gc::Size nx, Gc::Size ny, Gc::Size nz, Gc::Size neighbors)
+{
+	RandomGrid grid;
+	grid.dim[0] = nx;
+	grid.dim[1] = ny;
+	grid.dim[2] = nz;
+	grid.nb.Common(neighbors, false);
+	Gc::System::Algo::Sort::Heap(grid.nb.Begin(), grid.nb.End());
+
+	float const cx = random_value(float(nx)), cy = random_value(float(ny)), cz = random_value(float(nz));
+	float const r2 = 0.1f * (nx * nx + ny * ny + nz * nz);
+	Gc::Size const n = nx * ny * nz;
+	grid.source.resize(n);
+	grid.sink.resize(n);
+	grid.arc.resize(n * grid.nb.Elements());
+	for (Gc::Size p = 0; p < n; ++p)
+	{
+		float const x = float(p % nx) - cx, y = float((p / nx) % ny) - cy, z = float(p / (nx * ny)) - cz;
+		bool const inside = x * x + y * y + z * z < r2;
+		grid.source[p] = random_value(inside ? 10.f : 4.f);
+		grid.sink[p] = random_value(inside ? 4.f : 10.f);
+		for (Gc::Size i = 0; i < grid.nb.Elements(); ++i)
+		{
+			grid.arc[p * grid.nb.Elements() + i] = random_value(3.f);
+		}
+	}
+	return grid;
+}
+
+void initialize(GraphType& graph, const RandomGrid& grid)
+{
+	graph.Init(grid.dim, grid.nb);
+	Gc::Size const nx = grid.dim[0], ny = grid.dim[1];
+	for (Gc::Size p = 0; p < grid.source.size(); ++p)
+	{
+		long const pos[3] = {long(p % nx), long((p / nx) % ny), long(p / (nx * ny))};
+		for (Gc::Size i = 0; i < grid.nb.Elements(); ++i)
+		{
+			bool inside = true;
+			for (int d = 0; d < 3; ++d)
+			{
+				long q = pos[d] + grid.nb[i][d];
+				inside = inside && q >= 0 && q < long(grid.dim[d]);
+			}
+			if (inside)
+			{
+				graph.SetArcCap(p, i, grid.arc[p * grid.nb.Elements() + i]);
+			}
+		}
+		graph.SetTerminalArcCap(p, grid.source[p], grid.sink[p]);
+	}
+}
+
+std::vector<bool> labeling(const GraphType& graph, Gc::Size n)
+{
+	std::vector<bool> source(n);
+	for (Gc::Size p = 0; p < n; ++p)
+	{
+		source[p] = (graph.NodeOrigin(p) == Gc::Flow::Source);
+	}
+	return source;
+}
+
+size_t count_differences(const std::vector<bool>& a, const std::vector<bool>& b)
+{
+	size_t count = 0;
+	for (size_t i = 0; i < a.size(); ++i)
+	{
+		count += (a[i] != b[i]) ? 1 : 0;
+	}
+	return count;
+}
+
+// cost of the cut given by a labeling
+double cut_cost(const RandomGrid& grid, const std::vector<bool>& source)
+{
+	Gc::Size const nx = grid.dim[0], ny = grid.dim[1];
+	double cost = 0;
+	for (Gc::Size p = 0; p < source.size(); ++p)
+	{
+		cost += source[p] ? grid.sink[p] : grid.source[p];
+		if (!source[p])
+		{
+			continue;
+		}
+		long const pos[3] = {long(p % nx), long((p / nx) % ny), long(p / (nx * ny))};
+		for (Gc::Size i = 0; i < grid.nb.Elements(); ++i)
+		{
+			long q = 0;
+			bool inside = true;
+			for (int d = 2; d >= 0; --d)
+			{
+				long const c = pos[d] + grid.nb[i][d];
+				inside = inside && c >= 0 && c < long(grid.dim[d]);
+				q = q * long(grid.dim[d]) + c;
+			}
+			if (inside && !source[q])
+			{
+				cost += grid.arc[p * grid.nb.Elements() + i];
+			}
+		}
+	}
+	return cost;
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(iSeg_suite);
+BOOST_AUTO_TEST_SUITE(PartitionedGridMaxFlow_suite);
+
+// TestRunner.exe --run_test=iSeg_suite/PartitionedGridMaxFlow_suite/SameCutAsKohli_test --log_level=message
+BOOST_AUTO_TEST_CASE(SameCutAsKohli_test)
+{
+	srand(5);
+	for (int k = 0; k < 12; ++k)
+	{
+		Gc::Size const neighbors = (k % 2 == 0) ? 6 : 26;
+		RandomGrid grid = make_random_grid(8 + rand() % 8, 8 + rand() % 8, 50 + rand() % 40, neighbors);
+		Gc::Size const n = grid.source.size();
+
+		KohliType kohli;
+		initialize(kohli, grid);
+		kohli.FindMaxFlow();
+		auto expected = labeling(kohli, n);
+
+		for (int partitions : {2, 3})
+		{
+			PartitionedType partitioned(partitions);
+			initialize(partitioned, grid);
+			partitioned.FindMaxFlow();
+			BOOST_CHECK_EQUAL(partitioned.NumberOfPartitions(), partitions);
+			BOOST_REQUIRE(partitioned.Converged());
+			BOOST_CHECK_EQUAL(count_differences(labeling(partitioned, n), expected), 0);
+		}
+	}
+}
+
+// TestRunner.exe --run_test=iSeg_suite/PartitionedGridMaxFlow_suite/Fallback_test --log_level=message
+BOOST_AUTO_TEST_CASE(Fallback_test)
+{
+	// with a few iterations the multipliers cannot always reconcile the slabs,
+	// then the shared planes are fixed and the labeling must still be close to the minimum cut
+	srand(9);
+	int not_converged = 0;
+	for (int k = 0; k < 8; ++k)
+	{
+		RandomGrid grid = make_random_grid(10, 10, 64, (k % 2 == 0) ? 6 : 26);
+		Gc::Size const n = grid.source.size();
+
+		KohliType kohli;
+		initialize(kohli, grid);
+		kohli.FindMaxFlow();
+		auto expected = labeling(kohli, n);
+
+		PartitionedType partitioned(4);
+		partitioned.SetMaxIterations(5);
+		initialize(partitioned, grid);
+		partitioned.FindMaxFlow();
+		auto result = labeling(partitioned, n);
+		if (partitioned.Converged())
+		{
+			BOOST_CHECK_EQUAL(count_differences(result, expected), 0);
+			continue;
+		}
+		not_converged++;
+
+		double const minimum = cut_cost(grid, expected);
+		double const cost = cut_cost(grid, result);
+		BOOST_CHECK(cost >= minimum * (1 - 1e-5));
+		BOOST_CHECK(cost <= minimum * 1.001);
+		BOOST_TEST_MESSAGE("Fallback cut " << cost << ", minimum cut " << minimum << ", "
+																			 << count_differences(result, expected) << " of " << n << " labels differ");
+	}
+	BOOST_CHECK(not_converged > 0);
+}
+
+// TestRunner.exe --run_test=iSeg_suite/PartitionedGridMaxFlow_suite/Threshold_test --log_level=message
+BOOST_AUTO_TEST_CASE(Threshold_test)
+{
+	Gc::Energy::Neighbourhood<3, Gc::Int32> nb;
+	nb.Common(6, false);
+	Gc::Math::Algebra::Vector<3, Gc::Size> small_grid, large_grid, thin_grid;
+	for (int d = 0; d < 3; ++d)
+	{
+		small_grid[d] = 64;
+		large_grid[d] = 256;
+		thin_grid[d] = 1024;
+	}
+	thin_grid[2] = 2 * PartitionedType::kMinimumSlabThickness;
+
+	BOOST_CHECK(!PartitionedType::IsWorthPartitioning(small_grid, nb));
+	BOOST_CHECK(!PartitionedType::IsWorthPartitioning(thin_grid, nb));
+	BOOST_CHECK_EQUAL(PartitionedType::IsWorthPartitioning(large_grid, nb), PartitionedType::NumberOfPartitions(large_grid, nb) > 1);
+	BOOST_CHECK_EQUAL(PartitionedType::NumberOfPartitions(large_grid, nb, 4), 4);
+	BOOST_CHECK_EQUAL(PartitionedType::NumberOfPartitions(thin_grid, nb, 4), 1);
+}
+
+// TestRunner.exe --run_test=iSeg_suite/PartitionedGridMaxFlow_suite/SmallGrid_test --log_level=message
+BOOST_AUTO_TEST_CASE(SmallGrid_test)
+{
+	// grids which are too thin to split, including an empty one
+	srand(2);
+	for (Gc::Size nz : {0, 1, 2, 20})
+	{
+		RandomGrid grid = make_random_grid(5, 4, nz, 6);
+		Gc::Size const n = grid.source.size();
+
+		PartitionedType partitioned(4);
+		initialize(partitioned, grid);
+		partitioned.FindMaxFlow();
+		BOOST_CHECK(partitioned.Converged());
+		BOOST_CHECK(partitioned.NumberOfPartitions() <= 1);
+		if (n == 0)
+		{
+			continue;
+		}
+
+		KohliType kohli;
+		initialize(kohli, grid);
+		kohli.FindMaxFlow();
+		BOOST_CHECK_EQUAL(count_differences(labeling(partitioned, n), labeling(kohli, n)), 0);
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_AUTO_TEST_SUITE_END();
+
+} // namespace itk
@@ -21,10 +21,10 @@
 #include <QScrollArea>
 #include <QVBoxLayout>
 
-#include "itkBinaryThinningImageFilter3D.h"
 #include "itkNonMaxSuppressionImageFilter.h"
 
 #include <itkBinaryThinningImageFilter.h>
+#include <itkBinaryThinningImageFilter3D.h>
 #include <itkBinaryThresholdImageFilter.h>
 #include <itkConnectedComponentImageFilter.h>
 #include <itkHessianToObjectnessMeasureImageFilter.h>
@@ -1420,6 +1420,7 @@ void AutoTubePanel::update_kalman_filters()
 			typedef std::map<LabelType, std::vector<double>> LabelToParams;
 			LabelToParams label_to_params = get_label_map_params(labelMap);
 			// for each object in slice object list
+			std::vector<int> updated_filters;
 			for (unsigned int row(0); row < objects[i].size(); row++)
 			{
 				std::string label = objects[i][row];
@@ -1434,8 +1435,8 @@ void AutoTubePanel::update_kalman_filters()
 						std::vector<double> params = label_to_params[labelObject->GetLabel()];
 						std::vector<double> needed_params = {params[0], params[1]};
 						k_filters[index].set_measurement(needed_params);
-						k_filters[index].work();
 						k_filters[index].set_last_slice(i + 1);
+						updated_filters.push_back(index);
 					}
 				}
 				else
@@ -1444,6 +1445,12 @@ void AutoTubePanel::update_kalman_filters()
 					objects_not_in_list.push_back(label);
 				}
 			}
+			// each filter is updated at most once per slice, so the tracks can advance concurrently
+#pragma omp parallel for
+			for (int k = 0; k < static_cast<int>(updated_filters.size()); k++)
+			{
+				k_filters[updated_filters[k]].work();
+			}
 		}
 
 		if (not_in_k_filter_list)
@@ -1484,70 +1491,55 @@ LabelMapType::Pointer AutoTubePanel::calculate_label_map_params(LabelMapType::Po
 
 std::map<LabelType, std::vector<double>> AutoTubePanel::get_label_map_params(LabelMapType::Pointer labelMap)
 {
-	std::map<LabelType, std::vector<double>> label_to_params;
-	typedef float PixelType;
-	using ImageType = itk::Image<PixelType, 2>;
-	using ConstIteratorType = itk::ImageRegionConstIterator<ImageType>;
-
-	std::map<LabelType, double> label_2_x;
-	std::map<LabelType, double> label_2_y;
-	std::map<LabelType, double> label_2_nb_pixels;
-
-	typedef itk::LabelMapToLabelImageFilter<LabelMapType, ImageType> Label2ImageType;
-	auto label2image = Label2ImageType::New();
-	label2image->SetInput(labelMap);
-	label2image->Update();
+	auto labelObjects = labelMap->GetLabelObjects();
+	std::vector<std::vector<double>> params(labelObjects.size());
 
-	//centroid calculation
-	for (auto label : labelMap->GetLabels())
+#pragma omp parallel for
+	for (int i = 0; i < static_cast<int>(labelObjects.size()); i++)
 	{
-		label_2_x[label] = 0;
-		label_2_y[label] = 0;
-		label_2_nb_pixels[label] = 0;
-	}
+		const auto& labelObject = labelObjects[i];
 
-	ConstIteratorType in(label2image->GetOutput(), label2image->GetOutput()->GetRequestedRegion());
-
-	for (in.GoToBegin(); !in.IsAtEnd(); ++in)
-	{
-		if (labelMap->GetPixel(in.GetIndex()) != 0)
+		//centroid calculation: mean pixel index, summed up over the lines of the label object
+		long long sum_x = 0;
+		long long sum_y = 0;
+		long long nb_pixels = 0;
+		if (labelObject->GetLabel() != 0)
 		{
-			label_2_x[labelMap->GetPixel(in.GetIndex())] += in.GetIndex()[0];
-			label_2_y[labelMap->GetPixel(in.GetIndex())] += in.GetIndex()[1];
-			label_2_nb_pixels[labelMap->GetPixel(in.GetIndex())] += 1;
+			for (itk::SizeValueType l = 0; l < labelObject->GetNumberOfLines(); l++)
+			{
+				const auto& line = labelObject->GetLine(l);
+				long long x0 = line.GetIndex()[0];
+				long long length = line.GetLength();
+				sum_x += length * x0 + length * (length - 1) / 2;
+				sum_y += length * line.GetIndex()[1];
+				nb_pixels += length;
+			}
 		}
-	}
 
-	for (auto label : labelMap->GetLabels())
-	{
-		label_2_x[label] = label_2_x[label] / label_2_nb_pixels[label];
-		label_2_y[label] = label_2_y[label] / label_2_nb_pixels[label];
+		params[i].push_back(static_cast<double>(sum_x) / nb_pixels);
+		params[i].push_back(static_cast<double>(sum_y) / nb_pixels);
+		params[i].push_back(labelObject->GetEquivalentSphericalPerimeter());
+		params[i].push_back(labelObject->GetEquivalentSphericalRadius());
+		params[i].push_back(labelObject->GetFeretDiameter());
+		params[i].push_back(labelObject->GetFlatness());
+		params[i].push_back(labelObject->GetNumberOfPixels());
+		params[i].push_back(labelObject->GetNumberOfPixelsOnBorder());
+		params[i].push_back(labelObject->GetPerimeter());
+		params[i].push_back(labelObject->GetPerimeterOnBorder());
+		params[i].push_back(labelObject->GetPerimeterOnBorderRatio());
+		params[i].push_back(labelObject->GetPhysicalSize());
+		params[i].push_back(labelObject->GetRoundness());
 	}
 
-	for (unsigned int i = 0; i < labelMap->GetNumberOfLabelObjects(); i++)
+	std::map<LabelType, std::vector<double>> label_to_params;
+	for (size_t i = 0; i < labelObjects.size(); i++)
 	{
-		auto labelObject = labelMap->GetNthLabelObject(i);
-		std::vector<double> params;
-
-		params.push_back(label_2_x[labelObject->GetLabel()]);
-		params.push_back(label_2_y[labelObject->GetLabel()]);
-		params.push_back(labelObject->GetEquivalentSphericalPerimeter());
-		params.push_back(labelObject->GetEquivalentSphericalRadius());
-		params.push_back(labelObject->GetFeretDiameter());
-		params.push_back(labelObject->GetFlatness());
-		params.push_back(labelObject->GetNumberOfPixels());
-		params.push_back(labelObject->GetNumberOfPixelsOnBorder());
-		params.push_back(labelObject->GetPerimeter());
-		params.push_back(labelObject->GetPerimeterOnBorder());
-		params.push_back(labelObject->GetPerimeterOnBorderRatio());
-		params.push_back(labelObject->GetPhysicalSize());
-		params.push_back(labelObject->GetRoundness());
-		label_to_params.insert(std::make_pair(labelObject->GetLabel(), params));
+		label_to_params.insert(std::make_pair(labelObjects[i]->GetLabel(), std::move(params[i])));
 	}
 	return label_to_params;
 }
 
-std::vector<double> AutoTubePanel::softmax(std::vector<double> distances, std::vector<double> diff_in_pred, std::vector<double> diff_in_data)
+std::vector<double> AutoTubePanel::softmax(const std::vector<double>& distances, const std::vector<double>& diff_in_pred, const std::vector<double>& diff_in_data, double w_distance, double w_pred, double w_params) const
 {
 	std::vector<double> probabilities;
 
@@ -1556,7 +1548,7 @@ std::vector<double> AutoTubePanel::softmax(std::vector<double> distances, std::v
 	for (unsigned int i(0); i < distances.size(); i++)
 	{
 
-		double x = exp(-(_w_distance->text().toDouble() * distances[i] + _w_pred->text().toDouble() * diff_in_pred[i] + _w_params->text().toDouble() * diff_in_data[i]));
+		double x = exp(-(w_distance * distances[i] + w_pred * diff_in_pred[i] + w_params * diff_in_data[i]));
 		probabilities.push_back(x);
 		sum += x;
 	}
@@ -1874,7 +1866,7 @@ void AutoTubePanel::on_mouse_clicked(iseg::Point p)
 		}
 	}
 }
-double AutoTubePanel::calculate_distance(std::vector<double> params_1, std::vector<double> params_2)
+double AutoTubePanel::calculate_distance(const std::vector<double>& params_1, const std::vector<double>& params_2) const
 {
 	// calculate distance
 	itk::Point<double, 2> centroid1;
@@ -1958,14 +1950,9 @@ void AutoTubePanel::extrapolate_results()
 			// new label map
 			auto extrapolated_labelMap = label_maps[_handler3D->active_slice()];
 
-			std::vector<itk::Point<double, 2>>* centroids = new std::vector<itk::Point<double, 2>>;
-
-			for (unsigned int i = 0; i < labelMap->GetNumberOfLabelObjects(); i++)
-			{
-				// Get the ith region
-				auto labelObject = labelMap->GetNthLabelObject(i);
-				centroids->push_back(labelObject->GetCentroid());
-			}
+			// label objects of the previous and the new slice
+			auto old_objects = labelMap->GetLabelObjects();
+			auto new_objects = extrapolated_labelMap->GetLabelObjects();
 
 			typedef std::map<LabelType, std::vector<double>> LabelToParams;
 
@@ -1980,7 +1967,7 @@ void AutoTubePanel::extrapolate_results()
 			std::map<LabelType, std::string> l_to_t; // local variable label to text mapping
 			std::vector<std::string> probs;					 // probabilities
 
-			if (centroids->empty() || extrapolated_labelMap->GetNumberOfLabelObjects() == 0)
+			if (old_objects.empty() || new_objects.empty())
 			{
 				quit = true;
 				_handler3D->set_active_slice(slice_to_infer_from, true);
@@ -1988,69 +1975,77 @@ void AutoTubePanel::extrapolate_results()
 			}
 			std::vector<std::string> objects_list;
 
-			std::vector<std::string> labels;
-			for (auto filter : k_filters)
+			// index of the Kalman filter of each old label object (first filter with this label)
+			std::map<std::string, int> label_to_filter;
+			for (unsigned int index = 0; index < k_filters.size(); index++)
 			{
-				labels.push_back(filter.get_label());
+				label_to_filter.insert(std::make_pair(k_filters[index].get_label(), index));
+			}
+			std::vector<int> old_filters;
+			for (auto& old_labelObject : old_objects)
+			{
+				auto found = label_to_filter.find(label_to_text[slice_to_infer_from][old_labelObject->GetLabel()]);
+				if (found == label_to_filter.end())
+				{
+					quit_k_filters = true;
+					break;
+				}
+				old_filters.push_back(found->second);
 			}
-
-			std::vector<std::string>::iterator it; // iterator used to find the index of the given kalman filter from the label map
 
 			double threshold_probability = _min_probability->text().toDouble();
-
-			for (unsigned int i = 0; i < extrapolated_labelMap->GetNumberOfLabelObjects(); i++)
+			double w_distance = _w_distance->text().toDouble();
+			double w_pred = _w_pred->text().toDouble();
+			double w_params = _w_params->text().toDouble();
+
+			// calculates the probabilities of each label object from the extrapolated label map to being any label object from the previous label map.
+			// The new label objects are independent, only the naming below needs to be done in order.
+			std::vector<std::vector<double>> new_probabilities(quit_k_filters ? 0 : new_objects.size());
+#pragma omp parallel for
+			for (int i = 0; i < static_cast<int>(new_probabilities.size()); i++)
 			{
+				const auto& new_params = extrapolated_label_to_params.at(new_objects[i]->GetLabel());
+
 				std::vector<double> distances;
 				std::vector<double> diff_from_predictions;
 				std::vector<double> diff_in_data;
-				for (unsigned int j = 0; j < labelMap->GetNumberOfLabelObjects(); j++)
+				for (size_t j = 0; j < old_objects.size(); j++)
 				{
+					const auto& old_params = label_to_params.at(old_objects[j]->GetLabel());
 
-					std::vector<double> par = label_to_params[labelMap->GetNthLabelObject(j)->GetLabel()];
-
-					it = std::find(labels.begin(), labels.end(), label_to_text[slice_to_infer_from][labelMap->GetNthLabelObject(j)->GetLabel()]);
-					if (it != labels.end())
-					{
-						int index = std::distance(labels.begin(), it);
-
-						// calculates the difference in position prediction
-						double diff_from_pred = k_filters[index].diff_btw_predicated_object(extrapolated_label_to_params[extrapolated_labelMap->GetNthLabelObject(i)->GetLabel()]);
-						diff_from_predictions.push_back(diff_from_pred);
+					// calculates the difference in position prediction
+					double diff_from_pred = k_filters[old_filters[j]].diff_btw_predicated_object(new_params);
+					diff_from_predictions.push_back(diff_from_pred);
 
-						// calculate the distance
-						double distance = calculate_distance(label_to_params[labelMap->GetNthLabelObject(j)->GetLabel()], extrapolated_label_to_params[extrapolated_labelMap->GetNthLabelObject(i)->GetLabel()]);
-						distances.push_back(distance);
+					// calculate the distance
+					double distance = calculate_distance(old_params, new_params);
+					distances.push_back(distance);
 
-						unsigned int Size(label_to_params[labelMap->GetNthLabelObject(j)->GetLabel()].size());
-						// calculate the difference between the two given object's parameters
-						double sum(0);
-						for (unsigned int k(2); k < Size; k++)
-						{
-							sum += abs(label_to_params[labelMap->GetNthLabelObject(j)->GetLabel()][k] - extrapolated_label_to_params[extrapolated_labelMap->GetNthLabelObject(i)->GetLabel()][k]);
-						}
-						diff_in_data.push_back(sum); // two first elements are centroids
-					}
-					else
+					unsigned int Size(old_params.size());
+					// calculate the difference between the two given object's parameters
+					double sum(0);
+					for (unsigned int k(2); k < Size; k++)
 					{
-						quit_k_filters = true;
-						break;
+						sum += abs(old_params[k] - new_params[k]);
 					}
+					diff_in_data.push_back(sum); // two first elements are centroids
 				}
-				if (quit_k_filters)
-					break;
-				std::vector<double> probabilities;
-				// calculates the probabilities of label object from the extrapolated label map to being any label object from the previous label map
-				probabilities = softmax(distances, diff_from_predictions, diff_in_data);
+				new_probabilities[i] = softmax(distances, diff_from_predictions, diff_in_data, w_distance, w_pred, w_params);
+			}
+
+			for (unsigned int i = 0; i < new_probabilities.size(); i++)
+			{
+				const auto& probabilities = new_probabilities[i];
 
 				// index of highest probability
 				int max_index = std::distance(probabilities.begin(), std::max_element(probabilities.begin(), probabilities.end()));
 
-				auto new_labelObject = extrapolated_labelMap->GetNthLabelObject(i);
+				auto new_labelObject = new_objects[i];
 				bool set(false); // was the name of the new label object already set?
 
 				if (probabilities[max_index] > threshold_probability)
 				{
-					auto old_labelObject = labelMap->GetNthLabelObject(max_index);
+					auto old_labelObject = old_objects[max_index];
 
 					// if the new label object corresponds to an old label object that is a digit
 					// we add a random charecter to it so the user can see to which object it is linked too
@@ -2076,9 +2071,9 @@ void AutoTubePanel::extrapolate_results()
 					set = true;
 				}
 
-				for (unsigned int j = 0; j < labelMap->GetNumberOfLabelObjects(); j++)
+				for (unsigned int j = 0; j < old_objects.size(); j++)
 				{
-					auto old_labelObject = labelMap->GetNthLabelObject(j);
+					auto old_labelObject = old_objects[j];
 
 					// if Extrapolate Only Matches is not checked and the new object was not set then add it to the mapping
 					if (!_extrapolate_only_matches->isChecked() && !set)
@@ -2128,12 +2123,6 @@ void AutoTubePanel::extrapolate_results()
 			if (quit_k_filters)
 				break;
 
-			labels.clear();
-			for (auto filter : k_filters)
-			{
-				labels.push_back(filter.get_label());
-			}
-
 			for (auto& element : l_to_t)
 			{
 				// refresh object list to correspond to the mapping
@@ -2670,13 +2659,6 @@ void AutoTubePanel::do_work_nd(TInput* source, TTissue* tissues, TTarget* target
 
 		auto labelMap = binaryImageToLabelMapFilter->GetOutput();
 		auto map = calculate_label_map_params(labelMap);
-		typedef std::map<LabelType, std::vector<double>> LabelToParams;
-
-		LabelToParams label_to_params = get_label_map_params(map);
-
-		std::vector<std::string> labels;
-		for (auto& filter : k_filters)
-			labels.push_back(filter.get_label());
 
 		if (!_add->isChecked())
 		{
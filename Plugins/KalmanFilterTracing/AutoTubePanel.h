@@ -109,8 +109,8 @@ public:
 	std::map<LabelType, std::vector<double>> get_label_map_params(LabelMapType::Pointer labelMap);
 	LabelMapType::Pointer calculate_label_map_params(LabelMapType::Pointer labelMap);
 
-	double calculate_distance(std::vector<double> params_1, std::vector<double> params_2);
-	std::vector<double> softmax(std::vector<double> distances, std::vector<double> diff_in_pred, std::vector<double> diff_in_data);
+	double calculate_distance(const std::vector<double>& params_1, const std::vector<double>& params_2) const;
+	std::vector<double> softmax(const std::vector<double>& distances, const std::vector<double>& diff_in_pred, const std::vector<double>& diff_in_data, double w_distance, double w_pred, double w_params) const;
 
 	void visualize_label_map(LabelMapType::Pointer labelMap, std::vector<itk::Index<2>>* pixels = nullptr);
 
@@ -178,7 +178,7 @@ std::string KalmanFilter::get_label() const
 {
 	return label;
 }
-double KalmanFilter::diff_btw_predicated_object(std::vector<double> object_params)
+double KalmanFilter::diff_btw_predicated_object(const std::vector<double>& object_params) const
 {
 	VectorXd _v(N);
 	for (unsigned int i(0); i < N; i++)
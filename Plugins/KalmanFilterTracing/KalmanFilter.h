@@ -47,7 +47,7 @@ public:
 	std::vector<double> get_measurement();
 	std::vector<double> get_prediction() const;
 
-	double diff_btw_predicated_object(std::vector<double> object_params);
+	double diff_btw_predicated_object(const std::vector<double>& object_params) const;
 
 	double standard_deviation(const Eigen::VectorXd& v);
 
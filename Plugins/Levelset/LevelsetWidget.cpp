@@ -15,10 +15,12 @@
 
 #include <itkImage.h>
 #include <itkBinaryThresholdImageFilter.h>
+#include <itkExtractImageFilter.h>
 #include <itkFastMarchingImageFilter.h>
 #include <itkThresholdSegmentationLevelSetImageFilter.h>
 #include <itkConstNeighborhoodIterator.h>
-#include <itkApproximateSignedDistanceMapImageFilter.h>
+#include <itkImageRegionConstIteratorWithIndex.h>
+#include <itkImageRegionIterator.h>
 
 #include <QFormLayout>
 
@@ -31,10 +33,122 @@
 #include <accumulators/percentile.hpp>
 
 #include <algorithm>
+#include <deque>
 #include <sstream>
 
 namespace acc = boost::accumulators;
 
+namespace {
+
+/// bounding box of the seeds and of the pixels connected to them with values in [lower, upper]
+template<class TImage>
+typename TImage::RegionType threshold_connected_bbox(const TImage* image,
+		const std::vector<typename TImage::IndexType>& seeds, double lower, double upper)
+{
+	using index_type = typename TImage::IndexType;
+	static const unsigned int dim = TImage::ImageDimension;
+
+	auto const region = image->GetBufferedRegion();
+	auto const offset = [&region](const index_type& idx) {
+		size_t pos = 0;
+		for (int d = dim - 1; d >= 0; d--)
+		{
+			pos = pos * region.GetSize(d) + (idx[d] - region.GetIndex(d));
+		}
+		return pos;
+	};
+
+	index_type lower_idx = region.GetUpperIndex(), upper_idx = region.GetIndex();
+	auto const include = [&](const index_type& idx) {
+		for (unsigned int d = 0; d < dim; d++)
+		{
+			lower_idx[d] = std::min(lower_idx[d], idx[d]);
+			upper_idx[d] = std::max(upper_idx[d], idx[d]);
+		}
+	};
+
+	std::vector<bool> visited(region.GetNumberOfPixels(), false);
+	std::deque<index_type> queue;
+	for (auto const& idx : seeds)
+	{
+		if (!region.IsInside(idx))
+			continue;
+		include(idx);
+		double v = image->GetPixel(idx);
+		if (v >= lower && v <= upper && !visited[offset(idx)])
+		{
+			visited[offset(idx)] = true;
+			queue.push_back(idx);
+		}
+	}
+
+	while (!queue.empty())
+	{
+		auto idx = queue.front();
+		queue.pop_front();
+		include(idx);
+
+		for (unsigned int d = 0; d < dim; d++)
+		{
+			for (int step : {-1, 1})
+			{
+				auto n = idx;
+				n[d] += step;
+				if (region.IsInside(n) && !visited[offset(n)])
+				{
+					double v = image->GetPixel(n);
+					if (v >= lower && v <= upper)
+					{
+						visited[offset(n)] = true;
+						queue.push_back(n);
+					}
+				}
+			}
+		}
+	}
+
+	typename TImage::RegionType bbox;
+	bbox.SetIndex(lower_idx);
+	for (unsigned int d = 0; d < dim; d++)
+	{
+		bbox.SetSize(d, std::max<itk::IndexValueType>(upper_idx[d] - lower_idx[d] + 1, 0));
+	}
+	return bbox;
+}
+
+/// sets all pixels of the buffered region outside of 'inside' to value
+template<class TImage>
+void fill_outside(TImage* image, const typename TImage::RegionType& inside, typename TImage::PixelType value)
+{
+	auto rest = image->GetBufferedRegion();
+	for (unsigned int d = 0; d < TImage::ImageDimension; d++)
+	{
+		auto const begin = inside.GetIndex(d);
+		auto const end = begin + static_cast<itk::IndexValueType>(inside.GetSize(d));
+		auto const rest_end = rest.GetIndex(d) + static_cast<itk::IndexValueType>(rest.GetSize(d));
+
+		auto below = rest, above = rest;
+		below.SetSize(d, begin - rest.GetIndex(d));
+		above.SetIndex(d, end);
+		above.SetSize(d, rest_end - end);
+		for (auto const& slab : {below, above})
+		{
+			if (slab.GetNumberOfPixels() == 0)
+				continue;
+			itk::ImageRegionIterator<TImage> it(image, slab);
+			for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+			{
+				it.Set(value);
+			}
+		}
+
+		rest.SetIndex(d, begin);
+		rest.SetSize(d, inside.GetSize(d));
+	}
+}
+
+} // namespace
+
 LevelsetWidget::LevelsetWidget(iseg::SlicesHandlerInterface* hand3D, QWidget* parent,
 		const char* name, Qt::WindowFlags wFlags)
 		: WidgetInterface(parent, name, wFlags), handler3D(hand3D)
@@ -143,7 +257,7 @@ void LevelsetWidget::get_seeds(std::vector<itk::Index<2>>& seeds)
 
 void LevelsetWidget::get_seeds(std::vector<itk::Index<3>>& seeds)
 {
-	auto start_slice = handler3D->start_slice();
+	// the active slices keep their z-index in the images returned by GetSource(true)
 	for (auto slice : vpdyn)
 	{
 		for (auto p : slice.second)
@@ -151,7 +265,7 @@ void LevelsetWidget::get_seeds(std::vector<itk::Index<3>>& seeds)
 			itk::Index<3> idx;
 			idx[0] = p.px;
 			idx[1] = p.py;
-			idx[2] = slice.first - start_slice;
+			idx[2] = slice.first;
 			seeds.push_back(idx);
 		}
 	}
@@ -193,7 +307,7 @@ void LevelsetWidget::guess_thresholds_nd(TInput* source)
 		acc::tag::variance
 	> > stats;
 
-	itk::ConstNeighborhoodIterator<input_type> it(radius, source, source->GetLargestPossibleRegion());
+	itk::ConstNeighborhoodIterator<input_type> it(radius, source, source->GetBufferedRegion());
 	size_t const N = it.Size();
 	for (auto idx : indices)
 	{
@@ -243,14 +357,51 @@ void LevelsetWidget::do_work_nd(TInput* input, TInput* target)
 	using input_type = TInput;
 	using real_type = itk::Image<float, ImageDimension>;
 	using mask_type = itk::Image<unsigned char, ImageDimension>;
+	using region_type = typename input_type::RegionType;
 
 	using fast_marching_type = itk::FastMarchingImageFilter<real_type, real_type>;
 	using node_container_type = typename fast_marching_type::NodeContainer;
 	using node_type = typename fast_marching_type::NodeType;
 
+	double const lower = lower_threshold->text().toDouble();
+	double const upper = upper_threshold->text().toDouble();
+
+	// the front can only advance into pixels within the thresholds, so the level set
+	// is solved on the bounding box of the seeds and the pixels connected to them
+	std::vector<typename input_type::IndexType> indices;
+	if (init_from_target->isChecked())
+	{
+		itk::ImageRegionConstIteratorWithIndex<input_type> it(target, target->GetBufferedRegion());
+		for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+		{
+			if (it.Get() >= 0.001f)
+			{
+				indices.push_back(it.GetIndex());
+			}
+		}
+	}
+	else
+	{
+		get_seeds(indices);
+	}
+
+	region_type roi = threshold_connected_bbox(input, indices, lower, upper);
+	if (roi.GetNumberOfPixels() == 0)
+	{
+		ISEG_ERROR_MSG("no seeds inside the image.");
+		return;
+	}
+	roi.PadByRadius(8);
+	roi.Crop(input->GetBufferedRegion());
+
+	auto feature = itk::ExtractImageFilter<input_type, real_type>::New();
+	feature->SetInput(input);
+	feature->SetExtractionRegion(roi);
+	feature->SetDirectionCollapseToIdentity();
+
 	// create filters
 	auto fast_marching = fast_marching_type::New();
-	auto threshold_levelset = itk::ThresholdSegmentationLevelSetImageFilter<real_type, input_type>::New();
+	auto threshold_levelset = itk::ThresholdSegmentationLevelSetImageFilter<real_type, real_type>::New();
 	auto threshold = itk::BinaryThresholdImageFilter<real_type, mask_type>::New();
 
 	// initialize levelset
@@ -258,8 +409,13 @@ void LevelsetWidget::do_work_nd(TInput* input, TInput* target)
 	if (init_from_target->isChecked())
 	{
 		// threshold target -> mask
-		auto threshold_target = itk::BinaryThresholdImageFilter<input_type, real_type>::New();
-		threshold_target->SetInput(target);
+		auto target_roi = itk::ExtractImageFilter<input_type, real_type>::New();
+		target_roi->SetInput(target);
+		target_roi->SetExtractionRegion(roi);
+		target_roi->SetDirectionCollapseToIdentity();
+
+		auto threshold_target = itk::BinaryThresholdImageFilter<real_type, real_type>::New();
+		threshold_target->SetInput(target_roi->GetOutput());
 		threshold_target->SetLowerThreshold(0.001f);
 		threshold_target->SetInsideValue(-0.5f); // level set filter uses iso-value 0.0
 		threshold_target->SetOutsideValue(0.5f);
@@ -269,9 +425,6 @@ void LevelsetWidget::do_work_nd(TInput* input, TInput* target)
 	else
 	{
 		// setup seeds
-		std::vector<typename input_type::IndexType> indices;
-		get_seeds(indices);
-
 		const double initialDistance = 2.0; // \todo BL
 		const double seedValue = -initialDistance; // \todo BL
 		auto seeds = node_container_type::New();
@@ -284,9 +437,12 @@ void LevelsetWidget::do_work_nd(TInput* input, TInput* target)
 			seeds->InsertElement(i, node);
 		}
 
+		// the sparse field solver only reads the distance near the zero level set,
+		// so the front is only marched through a narrow band
 		fast_marching->SetTrialPoints(seeds);
 		fast_marching->SetSpeedConstant(1.0);
-		fast_marching->SetOutputRegion(input->GetBufferedRegion());
+		fast_marching->SetStoppingValue(initialDistance + 4.0);
+		fast_marching->SetOutputRegion(roi);
 		fast_marching->SetOutputSpacing(input->GetSpacing());
 		fast_marching->SetOutputOrigin(input->GetOrigin());
 		fast_marching->SetOutputDirection(input->GetDirection());
@@ -295,12 +451,12 @@ void LevelsetWidget::do_work_nd(TInput* input, TInput* target)
 
 	// set parameters
 	threshold_levelset->SetInput(initial_levelset);
-	threshold_levelset->SetFeatureImage(input);
+	threshold_levelset->SetFeatureImage(feature->GetOutput());
 	threshold_levelset->SetPropagationScaling(1.0);
 	threshold_levelset->SetCurvatureScaling(curvature_scaling->text().toDouble());
 	threshold_levelset->SetEdgeWeight(edge_weight->text().toDouble());
-	threshold_levelset->SetLowerThreshold(lower_threshold->text().toDouble());
-	threshold_levelset->SetUpperThreshold(upper_threshold->text().toDouble());
+	threshold_levelset->SetLowerThreshold(lower);
+	threshold_levelset->SetUpperThreshold(upper);
 	threshold_levelset->SetMaximumRMSError(0.02);
 	threshold_levelset->SetNumberOfIterations(1200);
 	threshold_levelset->SetIsoSurfaceValue(0.0);
@@ -328,7 +484,9 @@ void LevelsetWidget::do_work_nd(TInput* input, TInput* target)
 	dataSelection.work = true;
 	emit begin_datachange(dataSelection, this);
 
-	if (!iseg::Paste<mask_type, input_type>(threshold->GetOutput(), target))
+	// only the ROI is copied, the rest of the target is cleared
+	fill_outside(target, roi, 0.f);
+	if (!iseg::Paste<mask_type, input_type>(threshold->GetOutput(), target, roi))
 	{
 		ISEG_ERROR_MSG("could not set output because image regions don't match.");
 	}
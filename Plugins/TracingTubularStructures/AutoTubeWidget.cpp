@@ -13,23 +13,20 @@
 #include "Data/Logger.h"
 #include "Data/SlicesHandlerITKInterface.h"
 
-#include "itkBinaryThinningImageFilter3D.h"
 #include "itkNonMaxSuppressionImageFilter.h"
 
 #include <itkBinaryThinningImageFilter.h>
+#include <itkBinaryThinningImageFilter3D.h>
 #include <itkBinaryThresholdImageFilter.h>
 #include <itkConnectedComponentImageFilter.h>
 #include <itkCurvesLevelSetImageFilter.h>
 #include <itkFastMarchingImageFilter.h>
 #include <itkGradientMagnitudeRecursiveGaussianImageFilter.h>
-#include <itkHessianToObjectnessMeasureImageFilter.h>
 #include <itkImage.h>
 #include <itkMinimumMaximumImageCalculator.h>
-#include <itkMultiScaleHessianBasedMeasureImageFilter.h>
 #include <itkRelabelComponentImageFilter.h>
 #include <itkRescaleIntensityImageFilter.h>
 #include <itkSigmoidImageFilter.h>
-#include <itkSliceBySliceImageFilter.h>
 #include <itkThresholdImageFilter.h>
 
 #include <accumulators/percentile.hpp>
@@ -143,6 +140,8 @@ void AutoTubeWidget::init()
 
 void AutoTubeWidget::newloaded()
 {
+	_hessian_cache_2d.Clear();
+	_hessian_cache_3d.Clear();
 	on_slicenr_changed();
 }
 
@@ -154,6 +153,8 @@ void AutoTubeWidget::cleanup()
 {
 	_selected_objects->setText("");
 	_cached_feature_image.img = nullptr;
+	_hessian_cache_2d.Clear();
+	_hessian_cache_3d.Clear();
 }
 
 void AutoTubeWidget::on_mouse_clicked(iseg::Point p)
@@ -198,79 +199,43 @@ void AutoTubeWidget::do_work()
 	}
 }
 
-template<class TInput, class TImage>
-typename TImage::Pointer AutoTubeWidget::compute_feature_image(TInput* source) const
+std::vector<double> AutoTubeWidget::sigmas() const
 {
-	itkStaticConstMacro(ImageDimension, size_t, TInput::ImageDimension);
-	using hessian_pixel_type = itk::SymmetricSecondRankTensor<float, ImageDimension>;
-	using hessian_image_type = itk::Image<hessian_pixel_type, ImageDimension>;
-	using feature_filter_type = itk::HessianToObjectnessMeasureImageFilter<hessian_image_type, TImage>;
-	using multiscale_hessian_filter_type = itk::MultiScaleHessianBasedMeasureImageFilter<TInput, hessian_image_type, TImage>;
-
 	double sigm_min = _sigma_low->text().toDouble();
 	double sigm_max = _sigma_hi->text().toDouble();
-	int num_levels = _number_sigma_levels->text().toInt();
-
-	auto objectnessFilter = feature_filter_type::New();
-	objectnessFilter->SetBrightObject(false);
-	objectnessFilter->SetObjectDimension(1);
-	objectnessFilter->SetScaleObjectnessMeasure(true);
-	objectnessFilter->SetAlpha(0.5);
-	objectnessFilter->SetBeta(0.5);
-	objectnessFilter->SetGamma(5.0);
-
-	auto multiScaleEnhancementFilter = multiscale_hessian_filter_type::New();
-	multiScaleEnhancementFilter->SetInput(source);
-	multiScaleEnhancementFilter->SetHessianToMeasureFilter(objectnessFilter);
-	multiScaleEnhancementFilter->SetSigmaStepMethodToEquispaced();
-	multiScaleEnhancementFilter->SetSigmaMinimum(std::min(sigm_min, sigm_max));
-	multiScaleEnhancementFilter->SetSigmaMaximum(std::max(sigm_min, sigm_max));
-	multiScaleEnhancementFilter->SetNumberOfSigmaSteps(std::min(1, num_levels));
-	multiScaleEnhancementFilter->Update();
-	return multiScaleEnhancementFilter->GetOutput();
+
+	// itk::MultiScaleHessianBasedMeasureImageFilter was given min(1, levels) steps, i.e. only the smallest sigma
+	return std::vector<double>(1, std::min(sigm_min, sigm_max));
+}
+
+template<class TInput, class TImage>
+typename TImage::Pointer AutoTubeWidget::compute_feature_image(TInput* source) const
+{
+	iseg::ObjectnessParameters params;
+	params.m_BrightObject = false;
+	params.m_ObjectDimension = 1;
+	params.m_ScaleObjectnessMeasure = true;
+	params.m_Alpha = 0.5;
+	params.m_Beta = 0.5;
+	params.m_Gamma = 5.0;
+
+	return hessian_cache(source).ComputeObjectness(source, source->GetBufferedRegion(), sigmas(), false, true, params);
 }
 
 template<class TInput, class TImage>
 typename TImage::Pointer AutoTubeWidget::compute_feature_image_2d(TInput* source) const
 {
 	itkStaticConstMacro(ImageDimension, size_t, TInput::ImageDimension);
-	using input_type = TInput;
-	using output_type = TImage;
-	using image_type = itk::Image<float, 2>;
 
-	using hessian_filter_type = itk::HessianRecursiveGaussianImageFilter<image_type>;
-	using hessian_pixel_type = itk::SymmetricSecondRankTensor<double, 2>;
-	using hessian_image_type = itk::Image<hessian_pixel_type, 2>;
+	iseg::ObjectnessParameters params;
+	params.m_BrightObject = false;
+	params.m_ObjectDimension = (ImageDimension == 2 ? 1 : 0); // for 2D analysis we are looking for lines in a single slice
+	params.m_ScaleObjectnessMeasure = true;
+	params.m_Alpha = 0.5;
+	params.m_Beta = 0.5;
+	params.m_Gamma = 5.0;
 
-	using feature_filter_type = itk::HessianToObjectnessMeasureImageFilter<hessian_image_type, image_type>;
-	using multiscale_hessian_filter_type = itk::MultiScaleHessianBasedMeasureImageFilter<image_type, hessian_image_type, image_type>;
-	using slice_by_slice_filter_type = itk::SliceBySliceImageFilter<input_type, output_type, multiscale_hessian_filter_type>;
-
-	double sigm_min = _sigma_low->text().toDouble();
-	double sigm_max = _sigma_hi->text().toDouble();
-	int num_levels = _number_sigma_levels->text().toInt();
-
-	auto objectnessFilter = feature_filter_type::New();
-	objectnessFilter->SetBrightObject(false);
-	objectnessFilter->SetObjectDimension(ImageDimension == 2 ? 1 : 0); // for 2D analysis we are looking for lines in a single slice
-	objectnessFilter->SetScaleObjectnessMeasure(true);
-	objectnessFilter->SetAlpha(0.5);
-	objectnessFilter->SetBeta(0.5);
-	objectnessFilter->SetGamma(5.0);
-
-	auto multiScaleEnhancementFilter = multiscale_hessian_filter_type::New();
-	multiScaleEnhancementFilter->SetHessianToMeasureFilter(objectnessFilter);
-	multiScaleEnhancementFilter->SetSigmaStepMethodToEquispaced();
-	multiScaleEnhancementFilter->SetSigmaMinimum(std::min(sigm_min, sigm_max));
-	multiScaleEnhancementFilter->SetSigmaMaximum(std::max(sigm_min, sigm_max));
-	multiScaleEnhancementFilter->SetNumberOfSigmaSteps(std::min(1, num_levels));
-
-	auto slice_filter = slice_by_slice_filter_type::New();
-	slice_filter->SetInput(source);
-	slice_filter->SetFilter(multiScaleEnhancementFilter);
-	slice_filter->Update();
-
-	return slice_filter->GetOutput();
+	return hessian_cache(source).ComputeObjectness(source, source->GetBufferedRegion(), sigmas(), true, true, params);
 }
 
 template<class TInput, class TTissue, class TTarget>
@@ -9,6 +9,8 @@
  */
 #pragma once
 
+#include "HessianEigenvalueCache.h"
+
 #include "Data/SlicesHandlerInterface.h"
 
 #include "Interface/WidgetInterface.h"
@@ -41,6 +43,8 @@ private:
 	template<class TInput, class TTissue, class TTarget>
 	void do_work_nd(TInput* source, TTissue* tissues, TTarget* target);
 
+	std::vector<double> sigmas() const;
+
 	template<class TInput, class TImage>
 	typename TImage::Pointer compute_feature_image(TInput* source) const;
 
@@ -91,6 +95,13 @@ private:
 	Cache<float> _cached_feature_image;
 	Cache<unsigned char> _cached_skeleton;
 
+	iseg::HessianEigenvalueCache<2>& hessian_cache(itk::ImageBase<2>*) const { return _hessian_cache_2d; }
+	iseg::HessianEigenvalueCache<3>& hessian_cache(itk::ImageBase<3>*) const { return _hessian_cache_3d; }
+
+	// eigenvalues per scale, reused when only the scales or downstream parameters change
+	mutable iseg::HessianEigenvalueCache<2> _hessian_cache_2d;
+	mutable iseg::HessianEigenvalueCache<3> _hessian_cache_3d;
+
 private slots:
 	void select_objects();
 	void do_work();
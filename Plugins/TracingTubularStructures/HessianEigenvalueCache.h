@@ -0,0 +1,453 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#pragma once
+
+#include <itkHessianRecursiveGaussianImageFilter.h>
+#include <itkImage.h>
+#include <itkImageAlgorithm.h>
+#include <itkImageRegionConstIterator.h>
+#include <itkMath.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <list>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace iseg {
+
+/// parameters of the objectness measure, see itk::HessianToObjectnessMeasureImageFilter
+struct ObjectnessParameters
+{
+	double m_Alpha = 0.5;
+	double m_Beta = 0.5;
+	double m_Gamma = 5.0;
+	unsigned int m_ObjectDimension = 1;
+	bool m_BrightObject = true;
+	bool m_ScaleObjectnessMeasure = true;
+};
+
+/** \brief Hessian eigenvalues per scale, kept for repeated objectness (e.g. vesselness) evaluations
+
+	The Hessian is computed with recursive Gaussian derivatives, either in all
+	dimensions or per slice (slices in parallel). The eigenvalues are sorted by
+	magnitude and stored as one array per eigenvalue, so the objectness for other
+	parameters or scale combinations is a loop over plain arrays.
+
+	A scale is reused if it covers the requested region and the source did not
+	change in the region it was computed from (checked with a hash). The least
+	recently used scales are dropped when the memory limit is exceeded, but the
+	scales of the latest request are always kept, so a large volume can still
+	be evaluated again with other parameters.
+*/
+template<unsigned int VDimension>
+class HessianEigenvalueCache
+{
+public:
+	using image_type = itk::Image<float, VDimension>;
+	using region_type = typename image_type::RegionType;
+
+	/// memory limit for the scales of earlier requests
+	void SetMaximumMemory(size_t bytes) { m_MaximumMemory = bytes; }
+	size_t GetMaximumMemory() const { return m_MaximumMemory; }
+
+	void Clear() { m_Scales.clear(); }
+
+	size_t NumberOfScales() const { return m_Scales.size(); }
+
+	/// maximum of the objectness over the scales in the requested region
+	template<class TInput>
+	typename image_type::Pointer ComputeObjectness(const TInput* source, const region_type& region,
+			const std::vector<double>& sigmas, bool slice_by_slice, bool normalize_across_scale,
+			const ObjectnessParameters& params)
+	{
+		auto output = image_type::New();
+		output->SetLargestPossibleRegion(source->GetLargestPossibleRegion());
+		output->SetBufferedRegion(region);
+		output->SetRequestedRegion(region);
+		output->SetSpacing(source->GetSpacing());
+		output->SetOrigin(source->GetOrigin());
+		output->SetDirection(source->GetDirection());
+		output->Allocate();
+		output->FillBuffer(0.f);
+
+		for (size_t k = 0; k < sigmas.size(); ++k)
+		{
+			const Scale& scale = GetScale(source, region, sigmas[k], slice_by_slice && VDimension > 2, normalize_across_scale);
+			Accumulate(scale, region, params, k == 0, output->GetBufferPointer());
+			// the scales of this request are at the front
+			Trim(k + 1);
+		}
+		return output;
+	}
+
+private:
+	struct Scale
+	{
+		double m_Sigma;
+		bool m_SliceBySlice;
+		bool m_NormalizeAcrossScale;
+		/// region the eigenvalues are stored for
+		region_type m_Region;
+		/// region of the source the eigenvalues were computed from, and its hash
+		region_type m_InputRegion;
+		size_t m_InputHash;
+		unsigned int m_NumberOfEigenvalues;
+		std::vector<float> m_Eigenvalues[VDimension];
+
+		size_t Memory() const { return m_NumberOfEigenvalues * m_Region.GetNumberOfPixels() * sizeof(float); }
+	};
+
+	template<class TInput>
+	const Scale& GetScale(const TInput* source, const region_type& region, double sigma, bool slice_by_slice, bool normalize_across_scale)
+	{
+		for (auto it = m_Scales.begin(); it != m_Scales.end(); ++it)
+		{
+			if (it->m_Sigma == sigma && it->m_SliceBySlice == slice_by_slice &&
+					it->m_NormalizeAcrossScale == normalize_across_scale && it->m_Region.IsInside(region))
+			{
+				if (it->m_InputHash == Hash(source, it->m_InputRegion))
+				{
+					m_Scales.splice(m_Scales.begin(), m_Scales, it);
+					return m_Scales.front();
+				}
+				// the source changed
+				m_Scales.erase(it);
+				break;
+			}
+		}
+
+		Scale scale;
+		scale.m_Sigma = sigma;
+		scale.m_SliceBySlice = slice_by_slice;
+		scale.m_NormalizeAcrossScale = normalize_across_scale;
+		scale.m_Region = region;
+
+		// pad by the support of the Gaussian, so the values in the region match a filter on the whole image
+		scale.m_InputRegion = region;
+		for (unsigned int d = 0; d < VDimension; d++)
+		{
+			if (!(slice_by_slice && d + 1 == VDimension))
+			{
+				auto const pad = static_cast<itk::IndexValueType>(std::ceil(4.0 * sigma / source->GetSpacing()[d])) + 2;
+				scale.m_InputRegion.SetIndex(d, region.GetIndex(d) - pad);
+				scale.m_InputRegion.SetSize(d, region.GetSize(d) + 2 * pad);
+			}
+		}
+		scale.m_InputRegion.Crop(source->GetBufferedRegion());
+		scale.m_InputHash = Hash(source, scale.m_InputRegion);
+
+		scale.m_NumberOfEigenvalues = slice_by_slice ? VDimension - 1 : VDimension;
+		for (unsigned int k = 0; k < scale.m_NumberOfEigenvalues; k++)
+		{
+			scale.m_Eigenvalues[k].resize(region.GetNumberOfPixels());
+		}
+
+		if (slice_by_slice)
+		{
+			ComputeSlices(source, scale, std::integral_constant<bool, (VDimension > 2)>());
+		}
+		else
+		{
+			Compute(source, scale);
+		}
+
+		// drop smaller regions of this scale, they are covered by the new one
+		m_Scales.remove_if([&scale](const Scale& s) {
+			return s.m_Sigma == scale.m_Sigma && s.m_SliceBySlice == scale.m_SliceBySlice &&
+						 s.m_NormalizeAcrossScale == scale.m_NormalizeAcrossScale && scale.m_Region.IsInside(s.m_Region);
+		});
+
+		m_Scales.push_front(std::move(scale));
+		return m_Scales.front();
+	}
+
+	template<class TInput>
+	static size_t Hash(const TInput* source, const region_type& region)
+	{
+		int const slices = static_cast<int>(region.GetSize(VDimension - 1));
+		std::vector<size_t> slice_hash(slices);
+#pragma omp parallel for
+		for (int z = 0; z < slices; z++)
+		{
+			auto slice = region;
+			slice.SetIndex(VDimension - 1, region.GetIndex(VDimension - 1) + z);
+			slice.SetSize(VDimension - 1, 1);
+
+			std::hash<float> hasher;
+			size_t h = 0;
+			itk::ImageRegionConstIterator<TInput> it(source, slice);
+			for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+			{
+				h = h * 31 + hasher(it.Get());
+			}
+			slice_hash[z] = h;
+		}
+
+		std::hash<double> hasher;
+		size_t h = region.GetNumberOfPixels();
+		for (unsigned int d = 0; d < VDimension; d++)
+		{
+			h = h * 31 + hasher(source->GetSpacing()[d]);
+		}
+		for (auto sh : slice_hash)
+		{
+			h = h * 31 + sh;
+		}
+		return h;
+	}
+
+	/// stores the eigenvalues of the tensors in 'region', sorted by magnitude, starting at 'offset'
+	template<class TTensorImage>
+	static void StoreEigenvalues(const TTensorImage* tensors, const typename TTensorImage::RegionType& region, size_t offset, Scale& scale)
+	{
+		using tensor_type = typename TTensorImage::PixelType;
+		using eigenvalues_type = typename tensor_type::EigenValuesArrayType;
+
+		itk::ImageRegionConstIterator<TTensorImage> it(tensors, region);
+		eigenvalues_type eig;
+		for (it.GoToBegin(); !it.IsAtEnd(); ++it, ++offset)
+		{
+			it.Get().ComputeEigenValues(eig);
+			std::sort(eig.Begin(), eig.End(), [](double a, double b) { return std::abs(a) < std::abs(b); });
+			for (unsigned int k = 0; k < tensor_type::Dimension; k++)
+			{
+				scale.m_Eigenvalues[k][offset] = static_cast<float>(eig[k]);
+			}
+		}
+	}
+
+	template<class TInput>
+	static void Compute(const TInput* source, Scale& scale)
+	{
+		using hessian_filter_type = itk::HessianRecursiveGaussianImageFilter<image_type>;
+
+		auto input = image_type::New();
+		input->SetRegions(scale.m_InputRegion);
+		input->SetSpacing(source->GetSpacing());
+		input->SetOrigin(source->GetOrigin());
+		input->SetDirection(source->GetDirection());
+		input->Allocate();
+		itk::ImageAlgorithm::Copy(source, input.GetPointer(), scale.m_InputRegion, scale.m_InputRegion);
+
+		auto hessian = hessian_filter_type::New();
+		hessian->SetInput(input);
+		hessian->SetSigma(scale.m_Sigma);
+		hessian->SetNormalizeAcrossScale(scale.m_NormalizeAcrossScale);
+		hessian->Update();
+
+		auto tensors = hessian->GetOutput();
+		auto const& region = scale.m_Region;
+		int const slices = static_cast<int>(region.GetSize(VDimension - 1));
+		size_t const slice_size = region.GetNumberOfPixels() / std::max(slices, 1);
+#pragma omp parallel for
+		for (int z = 0; z < slices; z++)
+		{
+			auto slice = region;
+			slice.SetIndex(VDimension - 1, region.GetIndex(VDimension - 1) + z);
+			slice.SetSize(VDimension - 1, 1);
+			StoreEigenvalues(tensors, slice, z * slice_size, scale);
+		}
+	}
+
+	template<class TInput>
+	static void ComputeSlices(const TInput* source, Scale& scale, std::false_type)
+	{
+		Compute(source, scale);
+	}
+
+	template<class TInput>
+	static void ComputeSlices(const TInput* source, Scale& scale, std::true_type)
+	{
+		static const unsigned int slice_dimension = VDimension - 1;
+		using slice_image_type = itk::Image<float, slice_dimension>;
+		using hessian_filter_type = itk::HessianRecursiveGaussianImageFilter<slice_image_type>;
+
+		auto const& region = scale.m_Region;
+		auto const& input_region = scale.m_InputRegion;
+
+		typename slice_image_type::RegionType input_slice_region, slice_region;
+		typename slice_image_type::SpacingType spacing;
+		for (unsigned int d = 0; d < slice_dimension; d++)
+		{
+			input_slice_region.SetIndex(d, input_region.GetIndex(d));
+			input_slice_region.SetSize(d, input_region.GetSize(d));
+			slice_region.SetIndex(d, region.GetIndex(d));
+			slice_region.SetSize(d, region.GetSize(d));
+			spacing[d] = source->GetSpacing()[d];
+		}
+
+		int const slices = static_cast<int>(region.GetSize(slice_dimension));
+		size_t const slice_size = slice_region.GetNumberOfPixels();
+		bool failed = false;
+#pragma omp parallel for
+		for (int z = 0; z < slices; z++)
+		{
+			auto input_slice = input_region;
+			input_slice.SetIndex(slice_dimension, region.GetIndex(slice_dimension) + z);
+			input_slice.SetSize(slice_dimension, 1);
+
+			auto input = slice_image_type::New();
+			input->SetRegions(input_slice_region);
+			input->SetSpacing(spacing);
+			input->Allocate();
+
+			itk::ImageRegionConstIterator<TInput> it(source, input_slice);
+			auto buffer = input->GetBufferPointer();
+			for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+			{
+				*buffer++ = it.Get();
+			}
+
+			// the slices are already processed in parallel
+			auto hessian = hessian_filter_type::New();
+			hessian->SetNumberOfWorkUnits(1);
+			hessian->SetInput(input);
+			hessian->SetSigma(scale.m_Sigma);
+			hessian->SetNormalizeAcrossScale(scale.m_NormalizeAcrossScale);
+			try
+			{
+				hessian->Update();
+			}
+			catch (itk::ExceptionObject&)
+			{
+#pragma omp critical
+				failed = true;
+				continue;
+			}
+			StoreEigenvalues(hessian->GetOutput(), slice_region, z * slice_size, scale);
+		}
+		if (failed)
+		{
+			throw std::runtime_error("could not compute Hessian of slice");
+		}
+	}
+
+	/// objectness of eigenvalues sorted by magnitude, as in itk::HessianToObjectnessMeasureImageFilter
+	template<unsigned int N>
+	static void Objectness(const Scale& scale, const region_type& region, const ObjectnessParameters& params, bool first, float* output)
+	{
+		unsigned int const m = params.m_ObjectDimension;
+		double const two_alpha_sqr = 2.0 * params.m_Alpha * params.m_Alpha;
+		double const two_beta_sqr = 2.0 * params.m_Beta * params.m_Beta;
+		double const two_gamma_sqr = 2.0 * params.m_Gamma * params.m_Gamma;
+		double const sign = params.m_BrightObject ? 1.0 : -1.0;
+
+		// offset of the region in the stored scale
+		auto const& stored = scale.m_Region;
+		size_t const width = region.GetSize(0);
+		size_t const num_rows = region.GetNumberOfPixels() / std::max<size_t>(width, 1);
+
+		const float* values[N];
+		for (unsigned int k = 0; k < N; k++)
+		{
+			values[k] = scale.m_Eigenvalues[k].data();
+		}
+
+#pragma omp parallel for
+		for (int r = 0; r < static_cast<int>(num_rows); r++)
+		{
+			// position of the row in the stored region
+			size_t row = r, stored_offset = 0, stride = 1;
+			for (unsigned int d = 0; d < VDimension; d++)
+			{
+				itk::IndexValueType idx = region.GetIndex(d);
+				if (d > 0)
+				{
+					idx += row % region.GetSize(d);
+					row /= region.GetSize(d);
+				}
+				stored_offset += (idx - stored.GetIndex(d)) * stride;
+				stride *= stored.GetSize(d);
+			}
+
+			float* out = output + r * width;
+			for (size_t x = 0; x < width; x++)
+			{
+				double abs_l[N];
+				bool valid = true;
+				for (unsigned int k = 0; k < N; k++)
+				{
+					double l = values[k][stored_offset + x];
+					abs_l[k] = std::abs(l);
+					if (k >= m)
+					{
+						valid = valid && sign * l <= 0.0 && abs_l[k] >= itk::Math::eps;
+					}
+				}
+
+				double measure = 1.0;
+				if (m + 1 < N && params.m_Alpha != 0.0)
+				{
+					double denominator = 1.0;
+					for (unsigned int j = m + 1; j < N; j++)
+						denominator *= abs_l[j];
+					double r_a = abs_l[m] / std::pow(denominator, 1.0 / (N - m - 1));
+					measure *= 1.0 - std::exp(-r_a * r_a / two_alpha_sqr);
+				}
+				if (m > 0 && params.m_Beta != 0.0)
+				{
+					double denominator = 1.0;
+					for (unsigned int j = m; j < N; j++)
+						denominator *= abs_l[j];
+					double r_b = abs_l[m - 1] / std::pow(denominator, 1.0 / (N - m));
+					measure *= std::exp(-r_b * r_b / two_beta_sqr);
+				}
+
+				double frobenius_norm_sqr = 0.0;
+				for (unsigned int k = 0; k < N; k++)
+					frobenius_norm_sqr += abs_l[k] * abs_l[k];
+				measure *= 1.0 - std::exp(-frobenius_norm_sqr / two_gamma_sqr);
+
+				if (params.m_ScaleObjectnessMeasure)
+				{
+					measure *= abs_l[N - 1];
+				}
+
+				float const v = valid ? static_cast<float>(measure) : 0.f;
+				out[x] = first ? v : std::max(out[x], v);
+			}
+		}
+	}
+
+	static void Accumulate(const Scale& scale, const region_type& region, const ObjectnessParameters& params, bool first, float* output)
+	{
+		if (scale.m_NumberOfEigenvalues == 2)
+		{
+			Objectness<2>(scale, region, params, first, output);
+		}
+		else
+		{
+			Objectness<VDimension>(scale, region, params, first, output);
+		}
+	}
+
+	/// drops the least recently used scales above the memory limit, except the first 'keep'
+	void Trim(size_t keep)
+	{
+		size_t memory = 0;
+		for (auto const& s : m_Scales)
+		{
+			memory += s.Memory();
+		}
+		while (m_Scales.size() > keep && memory > m_MaximumMemory)
+		{
+			memory -= m_Scales.back().Memory();
+			m_Scales.pop_back();
+		}
+	}
+
+	std::list<Scale> m_Scales; // most recently used first
+	size_t m_MaximumMemory = size_t(1) << 30;
+};
+
+} // namespace iseg
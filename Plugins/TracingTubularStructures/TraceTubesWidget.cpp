@@ -18,13 +18,10 @@
 
 #include <itkBinaryThresholdImageFilter.h>
 #include <itkDanielssonDistanceMapImageFilter.h>
-#include <itkHessianRecursiveGaussianImageFilter.h>
-#include <itkHessianToObjectnessMeasureImageFilter.h>
 #include <itkMinimumMaximumImageCalculator.h>
 #include <itkRegionOfInterestImageFilter.h>
 #include <itkSignedDanielssonDistanceMapImageFilter.h>
 #include <itkSignedMaurerDistanceMapImageFilter.h>
-#include <itkSliceBySliceImageFilter.h>
 
 #include <QCheckBox>
 #include <QComboBox>
@@ -238,12 +235,14 @@ void TraceTubesWidget::init()
 
 void TraceTubesWidget::newloaded()
 {
+	_hessian_cache.Clear();
 	on_slicenr_changed();
 }
 
 void TraceTubesWidget::cleanup()
 {
 	_points.clear();
+	_hessian_cache.Clear();
 }
 
 std::string TraceTubesWidget::GetName()
@@ -299,82 +298,36 @@ int TraceTubesWidget::get_padding() const
 	return pad;
 }
 
-itk::Image<float, 3>::Pointer TraceTubesWidget::compute_vesselness(const itk::ImageBase<3>::RegionType& requested_region) const
+iseg::ObjectnessParameters TraceTubesWidget::objectness_parameters(unsigned int object_dimension) const
 {
-	using input_type = itk::SliceContiguousImage<float>;
-	using hessian_filter_type = itk::HessianRecursiveGaussianImageFilter<input_type>;
-	using hessian_pixel_type = itk::SymmetricSecondRankTensor<double, 3>;
-	using hessian_image_type = itk::Image<hessian_pixel_type, 3>;
-	using image_type = itk::Image<float, 3>;
-	using objectness_filter_type = itk::HessianToObjectnessMeasureImageFilter<hessian_image_type, image_type>;
+	iseg::ObjectnessParameters params;
+	params.m_BrightObject = !_dark_objects->isChecked();
+	params.m_ObjectDimension = object_dimension;
+	params.m_ScaleObjectnessMeasure = true;
+	params.m_Alpha = _alpha->text().toDouble();
+	params.m_Beta = _beta->text().toDouble();
+	params.m_Gamma = _gamma->text().toDouble();
+	return params;
+}
 
+itk::Image<float, 3>::Pointer TraceTubesWidget::compute_vesselness(const itk::ImageBase<3>::RegionType& requested_region) const
+{
 	double sigma = _sigma->text().toDouble();
-	double alpha = _alpha->text().toDouble();
-	double beta = _beta->text().toDouble();
-	double gamma = _gamma->text().toDouble();
 
 	iseg::SlicesHandlerITKInterface itk_handler(_handler);
 	auto source = itk_handler.GetSource(true);
 
-	auto hessian_filter = hessian_filter_type::New();
-	hessian_filter->SetInput(source);
-	hessian_filter->SetSigma(sigma);
-
-	auto objectness_filter = objectness_filter_type::New();
-	objectness_filter->SetInput(hessian_filter->GetOutput());
-	objectness_filter->SetBrightObject(!_dark_objects->isChecked());
-	objectness_filter->SetObjectDimension(1);
-	objectness_filter->SetScaleObjectnessMeasure(true);
-	objectness_filter->SetAlpha(alpha);
-	objectness_filter->SetBeta(beta);
-	objectness_filter->SetGamma(gamma);
-	objectness_filter->GetOutput()->SetRequestedRegion(requested_region);
-	objectness_filter->Update();
-
-	return objectness_filter->GetOutput();
+	return _hessian_cache.ComputeObjectness(source.GetPointer(), requested_region, {sigma}, false, false, objectness_parameters(1));
 }
 
 itk::Image<float, 3>::Pointer TraceTubesWidget::compute_blobiness(const itk::ImageBase<3>::RegionType& requested_region) const
 {
-	using input_type = itk::SliceContiguousImage<float>;
-	using output_type = itk::Image<float, 3>;
-	using image_type = itk::Image<float, 2>;
-
-	using hessian_filter_type = itk::HessianRecursiveGaussianImageFilter<image_type>;
-	using hessian_pixel_type = itk::SymmetricSecondRankTensor<double, 2>;
-	using hessian_image_type = itk::Image<hessian_pixel_type, 2>;
-
-	using objectness_filter_type = itk::HessianToObjectnessMeasureImageFilter<hessian_image_type, image_type>;
-	using slice_by_slice_filter_type = itk::SliceBySliceImageFilter<input_type, output_type, hessian_filter_type, objectness_filter_type>;
-
 	double sigma = _sigma->text().toDouble();
-	double alpha = _alpha->text().toDouble();
-	double beta = _beta->text().toDouble();
-	double gamma = _gamma->text().toDouble();
 
 	iseg::SlicesHandlerITKInterface itk_handler(_handler);
 	auto source = itk_handler.GetSource(true);
 
-	auto hessian_filter = hessian_filter_type::New();
-	hessian_filter->SetSigma(sigma);
-
-	auto objectness_filter = objectness_filter_type::New();
-	objectness_filter->SetInput(hessian_filter->GetOutput());
-	objectness_filter->SetBrightObject(!_dark_objects->isChecked());
-	objectness_filter->SetObjectDimension(0);
-	objectness_filter->SetScaleObjectnessMeasure(true);
-	objectness_filter->SetAlpha(alpha);
-	objectness_filter->SetBeta(beta);
-	objectness_filter->SetGamma(gamma);
-
-	auto slice_filter = slice_by_slice_filter_type::New();
-	slice_filter->SetInput(source);
-	slice_filter->SetInputFilter(hessian_filter);
-	slice_filter->SetOutputFilter(objectness_filter);
-	slice_filter->GetOutput()->SetRequestedRegion(requested_region);
-	slice_filter->Update();
-
-	return slice_filter->GetOutput();
+	return _hessian_cache.ComputeObjectness(source.GetPointer(), requested_region, {sigma}, true, false, objectness_parameters(0));
 }
 
 itk::Image<float, 3>::Pointer TraceTubesWidget::compute_object_sdf(const itk::ImageBase<3>::RegionType& requested_region) const
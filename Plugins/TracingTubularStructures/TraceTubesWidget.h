@@ -9,6 +9,8 @@
  */
 #pragma once
 
+#include "HessianEigenvalueCache.h"
+
 #include "Data/SlicesHandlerInterface.h"
 
 #include "Interface/WidgetInterface.h"
@@ -69,6 +71,8 @@ private:
 		kHessian3D,
 		kTarget
 	};
+	iseg::ObjectnessParameters objectness_parameters(unsigned int object_dimension) const;
+
 	itk::Image<float, 3>::Pointer compute_vesselness(const itk::ImageBase<3>::RegionType& requested_region) const;
 
 	itk::Image<float, 3>::Pointer compute_blobiness(const itk::ImageBase<3>::RegionType& requested_region) const;
@@ -81,6 +85,9 @@ private:
 	iseg::SlicesHandlerInterface* _handler;
 	std::vector<iseg::Point3D> _points;
 
+	// eigenvalues are reused when the points or objectness parameters change
+	mutable iseg::HessianEigenvalueCache<3> _hessian_cache;
+
 	QWidget* _main_options;
 	QComboBox* _metric;
 	QLineEdit* _intensity_value;
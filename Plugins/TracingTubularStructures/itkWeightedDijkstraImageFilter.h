@@ -10,11 +10,15 @@
 
 #pragma once
 
-#include <itkConstNeighborhoodIterator.h>
+#include <itkImage.h>
 #include <itkImageToPathFilter.h>
-#include <itkNeighborhoodAlgorithm.h>
 #include <itkPolyLineParametricPath.h>
 
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <list>
+#include <memory>
 #include <queue>
 #include <utility>
 #include <vector>
@@ -67,6 +71,19 @@ public:
 		return m_IntensityWeight * (iDifference + sIDifference) + m_LengthWeight * pLength + m_AngleWeight * pSmoothness;
 	}
 
+	// lower bound of the cost of any path from i to j, used as A* heuristic.
+	// Each step adds at least its length and |m_StartValue - m_EndValue| (triangle inequality),
+	// so the bound is consistent: it never drops by more than the weight of an edge.
+	ValueType GetLowerBound(const typename ImageType::IndexType& i, const typename ImageType::IndexType& j) const
+	{
+		using bit64 = long long;
+		bit64 dir[] = {j[0] - (bit64)i[0], j[1] - (bit64)i[1], j[2] - (bit64)i[2]};
+		auto steps = std::max(std::max(std::abs(dir[0]), std::abs(dir[1])), std::abs(dir[2]));
+		auto pLength = ComputeLength(dir[0] * m_Spacing[0], dir[1] * m_Spacing[1], dir[2] * m_Spacing[2]);
+
+		return m_IntensityWeight * fabs(m_EndValue - m_StartValue) * steps + m_LengthWeight * pLength;
+	}
+
 	inline SpacingValueType ComputeLength(SpacingValueType x, SpacingValueType y, SpacingValueType z) const
 	{
 		return std::sqrt(x * x + y * y + z * z);
@@ -36,116 +36,136 @@ template<typename TInputImageType, typename TMetric>
 void WeightedDijkstraImageFilter<TInputImageType, TMetric>::
 		GenerateData()
 {
-	using neighborhood_iterator_type = ConstNeighborhoodIterator<ImageType>;
-
 	using vertex_t = IndexType;
 	using weight_t = float;
-	using weight_vertex_pair_t = std::pair<weight_t, vertex_t>;
+	using offset_t = typename ImageType::OffsetType;
 
 	typename ImageType::ConstPointer image = this->GetInput();
 	m_Metric.Initialize(image, m_StartIndex, m_EndIndex);
 
-	using offset_table_t = typename ImageType::RegionType::OffsetTableType;
-	offset_table_t offset_table;
-	m_Region.ComputeOffsetTable(offset_table);
-
-	auto ijk2index = [&](const typename ImageType::IndexType& ijk) {
-		typename ImageType::OffsetValueType offset = 0;
-		ImageHelper<3, 3>::ComputeOffset(m_Region.GetIndex(), ijk, offset_table, offset);
-		return offset;
-	};
-
-	size_t source = ijk2index(m_StartIndex);
-	size_t target = ijk2index(m_EndIndex);
-	size_t N = m_Region.GetNumberOfPixels();
-
-	auto dummy_img = ImageType::New();
-	dummy_img->SetLargestPossibleRegion(image->GetLargestPossibleRegion());
-	dummy_img->SetBufferedRegion(m_Region);
-
-	typename neighborhood_iterator_type::RadiusType radius;
-	radius.Fill(1);
-	neighborhood_iterator_type nit(radius, dummy_img, m_Region);
-
-	std::vector<bool> is_boundary(N, false);
-	NeighborhoodAlgorithm::ImageBoundaryFacesCalculator<ImageType> face_calculator;
-	auto faces = face_calculator(dummy_img.GetPointer(), m_Region, radius);
-	if (!faces.empty())
-		faces.erase(faces.begin());
-	for (auto face_region : faces)
+	// 26-neighborhood
+	std::vector<offset_t> neighbors;
+	for (int k = -1; k <= 1; k++)
 	{
-		ImageRegionConstIterator<ImageType> it(image, face_region);
-		for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+		for (int j = -1; j <= 1; j++)
 		{
-			is_boundary.at(ijk2index(it.GetIndex())) = true;
+			for (int i = -1; i <= 1; i++)
+			{
+				if (i != 0 || j != 0 || k != 0)
+				{
+					neighbors.push_back({{i, j, k}});
+				}
+			}
 		}
 	}
-	bool any_boundary = std::count(is_boundary.begin(), is_boundary.end(), true);
+	static const unsigned char kNoPrevious = 255;
+
+	// Distances and predecessors are stored in blocks of 8x8x8 vertices, which are
+	// only allocated when the search reaches them. The A* search only visits a
+	// narrow band around the path, so most of the region is never allocated.
+	static const unsigned kBlockBits = 3;
+	static const unsigned kBlockMask = (1 << kBlockBits) - 1;
+	struct VertexData
+	{
+		weight_t distance = std::numeric_limits<weight_t>::max();
+		unsigned char previous = kNoPrevious;
+	};
+	using block_t = std::array<VertexData, 1 << (3 * kBlockBits)>;
 
-	std::vector<weight_t> min_distance(N, std::numeric_limits<weight_t>::max());
-	static const vertex_t kInvalidIndex = {-1, -1, -1};
-	std::vector<vertex_t> previous(N, kInvalidIndex);
+	auto const region_start = m_Region.GetIndex();
+	auto const region_size = m_Region.GetSize();
+	size_t block_dims[3];
+	for (unsigned d = 0; d < 3; d++)
+	{
+		block_dims[d] = (region_size[d] + kBlockMask) >> kBlockBits;
+	}
+	std::vector<std::unique_ptr<block_t>> blocks(block_dims[0] * block_dims[1] * block_dims[2]);
 
-	min_distance[source] = 0;
+	auto vertex_data = [&](const vertex_t& v) -> VertexData& {
+		size_t ijk[3];
+		for (unsigned d = 0; d < 3; d++)
+		{
+			ijk[d] = static_cast<size_t>(v[d] - region_start[d]);
+		}
+		auto& block = blocks[(ijk[0] >> kBlockBits) + block_dims[0] * ((ijk[1] >> kBlockBits) + block_dims[1] * (ijk[2] >> kBlockBits))];
+		if (!block)
+		{
+			block.reset(new block_t);
+		}
+		return (*block)[(ijk[0] & kBlockMask) + ((ijk[1] & kBlockMask) << kBlockBits) + ((ijk[2] & kBlockMask) << (2 * kBlockBits))];
+	};
 
+	// A* with a consistent heuristic settles the vertices with the same distances as Dijkstra,
+	// but stops before exploring vertices which are further away than the target
+	struct QueueEntry
+	{
+		weight_t estimate;
+		weight_t distance;
+		vertex_t vertex;
+	};
 	// we use greater instead of less to turn max-heap into min-heap
 	struct Greater
 	{
-		constexpr bool operator()(const weight_vertex_pair_t& l, const weight_vertex_pair_t& r) const
+		bool operator()(const QueueEntry& l, const QueueEntry& r) const
 		{
-			return (l.first > r.first);
+			return (l.estimate > r.estimate);
 		}
 	};
-	std::priority_queue<weight_vertex_pair_t,
-			std::vector<weight_vertex_pair_t>, Greater>
-			vertex_queue;
-	vertex_queue.push(std::make_pair(min_distance[source], m_StartIndex));
+	std::priority_queue<QueueEntry, std::vector<QueueEntry>, Greater> vertex_queue;
+
+	if (m_Region.IsInside(m_StartIndex) && m_Region.IsInside(m_EndIndex))
+	{
+		vertex_data(m_StartIndex).distance = 0;
+		vertex_queue.push(QueueEntry{m_Metric.GetLowerBound(m_StartIndex, m_EndIndex), 0, m_StartIndex});
+	}
 
 	while (!vertex_queue.empty())
 	{
-		weight_t dist = vertex_queue.top().first;
-		vertex_t u = vertex_queue.top().second;
-		size_t uid = ijk2index(u);
-		if (uid == target)
+		weight_t dist = vertex_queue.top().distance;
+		vertex_t u = vertex_queue.top().vertex;
+		if (u == m_EndIndex)
 			break;
-
-		vertex_t uprev = (uid == source) ? m_StartIndex : previous[uid];
 		vertex_queue.pop();
 
 		// Because we leave old copies of the vertex in the priority queue
 		// (with outdated higher distances), we need to ignore it when we come
 		// across it again, by checking its distance against the minimum distance
-		if (dist > min_distance[uid])
+		auto const& udata = vertex_data(u);
+		if (dist > udata.distance)
 			continue;
 
-		// Visit each edge exiting u
-		nit.SetLocation(u);
+		vertex_t uprev = (udata.previous == kNoPrevious) ? m_StartIndex : u - neighbors[udata.previous];
 
-		for (unsigned int i = 0; i < nit.Size(); i++)
+		// Visit each edge exiting u
+		for (unsigned char i = 0; i < neighbors.size(); i++)
 		{
-			if (is_boundary[uid] && !nit.IndexInBounds(i))
+			vertex_t v = u + neighbors[i];
+			if (!m_Region.IsInside(v))
 				continue;
 
-			vertex_t v = nit.GetIndex(i);
-			size_t vid = ijk2index(v);
-
 			weight_t weight = m_Metric.GetEdgeWeight(u, v, uprev);
 			weight_t distance_through_u = dist + weight;
 
-			if (distance_through_u < min_distance[vid])
+			auto& vdata = vertex_data(v);
+			if (distance_through_u < vdata.distance)
 			{
-				min_distance[vid] = distance_through_u;
-				previous[vid] = u;
-				vertex_queue.push(std::make_pair(min_distance[vid], v));
+				vdata.distance = distance_through_u;
+				vdata.previous = i;
+				vertex_queue.push(QueueEntry{distance_through_u + m_Metric.GetLowerBound(v, m_EndIndex), distance_through_u, v});
 			}
 		}
 	}
+
 	std::list<vertex_t> path;
-	for (vertex_t vertex = m_EndIndex; vertex != kInvalidIndex;)
+	for (vertex_t vertex = m_EndIndex;;)
 	{
 		path.push_front(vertex);
-		auto index = ijk2index(vertex);
-		vertex = previous[index];
+		if (!m_Region.IsInside(vertex))
+			break;
+		auto previous = vertex_data(vertex).previous;
+		if (previous == kNoPrevious)
+			break;
+		vertex = vertex - neighbors[previous];
 	}
 
 	PathType::Pointer output = this->GetOutput(0);
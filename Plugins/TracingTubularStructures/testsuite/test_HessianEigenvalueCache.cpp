@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include <boost/test/unit_test.hpp>
+
+#include "../HessianEigenvalueCache.h"
+
+#include <itkHessianToObjectnessMeasureImageFilter.h>
+#include <itkImageRegionConstIterator.h>
+#include <itkImageRegionIteratorWithIndex.h>
+
+namespace iseg {
+
+namespace {
+using image_type = itk::Image<float, 3>;
+
+image_type::Pointer make_tube()
+{
+	auto img = image_type::New();
+	itk::Index<3> idx = {0, 0, 0};
+	itk::Size<3> size = {40, 40, 30};
+	img->SetRegions(itk::ImageRegion<3>(idx, size));
+	img->Allocate();
+
+	// bright tube along z with a gaussian profile
+	itk::ImageRegionIteratorWithIndex<image_type> it(img, img->GetLargestPossibleRegion());
+	for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+	{
+		double dx = it.GetIndex()[0] - 20.0;
+		double dy = it.GetIndex()[1] - 18.0;
+		it.Set(static_cast<float>(100.0 * std::exp(-(dx * dx + dy * dy) / 8.0)));
+	}
+	return img;
+}
+
+image_type::Pointer compute_reference(image_type* img, double sigma, const ObjectnessParameters& params)
+{
+	using hessian_filter_type = itk::HessianRecursiveGaussianImageFilter<image_type>;
+	using hessian_image_type = hessian_filter_type::OutputImageType;
+	using objectness_filter_type = itk::HessianToObjectnessMeasureImageFilter<hessian_image_type, image_type>;
+
+	auto hessian_filter = hessian_filter_type::New();
+	hessian_filter->SetInput(img);
+	hessian_filter->SetSigma(sigma);
+
+	auto objectness_filter = objectness_filter_type::New();
+	objectness_filter->SetInput(hessian_filter->GetOutput());
+	objectness_filter->SetBrightObject(params.m_BrightObject);
+	objectness_filter->SetObjectDimension(params.m_ObjectDimension);
+	objectness_filter->SetScaleObjectnessMeasure(params.m_ScaleObjectnessMeasure);
+	objectness_filter->SetAlpha(params.m_Alpha);
+	objectness_filter->SetBeta(params.m_Beta);
+	objectness_filter->SetGamma(params.m_Gamma);
+	objectness_filter->Update();
+	return objectness_filter->GetOutput();
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(iSeg_suite);
+BOOST_AUTO_TEST_SUITE(TraceTubesWidget_suite);
+
+// TestRunner.exe --run_test=iSeg_suite/TraceTubesWidget_suite/HessianEigenvalueCache_test --log_level=message
+BOOST_AUTO_TEST_CASE(HessianEigenvalueCache_test)
+{
+	auto img = make_tube();
+
+	ObjectnessParameters params;
+	params.m_Gamma = 20.0;
+
+	itk::Index<3> idx = {12, 10, 8};
+	itk::Size<3> size = {16, 16, 12};
+	itk::ImageRegion<3> region(idx, size);
+
+	auto reference = compute_reference(img, 2.0, params);
+
+	HessianEigenvalueCache<3> cache;
+	auto vesselness = cache.ComputeObjectness(img.GetPointer(), region, {2.0}, false, false, params);
+	BOOST_CHECK_EQUAL(vesselness->GetBufferedRegion(), region);
+	BOOST_CHECK_EQUAL(cache.NumberOfScales(), 1);
+
+	float max_value = 0.f;
+	itk::ImageRegionConstIterator<image_type> rit(reference, region);
+	for (rit.GoToBegin(); !rit.IsAtEnd(); ++rit)
+	{
+		max_value = std::max(max_value, rit.Get());
+	}
+	BOOST_REQUIRE_GT(max_value, 0.f);
+
+	// the eigenvalues are computed on a padded region, so they match up to the boundary effects of the filter
+	itk::ImageRegionConstIterator<image_type> vit(vesselness, region);
+	for (rit.GoToBegin(), vit.GoToBegin(); !rit.IsAtEnd(); ++rit, ++vit)
+	{
+		BOOST_REQUIRE_SMALL(rit.Get() - vit.Get(), 1e-3f * max_value);
+	}
+
+	// other parameters and a smaller region reuse the stored eigenvalues
+	params.m_BrightObject = false;
+	itk::Index<3> sub_idx = {14, 12, 10};
+	itk::Size<3> sub_size = {8, 8, 8};
+	itk::ImageRegion<3> sub_region(sub_idx, sub_size);
+	auto dark = cache.ComputeObjectness(img.GetPointer(), sub_region, {2.0}, false, false, params);
+	BOOST_CHECK_EQUAL(cache.NumberOfScales(), 1);
+	itk::ImageRegionConstIterator<image_type> dit(dark, sub_region);
+	for (dit.GoToBegin(); !dit.IsAtEnd(); ++dit)
+	{
+		BOOST_REQUIRE_EQUAL(dit.Get(), 0.f);
+	}
+
+	// a modified source invalidates the stored eigenvalues, the result must
+	// match a cache which has not seen the old source
+	params.m_BrightObject = true;
+	itk::Index<3> spike = {16, 14, 12};
+	img->SetPixel(spike, 1000.f);
+	auto modified = cache.ComputeObjectness(img.GetPointer(), region, {2.0}, false, false, params);
+	BOOST_CHECK_EQUAL(cache.NumberOfScales(), 1);
+
+	HessianEigenvalueCache<3> fresh_cache;
+	auto expected = fresh_cache.ComputeObjectness(img.GetPointer(), region, {2.0}, false, false, params);
+	size_t changed = 0;
+	itk::ImageRegionConstIterator<image_type> mit(modified, region), eit(expected, region);
+	for (mit.GoToBegin(), eit.GoToBegin(), vit.GoToBegin(); !mit.IsAtEnd(); ++mit, ++eit, ++vit)
+	{
+		BOOST_REQUIRE_EQUAL(mit.Get(), eit.Get());
+		changed += (mit.Get() != vit.Get()) ? 1 : 0;
+	}
+	BOOST_CHECK_GT(changed, 0);
+
+	// a second scale
+	cache.ComputeObjectness(img.GetPointer(), region, {1.0, 2.0}, false, false, params);
+	BOOST_CHECK_EQUAL(cache.NumberOfScales(), 2);
+
+	cache.Clear();
+	BOOST_CHECK_EQUAL(cache.NumberOfScales(), 0);
+}
+
+// TestRunner.exe --run_test=iSeg_suite/TraceTubesWidget_suite/HessianEigenvalueCacheMemory_test --log_level=message
+BOOST_AUTO_TEST_CASE(HessianEigenvalueCacheMemory_test)
+{
+	auto img = make_tube();
+	ObjectnessParameters params;
+
+	// the scales of the latest request are kept, even above the limit
+	HessianEigenvalueCache<3> cache;
+	cache.SetMaximumMemory(1);
+	auto multi = cache.ComputeObjectness(img.GetPointer(), img->GetBufferedRegion(), {1.0, 2.0, 3.0}, false, true, params);
+	BOOST_CHECK_EQUAL(cache.NumberOfScales(), 3);
+
+	auto again = cache.ComputeObjectness(img.GetPointer(), img->GetBufferedRegion(), {1.0, 2.0, 3.0}, false, true, params);
+	BOOST_CHECK_EQUAL(cache.NumberOfScales(), 3);
+	itk::ImageRegionConstIterator<image_type> mit(multi, multi->GetBufferedRegion()), ait(again, again->GetBufferedRegion());
+	for (mit.GoToBegin(), ait.GoToBegin(); !mit.IsAtEnd(); ++mit, ++ait)
+	{
+		BOOST_REQUIRE_EQUAL(mit.Get(), ait.Get());
+	}
+
+	// older scales are dropped for a new request
+	cache.ComputeObjectness(img.GetPointer(), img->GetBufferedRegion(), {4.0}, false, true, params);
+	BOOST_CHECK_EQUAL(cache.NumberOfScales(), 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_AUTO_TEST_SUITE_END();
+
+} // namespace iseg
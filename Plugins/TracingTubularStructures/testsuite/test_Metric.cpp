@@ -80,6 +80,51 @@ BOOST_AUTO_TEST_CASE(DijkstraMetric_test)
 		m.Initialize(img, iprev, j);
 
 		BOOST_CHECK_CLOSE(3 * 0 + 1.0 + 0.0, m.GetEdgeWeight(i, j, iprev), 1e-3);
+		BOOST_CHECK_CLOSE(2.0, m.GetLowerBound(iprev, j), 1e-3);
+	}
+}
+
+// TestRunner.exe --run_test=iSeg_suite/TraceTubesWidget_suite/ShortestPath_test --log_level=message
+BOOST_AUTO_TEST_CASE(ShortestPath_test)
+{
+	using image_type = itk::Image<float, 3>;
+	using path_filter_type = itk::WeightedDijkstraImageFilter<image_type>;
+
+	auto img = image_type::New();
+	{
+		itk::Index<3> idx = {0, 0, 0};
+		itk::Size<3> size = {40, 30, 20};
+		img->SetRegions(itk::ImageRegion<3>(idx, size));
+	}
+	img->Allocate();
+	img->FillBuffer(10.f);
+
+	// bright tube with a kink, the path should follow it instead of the straight line
+	itk::Index<3> start = {5, 20, 10}, corner = {20, 5, 10}, end = {35, 20, 10};
+	for (int i = 0; i <= 15; i++)
+	{
+		img->SetPixel({{start[0] + i, start[1] - i, 10}}, 0.f);
+		img->SetPixel({{corner[0] + i, corner[1] + i, 10}}, 0.f);
+	}
+
+	// region which does not start at the image origin
+	itk::Index<3> idx = {2, 3, 4};
+	itk::Size<3> size = {36, 25, 12};
+
+	auto dijkstra = path_filter_type::New();
+	dijkstra->SetInput(img);
+	dijkstra->SetRegion(itk::ImageRegion<3>(idx, size));
+	dijkstra->SetStartIndex(start);
+	dijkstra->SetEndIndex(end);
+	dijkstra->Update();
+
+	auto path = dijkstra->GetOutput()->GetVertexList();
+	BOOST_REQUIRE_EQUAL(path->Size(), 31);
+	for (unsigned int i = 0; i < path->Size(); i++)
+	{
+		auto v = path->ElementAt(i);
+		BOOST_CHECK_EQUAL(v[1], i <= 15 ? 20 - i : i - 10);
+		BOOST_CHECK_EQUAL(v[2], 10);
 	}
 }
 
@@ -32,7 +32,10 @@ namespace itk
 * Building skeleton models via 3-D medial surface/axis thinning algorithms.
 * Computer Vision, Graphics, and Image Processing, 56(6):462--478, 1994.
 * 
-* To do: Make use of multi-threading.
+* Only the current border set is visited. The simple border points of a
+* subiteration are found in parallel, and re-checked and deleted in parallel
+* per subfield (voxels with the same parity of x, y and z), which replaces
+* the sequential re-checking of the original implementation.
 *
 * \author Hanno Homann, Oxford University, Wolfson Medical Vision Lab, UK.
 * 
@@ -133,13 +136,13 @@ protected:
   /**  Compute thinning Image. */
   void ComputeThinImage();
   
-  /**  isEulerInvariant [Lee94] */
-  bool isEulerInvariant(NeighborhoodType neighbors, int *LUT);
-  void fillEulerLUT(int *LUT);  
+  /**  isEulerInvariant [Lee94], neighbors are the 27 values of the 3x3x3 neighborhood */
+  bool isEulerInvariant(const int *neighbors, const int *LUT) const;
+  void fillEulerLUT(int *LUT) const;
   /**  isSimplePoint [Lee94] */
-  bool isSimplePoint(NeighborhoodType neighbors);
+  bool isSimplePoint(const int *neighbors) const;
   /**  Octree_labeling [Lee94] */
-  void Octree_labeling(int octant, int label, int *cube);
+  void Octree_labeling(int octant, int label, int *cube) const;
 
 
 private:   
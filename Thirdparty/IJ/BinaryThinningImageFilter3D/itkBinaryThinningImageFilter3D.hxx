@@ -102,116 +102,222 @@ BinaryThinningImageFilter3D<TInputImage,TOutputImage>
   OutputImagePointer thinImage = GetThinning();
 
   typename OutputImageType::RegionType region = thinImage->GetRequestedRegion();
-  
-  ConstBoundaryConditionType boundaryCondition;
-  boundaryCondition.SetConstant( 0 );
-
-  typename NeighborhoodIteratorType::RadiusType radius;
-  radius.Fill(1);
-  NeighborhoodIteratorType ot( radius, thinImage, region );
-  ot.SetBoundaryCondition( boundaryCondition );
-
-  std::vector < IndexType > simpleBorderPoints;
-  typename std::vector < IndexType >::iterator simpleBorderPointsIt;
-
-  // Define offsets
-  typedef typename NeighborhoodIteratorType::OffsetType OffsetType;
-  OffsetType N   = {{ 0,-1, 0}};  // north
-  OffsetType S   = {{ 0, 1, 0}};  // south
-  OffsetType E   = {{ 1, 0, 0}};  // east
-  OffsetType W   = {{-1, 0, 0}};  // west
-  OffsetType U   = {{ 0, 0, 1}};  // up
-  OffsetType B   = {{ 0, 0,-1}};  // bottom
+  SizeType size = region.GetSize();
+
+  // Work on a copy padded by one background voxel, so the 3x3x3
+  // neighborhood of a foreground voxel never leaves the buffer.
+  // Bit 0 marks foreground voxels, bit 1 voxels in the border set.
+  const unsigned char FOREGROUND = 1;
+  const unsigned char BORDER = 2;
+  const std::ptrdiff_t sx = size[0] + 2;
+  const std::ptrdiff_t sy = size[1] + 2;
+  const std::ptrdiff_t sxy = sx * sy;
+  const int slices = static_cast<int>( size[2] );
+  std::vector<unsigned char> image( sxy * ( size[2] + 2 ), 0 );
+
+#pragma omp parallel for
+  for( int z = 0; z < slices; z++ )
+  {
+    RegionType slice = region;
+    slice.SetIndex( 2, region.GetIndex(2) + z );
+    slice.SetSize( 2, 1 );
+    ImageRegionConstIterator< TOutputImage > it( thinImage, slice );
+    it.GoToBegin();
+    for( std::ptrdiff_t y = 1; y <= static_cast<std::ptrdiff_t>( size[1] ); y++ )
+    {
+      unsigned char* row = &image[ ( z + 1 ) * sxy + y * sx ];
+      for( std::ptrdiff_t x = 1; x <= static_cast<std::ptrdiff_t>( size[0] ); x++, ++it )
+      {
+        row[x] = ( it.Get() == 1 ) ? FOREGROUND : 0;
+      }
+    }
+  }
+
+  // buffer offsets of the 3x3x3 neighborhood, in the order of the NeighborhoodIterator
+  std::ptrdiff_t offsets[27];
+  for( int i = 0; i < 27; i++ )
+  {
+    offsets[i] = ( i % 3 - 1 ) + ( i / 3 % 3 - 1 ) * sx + ( i / 9 - 1 ) * sxy;
+  }
+  // neighbor which is background for the border types N, S, E, W, U, B
+  const int borderNeighbor[6] = { 10, 16, 14, 12, 22, 4 };
+
+  // The border set holds the foreground voxels with a background 6-neighbor.
+  // Only these can be deleted, and it only grows by neighbors of deleted voxels.
+  std::vector< std::vector< std::ptrdiff_t > > sliceBorder( slices );
+#pragma omp parallel for
+  for( int z = 0; z < slices; z++ )
+  {
+    for( std::ptrdiff_t p = ( z + 1 ) * sxy; p < ( z + 2 ) * sxy; p++ )
+    {
+      if( image[p] & FOREGROUND )
+      {
+        for( int b = 0; b < 6; b++ )
+        {
+          if( !( image[ p + offsets[ borderNeighbor[b] ] ] & FOREGROUND ) )
+          {
+            sliceBorder[z].push_back( p );
+            break;
+          }
+        }
+      }
+    }
+  }
+  std::vector< std::ptrdiff_t > border;
+  for( int z = 0; z < slices; z++ )
+  {
+    border.insert( border.end(), sliceBorder[z].begin(), sliceBorder[z].end() );
+    std::vector< std::ptrdiff_t >().swap( sliceBorder[z] );
+  }
+  for( size_t k = 0; k < border.size(); k++ )
+  {
+    image[ border[k] ] |= BORDER;
+  }
 
   // prepare Euler LUT [Lee94]
   int eulerLUT[256]; 
   fillEulerLUT( eulerLUT );
-  // Loop through the image several times until there is no change.
+
+  std::vector< unsigned char > deletable;
+  std::vector< std::ptrdiff_t > subfield[8];
+
+  // Loop through the border set several times until there is no change.
   int unchangedBorders = 0;
   while( unchangedBorders < 6 )  // loop until no change for all the six border types
   {
     unchangedBorders = 0;
-    for( int currentBorder = 1; currentBorder <= 6; currentBorder++)
+    for( int currentBorder = 0; currentBorder < 6; currentBorder++)
     {
-      // Loop through the image.
-      for ( ot.GoToBegin(); !ot.IsAtEnd(); ++ot )
-      { 
-        // check if point is foreground
-        if ( ot.GetCenterPixel() != 1 )
+      // find the simple border points of the current type, the image is not modified
+      const int numberOfBorderPoints = static_cast<int>( border.size() );
+      deletable.assign( numberOfBorderPoints, 0 );
+#pragma omp parallel for schedule(dynamic, 1024)
+      for( int k = 0; k < numberOfBorderPoints; k++ )
+      {
+        const std::ptrdiff_t p = border[k];
+        if( image[ p + offsets[ borderNeighbor[currentBorder] ] ] & FOREGROUND )
         {
-          continue;         // current point is already background 
+          continue;         // current point is not a border point of type currentBorder
         }
-        // check 6-neighbors if point is a border point of type currentBorder
-        bool isBorderPoint = false;
-        if( currentBorder == 1 && ot.GetPixel(N)<=0 )
-          isBorderPoint = true;
-        if( currentBorder == 2 && ot.GetPixel(S)<=0 )
-          isBorderPoint = true;
-        if( currentBorder == 3 && ot.GetPixel(E)<=0 )
-          isBorderPoint = true;
-        if( currentBorder == 4 && ot.GetPixel(W)<=0 )
-          isBorderPoint = true;
-        if( currentBorder == 5 && ot.GetPixel(U)<=0 )
-          isBorderPoint = true;
-        if( currentBorder == 6 && ot.GetPixel(B)<=0 )
-          isBorderPoint = true;
-        if( !isBorderPoint )
-        {
-          continue;         // current point is not deletable
-        }        
-        // check if point is the end of an arc
+
+        int neighbors[27];
         int numberOfNeighbors = -1;   // -1 and not 0 because the center pixel will be counted as well  
-        for( int i = 0; i < 27; i++ ) // i =  0..26
-          if( ot.GetPixel(i)==1 )
-            numberOfNeighbors++;
+        for( int i = 0; i < 27; i++ )
+        {
+          neighbors[i] = image[ p + offsets[i] ] & FOREGROUND;
+          numberOfNeighbors += neighbors[i];
+        }
 
+        // check if point is the end of an arc
         if( numberOfNeighbors == 1 )
         {
           continue;         // current point is not deletable
         }
 
         // check if point is Euler invariant
-        if( !isEulerInvariant( ot.GetNeighborhood(), eulerLUT ) )
+        if( !isEulerInvariant( neighbors, eulerLUT ) )
         {
           continue;         // current point is not deletable
         }
 
         // check if point is simple (deletion does not change connectivity in the 3x3x3 neighborhood)
-        if( !isSimplePoint( ot.GetNeighborhood() ) )
+        if( !isSimplePoint( neighbors ) )
         {
           continue;         // current point is not deletable
         }
 
-        // add all simple border points to a list for sequential re-checking
-        simpleBorderPoints.push_back( ot.GetIndex() );
-      } // end image iteration loop
+        deletable[k] = 1;
+      }
 
-      // sequential re-checking to preserve connectivity when
-      // deleting in a parallel way
-      bool noChange = true;
-      for( simpleBorderPointsIt=simpleBorderPoints.begin(); simpleBorderPointsIt!=simpleBorderPoints.end(); simpleBorderPointsIt++)
+      // Re-check the simple border points to preserve connectivity. Points of the
+      // same subfield (same parity of x, y and z) are not in each other's 3x3x3
+      // neighborhood, so each subfield can be re-checked and deleted in parallel,
+      // which is equivalent to a sequential re-checking in subfield order.
+      for( int k = 0; k < numberOfBorderPoints; k++ )
       {
-      	// 1. Set simple border point to 0
-        thinImage->SetPixel( *simpleBorderPointsIt, NumericTraits<OutputImagePixelType>::Zero);
-        // 2. Check if neighborhood is still connected
-        ot.SetLocation( *simpleBorderPointsIt );
-        if( !isSimplePoint( ot.GetNeighborhood() ) )
+        if( deletable[k] )
         {
-          // we cannot delete current point, so reset
-          thinImage->SetPixel( *simpleBorderPointsIt, NumericTraits<OutputImagePixelType>::One );
+          const std::ptrdiff_t p = border[k];
+          const int parity = static_cast<int>( ( p % sx ) & 1 ) +
+                             2 * static_cast<int>( ( p / sx % sy ) & 1 ) +
+                             4 * static_cast<int>( ( p / sxy ) & 1 );
+          subfield[parity].push_back( p );
         }
-        else
+      }
+
+      int numberOfDeleted = 0;
+      for( int f = 0; f < 8; f++ )
+      {
+        const int numberOfPoints = static_cast<int>( subfield[f].size() );
+#pragma omp parallel for reduction(+ : numberOfDeleted)
+        for( int k = 0; k < numberOfPoints; k++ )
         {
-          noChange = false;
+          const std::ptrdiff_t p = subfield[f][k];
+          int neighbors[27];
+          for( int i = 0; i < 27; i++ )
+          {
+            neighbors[i] = image[ p + offsets[i] ] & FOREGROUND;
+          }
+          // the center pixel is ignored, so the check is the same as after setting it to 0
+          if( isSimplePoint( neighbors ) )
+          {
+            image[p] = 0;
+            numberOfDeleted++;
+          }
         }
+        subfield[f].clear();
       }
-      if( noChange )
+
+      if( numberOfDeleted == 0 )
+      {
         unchangedBorders++;
+        continue;
+      }
 
-      simpleBorderPoints.clear();
+      // update the border set: drop deleted points, add their foreground 6-neighbors
+      size_t last = 0;
+      const size_t numberOfOldBorderPoints = border.size();
+      for( size_t k = 0; k < numberOfOldBorderPoints; k++ )
+      {
+        const std::ptrdiff_t p = border[k];
+        if( image[p] & FOREGROUND )
+        {
+          border[last++] = p;
+          continue;
+        }
+        for( int b = 0; b < 6; b++ )
+        {
+          const std::ptrdiff_t q = p + offsets[ borderNeighbor[b] ];
+          if( image[q] == FOREGROUND )
+          {
+            image[q] |= BORDER;
+            border.push_back( q );
+          }
+        }
+      }
+      border.erase( border.begin() + last, border.begin() + numberOfOldBorderPoints );
     } // end currentBorder for loop
   } // end unchangedBorders while loop
 
+  // copy the skeleton to the output
+#pragma omp parallel for
+  for( int z = 0; z < slices; z++ )
+  {
+    RegionType slice = region;
+    slice.SetIndex( 2, region.GetIndex(2) + z );
+    slice.SetSize( 2, 1 );
+    ImageRegionIterator< TOutputImage > ot( thinImage, slice );
+    ot.GoToBegin();
+    for( std::ptrdiff_t y = 1; y <= static_cast<std::ptrdiff_t>( size[1] ); y++ )
+    {
+      const unsigned char* row = &image[ ( z + 1 ) * sxy + y * sx ];
+      for( std::ptrdiff_t x = 1; x <= static_cast<std::ptrdiff_t>( size[0] ); x++, ++ot )
+      {
+        ot.Set( ( row[x] & FOREGROUND ) ? NumericTraits<OutputImagePixelType>::One : NumericTraits<OutputImagePixelType>::Zero );
+      }
+    }
+  }
+
   itkDebugMacro( << "ComputeThinImage End");
 }
 
@@ -236,7 +342,7 @@ BinaryThinningImageFilter3D<TInputImage,TOutputImage>
 template <class TInputImage,class TOutputImage>
 void 
 BinaryThinningImageFilter3D<TInputImage,TOutputImage>
-::fillEulerLUT(int *LUT)
+::fillEulerLUT(int *LUT) const
 {
   LUT[1]  =  1;
   LUT[3]  = -1;
@@ -378,7 +484,7 @@ BinaryThinningImageFilter3D<TInputImage,TOutputImage>
 template <class TInputImage,class TOutputImage>
 bool 
 BinaryThinningImageFilter3D<TInputImage,TOutputImage>
-::isEulerInvariant(NeighborhoodType neighbors, int *LUT)
+::isEulerInvariant(const int *neighbors, const int *LUT) const
 {
   // calculate Euler characteristic for each octant and sum up
   int EulerChar = 0;
@@ -534,7 +640,7 @@ BinaryThinningImageFilter3D<TInputImage,TOutputImage>
 template <class TInputImage,class TOutputImage>
 bool 
 BinaryThinningImageFilter3D<TInputImage,TOutputImage>
-::isSimplePoint(NeighborhoodType neighbors)
+::isSimplePoint(const int *neighbors) const
 {
   // copy neighbors for labeling
   int cube[26];
@@ -617,7 +723,7 @@ BinaryThinningImageFilter3D<TInputImage,TOutputImage>
 template <class TInputImage,class TOutputImage>
 void 
 BinaryThinningImageFilter3D<TInputImage,TOutputImage>
-::Octree_labeling(int octant, int label, int *cube)
+::Octree_labeling(int octant, int label, int *cube) const
 {
   // check if there are points in the octant with value 1
   if( octant==1 )
@@ -75,7 +75,7 @@ void Levelset::init(unsigned short h, unsigned short w, float* initial, float f,
 
 	image->newbmp(w, h);
 	image->copy2bmp(initial, 1);
-	image->dead_reckoning(f);
+	free(image->dead_reckoning(f));
 
 	//	float *dummy=image->copy_work();
 	//	ownlvlset=true;
@@ -170,7 +170,7 @@ void Levelset::reinitialize()
 
 	image->threshold(thresh);
 	image->swap_bmpwork();
-	image->dead_reckoning(255);
+	free(image->dead_reckoning(255));
 	//	image->IFT_distance1(255);
 	/*	Pair p,p1;
 	image->get_range(&p);
@@ -1845,6 +1845,15 @@ void MainWindow::execute_swapxy()
 	}
 
 	emit end_datachange(this, iseg::ClearUndo);
+
+	if (!ok)
+	{
+		QMessageBox::warning(this, "iSeg",
+				"Error: Not enough memory to swap the axes.",
+				QMessageBox::Ok | QMessageBox::Default);
+		return;
+	}
+
 	Pair p = handler3D->get_pixelsize();
 	if (p.low != p.high)
 	{
@@ -1900,6 +1909,14 @@ void MainWindow::execute_swapxz()
 
 	emit end_datachange(this, iseg::ClearUndo);
 
+	if (!ok)
+	{
+		QMessageBox::warning(this, "iSeg",
+				"Error: Not enough memory to swap the axes.",
+				QMessageBox::Ok | QMessageBox::Default);
+		return;
+	}
+
 	Pair p = handler3D->get_pixelsize();
 	float thick = handler3D->get_slicethickness();
 	if (thick != p.high)
@@ -1959,6 +1976,14 @@ void MainWindow::execute_swapyz()
 
 	emit end_datachange(this, iseg::ClearUndo);
 
+	if (!ok)
+	{
+		QMessageBox::warning(this, "iSeg",
+				"Error: Not enough memory to swap the axes.",
+				QMessageBox::Ok | QMessageBox::Default);
+		return;
+	}
+
 	Pair p = handler3D->get_pixelsize();
 	float thick = handler3D->get_slicethickness();
 	if (thick != p.low)
@@ -1995,56 +2020,29 @@ void MainWindow::execute_resize(int resizetype)
 	int dxm, dxp, dym, dyp, dzm, dzp;
 	RD.return_padding(dxm, dxp, dym, dyp, dzm, dzp);
 
-	unsigned short w, h, nrslices;
-	w = handler3D->width();
-	h = handler3D->height();
-	nrslices = handler3D->num_slices();
-	QString str1;
-	bool ok = true;
-	str1 = QDir::temp().absFilePath(QString("bmp_float.raw"));
-	if (handler3D->SaveRaw_resized(str1.ascii(), dxm, dxp, dym, dyp, dzm, dzp,
-					false) != 0)
-		ok = false;
-	str1 = QDir::temp().absFilePath(QString("work_float.raw"));
-	if (handler3D->SaveRaw_resized(str1.ascii(), dxm, dxp, dym, dyp, dzm, dzp,
-					true) != 0)
-		ok = false;
-	str1 = QDir::temp().absFilePath(QString("tissues.raw"));
-	if (handler3D->SaveTissuesRaw_resized(str1.ascii(), dxm, dxp, dym, dyp, dzm,
-					dzp) != 0)
-		ok = false;
-
+	bool ok = handler3D->resize(dxm, dxp, dym, dyp, dzm, dzp);
 	if (ok)
 	{
-		str1 = QDir::temp().absFilePath(QString("work_float.raw"));
-		if (handler3D->ReadRawFloat(str1.ascii(), w + dxm + dxp, h + dym + dyp, 0,
-						nrslices + dzm + dzp) != 1)
-			ok = false;
-	}
-	if (ok)
-	{
-		str1 = QDir::temp().absFilePath(QString("bmp_float.raw"));
-		if (handler3D->ReloadRawFloat(str1.ascii(), 0) != 1)
-			ok = false;
-	}
-	if (ok)
-	{
-		str1 = QDir::temp().absFilePath(QString("tissues.raw"));
-		if (handler3D->ReloadRawTissues(str1.ascii(), sizeof(tissues_size_t) * 8, 0) != 1)
-		{
-			ok = false;
-		}
+		Transform tr = handler3D->transform();
+		int plo[3] = {dxm, dym, dzm};
+		tr.paddingUpdateTransform(plo, handler3D->spacing());
+		handler3D->set_transform(tr);
 	}
 
-	Transform tr = handler3D->transform();
-	int plo[3] = {dxm, dym, dzm};
-	tr.paddingUpdateTransform(plo, handler3D->spacing());
-	handler3D->set_transform(tr);
-
 	// add color lookup table again
 	handler3D->UpdateColorLookupTable(lut);
 
-	emit end_datachange(this, iseg::ClearUndo);
+	// the undo steps hold slices of the old size and cannot be restored
+	// after resizing, so they are dropped; a failed resize keeps them
+	emit end_datachange(this, ok ? iseg::ClearUndo : iseg::NoUndo);
+
+	if (!ok)
+	{
+		QMessageBox::warning(this, "iSeg",
+				"Error: Not enough memory to resize the volume.\nThe volume is unchanged.",
+				QMessageBox::Ok | QMessageBox::Default);
+		return;
+	}
 
 	clear_stack();
 }
@@ -7065,14 +7063,14 @@ void MainWindow::execute_remove_unused_tissues()
 
 void MainWindow::execute_cleanup()
 {
-	tissues_size_t** slices = new tissues_size_t*[handler3D->end_slice() - handler3D->start_slice()];
+	std::vector<tissues_size_t*> slices(handler3D->end_slice() - handler3D->start_slice());
 	tissuelayers_size_t activelayer = handler3D->active_tissuelayer();
 	for (unsigned short i = handler3D->start_slice(); i < handler3D->end_slice(); i++)
 	{
 		slices[i - handler3D->start_slice()] = handler3D->return_tissues(activelayer, i);
 	}
 	TissueCleaner TC(
-			slices, handler3D->end_slice() - handler3D->start_slice(),
+			slices.data(), handler3D->end_slice() - handler3D->start_slice(),
 			handler3D->width(), handler3D->height());
 	if (!TC.Allocate())
 	{
@@ -7263,6 +7261,9 @@ void MainWindow::handle_end_datachange(QWidget* sender, iseg::EndUndoAction undo
 	// End undo
 	end_undo_helper(undoAction);
 
+	// Notify listeners, e.g. surface viewer, about the modified slices
+	handler3D->on_data_modified(changeData);
+
 	// Handle 3d data change
 	if (changeData.allSlices)
 	{
@@ -637,7 +637,6 @@ void OutlineCorrectionWidget::execute_pushed()
 			{
 				if (mm_unit)
 				{
-					// \warning creates block shaped kernel, instead of ellipsoid
 					if (dataSelection.work)
 					{
 						float setto = handler3D->add_skin3D_outside2(rx, ry, rz);
@@ -683,7 +682,6 @@ void OutlineCorrectionWidget::execute_pushed()
 			{
 				if (mm_unit)
 				{
-					// \warning creates block shaped kernel, instead of ellipsoid
 					if (dataSelection.work)
 					{
 						float setto = handler3D->add_skin3D(rx, ry, rz);
@@ -303,7 +303,8 @@ void PickerWidget::copy_pressed()
 	}
 	else
 	{
-		auto tissues = bmphand->return_tissues(handler3D->active_tissuelayer());
+		const bmphandler* source = bmphand;
+		const tissues_size_t* tissues = source->return_tissues(handler3D->active_tissuelayer());
 		for (unsigned int i = 0; i < area; i++)
 		{
 			valuedistrib[i] = (float)tissues[i];
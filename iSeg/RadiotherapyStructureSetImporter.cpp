@@ -20,8 +20,20 @@
 #include <qstring.h>
 #include <qstringlist.h>
 
+#include <vector>
+
 namespace iseg {
 
+namespace {
+// contours of one structure which lie on the same slice
+struct SliceContours
+{
+	tissues_size_t tissuenr;
+	std::vector<float*> points;
+	unsigned int* nrpoints;
+};
+} // namespace
+
 RadiotherapyStructureSetImporter::RadiotherapyStructureSetImporter(QString loadfilename, SlicesHandler* hand3D, QWidget* parent, const char* name, Qt::WindowFlags wFlags)
 	: QDialog(parent, name, TRUE, wFlags), handler3D(hand3D)
 {
@@ -159,13 +171,6 @@ void RadiotherapyStructureSetImporter::ok_pressed()
 {
 	storeparams();
 
-	bool* mask = new bool[handler3D->return_area()];
-	if (mask == nullptr)
-	{
-		QMessageBox::about(this, "Warning", "Not enough memory");
-		return;
-	}
-
 	tissues_size_t nrnew = 0;
 	for (size_t i = 0; i < tissues.size(); i++)
 	{
@@ -201,14 +206,16 @@ void RadiotherapyStructureSetImporter::ok_pressed()
 	dataSelection.tissues = true;
 	emit begin_datachange(dataSelection, this);
 
-	bool error = false;
+	const int startSL = handler3D->start_slice();
+	const int endSL = handler3D->end_slice();
+	const float swap_z = dc[0] * dc[4];
+
+	// contours of each slice, in order of increasing priority
+	std::vector<std::vector<SliceContours>> slice_contours(endSL - startSL);
+
 	tissues_size_t tissuenr;
-	std::string namedummy;
 	for (int i = 1; i <= tissues.size(); i++) // i is priority
 	{
-		if (error)
-			break;
-
 		gdcmvtk_rtstruct::tissuevec::iterator it = tissues.begin();
 		int j = 0;
 		while (vecpriorities[j] != i) // j is tissue index, processed in order of priority
@@ -237,27 +244,22 @@ void RadiotherapyStructureSetImporter::ok_pressed()
 
 			size_t pospoints = 0;
 			size_t posoutlines = 0;
-			std::vector<float*> points;
-			bool clockwisefill = false;
 			while (posoutlines < rtstruct_i->outlinelength.size())
 			{
-				points.clear();
-				unsigned int* nrpoints = &(rtstruct_i->outlinelength[posoutlines]);
+				SliceContours contours;
+				contours.tissuenr = tissuenr;
+				contours.nrpoints = &(rtstruct_i->outlinelength[posoutlines]);
 				float zcoord = rtstruct_i->points[pospoints + 2];
-				points.push_back(&(rtstruct_i->points[pospoints]));
+				contours.points.push_back(&(rtstruct_i->points[pospoints]));
 				pospoints += rtstruct_i->outlinelength[posoutlines] * 3;
 				posoutlines++;
 				while (posoutlines < rtstruct_i->outlinelength.size() && zcoord == rtstruct_i->points[pospoints + 2])
 				{
-					points.push_back(&(rtstruct_i->points[pospoints]));
+					contours.points.push_back(&(rtstruct_i->points[pospoints]));
 					pospoints += rtstruct_i->outlinelength[posoutlines] * 3;
 					posoutlines++;
 				}
 
-				const int startSL = handler3D->start_slice();
-				const int endSL = handler3D->end_slice();
-
-				float swap_z = dc[0] * dc[4];
 				int slicenr = round(swap_z * (disp[2] - zcoord) / thick);
 
 				if (slicenr < 0 && swap_z > 0.f)
@@ -270,19 +272,7 @@ void RadiotherapyStructureSetImporter::ok_pressed()
 
 				if (slicenr >= startSL && slicenr < endSL)
 				{
-					try
-					{
-						fillcontours::fill_contour(mask, pixel_extents, disp,
-								pixel_size, dc, &(points[0]),
-								nrpoints, points.size(), clockwisefill);
-					}
-					catch (std::exception& e)
-					{
-						QMessageBox::warning(this, "An Exception Occurred", e.what());
-						error = true;
-						break;
-					}
-					handler3D->add2tissue(tissuenr, mask, static_cast<unsigned short>(slicenr), true);
+					slice_contours[slicenr - startSL].push_back(contours);
 				}
 				else
 				{
@@ -292,9 +282,53 @@ void RadiotherapyStructureSetImporter::ok_pressed()
 		}
 	}
 
+	// locked tissues are not overwritten
+	std::vector<bool> locked(TissueInfos::GetTissueCount() + 1, false);
+	for (tissues_size_t t = 1; t < locked.size(); t++)
+		locked[t] = TissueInfos::GetTissueLocked(t);
+
+	// rasterize the slices in parallel, all structures of a slice in one sweep,
+	// where higher priorities overwrite lower ones
+	std::string error;
+	const int nrslices = endSL - startSL;
+	const tissuelayers_size_t layer = handler3D->active_tissuelayer();
+#pragma omp parallel
+	{
+		fillcontours::ScanlineFiller filler;
+		std::vector<fillcontours::ScanlineFiller::Structure> structures;
+#pragma omp for schedule(dynamic)
+		for (int k = 0; k < nrslices; k++)
+		{
+			if (slice_contours[k].empty())
+				continue;
+
+			structures.clear();
+			for (auto& contours : slice_contours[k])
+			{
+				structures.push_back({contours.tissuenr, &(contours.points[0]), contours.nrpoints,
+						static_cast<unsigned int>(contours.points.size())});
+			}
+			try
+			{
+				filler.fill_labels(handler3D->return_tissues(layer, static_cast<unsigned short>(startSL + k)),
+						pixel_extents, disp, pixel_size, dc, structures, locked);
+			}
+			catch (std::exception& e)
+			{
+#pragma omp critical
+				{
+					error = e.what();
+				}
+			}
+		}
+	}
+
 	emit end_datachange(this);
 
-	delete[] mask;
+	if (!error.empty())
+	{
+		QMessageBox::warning(this, "An Exception Occurred", error.c_str());
+	}
 
 	close();
 }
@@ -14,6 +14,8 @@
 #include "StdStringToQString.h"
 #include "TissueInfos.h"
 
+#include "Interface/ProgressDialog.h"
+
 #include <qfiledialog.h>
 #include <q3hbox.h>
 #include <qlistwidget.h>
@@ -303,21 +305,30 @@ void SaveOutlinesWidget::save_pushed()
 				Pair pair1 = handler3D->get_pixelsize();
 				handler3D->set_pixelsize(pair1.high / 2, pair1.low / 2);
 				//				handler3D->extract_contours2(sb_minsize->value(), vtissues);
-				if (rb_dougpeuck->isChecked())
-				{
-					handler3D->extract_contours2_xmirrored(
-						sb_minsize->value(), vtissues, sl_f->value() * 0.05f);
-					//					handler3D->dougpeuck_line(sl_f->value()*0.05f*2);
-				}
-				else if (rb_dist->isChecked())
+				bool ok = true;
 				{
-					handler3D->extract_contours2_xmirrored(sb_minsize->value(),
-														   vtissues);
+					ProgressDialog progress("Extracting outlines ...", this);
+					if (rb_dougpeuck->isChecked())
+					{
+						ok = handler3D->extract_contours2_xmirrored(
+							sb_minsize->value(), vtissues, sl_f->value() * 0.05f, &progress);
+						//					handler3D->dougpeuck_line(sl_f->value()*0.05f*2);
+					}
+					else if (rb_dist->isChecked())
+					{
+						ok = handler3D->extract_contours2_xmirrored(sb_minsize->value(),
+																	vtissues, &progress);
+					}
+					else if (rb_none->isChecked())
+					{
+						ok = handler3D->extract_contours2_xmirrored(sb_minsize->value(),
+																	vtissues, &progress);
+					}
 				}
-				else if (rb_none->isChecked())
+				if (!ok)
 				{
-					handler3D->extract_contours2_xmirrored(sb_minsize->value(),
-														   vtissues);
+					handler3D->set_pixelsize(pair1.high, pair1.low);
+					return;
 				}
 				handler3D->shift_contours(-(int)handler3D->width(),
 										  -(int)handler3D->height());
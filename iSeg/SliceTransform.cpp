@@ -13,16 +13,14 @@
 #include "SlicesHandler.h"
 #include "bmp_read_1.h"
 
+#include <algorithm>
 #include <cmath>
+#include <vector>
 
 #ifndef M_PI
 #	define M_PI 3.1415926535
 #endif
 
-#ifndef round
-#	define round(x) (x < 0 ? ceil((x)-0.5) : floor((x) + 0.5))
-#endif
-
 namespace iseg {
 
 SliceTransform::SliceTransform(SlicesHandler* hand3D)
@@ -33,6 +31,7 @@ SliceTransform::SliceTransform(SlicesHandler* hand3D)
 	bmphand = handler3D->get_activebmphandler();
 
 	transformSource = transformTarget = transformTissues = true;
+	interpolation = SliceResampler::kNearest;
 
 	// Reallocate slice data
 	ReallocateSliceData();
@@ -160,39 +159,47 @@ void SliceTransform::Execute(bool allSlices)
 {
 	if (allSlices)
 	{
-		for (unsigned short slice = handler3D->start_slice();
-				 slice < handler3D->end_slice(); ++slice)
+		// the active slice has already been transformed, the others are transformed in parallel
+		SliceResampler resampler(transformMatrix, handler3D->width(), handler3D->height());
+		const unsigned area = handler3D->return_area();
+		const int startSlice = handler3D->start_slice();
+		const int endSlice = handler3D->end_slice();
+		const int active = activeSlice;
+		auto sources = handler3D->source_slices();
+		auto targets = handler3D->target_slices();
+		auto tissues = handler3D->tissue_slices(handler3D->active_tissuelayer());
+#pragma omp parallel
 		{
-			// Active slice has already been transformed
-			if (slice == activeSlice)
+			std::vector<float> bits(transformSource || transformTarget ? area : 0);
+			std::vector<tissues_size_t> labels(transformTissues ? area : 0);
+#pragma omp for
+			for (int slice = startSlice; slice < endSlice; ++slice)
 			{
-				continue;
+				if (slice == active)
+				{
+					continue;
+				}
+				if (transformSource)
+				{
+					std::copy(sources[slice], sources[slice] + area, bits.begin());
+					resampler.resample(bits.data(), sources[slice], interpolation);
+				}
+				if (transformTarget)
+				{
+					std::copy(targets[slice], targets[slice] + area, bits.begin());
+					resampler.resample(bits.data(), targets[slice], interpolation);
+				}
+				if (transformTissues)
+				{
+					std::copy(tissues[slice], tissues[slice] + area, labels.begin());
+					resampler.resample(labels.data(), tissues[slice]);
+				}
 			}
-
-			// Activate and get current slice
-			handler3D->set_active_slice(slice);
-			bmphand = handler3D->get_activebmphandler();
-
-			// Get copy of original slice data
-			CopyFromOriginalSlice(transformSource, transformTarget,
-					transformTissues);
-
-			// Apply transform
-			ApplyTransform(transformSource, transformTarget, transformTissues);
 		}
-
-		// Restore previously active slice
-		handler3D->set_active_slice(activeSlice);
-		bmphand = handler3D->get_activebmphandler();
-
-		// Reset transformation
-		Initialize();
-	}
-	else
-	{
-		// Reset transformation
-		Initialize();
 	}
+
+	// Reset transformation
+	Initialize();
 }
 
 void SliceTransform::Cancel()
@@ -494,111 +501,28 @@ void SliceTransform::SwapDataPointers()
 
 void SliceTransform::ApplyTransform(bool source, bool target, bool tissues)
 {
-	if (source && target && tissues)
+	// transformMatrix * original --> preview
+	SliceResampler resampler(transformMatrix, bmphand->return_width(), bmphand->return_height());
+	if (source)
 	{
-		// Faster version without if-statements in the loop
-		ApplyTransformAll();
-		return;
+		resampler.resample(originalSource, bmphand->return_bmp(), interpolation);
 	}
-
-	// transformMatrix * original --> preview
-	double a, b, c;
-	int xTr, yTr;
-	unsigned short width = bmphand->return_width();
-	unsigned short height = bmphand->return_height();
-	float* sourcePtr = bmphand->return_bmp();
-	float* targetPtr = bmphand->return_work();
-	tissues_size_t* tissuesPtr =
-			bmphand->return_tissues(handler3D->active_tissuelayer());
-	for (unsigned int y = 0; y < height; ++y)
-	{
-		for (unsigned int x = 0; x < width; ++x)
-		{
-			// Transform in homogeneous coordinates
-			a = transformMatrix[0] * x + transformMatrix[1] * y +
-					transformMatrix[2];
-			b = transformMatrix[3] * x + transformMatrix[4] * y +
-					transformMatrix[5];
-			c = transformMatrix[6] * x + transformMatrix[7] * y +
-					transformMatrix[8];
-
-			xTr = (int)round(a / c);
-			yTr = (int)round(b / c);
-			if (xTr >= 0 && yTr >= 0 && xTr < width && yTr < height)
-			{
-				if (source)
-				{
-					sourcePtr[y * width + x] =
-							originalSource[yTr * width + xTr];
-				}
-				if (target)
-				{
-					targetPtr[y * width + x] =
-							originalTarget[yTr * width + xTr];
-				}
-				if (tissues)
-				{
-					tissuesPtr[y * width + x] =
-							originalTissues[yTr * width + xTr];
-				}
-			}
-			else
-			{
-				if (source)
-				{
-					sourcePtr[y * width + x] = 0.0f;
-				}
-				if (target)
-				{
-					targetPtr[y * width + x] = 0.0f;
-				}
-				if (tissues)
-				{
-					tissuesPtr[y * width + x] = 0;
-				}
-			}
-		}
+	if (target)
+	{
+		resampler.resample(originalTarget, bmphand->return_work(), interpolation);
+	}
+	if (tissues)
+	{
+		resampler.resample(originalTissues, bmphand->return_tissues(handler3D->active_tissuelayer()));
 	}
 }
 
-void SliceTransform::ApplyTransformAll()
+void SliceTransform::SetInterpolation(SliceResampler::eInterpolation interp)
 {
-	// transformMatrix * original --> preview
-	double a, b, c;
-	int xTr, yTr;
-	unsigned short width = bmphand->return_width();
-	unsigned short height = bmphand->return_height();
-	float* sourcePtr = bmphand->return_bmp();
-	float* targetPtr = bmphand->return_work();
-	tissues_size_t* tissuesPtr =
-			bmphand->return_tissues(handler3D->active_tissuelayer());
-	for (unsigned int y = 0; y < height; ++y)
-	{
-		for (unsigned int x = 0; x < width; ++x)
-		{
-			// Transform in homogeneous coordinates
-			a = transformMatrix[0] * x + transformMatrix[1] * y +
-					transformMatrix[2];
-			b = transformMatrix[3] * x + transformMatrix[4] * y +
-					transformMatrix[5];
-			c = transformMatrix[6] * x + transformMatrix[7] * y +
-					transformMatrix[8];
-
-			xTr = (int)round(a / c);
-			yTr = (int)round(b / c);
-			if (xTr >= 0 && yTr >= 0 && xTr < width && yTr < height)
-			{
-				sourcePtr[y * width + x] = originalSource[yTr * width + xTr];
-				targetPtr[y * width + x] = originalTarget[yTr * width + xTr];
-				tissuesPtr[y * width + x] = originalTissues[yTr * width + xTr];
-			}
-			else
-			{
-				sourcePtr[y * width + x] = 0.0f;
-				targetPtr[y * width + x] = 0.0f;
-				tissuesPtr[y * width + x] = 0;
-			}
-		}
+	if (interpolation != interp)
+	{
+		interpolation = interp;
+		ApplyTransform(transformSource, transformTarget, false);
 	}
 }
 
@@ -11,6 +11,8 @@
 
 #include "Data/Types.h"
 
+#include "Core/SliceResampler.h"
+
 namespace iseg {
 
 class SlicesHandler;
@@ -42,6 +44,9 @@ public:
 	void Flip(bool flipXAxis, int axisPosition, bool apply = true);
 	void Matrix(double* inverseMatrix, bool apply = true);
 
+	/// interpolation of source and target, tissues always use nearest neighbor
+	void SetInterpolation(SliceResampler::eInterpolation interp);
+
 	bool GetIsIdentityTransform();
 
 private:
@@ -53,7 +58,6 @@ private:
 	void CopyToOriginalSlice(bool source, bool target, bool tissues);
 
 	void ApplyTransform(bool source, bool target, bool tissues);
-	void ApplyTransformAll();
 
 private:
 	// Image data
@@ -71,6 +75,7 @@ private:
 	bool transformSource;
 	bool transformTarget;
 	bool transformTissues;
+	SliceResampler::eInterpolation interpolation;
 };
 
 } // namespace iseg
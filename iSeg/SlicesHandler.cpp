@@ -33,8 +33,10 @@
 
 #include "Core/ColorLookupTable.h"
 #include "Core/ConnectedShapeBasedInterpolation.h"
+#include "Core/DistanceTransform.h"
 #include "Core/ExpectationMaximization.h"
 #include "Core/HDF5Writer.h"
+#include "Core/HysteresisThreshold.h"
 #include "Core/ImageForestingTransform.h"
 #include "Core/ImageReader.h"
 #include "Core/ImageWriter.h"
@@ -47,9 +49,11 @@
 #include "Core/RTDoseReader.h"
 #include "Core/RTDoseWriter.h"
 #include "Core/SliceProvider.h"
+#include "Core/SliceTranspose.h"
 #include "Core/SmoothSteps.h"
 #include "Core/Treaps.h"
 #include "Core/VoxelSurface.h"
+#include "Core/WatershedMergeTree.h"
 
 #include "vtkMyGDCMPolyDataReader.h"
 
@@ -73,15 +77,16 @@
 
 #include <boost/format.hpp>
 
-#include <qdir.h>
-#include <qfileinfo.h>
-#include <qmessagebox.h>
-#include <qprogressdialog.h>
+#include <limits>
 
-#ifndef NO_OPENMP_SUPPORT
+#ifdef _OPENMP
 #	include <omp.h>
 #endif
 
+#include <qdir.h>
+#include <qfileinfo.h>
+#include <qmessagebox.h>
+
 namespace iseg {
 
 namespace // PROJECT VERSION NUMBERS
@@ -116,6 +121,155 @@ struct posit
 	}
 };
 
+namespace {
+// Continues the exterior, which has been flood filled with set_to in each
+// slice, through the background (0) across the slices.
+template<typename T>
+void flood_exterior_3D(const std::vector<T*>& slices, unsigned short width,
+		unsigned area, T set_to)
+{
+	const unsigned short n = static_cast<unsigned short>(slices.size());
+	std::vector<posit> s;
+	posit p1;
+
+	for (unsigned short z = 0; z + 1 < n; z++)
+	{
+		for (unsigned i = 0; i < area; i++)
+		{
+			if (slices[z][i] == 0 && slices[z + 1][i] == set_to)
+			{
+				slices[z][i] = set_to;
+				p1.pxy = i;
+				p1.pz = z;
+				s.push_back(p1);
+			}
+			else if (slices[z][i] == set_to && slices[z + 1][i] == 0)
+			{
+				slices[z + 1][i] = set_to;
+				p1.pxy = i;
+				p1.pz = z + 1;
+				s.push_back(p1);
+			}
+		}
+	}
+
+	auto visit = [&](unsigned short z, unsigned i) {
+		if (slices[z][i] == 0)
+		{
+			slices[z][i] = set_to;
+			p1.pxy = i;
+			p1.pz = z;
+			s.push_back(p1);
+		}
+	};
+
+	while (!s.empty())
+	{
+		posit i = s.back();
+		s.pop_back();
+
+		if (i.pxy % width != 0)
+			visit(i.pz, i.pxy - 1);
+		if ((i.pxy + 1) % width != 0)
+			visit(i.pz, i.pxy + 1);
+		if (i.pxy >= width)
+			visit(i.pz, i.pxy - width);
+		if (i.pxy < area - width)
+			visit(i.pz, i.pxy + width);
+		if (i.pz > 0)
+			visit(i.pz - 1, i.pxy);
+		if (i.pz + 1 < n)
+			visit(i.pz + 1, i.pxy);
+	}
+}
+
+// Squared distance to the nearest voxel for which is_feature(slice, pos)
+// holds, measured in units of the radius along each axis, i.e. voxels
+// within the ellipsoid given by the radius have a distance <= 1.
+template<typename F>
+std::vector<std::vector<float>> scaled_distance2(unsigned short width,
+		unsigned short height, unsigned short nrslices, const float radius[3],
+		F is_feature)
+{
+	const unsigned area = unsigned(width) * height;
+	const float inf = std::numeric_limits<float>::infinity();
+
+	std::vector<std::vector<float>> dist(nrslices);
+	std::vector<float*> slices(nrslices);
+#pragma omp parallel for
+	for (int z = 0; z < nrslices; z++)
+	{
+		dist[z].resize(area);
+		slices[z] = dist[z].data();
+		for (unsigned i = 0; i < area; i++)
+		{
+			dist[z][i] = is_feature(z, i) ? 0.f : inf;
+		}
+	}
+
+	// a zero radius only allows distances within the same line/slice
+	float spacing[3];
+	for (int k = 0; k < 3; k++)
+	{
+		spacing[k] = radius[k] > 0 ? 1.f / radius[k] : 1e6f;
+	}
+	squared_distance_transform(slices, width, height, spacing);
+
+	return dist;
+}
+
+// tolerance for the scaled distance, so that voxels at exactly the radius are included
+float const skin_limit = 1.f + f_tol;
+
+// Moves the kept part of a slice into a width x height slice, where pixel
+// (x, y) goes to (x + dx, y + dy) and the new pixels are zero. A slice which
+// does not grow is rewritten in place via the scratch slice and shrunk, so
+// this only fails (leaving the slice unchanged) if a larger slice cannot be
+// allocated.
+template<typename T>
+bool resize_slice(T*& bits, int old_width, int old_height, int width, int height, int dx, int dy, T* scratch)
+{
+	const size_t old_area = static_cast<size_t>(old_width) * old_height;
+	const size_t area = static_cast<size_t>(width) * height;
+
+	const T* src = bits;
+	T* dst = bits;
+	if (area > old_area)
+	{
+		dst = static_cast<T*>(malloc(sizeof(T) * area));
+		if (dst == nullptr)
+			return false;
+	}
+	else
+	{
+		std::copy(bits, bits + old_area, scratch);
+		src = scratch;
+	}
+
+	std::fill(dst, dst + area, T(0));
+	const int x0 = std::max(0, -dx), x1 = std::min(old_width, width - dx);
+	const int y0 = std::max(0, -dy), y1 = std::min(old_height, height - dy);
+	for (int y = y0; y < y1 && x0 < x1; y++)
+	{
+		const T* row = src + static_cast<size_t>(y) * old_width + x0;
+		std::copy(row, row + (x1 - x0), dst + static_cast<size_t>(y + dy) * width + x0 + dx);
+	}
+
+	if (dst != bits)
+	{
+		free(bits);
+		bits = dst;
+	}
+	else if (area < old_area)
+	{
+		// if shrinking fails, the larger block is kept
+		if (T* shrunk = static_cast<T*>(realloc(bits, sizeof(T) * area)))
+			bits = shrunk;
+	}
+	return true;
+}
+} // namespace
+
 SlicesHandler::SlicesHandler()
 {
 	_activeslice = 0;
@@ -134,6 +288,18 @@ SlicesHandler::SlicesHandler()
 	_loaded = false;
 	_uelem = nullptr;
 	_undo3D = true;
+
+	// the writes through the tissue pointers are complete once the change is reported
+	on_data_modified.connect([this](const DataSelection& sel) {
+		if (!sel.tissues)
+			return;
+		const unsigned short begin = sel.allSlices ? 0 : sel.sliceNr;
+		const unsigned short end = sel.allSlices ? _nrslices : std::min<unsigned short>(sel.sliceNr + 1, _nrslices);
+		for (unsigned short z = begin; z < end; z++)
+		{
+			_image_slices[z].tissues_changed();
+		}
+	});
 }
 
 SlicesHandler::~SlicesHandler() { delete _tissue_hierachy; }
@@ -2230,7 +2396,7 @@ int SlicesHandler::SaveRaw(const char* filename, bool work)
 int SlicesHandler::SaveTissueRaw(const char* filename)
 {
 	FILE* fp;
-	tissues_size_t* bits_tmp;
+	const tissues_size_t* bits_tmp;
 
 	if ((fp = fopen(filename, "wb")) == nullptr)
 		return (-1);
@@ -2243,7 +2409,7 @@ int SlicesHandler::SaveTissueRaw(const char* filename)
 		unsigned char* ucharBuffer = new unsigned char[bitsize];
 		for (unsigned short j = 0; j < _nrslices; j++)
 		{
-			bits_tmp = _image_slices[j].return_tissues(_active_tissuelayer);
+			bits_tmp = const_slice(j).return_tissues(_active_tissuelayer);
 			for (unsigned int i = 0; i < bitsize; ++i)
 			{
 				ucharBuffer[i] = (unsigned char)bits_tmp[i];
@@ -2261,7 +2427,7 @@ int SlicesHandler::SaveTissueRaw(const char* filename)
 	{
 		for (unsigned short j = 0; j < _nrslices; j++)
 		{
-			bits_tmp = _image_slices[j].return_tissues(_active_tissuelayer);
+			bits_tmp = const_slice(j).return_tissues(_active_tissuelayer);
 			if (fwrite(bits_tmp, sizeof(tissues_size_t), bitsize, fp) <
 					(unsigned int)bitsize)
 			{
@@ -2482,8 +2648,8 @@ int SlicesHandler::SaveTissuesRaw_resized(const char* filename, int dxm,
 	for (unsigned short j = (unsigned short)std::max(0, -dzm);
 			 j < _nrslices - (unsigned short)std::max(0, -dzp); j++)
 	{
-		tissues_size_t* p_bits =
-				_image_slices[j].return_tissues(_active_tissuelayer);
+		const tissues_size_t* p_bits =
+				const_slice(j).return_tissues(_active_tissuelayer);
 		unsigned pos1, pos2;
 		pos1 = posstart1;
 		pos2 = posstart2;
@@ -2528,60 +2694,25 @@ bool SlicesHandler::SwapXY()
 {
 	auto lut = GetColorLookupTable();
 
-	unsigned short w, h, nrslices;
-	w = height();
-	h = width();
-	nrslices = num_slices();
-	QString str1;
-	bool ok = true;
-	unsigned char mode1 = get_activebmphandler()->return_mode(true);
-	unsigned char mode2 = get_activebmphandler()->return_mode(false);
-
-	str1 = QDir::temp().absFilePath(QString("bmp_float.raw"));
-	if (SaveRaw_xy_swapped(str1.ascii(), false) != 0)
-		ok = false;
-	str1 = QDir::temp().absFilePath(QString("work_float.raw"));
-	if (SaveRaw_xy_swapped(str1.ascii(), true) != 0)
-		ok = false;
-	str1 = QDir::temp().absFilePath(QString("tissues.raw"));
-	if (SaveTissuesRaw_xy_swapped(str1.ascii()) != 0)
-		ok = false;
+	bool ok = transpose_volume(0, 1);
 
 	if (ok)
 	{
-		str1 = QDir::temp().absFilePath(QString("work_float.raw"));
-		if (ReadRawFloat(str1.ascii(), w, h, 0, nrslices) != 1)
-			ok = false;
-		set_modeall(mode1, true);
-	}
-	if (ok)
-	{
-		str1 = QDir::temp().absFilePath(QString("bmp_float.raw"));
-		if (ReloadRawFloat(str1.ascii(), 0) != 1)
-			ok = false;
-		set_modeall(mode2, false);
-	}
-	if (ok)
-	{
-		str1 = QDir::temp().absFilePath(QString("tissues.raw"));
-		if (ReloadRawTissues(str1.ascii(), sizeof(tissues_size_t) * 8, 0) != 1)
-			ok = false;
+		// BL TODO direction cosines don't reflect full transform
+		float disp[3];
+		get_displacement(disp);
+		float dummy = disp[1];
+		disp[1] = disp[0];
+		disp[0] = dummy;
+		set_displacement(disp);
+		float dc[6];
+		get_direction_cosines(dc);
+		std::swap(dc[0], dc[3]);
+		std::swap(dc[1], dc[4]);
+		std::swap(dc[2], dc[5]);
+		set_direction_cosines(dc);
 	}
 
-	// BL TODO direction cosines don't reflect full transform
-	float disp[3];
-	get_displacement(disp);
-	float dummy = disp[1];
-	disp[1] = disp[0];
-	disp[0] = dummy;
-	set_displacement(disp);
-	float dc[6];
-	get_direction_cosines(dc);
-	std::swap(dc[0], dc[3]);
-	std::swap(dc[1], dc[4]);
-	std::swap(dc[2], dc[5]);
-	set_direction_cosines(dc);
-
 	// add color lookup table again
 	UpdateColorLookupTable(lut);
 
@@ -2594,132 +2725,329 @@ bool SlicesHandler::SwapYZ()
 {
 	auto lut = GetColorLookupTable();
 
-	unsigned short w, h, nrslices;
-	w = width();
-	h = num_slices();
-	nrslices = height();
-	QString str1;
-	bool ok = true;
-	str1 = QDir::temp().absFilePath(QString("bmp_float.raw"));
-	if (SaveRaw_yz_swapped(str1.ascii(), false) != 0)
-		ok = false;
-	str1 = QDir::temp().absFilePath(QString("work_float.raw"));
-	if (SaveRaw_yz_swapped(str1.ascii(), true) != 0)
-		ok = false;
-	str1 = QDir::temp().absFilePath(QString("tissues.raw"));
-	if (SaveTissuesRaw_yz_swapped(str1.ascii()) != 0)
-		ok = false;
+	bool ok = transpose_volume(1, 2);
 
 	if (ok)
 	{
-		str1 = QDir::temp().absFilePath(QString("work_float.raw"));
-		if (ReadRawFloat(str1.ascii(), w, h, 0, nrslices) != 1)
-			ok = false;
+		// BL TODO direction cosines don't reflect full transform
+		float disp[3];
+		get_displacement(disp);
+		float dummy = disp[2];
+		disp[2] = disp[1];
+		disp[1] = dummy;
+		set_displacement(disp);
+		float dc[6];
+		get_direction_cosines(dc);
+		float cross[3]; // direction cosines of z-axis (in image coordinate frame)
+		vtkMath::Cross(&dc[0], &dc[3], cross);
+		vtkMath::Normalize(cross);
+		for (unsigned short i = 0; i < 3; ++i)
+		{
+			dc[i + 3] = cross[i];
+		}
+		set_direction_cosines(dc);
 	}
+
+	// add color lookup table again
+	UpdateColorLookupTable(lut);
+
+	SliceProviderInstaller::getinst()->report();
+
+	return ok;
+}
+
+bool SlicesHandler::SwapXZ()
+{
+	auto lut = GetColorLookupTable();
+
+	bool ok = transpose_volume(0, 2);
+
 	if (ok)
 	{
-		str1 = QDir::temp().absFilePath(QString("bmp_float.raw"));
-		if (ReloadRawFloat(str1.ascii(), 0) != 1)
-			ok = false;
+		// BL TODO direction cosines don't reflect full transform
+		float disp[3];
+		get_displacement(disp);
+		float dummy = disp[2];
+		disp[2] = disp[0];
+		disp[0] = dummy;
+		set_displacement(disp);
+		float dc[6];
+		get_direction_cosines(dc);
+		float cross[3]; // direction cosines of z-axis (in image coordinate frame)
+		vtkMath::Cross(&dc[0], &dc[3], cross);
+		vtkMath::Normalize(cross);
+		for (unsigned short i = 0; i < 3; ++i)
+		{
+			dc[i] = cross[i];
+		}
+		set_direction_cosines(dc);
 	}
-	if (ok)
+
+	// add color lookup table again
+	UpdateColorLookupTable(lut);
+
+	SliceProviderInstaller::getinst()->report();
+
+	return ok;
+}
+
+void SlicesHandler::detach_slices(std::vector<float*>& bmp, std::vector<float*>& work, std::vector<tissues_size_t*>& tissues)
+{
+	// takes the buffers from the slices, which are released
+	bmp.resize(_nrslices);
+	work.resize(_nrslices);
+	tissues.resize(_nrslices);
+	for (unsigned short z = 0; z < _nrslices; z++)
 	{
-		str1 = QDir::temp().absFilePath(QString("tissues.raw"));
-		if (ReloadRawTissues(str1.ascii(), sizeof(tissues_size_t) * 8, 0) != 1)
-			ok = false;
+		bmp[z] = _image_slices[z].swap_bmp_pointer(nullptr);
+		work[z] = _image_slices[z].swap_work_pointer(nullptr);
+		tissues[z] = _image_slices[z].swap_tissues_pointer(0, nullptr);
+		_image_slices[z].freebmp();
 	}
+}
+
+void SlicesHandler::attach_slices(unsigned short w, unsigned short h, const std::vector<float*>& bmp, const std::vector<float*>& work, const std::vector<tissues_size_t*>& tissues, unsigned char mode1, unsigned char mode2)
+{
+	_activeslice = 0;
+	_active_tissuelayer = 0;
+	_width = w;
+	_height = h;
+	_area = _height * (unsigned int)_width;
+	_startslice = 0;
+	_endslice = _nrslices = static_cast<unsigned short>(bmp.size());
+	_os.set_sizenr(_nrslices);
 
-	// BL TODO direction cosines don't reflect full transform
-	float disp[3];
-	get_displacement(disp);
-	float dummy = disp[2];
-	disp[2] = disp[1];
-	disp[1] = dummy;
-	set_displacement(disp);
-	float dc[6];
-	get_direction_cosines(dc);
-	float cross[3]; // direction cosines of z-axis (in image coordinate frame)
-	vtkMath::Cross(&dc[0], &dc[3], cross);
-	vtkMath::Normalize(cross);
-	for (unsigned short i = 0; i < 3; ++i)
+	_image_slices.resize(_nrslices);
+	for (unsigned short z = 0; z < _nrslices; z++)
 	{
-		dc[i + 3] = cross[i];
+		_image_slices[z].newbmp(_width, _height, bmp[z], work[z], tissues[z]);
+		_image_slices[z].set_mode(mode1, true);
+		_image_slices[z].set_mode(mode2, false);
 	}
-	set_direction_cosines(dc);
 
-	// add color lookup table again
-	UpdateColorLookupTable(lut);
+	new_overlay();
 
-	SliceProviderInstaller::getinst()->report();
+	// Ranges
+	Pair dummy;
+	_slice_ranges.resize(_nrslices);
+	_slice_bmpranges.resize(_nrslices);
+	compute_range_mode1(&dummy);
+	compute_bmprange_mode1(&dummy);
 
-	return ok;
+	_loaded = true;
 }
 
-bool SlicesHandler::SwapXZ()
+bool SlicesHandler::transpose_volume(int axis1, int axis2)
 {
-	auto lut = GetColorLookupTable();
+	unsigned short dims[3] = {_width, _height, _nrslices};
+	std::swap(dims[axis1], dims[axis2]);
 
-	unsigned short w, h, nrslices;
-	w = num_slices();
-	h = height();
-	nrslices = width();
-	Pair p = get_pixelsize();
-	float thick = get_slicethickness();
-	QString str1;
-	bool ok = true;
-	str1 = QDir::temp().absFilePath(QString("bmp_float.raw"));
-	if (SaveRaw_xz_swapped(str1.ascii(), false) != 0)
-		ok = false;
-	str1 = QDir::temp().absFilePath(QString("work_float.raw"));
-	if (SaveRaw_xz_swapped(str1.ascii(), true) != 0)
-		ok = false;
-	str1 = QDir::temp().absFilePath(QString("tissues.raw"));
-	if (SaveTissuesRaw_xz_swapped(str1.ascii()) != 0)
-		ok = false;
+	unsigned char mode1 = get_activebmphandler()->return_mode(true);
+	unsigned char mode2 = get_activebmphandler()->return_mode(false);
 
-	if (ok)
+	// the buffers are reoriented in place and handed to the new slices
+	std::vector<float*> bmp, work;
+	std::vector<tissues_size_t*> tissues;
+	const unsigned short old_width = _width, old_height = _height;
+	detach_slices(bmp, work, tissues);
+
+	// swap_axes leaves a stack unchanged if it fails, so on failure the
+	// stacks which are already reoriented are turned back
+	int swapped = 0;
+	try
 	{
-		str1 = QDir::temp().absFilePath(QString("work_float.raw"));
-		if (ReadRawFloat(str1.ascii(), w, h, 0, nrslices) != 1)
-			ok = false;
+		swap_axes(bmp, old_width, old_height, axis1, axis2);
+		swapped++;
+		swap_axes(work, old_width, old_height, axis1, axis2);
+		swapped++;
+		swap_axes(tissues, old_width, old_height, axis1, axis2);
+		swapped++;
 	}
-	if (ok)
+	catch (std::bad_alloc&)
 	{
-		str1 = QDir::temp().absFilePath(QString("bmp_float.raw"));
-		if (ReloadRawFloat(str1.ascii(), 0) != 1)
-			ok = false;
+		try
+		{
+			if (swapped > 1)
+				swap_axes(work, dims[0], dims[1], axis1, axis2);
+			if (swapped > 0)
+				swap_axes(bmp, dims[0], dims[1], axis1, axis2);
+		}
+		catch (std::bad_alloc&)
+		{
+			// the stacks have different orientations and cannot be restored
+			ISEG_ERROR_MSG("out of memory while restoring volume after failed axis swap");
+			for (auto bits : bmp)
+				free(bits);
+			for (auto bits : work)
+				free(bits);
+			for (auto bits : tissues)
+				free(bits);
+			newbmp(old_width, old_height, static_cast<unsigned short>(tissues.size()));
+			return false;
+		}
+
+		attach_slices(old_width, old_height, bmp, work, tissues, mode1, mode2);
+		return false;
 	}
-	if (ok)
+
+	attach_slices(dims[0], dims[1], bmp, work, tissues, mode1, mode2);
+	return true;
+}
+
+bool SlicesHandler::resize(int dxm, int dxp, int dym, int dyp, int dzm, int dzp)
+{
+	const int w = _width + dxm + dxp;
+	const int h = _height + dym + dyp;
+	const int n = _nrslices + dzm + dzp;
+	if (w <= 0 || h <= 0 || n <= 0 || w > std::numeric_limits<unsigned short>::max() ||
+			h > std::numeric_limits<unsigned short>::max() || n > std::numeric_limits<unsigned short>::max())
+		return false;
+
+	unsigned char mode1 = get_activebmphandler()->return_mode(true);
+	unsigned char mode2 = get_activebmphandler()->return_mode(false);
+
+	const int old_width = _width;
+	const int old_height = _height;
+	const bool same_slices = (w == old_width && h == old_height && dxm == 0 && dym == 0);
+	const size_t area = static_cast<size_t>(w) * h;
+
+	std::vector<float*> old_bmp, old_work;
+	std::vector<tissues_size_t*> old_tissues;
+	detach_slices(old_bmp, old_work, old_tissues);
+	const int old_n = static_cast<int>(old_bmp.size());
+
+	// the added slices and one scratch slice per thread are allocated first,
+	// so the old slices are untouched if this fails
+	std::vector<float*> bmp(n, nullptr), work(n, nullptr);
+	std::vector<tissues_size_t*> tissues(n, nullptr);
+	bool ok = true;
+#pragma omp parallel for reduction(&& : ok)
+	for (int k = 0; k < n; k++)
+	{
+		const int z = k - dzm;
+		if (z >= 0 && z < old_n)
+			continue;
+
+		bmp[k] = static_cast<float*>(malloc(sizeof(float) * area));
+		work[k] = static_cast<float*>(malloc(sizeof(float) * area));
+		tissues[k] = static_cast<tissues_size_t*>(malloc(sizeof(tissues_size_t) * area));
+		ok = ok && bmp[k] != nullptr && work[k] != nullptr && tissues[k] != nullptr;
+		if (ok)
+		{
+			std::fill(bmp[k], bmp[k] + area, 0.f);
+			std::fill(work[k], work[k] + area, 0.f);
+			std::fill(tissues[k], tissues[k] + area, 0);
+		}
+	}
+
+#ifdef _OPENMP
+	const size_t threads = static_cast<size_t>(omp_get_max_threads());
+#else
+	const size_t threads = 1;
+#endif
+	const size_t scratch_area = std::max(area, static_cast<size_t>(old_width) * old_height);
+	std::vector<float> scratch;
+	std::vector<tissues_size_t> tissue_scratch;
+	if (ok && !same_slices)
 	{
-		str1 = QDir::temp().absFilePath(QString("tissues.raw"));
-		if (ReloadRawTissues(str1.ascii(), sizeof(tissues_size_t) * 8, 0) != 1)
+		try
+		{
+			scratch.resize(threads * scratch_area);
+			tissue_scratch.resize(threads * scratch_area);
+		}
+		catch (std::bad_alloc&)
+		{
 			ok = false;
+		}
 	}
 
-	// BL TODO direction cosines don't reflect full transform
-	float disp[3];
-	get_displacement(disp);
-	float dummy = disp[2];
-	disp[2] = disp[0];
-	disp[0] = dummy;
-	set_displacement(disp);
-	float dc[6];
-	get_direction_cosines(dc);
-	float cross[3]; // direction cosines of z-axis (in image coordinate frame)
-	vtkMath::Cross(&dc[0], &dc[3], cross);
-	vtkMath::Normalize(cross);
-	for (unsigned short i = 0; i < 3; ++i)
+	// The kept slices are resized one by one, so at most one new slice per
+	// thread is allocated in addition to the volume. If the slices grow and an
+	// allocation fails, the resized slices are shrunk back, which cannot fail.
+	std::vector<unsigned char> resized(old_n, 0);
+	if (ok && !same_slices)
 	{
-		dc[i] = cross[i];
+#pragma omp parallel for schedule(dynamic) reduction(&& : ok)
+		for (int z = 0; z < old_n; z++)
+		{
+			const int k = z + dzm;
+			if (k < 0 || k >= n)
+				continue;
+
+#ifdef _OPENMP
+			const size_t offset = omp_get_thread_num() * scratch_area;
+#else
+			const size_t offset = 0;
+#endif
+			float* s = scratch.data() + offset;
+			tissues_size_t* ts = tissue_scratch.data() + offset;
+			bool done = resize_slice(old_bmp[z], old_width, old_height, w, h, dxm, dym, s);
+			if (done && !resize_slice(old_work[z], old_width, old_height, w, h, dxm, dym, s))
+			{
+				resize_slice(old_bmp[z], w, h, old_width, old_height, -dxm, -dym, s);
+				done = false;
+			}
+			if (done && !resize_slice(old_tissues[z], old_width, old_height, w, h, dxm, dym, ts))
+			{
+				resize_slice(old_bmp[z], w, h, old_width, old_height, -dxm, -dym, s);
+				resize_slice(old_work[z], w, h, old_width, old_height, -dxm, -dym, s);
+				done = false;
+			}
+			resized[z] = done;
+			ok = ok && done;
+		}
+
+		if (!ok)
+		{
+#pragma omp parallel for
+			for (int z = 0; z < old_n; z++)
+			{
+				if (!resized[z])
+					continue;
+#ifdef _OPENMP
+				const size_t offset = omp_get_thread_num() * scratch_area;
+#else
+				const size_t offset = 0;
+#endif
+				resize_slice(old_bmp[z], w, h, old_width, old_height, -dxm, -dym, scratch.data() + offset);
+				resize_slice(old_work[z], w, h, old_width, old_height, -dxm, -dym, scratch.data() + offset);
+				resize_slice(old_tissues[z], w, h, old_width, old_height, -dxm, -dym, tissue_scratch.data() + offset);
+			}
+		}
 	}
-	set_direction_cosines(dc);
 
-	// add color lookup table again
-	UpdateColorLookupTable(lut);
+	if (!ok)
+	{
+		for (int k = 0; k < n; k++)
+		{
+			free(bmp[k]);
+			free(work[k]);
+			free(tissues[k]);
+		}
+		attach_slices(old_width, old_height, old_bmp, old_work, old_tissues, mode1, mode2);
+		return false;
+	}
 
-	SliceProviderInstaller::getinst()->report();
+	// the kept slices are moved, the cropped ones are freed
+	for (int z = 0; z < old_n; z++)
+	{
+		const int k = z + dzm;
+		if (k >= 0 && k < n)
+		{
+			bmp[k] = old_bmp[z];
+			work[k] = old_work[z];
+			tissues[k] = old_tissues[z];
+		}
+		else
+		{
+			free(old_bmp[z]);
+			free(old_work[z]);
+			free(old_tissues[z]);
+		}
+	}
 
-	return ok;
+	attach_slices(w, h, bmp, work, tissues, mode1, mode2);
+	return true;
 }
 
 int SlicesHandler::SaveRaw_xy_swapped(const char* filename, bool work)
@@ -3010,7 +3338,7 @@ int SlicesHandler::SaveRaw_yz_swapped(const char* filename,
 int SlicesHandler::SaveTissuesRaw(const char* filename)
 {
 	FILE* fp;
-	tissues_size_t* bits_tmp;
+	const tissues_size_t* bits_tmp;
 	//float *p_bits;
 
 	if ((fp = fopen(filename, "wb")) == nullptr)
@@ -3020,7 +3348,7 @@ int SlicesHandler::SaveTissuesRaw(const char* filename)
 
 	for (unsigned short j = 0; j < _nrslices; j++)
 	{
-		bits_tmp = _image_slices[j].return_tissues(_active_tissuelayer);
+		bits_tmp = const_slice(j).return_tissues(_active_tissuelayer);
 		if (fwrite(bits_tmp, sizeof(tissues_size_t), bitsize, fp) <
 				(unsigned int)bitsize)
 		{
@@ -3037,7 +3365,7 @@ int SlicesHandler::SaveTissuesRaw_xy_swapped(const char* filename)
 {
 	FILE* fp;
 	tissues_size_t* bits_tmp;
-	tissues_size_t* p_bits;
+	const tissues_size_t* p_bits;
 
 	bits_tmp = (tissues_size_t*)malloc(sizeof(tissues_size_t) * _area);
 	if (bits_tmp == nullptr)
@@ -3050,7 +3378,7 @@ int SlicesHandler::SaveTissuesRaw_xy_swapped(const char* filename)
 
 	for (unsigned short j = 0; j < _nrslices; j++)
 	{
-		p_bits = _image_slices[j].return_tissues(_active_tissuelayer); // TODO
+		p_bits = const_slice(j).return_tissues(_active_tissuelayer); // TODO
 		unsigned pos1, pos2;
 		pos1 = 0;
 		for (unsigned short y = 0; y < _height; y++)
@@ -3081,7 +3409,7 @@ int SlicesHandler::SaveTissuesRaw_xz_swapped(const char* filename)
 {
 	FILE* fp;
 	tissues_size_t* bits_tmp;
-	tissues_size_t* p_bits;
+	const tissues_size_t* p_bits;
 
 	unsigned int bitsize = _nrslices * (unsigned)_height;
 	bits_tmp = (tissues_size_t*)malloc(sizeof(tissues_size_t) * bitsize);
@@ -3098,7 +3426,7 @@ int SlicesHandler::SaveTissuesRaw_xz_swapped(const char* filename)
 		for (unsigned short z = 0; z < _nrslices; z++)
 		{
 			p_bits =
-					(_image_slices[z]).return_tissues(_active_tissuelayer); // TODO
+					const_slice(z).return_tissues(_active_tissuelayer); // TODO
 			pos2 = z;
 			pos1 = x;
 			for (unsigned short y = 0; y < _height; y++)
@@ -3126,7 +3454,7 @@ int SlicesHandler::SaveTissuesRaw_yz_swapped(const char* filename)
 {
 	FILE* fp;
 	tissues_size_t* bits_tmp;
-	tissues_size_t* p_bits;
+	const tissues_size_t* p_bits;
 
 	unsigned int bitsize = _nrslices * (unsigned)_width;
 	bits_tmp = (tissues_size_t*)malloc(sizeof(tissues_size_t) * bitsize);
@@ -3143,7 +3471,7 @@ int SlicesHandler::SaveTissuesRaw_yz_swapped(const char* filename)
 		for (unsigned short z = 0; z < _nrslices; z++)
 		{
 			p_bits =
-					(_image_slices[z]).return_tissues(_active_tissuelayer); // TODO
+					const_slice(z).return_tissues(_active_tissuelayer); // TODO
 			pos2 = z * _width;
 			pos1 = y * _width;
 			for (unsigned short x = 0; x < _width; x++)
@@ -3667,7 +3995,7 @@ bool SlicesHandler::value_at_boundary3D(float value)
 bool SlicesHandler::tissuevalue_at_boundary3D(tissues_size_t value)
 {
 	// Top
-	tissues_size_t* tmp = &(_image_slices[_startslice].return_tissues(_active_tissuelayer)[0]);
+	const tissues_size_t* tmp = &(const_slice(_startslice).return_tissues(_active_tissuelayer)[0]);
 	for (unsigned pos = 0; pos < _area; pos++, tmp++)
 	{
 		if (*tmp == value)
@@ -3687,7 +4015,7 @@ bool SlicesHandler::tissuevalue_at_boundary3D(tissues_size_t value)
 	}
 
 	// Bottom
-	tmp = &(_image_slices[_endslice - 1].return_tissues(_active_tissuelayer)[0]);
+	tmp = &(const_slice(_endslice - 1).return_tissues(_active_tissuelayer)[0]);
 	for (unsigned pos = 0; pos < _area; pos++, tmp++)
 	{
 		if (*tmp == value)
@@ -4225,86 +4553,80 @@ void SlicesHandler::extractinterpolatesave_contours2_xmirrored(
 	fclose(fp);
 }
 
-void SlicesHandler::extract_contours(int minsize, std::vector<tissues_size_t>& tissuevec)
+bool SlicesHandler::trace_contours(const std::vector<tissues_size_t>& tissuevec, ProgressInfo* progress,
+		const std::function<void(unsigned short, tissues_size_t, std::vector<std::vector<Point>>*, std::vector<std::vector<Point>>*)>& trace)
 {
 	_os.clear();
-	std::vector<std::vector<Point>> v1, v2;
-	std::vector<Point_type> vP;
+	build_tissue_indices(0, _nrslices);
+
+	// each slice only adds lines to its own outline slice, and per slice the
+	// tissues are traced in the order given, so the result does not depend on
+	// the number of threads. Progress and cancel are handled between blocks.
+	int const block = 64;
+	int const iN = _nrslices;
+	if (progress)
+		progress->setNumberOfSteps(iN);
 
-	for (std::vector<tissues_size_t>::iterator it1 = tissuevec.begin();
-			 it1 != tissuevec.end(); it1++)
+	for (int start = 0; start < iN; start += block)
 	{
-		for (unsigned short i = 0; i < _nrslices; i++)
+		int const stop = std::min(start + block, iN);
+#pragma omp parallel for schedule(dynamic)
+		for (int i = start; i < stop; i++)
 		{
-			v1.clear();
-			v2.clear();
-			_image_slices[i]
-					.get_tissuecontours(_active_tissuelayer, *it1, &v1, &v2,
-							minsize);
-			for (std::vector<std::vector<Point>>::iterator it = v1.begin();
-					 it != v1.end(); it++)
-			{
-				//			Pointconvert(*it,vP);
-				//			os.add_line(i,tissuetype,&vP,true);
-				_os.add_line(i, *it1, &(*it), true);
-			}
-			for (std::vector<std::vector<Point>>::iterator it = v2.begin();
-					 it != v2.end(); it++)
+			const TissueIndex& index = _image_slices[i].return_tissueindex(_active_tissuelayer);
+			std::vector<std::vector<Point>> v1, v2;
+			for (auto tissue_label : tissuevec)
 			{
-				//			Pointconvert(*it,vP);
-				//			os.add_line(i,tissuetype,&vP,false);
-				_os.add_line(i, *it1, &(*it), false);
+				// nothing to trace for tissues which are not in the slice
+				if (!index.contains(tissue_label))
+					continue;
+
+				v1.clear();
+				v2.clear();
+				trace(i, tissue_label, &v1, &v2);
+				for (auto& line : v1)
+				{
+					_os.add_line(i, tissue_label, &line, true);
+				}
+				for (auto& line : v2)
+				{
+					_os.add_line(i, tissue_label, &line, false);
+				}
 			}
 		}
-	}
-}
-
-void SlicesHandler::extract_contours2_xmirrored(int minsize, std::vector<tissues_size_t>& tissuevec)
-{
-	_os.clear();
-	std::vector<std::vector<Point>> v1, v2;
 
-	for (auto tissue_label : tissuevec)
-	{
-		for (unsigned short i = 0; i < _nrslices; i++)
+		if (progress)
 		{
-			v1.clear();
-			v2.clear();
-			_image_slices[i].get_tissuecontours2_xmirrored(_active_tissuelayer, tissue_label, &v1, &v2, minsize);
-			for (auto& line : v1)
+			progress->setValue(stop);
+			if (progress->wasCanceled())
 			{
-				_os.add_line(i, tissue_label, &line, true);
-			}
-			for (auto& line : v2)
-			{
-				_os.add_line(i, tissue_label, &line, false);
+				_os.clear();
+				return false;
 			}
 		}
 	}
+	return true;
 }
 
-void SlicesHandler::extract_contours2_xmirrored(int minsize, std::vector<tissues_size_t>& tissuevec, float epsilon)
+bool SlicesHandler::extract_contours(int minsize, std::vector<tissues_size_t>& tissuevec, ProgressInfo* progress)
 {
-	_os.clear();
-	std::vector<std::vector<Point>> v1, v2;
+	return trace_contours(tissuevec, progress, [this, minsize](unsigned short i, tissues_size_t tissue_label, std::vector<std::vector<Point>>* v1, std::vector<std::vector<Point>>* v2) {
+		_image_slices[i].get_tissuecontours(_active_tissuelayer, tissue_label, v1, v2, minsize);
+	});
+}
 
-	for (auto tissue_label : tissuevec)
-	{
-		for (unsigned short i = 0; i < _nrslices; i++)
-		{
-			v1.clear();
-			v2.clear();
-			_image_slices[i].get_tissuecontours2_xmirrored(_active_tissuelayer, tissue_label, &v1, &v2, minsize, epsilon);
-			for (auto& line : v1)
-			{
-				_os.add_line(i, tissue_label, &line, true);
-			}
-			for (auto& line : v2)
-			{
-				_os.add_line(i, tissue_label, &line, false);
-			}
-		}
-	}
+bool SlicesHandler::extract_contours2_xmirrored(int minsize, std::vector<tissues_size_t>& tissuevec, ProgressInfo* progress)
+{
+	return trace_contours(tissuevec, progress, [this, minsize](unsigned short i, tissues_size_t tissue_label, std::vector<std::vector<Point>>* v1, std::vector<std::vector<Point>>* v2) {
+		_image_slices[i].get_tissuecontours2_xmirrored(_active_tissuelayer, tissue_label, v1, v2, minsize);
+	});
+}
+
+bool SlicesHandler::extract_contours2_xmirrored(int minsize, std::vector<tissues_size_t>& tissuevec, float epsilon, ProgressInfo* progress)
+{
+	return trace_contours(tissuevec, progress, [this, minsize, epsilon](unsigned short i, tissues_size_t tissue_label, std::vector<std::vector<Point>>* v1, std::vector<std::vector<Point>>* v2) {
+		_image_slices[i].get_tissuecontours2_xmirrored(_active_tissuelayer, tissue_label, v1, v2, minsize, epsilon);
+	});
 }
 
 void SlicesHandler::bmp_sum()
@@ -4668,42 +4990,35 @@ void SlicesHandler::dougpeuck_line(float epsilon)
 	_os.doug_peuck(epsilon, true);
 }
 
-void SlicesHandler::hysteretic(float thresh_low, float thresh_high, bool connectivity, unsigned short nrpasses)
+void SlicesHandler::hysteresis(float seed_low, float seed_high,
+		float grow_low, float grow_high,
+		bool connectivity, bool grow_across_slices,
+		float set_to)
 {
-	float setvalue = 255;
-	unsigned short slicenr = _startslice;
+	std::vector<const float*> source;
+	std::vector<float*> target;
+	for (unsigned short i = _startslice; i < _endslice; i++)
+	{
+		source.push_back(_image_slices[i].return_bmp());
+		target.push_back(_image_slices[i].return_work());
+	}
 
-	clear_work();
+	HysteresisThreshold engine(seed_low, seed_high, grow_low, grow_high);
+	engine.set_connectivity(connectivity);
+	engine.set_grow_across_slices(grow_across_slices);
+	engine.execute(source, target, _width, _height, set_to);
 
-	_image_slices[slicenr].hysteretic(thresh_low, thresh_high, connectivity,
-			setvalue);
-	for (unsigned short i = 0; i < nrpasses; i++)
+	for (unsigned short i = _startslice; i < _endslice; i++)
 	{
-		while (++slicenr < _endslice)
-		{
-			_image_slices[slicenr].hysteretic(
-					thresh_low, thresh_high, connectivity,
-					_image_slices[slicenr - 1].return_work(), setvalue - 1,
-					setvalue);
-		}
-		setvalue++;
-		slicenr--;
-		while (slicenr-- > _startslice)
-		{
-			_image_slices[slicenr].hysteretic(
-					thresh_low, thresh_high, connectivity,
-					_image_slices[slicenr + 1].return_work(), setvalue - 1,
-					setvalue);
-		}
-		setvalue++;
-		slicenr = _startslice;
+		_image_slices[i].set_mode(2, false);
 	}
+}
 
-	float thresh[2];
-	thresh[0] = 1;
-	thresh[1] = 255 - f_tol;
-	swap_bmpworkall();
-	threshold(thresh);
+void SlicesHandler::hysteretic(float thresh_low, float thresh_high, bool connectivity, unsigned short nrpasses)
+{
+	// the growth is done in 3D, the passes up and down the stack are not needed anymore
+	const float inf = std::numeric_limits<float>::infinity();
+	hysteresis(thresh_high, inf, thresh_low, inf, connectivity, true, 255.f);
 }
 
 void SlicesHandler::thresholded_growing(short unsigned slicenr, Point p,
@@ -5117,45 +5432,9 @@ void SlicesHandler::double_hysteretic(float thresh_low_l, float thresh_low_h,
 		bool connectivity,
 		unsigned short nrpasses)
 {
-	float setvalue = 255;
-	unsigned short slicenr = _startslice;
-
-	clear_work();
-
-	_image_slices[slicenr].double_hysteretic(thresh_low_l, thresh_low_h,
-			thresh_high_l, thresh_high_h,
-			connectivity, setvalue);
-	//	if(nrslices>1) {
-	for (unsigned short i = 0; i < nrpasses; i++)
-	{
-		while (++slicenr < _endslice)
-		{
-			_image_slices[slicenr].double_hysteretic(
-					thresh_low_l, thresh_low_h, thresh_high_l, thresh_high_h,
-					connectivity, _image_slices[slicenr - 1].return_work(),
-					setvalue - 1, setvalue);
-		}
-		setvalue++;
-		slicenr--;
-		while (slicenr-- > _startslice)
-		{
-			_image_slices[slicenr].double_hysteretic(
-					thresh_low_l, thresh_low_h, thresh_high_l, thresh_high_h,
-					connectivity, _image_slices[slicenr + 1].return_work(),
-					setvalue - 1, setvalue);
-		}
-		setvalue++;
-		slicenr = 0;
-	}
-	//	}
-
-	float thresh[2];
-	thresh[0] = 1;
-	thresh[1] = 255 - f_tol;
-	swap_bmpworkall();
-	threshold(thresh);
-
-	//xxxa again. what happens to bmp? and what should we do with mode?
+	// the growth is done in 3D, the passes up and down the stack are not needed anymore
+	hysteresis(thresh_low_h, thresh_high_l, thresh_low_l, thresh_high_h,
+			connectivity, true, 255.f);
 }
 
 void SlicesHandler::double_hysteretic_allslices(float thresh_low_l,
@@ -5164,10 +5443,8 @@ void SlicesHandler::double_hysteretic_allslices(float thresh_low_l,
 		float thresh_high_h,
 		bool connectivity, float set_to)
 {
-	for (unsigned short i = _startslice; i < _endslice; i++)
-	{
-		_image_slices[i].double_hysteretic(thresh_low_l, thresh_low_h, thresh_high_l, thresh_high_h, connectivity, set_to);
-	}
+	hysteresis(thresh_low_h, thresh_high_l, thresh_low_l, thresh_high_h,
+			connectivity, false, set_to);
 }
 
 void SlicesHandler::interpolateworkgrey(unsigned short slice1, unsigned short slice2, bool connected)
@@ -5904,8 +6181,8 @@ void SlicesHandler::interpolatetissue(unsigned short slice1, unsigned short slic
 			bmp2[i] = (float)tissue2[i];
 		}
 
-		_image_slices[slice2].dead_reckoning((float)tissuetype);
-		_image_slices[slice1].dead_reckoning((float)tissuetype);
+		free(_image_slices[slice2].dead_reckoning((float)tissuetype));
+		free(_image_slices[slice1].dead_reckoning((float)tissuetype));
 
 		bmp1 = _image_slices[slice1].return_work();
 		bmp2 = _image_slices[slice2].return_work();
@@ -6020,8 +6297,8 @@ void SlicesHandler::extrapolatetissue(unsigned short origin1,
 		bmp2[i] = (float)tissue2[i];
 	}
 
-	_image_slices[origin1].dead_reckoning((float)tissuetype);
-	_image_slices[origin2].dead_reckoning((float)tissuetype);
+	free(_image_slices[origin1].dead_reckoning((float)tissuetype));
+	free(_image_slices[origin2].dead_reckoning((float)tissuetype));
 
 	bmp1 = _image_slices[origin1].return_work();
 	bmp2 = _image_slices[origin2].return_work();
@@ -6092,8 +6369,8 @@ void SlicesHandler::interpolatework(unsigned short slice1,
 			bmp2[i] = 0.0f;
 	}
 
-	_image_slices[slice2].dead_reckoning(255.0f);
-	_image_slices[slice1].dead_reckoning(255.0f);
+	free(_image_slices[slice2].dead_reckoning(255.0f));
+	free(_image_slices[slice1].dead_reckoning(255.0f));
 
 	bmp1 = _image_slices[slice1].return_work();
 	bmp2 = _image_slices[slice2].return_work();
@@ -6176,8 +6453,8 @@ void SlicesHandler::extrapolatework(unsigned short origin1,
 			bmp2[i] = 0.0f;
 	}
 
-	_image_slices[origin2].dead_reckoning(255.0f);
-	_image_slices[origin1].dead_reckoning(255.0f);
+	free(_image_slices[origin2].dead_reckoning(255.0f));
+	free(_image_slices[origin1].dead_reckoning(255.0f));
 
 	bmp1 = _image_slices[origin1].return_work();
 	bmp2 = _image_slices[origin2].return_work();
@@ -6470,11 +6747,11 @@ void SlicesHandler::slicetissue_x(tissues_size_t* return_bits,
 		unsigned short xcoord)
 {
 	unsigned n = 0;
-	tissues_size_t* dummy;
+	const tissues_size_t* dummy;
 
 	for (unsigned short i = 0; i < _nrslices; i++)
 	{
-		dummy = _image_slices[i].return_tissues(_active_tissuelayer);
+		dummy = const_slice(i).return_tissues(_active_tissuelayer);
 		for (unsigned short j = 0; j < _height; j++)
 		{
 			return_bits[n] = dummy[j * _width + xcoord];
@@ -6488,11 +6765,11 @@ void SlicesHandler::slicetissue_y(tissues_size_t* return_bits,
 		unsigned short ycoord)
 {
 	unsigned n = 0;
-	tissues_size_t* dummy;
+	const tissues_size_t* dummy;
 
 	for (unsigned short i = 0; i < _nrslices; i++)
 	{
-		dummy = _image_slices[i].return_tissues(_active_tissuelayer);
+		dummy = const_slice(i).return_tissues(_active_tissuelayer);
 		for (unsigned short j = 0; j < _width; j++)
 		{
 			return_bits[n] = dummy[j + ycoord * _width];
@@ -7100,9 +7377,9 @@ void SlicesHandler::getstack_tissue(unsigned int slice, unsigned i,
 			override);
 }
 
-float* SlicesHandler::getstack(unsigned i, unsigned char& mode)
+bool SlicesHandler::getstack(unsigned i, float* bits, unsigned char& mode)
 {
-	return get_activebmphandler()->getstack(i, mode);
+	return get_activebmphandler()->getstack(i, bits, mode);
 }
 
 void SlicesHandler::popstack_bmp() { get_activebmphandler()->popstack_bmp(); }
@@ -7421,6 +7698,7 @@ iseg::DataSelection SlicesHandler::undo()
 
 				_uelem = nullptr;
 
+				on_data_modified(dataSelection);
 				return dataSelection;
 			}
 			else
@@ -7501,6 +7779,7 @@ iseg::DataSelection SlicesHandler::undo()
 
 				_uelem = nullptr;
 
+				on_data_modified(dataSelection);
 				return dataSelection;
 			}
 			else
@@ -7589,6 +7868,7 @@ iseg::DataSelection SlicesHandler::redo()
 
 				_uelem = nullptr;
 
+				on_data_modified(dataSelection);
 				return dataSelection;
 			}
 			else
@@ -7669,6 +7949,7 @@ iseg::DataSelection SlicesHandler::redo()
 
 				_uelem = nullptr;
 
+				on_data_modified(dataSelection);
 				return dataSelection;
 			}
 			else
@@ -8269,16 +8550,28 @@ void SlicesHandler::buildmissingtissues(tissues_size_t j)
 	}
 }
 
+void SlicesHandler::build_tissue_indices(unsigned short startslice, unsigned short endslice) const
+{
+	int const iN = endslice;
+
+#pragma omp parallel for
+	for (int i = startslice; i < iN; i++)
+	{
+		_image_slices[i].return_tissueindex(_active_tissuelayer);
+	}
+}
+
 std::vector<tissues_size_t> SlicesHandler::find_unused_tissues()
 {
 	std::vector<unsigned char> is_used(TissueInfos::GetTissueCount() + 1, 0);
 
+	build_tissue_indices(0, _nrslices);
 	for (int i = 0, iN = _nrslices; i < iN; i++)
 	{
-		auto tissues = _image_slices[i].return_tissues(_active_tissuelayer);
-		for (unsigned k = 0; k < _area; ++k)
+		for (auto t : _image_slices[i].return_tissueindex(_active_tissuelayer).tissues())
 		{
-			is_used[tissues[k]] = 1;
+			if (t < is_used.size())
+				is_used[t] = 1;
 		}
 	}
 
@@ -8372,7 +8665,7 @@ bool SlicesHandler::print_atlas(const char* filename)
 		out.writeRawData((char*)_image_slices[i].return_bmp(),
 				(int)_area * sizeof(float));
 		out.writeRawData(
-				(char*)_image_slices[i].return_tissues(_active_tissuelayer),
+				(const char*)const_slice(i).return_tissues(_active_tissuelayer),
 				(int)_area * sizeof(tissues_size_t));
 	}
 
@@ -8637,6 +8930,7 @@ bool SlicesHandler::get_extent(tissues_size_t tissuenr, bool onlyactiveslices,
 		startslice1 = _startslice;
 		endslice1 = _endslice;
 	}
+	build_tissue_indices(startslice1, endslice1);
 	for (unsigned short i = startslice1; i < endslice1; i++)
 	{
 		if (!found)
@@ -8676,2250 +8970,346 @@ bool SlicesHandler::get_extent(tissues_size_t tissuenr, bool onlyactiveslices,
 
 void SlicesHandler::add_skin3D(int ix, int iy, int iz, float setto)
 {
-	// ix,iy,iz are in pixels
+	// ix,iy,iz are in pixels, the skin is the tissue within this (ellipsoidal) distance of the background
+	const float radius[3] = {float(ix), float(iy), float(iz)};
+	const int n = _endslice - _startslice;
 
-	//Create skin in each slice as same way is done in the 2D AddSkin process
-	for (unsigned short z = _startslice; z < _endslice; z++)
-	{
-		float* work;
-		work = _image_slices[z].return_work();
-		unsigned i = 0, pos, y, x;
+	auto dist = scaled_distance2(_width, _height, n, radius, [this](int z, unsigned i) {
+		return _image_slices[_startslice + z].return_work()[i] == 0;
+	});
 
-		//Create a binary vector noTissue/Tissue
-		std::vector<int> s;
-		for (int j = 0; j < _height; j++)
+#pragma omp parallel for
+	for (int z = 0; z < n; z++)
+	{
+		float* work = _image_slices[_startslice + z].return_work();
+		const float* d = dist[z].data();
+		for (unsigned i = 0; i < _area; i++)
 		{
-			for (int k = 0; k < _width; k++)
-			{
-				if (work[i] == 0)
-					s.push_back(-1);
-				else
-					s.push_back(0);
-				i++;
-			}
+			if (work[i] != 0 && d[i] <= skin_limit)
+				work[i] = setto;
 		}
+	}
+}
 
-		// i4 itetations through  y, -y, x, -x converting, each time a tissue beginning is find, one tissue pixel into skin
-		//!! It is assumed that ix and iy are the same
-		bool convertSkin = true;
-		for (i = 1; i < ix + 1; i++)
-		{
-			for (y = 0; y < _height; y++)
-			{
-				pos = y * _width;
-				while (pos < (y + 1) * _width)
-				{
-					if (s[pos] == 0)
-					{
-						if (convertSkin)
-							s[pos] = 256;
-						convertSkin = false;
-					}
-					else
-						convertSkin = true;
+void SlicesHandler::add_skin3D_outside(int ix, int iy, int iz, float setto)
+{
+	// ix,iy,iz are in pixels, the skin is the exterior within this (ellipsoidal) distance of the object
+	float set_to = (float)123E10;
+	const int n = _endslice - _startslice;
 
-					pos++;
-				}
+	std::vector<float*> works(n);
+#pragma omp parallel for
+	for (int z = 0; z < n; z++)
+	{
+		_image_slices[_startslice + z].flood_exterior(set_to);
+		works[z] = _image_slices[_startslice + z].return_work();
+	}
+	flood_exterior_3D(works, _width, _area, set_to);
 
-				pos = (y + 1) * _width - 1;
-				while (pos > y * _width)
-				{
-					if (s[pos] == 0)
-					{
-						if (convertSkin)
-							s[pos] = 256;
-						convertSkin = false;
-					}
-					else
-						convertSkin = true;
+	const float radius[3] = {float(ix), float(iy), float(iz)};
+	auto dist = scaled_distance2(_width, _height, n, radius, [&](int z, unsigned i) {
+		return works[z][i] != set_to;
+	});
 
-					pos--;
-				}
-			}
+#pragma omp parallel for
+	for (int z = 0; z < n; z++)
+	{
+		float* work = works[z];
+		const float* d = dist[z].data();
+		for (unsigned i = 0; i < _area; i++)
+		{
+			if (work[i] == set_to)
+				work[i] = (d[i] <= skin_limit) ? setto : 0;
+		}
+	}
+}
 
-			for (x = 0; x < _width; x++)
-			{
-				pos = x;
-				while (pos < _height * _width)
-				{
-					if (s[pos] == 0)
-					{
-						if (convertSkin)
-							s[pos] = 256;
-						convertSkin = false;
-					}
-					else
-						convertSkin = true;
+void SlicesHandler::add_skin3D_outside2(int ix, int iy, int iz, float setto)
+{
+	add_skin3D_outside(ix, iy, iz, setto);
+}
 
-					pos += _width;
-				}
+void SlicesHandler::add_skintissue3D_outside2(int ix, int iy, int iz, tissues_size_t f)
+{
+	// ix,iy,iz are in pixels, the skin is the exterior within this (ellipsoidal) distance of the object
+	tissues_size_t set_to = TISSUES_SIZE_MAX;
+	const int n = _endslice - _startslice;
 
-				pos = _width * (_height - 1) + x;
-				while (pos > _width)
-				{
-					if (s[pos] == 0)
-					{
-						if (convertSkin)
-							s[pos] = 256;
-						convertSkin = false;
-					}
-					else
-						convertSkin = true;
+	std::vector<tissues_size_t*> tissues(n);
+#pragma omp parallel for
+	for (int z = 0; z < n; z++)
+	{
+		_image_slices[_startslice + z].flood_exteriortissue(_active_tissuelayer, set_to);
+		tissues[z] = _image_slices[_startslice + z].return_tissues(_active_tissuelayer);
+	}
+	flood_exterior_3D(tissues, _width, _area, set_to);
 
-					pos -= _width;
-				}
-			}
-		}
+	const float radius[3] = {float(ix), float(iy), float(iz)};
+	auto dist = scaled_distance2(_width, _height, n, radius, [&](int z, unsigned i) {
+		return tissues[z][i] != set_to;
+	});
 
-		//go over the vector and set the skin pixel at the source pointer
-		i = 0;
-		for (int j = 0; j < _height; j++)
+#pragma omp parallel for
+	for (int z = 0; z < n; z++)
+	{
+		tissues_size_t* tissue = tissues[z];
+		const float* d = dist[z].data();
+		for (unsigned i = 0; i < _area; i++)
 		{
-			for (int k = 0; k < _width; k++)
-			{
-				if (s[i] == 256)
-					work[i] = setto;
-				i++;
-			}
+			if (tissue[i] == set_to)
+				tissue[i] = (d[i] <= skin_limit) ? f : 0;
 		}
 	}
+}
 
-	// To create skin in 3D, it is check if where there is tissue, in the thickness (up&down) distance there is neither tissue nor skin
-	//The conversion is already done.
-	//int checkSliceDistance = int(iz/thickness);
-	int checkSliceDistance = iz;
-
-	for (unsigned short z = _startslice; z < _endslice - checkSliceDistance; z++)
+float SlicesHandler::add_skin3D(int i1)
+{
+	Pair p;
+	get_range(&p);
+	float setto;
+	if (p.high <= 254.0f)
+		setto = 255.0f;
+	else if (p.low >= 1.0f)
+		setto = 0.0f;
+	else
 	{
-		float* work1;
-		float* work2;
-		work1 = _image_slices[z].return_work();
-		work2 = _image_slices[z + checkSliceDistance].return_work();
+		setto = p.low;
 
-		unsigned i = 0;
-		for (int j = 0; j < _height; j++)
+		for (unsigned short i = _startslice; i < _endslice; i++)
 		{
-			for (int k = 0; k < _width; k++)
+			float* bits = _image_slices[i].return_work();
+			for (unsigned pos = 0; pos < _area; pos++)
 			{
-				if (work1[i] != 0 && work1[i] != setto)
-					if (work2[i] == 0)
-						work1[i] = setto;
-				i++;
+				if (bits[pos] != p.high)
+					setto = std::max(setto, bits[pos]);
 			}
 		}
+
+		setto = (setto + p.high) / 2;
 	}
 
-	for (unsigned short z = _endslice - 1; z > _startslice + checkSliceDistance;
-			 z--)
+	add_skin3D(i1, i1, i1, setto);
+	return setto;
+}
+
+float SlicesHandler::add_skin3D(int ix, int iy, int iz)
+{
+	Pair p;
+	get_range(&p);
+	float setto;
+	if (p.high <= 254.0f)
+		setto = 255.0f;
+	else if (p.low >= 1.0f)
+		setto = 0.0f;
+	else
 	{
-		float* work1;
-		float* work2;
-		work1 = _image_slices[z].return_work();
-		work2 = _image_slices[z - checkSliceDistance].return_work();
+		setto = p.low;
 
-		unsigned i = 0;
-		for (int j = 0; j < _height; j++)
+		for (unsigned short i = _startslice; i < _endslice; i++)
 		{
-			for (int k = 0; k < _width; k++)
+			float* bits = _image_slices[i].return_work();
+			for (unsigned pos = 0; pos < _area; pos++)
 			{
-				if (work1[i] != 0 && work1[i] != setto)
-					if (work2[i] == 0)
-						work1[i] = setto;
-				i++;
+				if (bits[pos] != p.high)
+					setto = std::max(setto, bits[pos]);
 			}
 		}
+
+		setto = (setto + p.high) / 2;
 	}
+
+	// ix,iy,iz are in pixels
+	add_skin3D(ix, iy, iz, setto);
+	return setto;
 }
 
-void SlicesHandler::add_skin3D_outside(int ix, int iy, int iz, float setto)
+float SlicesHandler::add_skin3D_outside(int i1)
 {
-	float set_to = (float)123E10;
-	for (unsigned short z = _startslice; z < _endslice; z++)
+	Pair p;
+	get_range(&p);
+	float setto;
+	if (p.high <= 254.0f)
+		setto = 255.0f;
+	else if (p.low >= 1.0f)
+		setto = 0.0f;
+	else
 	{
-		_image_slices[z].flood_exterior(set_to);
-	}
-
-	std::vector<posit> s;
-	posit p1;
-
-	p1.pz = _activeslice;
+		setto = p.low;
 
-	float* work1;
-	float* work2;
-	for (unsigned short z = _startslice; z + 1 < _endslice; z++)
-	{
-		work1 = _image_slices[z].return_work();
-		work2 = _image_slices[z + 1].return_work();
-		for (unsigned long i = 0; i < _area; i++)
+		for (unsigned short i = _startslice; i < _endslice; i++)
 		{
-			if (work1[i] == 0 && work2[i] == set_to)
+			float* bits = _image_slices[i].return_work();
+			for (unsigned pos = 0; pos < _area; pos++)
 			{
-				work1[i] = set_to;
-				p1.pxy = i;
-				p1.pz = z;
-				s.push_back(p1);
+				if (bits[pos] != p.high)
+					setto = std::max(setto, bits[pos]);
 			}
 		}
+
+		setto = (setto + p.high) / 2;
 	}
-	for (unsigned short z = _endslice - 1; z > _startslice; z--)
+
+	add_skin3D_outside(i1, i1, i1, setto);
+	return setto;
+}
+
+float SlicesHandler::add_skin3D_outside2(int ix, int iy, int iz)
+{
+	Pair p;
+	get_range(&p);
+	float setto;
+	if (p.high <= 254.0f)
+		setto = 255.0f;
+	else if (p.low >= 1.0f)
+		setto = 0.0f;
+	else
 	{
-		work1 = _image_slices[z].return_work();
-		work2 = _image_slices[z - 1].return_work();
-		for (unsigned long i = 0; i < _area; i++)
+		setto = p.low;
+
+		for (unsigned short i = _startslice; i < _endslice; i++)
 		{
-			if (work1[i] == 0 && work2[i] == set_to)
+			float* bits = _image_slices[i].return_work();
+			for (unsigned pos = 0; pos < _area; pos++)
 			{
-				work1[i] = set_to;
-				p1.pxy = i;
-				p1.pz = z;
-				s.push_back(p1);
+				if (bits[pos] != p.high)
+					setto = std::max(setto, bits[pos]);
 			}
 		}
+
+		setto = (setto + p.high) / 2;
 	}
 
-	posit i, j;
-	float* work;
+	add_skin3D_outside2(ix, iy, iz, setto);
+	return setto;
+}
 
-	while (!s.empty())
+void SlicesHandler::add_skintissue3D(int ix, int iy, int iz, tissues_size_t f)
+{
+	// ix,iy,iz are in pixels, the skin is everything within this (ellipsoidal) distance of the exterior
+	tissues_size_t set_to = TISSUES_SIZE_MAX;
+	const int n = _endslice - _startslice;
+
+	std::vector<tissues_size_t*> tissues(n);
+#pragma omp parallel for
+	for (int z = 0; z < n; z++)
 	{
-		i = s.back();
-		s.pop_back();
+		_image_slices[_startslice + z].flood_exteriortissue(_active_tissuelayer, set_to);
+		tissues[z] = _image_slices[_startslice + z].return_tissues(_active_tissuelayer);
+	}
+	flood_exterior_3D(tissues, _width, _area, set_to);
 
-		work = _image_slices[i.pz].return_work();
-		if (i.pxy % _width != 0 && work[i.pxy - 1] == 0)
-		{
-			work[i.pxy - 1] = set_to;
-			j.pxy = i.pxy - 1;
-			j.pz = i.pz;
-			s.push_back(j);
-		}
-		if ((i.pxy + 1) % _width != 0 && work[i.pxy + 1] == 0)
-		{
-			work[i.pxy + 1] = set_to;
-			j.pxy = i.pxy + 1;
-			j.pz = i.pz;
-			s.push_back(j);
-		}
-		if (i.pxy >= _width && work[i.pxy - _width] == 0)
-		{
-			work[i.pxy - _width] = set_to;
-			j.pxy = i.pxy - _width;
-			j.pz = i.pz;
-			s.push_back(j);
-		}
-		if (i.pxy < _area - _width && work[i.pxy + _width] == 0)
-		{
-			work[i.pxy + _width] = set_to;
-			j.pxy = i.pxy + _width;
-			j.pz = i.pz;
-			s.push_back(j);
-		}
-		if (i.pz > _startslice)
-		{
-			work = _image_slices[i.pz - 1].return_work();
-			if (work[i.pxy] == 0)
-			{
-				work[i.pxy] = set_to;
-				j.pxy = i.pxy;
-				j.pz = i.pz - 1;
-				s.push_back(j);
-			}
-		}
-		if (i.pz + 1 < _endslice)
+	const float radius[3] = {float(ix), float(iy), float(iz)};
+	auto dist = scaled_distance2(_width, _height, n, radius, [&](int z, unsigned i) {
+		return tissues[z][i] == set_to;
+	});
+
+#pragma omp parallel for
+	for (int z = 0; z < n; z++)
+	{
+		tissues_size_t* tissue = tissues[z];
+		const float* d = dist[z].data();
+		for (unsigned i = 0; i < _area; i++)
 		{
-			work = _image_slices[i.pz + 1].return_work();
-			if (work[i.pxy] == 0)
-			{
-				work[i.pxy] = set_to;
-				j.pxy = i.pxy;
-				j.pz = i.pz + 1;
-				s.push_back(j);
-			}
+			if (tissue[i] == set_to)
+				tissue[i] = 0;
+			else if (d[i] <= skin_limit && !TissueInfos::GetTissueLocked(tissue[i]))
+				tissue[i] = f;
 		}
 	}
+}
 
-	unsigned short x, y;
-	unsigned long pos;
-	unsigned short i1;
-	for (unsigned short z = _startslice; z < _endslice; z++)
-	{
-		work = _image_slices[z].return_work();
+void SlicesHandler::add_skintissue3D_outside(int ixyz, tissues_size_t f)
+{
+	add_skintissue3D_outside2(ixyz, ixyz, ixyz, f);
+}
 
-		for (y = 0; y < _height; y++)
-		{
-			pos = y * _width;
-			i1 = 0;
-			while (pos < (unsigned long)(y + 1) * _width)
-			{
-				if (work[pos] != set_to)
-					i1 = ix;
-				else
-				{
-					if (i1 > 0)
-					{
-						work[pos] = setto;
-						i1--;
-					}
-				}
-				pos++;
-			}
-		}
-
-		for (y = 0; y < _height; y++)
-		{
-			pos = (y + 1) * _width - 1;
-			i1 = 0;
-			while (pos > (unsigned long)y * _width)
-			{
-				if (work[pos] != set_to)
-					i1 = ix;
-				else
-				{
-					if (i1 > 0)
-					{
-						work[pos] = setto;
-						i1--;
-					}
-				}
-				pos--;
-			}
-			if (work[pos] != set_to)
-				i1 = ix;
-			else
-			{
-				if (i1 > 0)
-				{
-					work[pos] = setto;
-					i1--;
-				}
-			}
-		}
-
-		for (x = 0; x < _width; x++)
-		{
-			pos = x;
-			i1 = 0;
-			while (pos < _area)
-			{
-				if (work[pos] != set_to)
-					i1 = iy;
-				else
-				{
-					if (i1 > 0)
-					{
-						work[pos] = setto;
-						i1--;
-					}
-				}
-				pos += _width;
-			}
-		}
-
-		for (x = 0; x < _width; x++)
-		{
-			pos = _area + x - _width;
-			i1 = 0;
-			while (pos > _width)
-			{
-				if (work[pos] != set_to)
-					i1 = iy;
-				else
-				{
-					if (i1 > 0)
-					{
-						work[pos] = setto;
-						i1--;
-					}
-				}
-				pos -= _width;
-			}
-			if (work[pos] != set_to)
-				i1 = iy;
-			else
-			{
-				if (i1 > 0)
-				{
-					work[pos] = setto;
-					i1--;
-				}
-			}
-		}
-	}
-
-	unsigned short* counter = (unsigned short*)malloc(sizeof(unsigned short) * _area);
-	for (unsigned i1 = 0; i1 < _area; i1++)
-		counter[i1] = 0;
-	for (unsigned short z = _startslice; z < _endslice; z++)
-	{
-		work = _image_slices[z].return_work();
-		for (pos = 0; pos < _area; pos++)
-		{
-			if (work[pos] != set_to)
-				counter[pos] = iz;
-			else
-			{
-				if (counter[pos] > 0)
-				{
-					work[pos] = setto;
-					counter[pos]--;
-				}
-			}
-		}
-	}
-	for (unsigned i1 = 0; i1 < _area; i1++)
-		counter[i1] = 0;
-	for (unsigned short z = _endslice - 1; z > _startslice; z--)
-	{
-		work = _image_slices[z].return_work();
-		for (pos = 0; pos < _area; pos++)
-		{
-			if (work[pos] != set_to)
-				counter[pos] = iz;
-			else
-			{
-				if (counter[pos] > 0)
-				{
-					work[pos] = setto;
-					counter[pos]--;
-				}
-			}
-		}
-	}
-	work = _image_slices[_startslice].return_work();
-	for (pos = 0; pos < _area; pos++)
-	{
-		if (work[pos] != set_to)
-			counter[pos] = iz;
-		else
-		{
-			if (counter[pos] > 0)
-			{
-				work[pos] = setto;
-				counter[pos]--;
-			}
-		}
-	}
-	free(counter);
-
-	for (unsigned short z = _startslice; z < _endslice; z++)
-	{
-		work = _image_slices[z].return_work();
-		for (unsigned i1 = 0; i1 < _area; i1++)
-			if (work[i1] == set_to)
-				work[i1] = 0;
-	}
-}
-
-void SlicesHandler::add_skin3D_outside2(int ix, int iy, int iz, float setto)
-{
-	float set_to = (float)123E10;
-	float set_to2 = (float)321E10;
-	for (unsigned short z = _startslice; z < _endslice; z++)
-	{
-		_image_slices[z].flood_exterior(set_to);
-	}
-
-	//Point p;
-	//unsigned position;
-	std::vector<posit> s;
-	posit p1;
-
-	//	p1.pxy=position;
-	p1.pz = _activeslice;
-
-	float* work1;
-	float* work2;
-	for (unsigned short z = _startslice; z + 1 < _endslice; z++)
-	{
-		work1 = _image_slices[z].return_work();
-		work2 = _image_slices[z + 1].return_work();
-		for (unsigned long i = 0; i < _area; i++)
-		{
-			if (work1[i] == 0 && work2[i] == set_to)
-			{
-				work1[i] = set_to;
-				p1.pxy = i;
-				p1.pz = z;
-				s.push_back(p1);
-			}
-		}
-	}
-	for (unsigned short z = _endslice - 1; z > _startslice; z--)
-	{
-		work1 = _image_slices[z].return_work();
-		work2 = _image_slices[z - 1].return_work();
-		for (unsigned long i = 0; i < _area; i++)
-		{
-			if (work1[i] == 0 && work2[i] == set_to)
-			{
-				work1[i] = set_to;
-				p1.pxy = i;
-				p1.pz = z;
-				s.push_back(p1);
-			}
-		}
-	}
-
-	posit i, j;
-	float* work;
-
-	while (!s.empty())
-	{
-		i = s.back();
-		s.pop_back();
-
-		work = _image_slices[i.pz].return_work();
-		if (i.pxy % _width != 0 && work[i.pxy - 1] == 0)
-		{
-			work[i.pxy - 1] = set_to;
-			j.pxy = i.pxy - 1;
-			j.pz = i.pz;
-			s.push_back(j);
-		}
-		if ((i.pxy + 1) % _width != 0 && work[i.pxy + 1] == 0)
-		{
-			work[i.pxy + 1] = set_to;
-			j.pxy = i.pxy + 1;
-			j.pz = i.pz;
-			s.push_back(j);
-		}
-		if (i.pxy >= _width && work[i.pxy - _width] == 0)
-		{
-			work[i.pxy - _width] = set_to;
-			j.pxy = i.pxy - _width;
-			j.pz = i.pz;
-			s.push_back(j);
-		}
-		if (i.pxy < _area - _width && work[i.pxy + _width] == 0)
-		{
-			work[i.pxy + _width] = set_to;
-			j.pxy = i.pxy + _width;
-			j.pz = i.pz;
-			s.push_back(j);
-		}
-		if (i.pz > _startslice)
-		{
-			work = _image_slices[i.pz - 1].return_work();
-			if (work[i.pxy] == 0)
-			{
-				work[i.pxy] = set_to;
-				j.pxy = i.pxy;
-				j.pz = i.pz - 1;
-				s.push_back(j);
-			}
-		}
-		if (i.pz + 1 < _endslice)
-		{
-			work = _image_slices[i.pz + 1].return_work();
-			if (work[i.pxy] == 0)
-			{
-				work[i.pxy] = set_to;
-				j.pxy = i.pxy;
-				j.pz = i.pz + 1;
-				s.push_back(j);
-			}
-		}
-	}
-
-	unsigned int totcount = (ix + 1) * (iy + 1) * (iz + 1);
-	unsigned int subx = (iy + 1) * (iz + 1);
-	unsigned int suby = (ix + 1) * (iz + 1);
-	unsigned int subz = (iy + 1) * (ix + 1);
-
-	Treap<posit, unsigned int> treap1;
-	if (iz > 0)
-	{
-		for (unsigned short z = _startslice; z + 1 < _endslice; z++)
-		{
-			work1 = _image_slices[z].return_work();
-			work2 = _image_slices[z + 1].return_work();
-			for (unsigned long i = 0; i < _area; i++)
-			{
-				if (work1[i] == set_to)
-				{
-					if ((work2[i] != set_to) && (work2[i] != set_to2))
-					{
-						p1.pxy = i;
-						p1.pz = z;
-						Treap<posit, unsigned int>::Node* n = nullptr;
-						treap1.insert(n, p1, 1, subz);
-						work1[i] = set_to2;
-					}
-				}
-				else if (work1[i] == set_to2)
-				{
-					if ((work2[i] != set_to) && (work2[i] != set_to2))
-					{
-						p1.pxy = i;
-						p1.pz = z;
-						Treap<posit, unsigned int>::Node* n1 =
-								treap1.lookup(p1);
-						if (n1->getPriority() > subz)
-							treap1.update_priority(n1, subz);
-					}
-				}
-				else
-				{
-					if (work2[i] == set_to2)
-					{
-						p1.pxy = i;
-						p1.pz = z + 1;
-						Treap<posit, unsigned int>::Node* n1 =
-								treap1.lookup(p1);
-						if (n1->getPriority() > subz)
-							treap1.update_priority(n1, subz);
-					}
-					else if (work2[i] == set_to)
-					{
-						p1.pxy = i;
-						p1.pz = z + 1;
-						Treap<posit, unsigned int>::Node* n = nullptr;
-						treap1.insert(n, p1, 1, subz);
-						work2[i] = set_to2;
-					}
-				}
-			}
-		}
-	}
-
-	if (ix > 0)
-	{
-		for (unsigned short z = _startslice; z < _endslice; z++)
-		{
-			p1.pz = z;
-			work1 = _image_slices[z].return_work();
-			unsigned long i = 0;
-			for (unsigned short y = 0; y < _height; y++)
-			{
-				for (unsigned short x = 0; x + 1 < _width; x++)
-				{
-					if (work1[i] == set_to)
-					{
-						if ((work1[i + 1] != set_to) &&
-								(work1[i + 1] != set_to2))
-						{
-							p1.pxy = i;
-							Treap<posit, unsigned int>::Node* n = nullptr;
-							treap1.insert(n, p1, 1, subx);
-							work1[i] = set_to2;
-						}
-					}
-					else if (work1[i] == set_to2)
-					{
-						if ((work1[i + 1] != set_to) &&
-								(work1[i + 1] != set_to2))
-						{
-							p1.pxy = i;
-							Treap<posit, unsigned int>::Node* n1 =
-									treap1.lookup(p1);
-							if (n1->getPriority() > subx)
-								treap1.update_priority(n1, subx);
-						}
-					}
-					else
-					{
-						if (work1[i + 1] == set_to2)
-						{
-							p1.pxy = i + 1;
-							Treap<posit, unsigned int>::Node* n1 =
-									treap1.lookup(p1);
-							if (n1->getPriority() > subx)
-								treap1.update_priority(n1, subx);
-						}
-						else if (work1[i + 1] == set_to)
-						{
-							p1.pxy = i + 1;
-							Treap<posit, unsigned int>::Node* n = nullptr;
-							treap1.insert(n, p1, 1, subx);
-							work1[i + 1] = set_to2;
-						}
-					}
-					i++;
-				}
-				i++;
-			}
-		}
-	}
-
-	if (iy > 0)
-	{
-		for (unsigned short z = _startslice; z < _endslice; z++)
-		{
-			p1.pz = z;
-			work1 = _image_slices[z].return_work();
-			unsigned long i = 0;
-			for (unsigned short y = 0; y + 1 < _height; y++)
-			{
-				for (unsigned short x = 0; x < _width; x++)
-				{
-					if (work1[i] == set_to)
-					{
-						if ((work1[i + _width] != set_to) &&
-								(work1[i + _width] != set_to2))
-						{
-							p1.pxy = i;
-							Treap<posit, unsigned int>::Node* n = nullptr;
-							treap1.insert(n, p1, 1, suby);
-							work1[i] = set_to2;
-						}
-					}
-					else if (work1[i] == set_to2)
-					{
-						if ((work1[i + _width] != set_to) &&
-								(work1[i + _width] != set_to2))
-						{
-							p1.pxy = i;
-							Treap<posit, unsigned int>::Node* n1 =
-									treap1.lookup(p1);
-							if (n1->getPriority() > suby)
-								treap1.update_priority(n1, suby);
-						}
-					}
-					else
-					{
-						if (work1[i + _width] == set_to2)
-						{
-							p1.pxy = i + _width;
-							Treap<posit, unsigned int>::Node* n1 =
-									treap1.lookup(p1);
-							if (n1->getPriority() > suby)
-								treap1.update_priority(n1, suby);
-						}
-						else if (work1[i + _width] == set_to)
-						{
-							p1.pxy = i + _width;
-							Treap<posit, unsigned int>::Node* n = nullptr;
-							treap1.insert(n, p1, 1, suby);
-							work1[i + _width] = set_to2;
-						}
-					}
-					i++;
-				}
-			}
-		}
-	}
-
-	Treap<posit, unsigned int>::Node* n1;
-	posit p2;
-	unsigned int prior;
-	while ((n1 = treap1.get_top()) != nullptr)
-	{
-		p1 = n1->getKey();
-		prior = n1->getPriority();
-		work1 = _image_slices[p1.pz].return_work();
-		work1[p1.pxy] = setto;
-		if (p1.pxy % _width != 0)
-		{
-			if (work1[p1.pxy - 1] == set_to)
-			{
-				if (prior + 2 * subx <= totcount)
-				{
-					p2.pxy = p1.pxy - 1;
-					p2.pz = p1.pz;
-					Treap<posit, unsigned int>::Node* n = nullptr;
-					treap1.insert(n, p2, 1, prior + subx);
-					work1[p1.pxy - 1] = set_to2;
-				}
-			}
-			else if (work1[p1.pxy - 1] == set_to2)
-			{
-				p2.pxy = p1.pxy - 1;
-				p2.pz = p1.pz;
-				Treap<posit, unsigned int>::Node* n2 = treap1.lookup(p2);
-				if (n2->getPriority() > prior + subx)
-					treap1.update_priority(n2, prior + subx);
-			}
-		}
-		if ((p1.pxy + 1) % _width != 0)
-		{
-			if (work1[p1.pxy + 1] == set_to)
-			{
-				if (prior + 2 * subx <= totcount)
-				{
-					p2.pxy = p1.pxy + 1;
-					p2.pz = p1.pz;
-					Treap<posit, unsigned int>::Node* n = nullptr;
-					treap1.insert(n, p2, 1, prior + subx);
-					work1[p1.pxy + 1] = set_to2;
-				}
-			}
-			else if (work1[p1.pxy + 1] == set_to2)
-			{
-				p2.pxy = p1.pxy + 1;
-				p2.pz = p1.pz;
-				Treap<posit, unsigned int>::Node* n2 = treap1.lookup(p2);
-				if (n2->getPriority() > prior + subx)
-					treap1.update_priority(n2, prior + subx);
-			}
-		}
-		if (p1.pxy >= _width)
-		{
-			if (work1[p1.pxy - _width] == set_to)
-			{
-				if (prior + 2 * suby <= totcount)
-				{
-					p2.pxy = p1.pxy - _width;
-					p2.pz = p1.pz;
-					Treap<posit, unsigned int>::Node* n = nullptr;
-					treap1.insert(n, p2, 1, prior + suby);
-					work1[p1.pxy - _width] = set_to2;
-				}
-			}
-			else if (work1[p1.pxy - _width] == set_to2)
-			{
-				p2.pxy = p1.pxy - _width;
-				p2.pz = p1.pz;
-				Treap<posit, unsigned int>::Node* n2 = treap1.lookup(p2);
-				if (n2->getPriority() > prior + suby)
-					treap1.update_priority(n2, prior + suby);
-			}
-		}
-		if (p1.pxy < _area - _width)
-		{
-			if (work1[p1.pxy + _width] == set_to)
-			{
-				if (prior + 2 * suby <= totcount)
-				{
-					p2.pxy = p1.pxy + _width;
-					p2.pz = p1.pz;
-					Treap<posit, unsigned int>::Node* n = nullptr;
-					treap1.insert(n, p2, 1, prior + suby);
-					work1[p1.pxy + _width] = set_to2;
-				}
-			}
-			else if (work1[p1.pxy + _width] == set_to2)
-			{
-				p2.pxy = p1.pxy + _width;
-				p2.pz = p1.pz;
-				Treap<posit, unsigned int>::Node* n2 = treap1.lookup(p2);
-				if (n2->getPriority() > prior + suby)
-					treap1.update_priority(n2, prior + suby);
-			}
-		}
-		if (p1.pz > _startslice)
-		{
-			work2 = _image_slices[p1.pz - 1].return_work();
-			if (work2[p1.pxy] == set_to)
-			{
-				if (prior + 2 * subz <= totcount)
-				{
-					p2.pxy = p1.pxy;
-					p2.pz = p1.pz - 1;
-					Treap<posit, unsigned int>::Node* n = nullptr;
-					treap1.insert(n, p2, 1, prior + subz);
-					work2[p1.pxy] = set_to2;
-				}
-			}
-			else if (work2[p1.pxy] == set_to2)
-			{
-				p2.pxy = p1.pxy;
-				p2.pz = p1.pz - 1;
-				Treap<posit, unsigned int>::Node* n2 = treap1.lookup(p2);
-				if (n2->getPriority() > prior + subz)
-					treap1.update_priority(n2, prior + subz);
-			}
-		}
-		if (p1.pz + 1 < _endslice)
-		{
-			work2 = _image_slices[p1.pz + 1].return_work();
-			if (work2[p1.pxy] == set_to)
-			{
-				if (prior + 2 * subz <= totcount)
-				{
-					p2.pxy = p1.pxy;
-					p2.pz = p1.pz + 1;
-					Treap<posit, unsigned int>::Node* n = nullptr;
-					treap1.insert(n, p2, 1, prior + subz);
-					work2[p1.pxy] = set_to2;
-				}
-			}
-			else if (work2[p1.pxy] == set_to2)
-			{
-				p2.pxy = p1.pxy;
-				p2.pz = p1.pz + 1;
-				Treap<posit, unsigned int>::Node* n2 = treap1.lookup(p2);
-				if (n2->getPriority() > prior + subz)
-					treap1.update_priority(n2, prior + subz);
-			}
-		}
-
-		delete treap1.remove(n1);
-	}
-
-	for (unsigned short z = _startslice; z < _endslice; z++)
-	{
-		work = _image_slices[z].return_work();
-		for (unsigned i1 = 0; i1 < _area; i1++)
-			if (work[i1] == set_to)
-				work[i1] = 0;
-	}
-
-}
-
-void SlicesHandler::add_skintissue3D_outside2(int ix, int iy, int iz, tissues_size_t f)
-{
-	tissues_size_t set_to = TISSUES_SIZE_MAX;
-	tissues_size_t set_to2 = TISSUES_SIZE_MAX - 1;
-	for (unsigned short z = _startslice; z < _endslice; z++)
-	{
-		_image_slices[z].flood_exteriortissue(_active_tissuelayer, set_to);
-	}
-
-	std::vector<posit> s;
-	posit p1;
-
-	p1.pz = _activeslice;
-
-	tissues_size_t* work1;
-	tissues_size_t* work2;
-	for (unsigned short z = _startslice; z + 1 < _endslice; z++)
-	{
-		work1 = _image_slices[z].return_tissues(_active_tissuelayer);
-		work2 = _image_slices[z + 1].return_tissues(_active_tissuelayer);
-		for (unsigned long i = 0; i < _area; i++)
-		{
-			if (work1[i] == 0 && work2[i] == set_to)
-			{
-				work1[i] = set_to;
-				p1.pxy = i;
-				p1.pz = z;
-				s.push_back(p1);
-			}
-		}
-	}
-	for (unsigned short z = _endslice - 1; z > _startslice; z--)
-	{
-		work1 = _image_slices[z].return_tissues(_active_tissuelayer);
-		work2 = _image_slices[z - 1].return_tissues(_active_tissuelayer);
-		for (unsigned long i = 0; i < _area; i++)
-		{
-			if (work1[i] == 0 && work2[i] == set_to)
-			{
-				work1[i] = set_to;
-				p1.pxy = i;
-				p1.pz = z;
-				s.push_back(p1);
-			}
-		}
-	}
-
-	posit i, j;
-	tissues_size_t* work;
-
-	while (!s.empty())
-	{
-		i = s.back();
-		s.pop_back();
-
-		work = _image_slices[i.pz].return_tissues(_active_tissuelayer);
-		if (i.pxy % _width != 0 && work[i.pxy - 1] == 0)
-		{
-			work[i.pxy - 1] = set_to;
-			j.pxy = i.pxy - 1;
-			j.pz = i.pz;
-			s.push_back(j);
-		}
-		if ((i.pxy + 1) % _width != 0 && work[i.pxy + 1] == 0)
-		{
-			work[i.pxy + 1] = set_to;
-			j.pxy = i.pxy + 1;
-			j.pz = i.pz;
-			s.push_back(j);
-		}
-		if (i.pxy >= _width && work[i.pxy - _width] == 0)
-		{
-			work[i.pxy - _width] = set_to;
-			j.pxy = i.pxy - _width;
-			j.pz = i.pz;
-			s.push_back(j);
-		}
-		if (i.pxy < _area - _width && work[i.pxy + _width] == 0)
-		{
-			work[i.pxy + _width] = set_to;
-			j.pxy = i.pxy + _width;
-			j.pz = i.pz;
-			s.push_back(j);
-		}
-		if (i.pz > _startslice)
-		{
-			work = _image_slices[i.pz - 1].return_tissues(_active_tissuelayer);
-			if (work[i.pxy] == 0)
-			{
-				work[i.pxy] = set_to;
-				j.pxy = i.pxy;
-				j.pz = i.pz - 1;
-				s.push_back(j);
-			}
-		}
-		if (i.pz + 1 < _endslice)
-		{
-			work = _image_slices[i.pz + 1].return_tissues(_active_tissuelayer);
-			if (work[i.pxy] == 0)
-			{
-				work[i.pxy] = set_to;
-				j.pxy = i.pxy;
-				j.pz = i.pz + 1;
-				s.push_back(j);
-			}
-		}
-	}
-
-	unsigned int totcount = (ix + 1) * (iy + 1) * (iz + 1);
-	unsigned int subx = (iy + 1) * (iz + 1);
-	unsigned int suby = (ix + 1) * (iz + 1);
-	unsigned int subz = (iy + 1) * (ix + 1);
-
-	Treap<posit, unsigned int> treap1;
-	if (iz > 0)
-	{
-		for (unsigned short z = _startslice; z + 1 < _endslice; z++)
-		{
-			work1 = _image_slices[z].return_tissues(_active_tissuelayer);
-			work2 = _image_slices[z + 1].return_tissues(_active_tissuelayer);
-			for (unsigned long i = 0; i < _area; i++)
-			{
-				if (work1[i] == set_to)
-				{
-					if ((work2[i] != set_to) && (work2[i] != set_to2))
-					{
-						p1.pxy = i;
-						p1.pz = z;
-						Treap<posit, unsigned int>::Node* n = nullptr;
-						treap1.insert(n, p1, 1, subz);
-						work1[i] = set_to2;
-					}
-				}
-				else if (work1[i] == set_to2)
-				{
-					if ((work2[i] != set_to) && (work2[i] != set_to2))
-					{
-						p1.pxy = i;
-						p1.pz = z;
-						Treap<posit, unsigned int>::Node* n1 =
-								treap1.lookup(p1);
-						if (n1->getPriority() > subz)
-							treap1.update_priority(n1, subz);
-					}
-				}
-				else
-				{
-					if (work2[i] == set_to2)
-					{
-						p1.pxy = i;
-						p1.pz = z + 1;
-						Treap<posit, unsigned int>::Node* n1 =
-								treap1.lookup(p1);
-						if (n1->getPriority() > subz)
-							treap1.update_priority(n1, subz);
-					}
-					else if (work2[i] == set_to)
-					{
-						p1.pxy = i;
-						p1.pz = z + 1;
-						Treap<posit, unsigned int>::Node* n = nullptr;
-						treap1.insert(n, p1, 1, subz);
-						work2[i] = set_to2;
-					}
-				}
-			}
-		}
-	}
-
-	if (ix > 0)
-	{
-		for (unsigned short z = _startslice; z < _endslice; z++)
-		{
-			p1.pz = z;
-			work1 = _image_slices[z].return_tissues(_active_tissuelayer);
-			unsigned long i = 0;
-			for (unsigned short y = 0; y < _height; y++)
-			{
-				for (unsigned short x = 0; x + 1 < _width; x++)
-				{
-					if (work1[i] == set_to)
-					{
-						if ((work1[i + 1] != set_to) &&
-								(work1[i + 1] != set_to2))
-						{
-							p1.pxy = i;
-							Treap<posit, unsigned int>::Node* n = nullptr;
-							treap1.insert(n, p1, 1, subx);
-							work1[i] = set_to2;
-						}
-					}
-					else if (work1[i] == set_to2)
-					{
-						if ((work1[i + 1] != set_to) &&
-								(work1[i + 1] != set_to2))
-						{
-							p1.pxy = i;
-							Treap<posit, unsigned int>::Node* n1 =
-									treap1.lookup(p1);
-							if (n1->getPriority() > subx)
-								treap1.update_priority(n1, subx);
-						}
-					}
-					else
-					{
-						if (work1[i + 1] == set_to2)
-						{
-							p1.pxy = i + 1;
-							Treap<posit, unsigned int>::Node* n1 =
-									treap1.lookup(p1);
-							if (n1->getPriority() > subx)
-								treap1.update_priority(n1, subx);
-						}
-						else if (work1[i + 1] == set_to)
-						{
-							p1.pxy = i + 1;
-							Treap<posit, unsigned int>::Node* n = nullptr;
-							treap1.insert(n, p1, 1, subx);
-							work1[i + 1] = set_to2;
-						}
-					}
-					i++;
-				}
-				i++;
-			}
-		}
-	}
-
-	if (iy > 0)
-	{
-		for (unsigned short z = _startslice; z < _endslice; z++)
-		{
-			p1.pz = z;
-			work1 = _image_slices[z].return_tissues(_active_tissuelayer);
-			unsigned long i = 0;
-			for (unsigned short y = 0; y + 1 < _height; y++)
-			{
-				for (unsigned short x = 0; x < _width; x++)
-				{
-					if (work1[i] == set_to)
-					{
-						if ((work1[i + _width] != set_to) &&
-								(work1[i + _width] != set_to2))
-						{
-							p1.pxy = i;
-							Treap<posit, unsigned int>::Node* n = nullptr;
-							treap1.insert(n, p1, 1, suby);
-							work1[i] = set_to2;
-						}
-					}
-					else if (work1[i] == set_to2)
-					{
-						if ((work1[i + _width] != set_to) &&
-								(work1[i + _width] != set_to2))
-						{
-							p1.pxy = i;
-							Treap<posit, unsigned int>::Node* n1 =
-									treap1.lookup(p1);
-							if (n1->getPriority() > suby)
-								treap1.update_priority(n1, suby);
-						}
-					}
-					else
-					{
-						if (work1[i + _width] == set_to2)
-						{
-							p1.pxy = i + _width;
-							Treap<posit, unsigned int>::Node* n1 =
-									treap1.lookup(p1);
-							if (n1->getPriority() > suby)
-								treap1.update_priority(n1, suby);
-						}
-						else if (work1[i + _width] == set_to)
-						{
-							p1.pxy = i + _width;
-							Treap<posit, unsigned int>::Node* n = nullptr;
-							treap1.insert(n, p1, 1, suby);
-							work1[i + _width] = set_to2;
-						}
-					}
-					i++;
-				}
-			}
-		}
-	}
-
-	Treap<posit, unsigned int>::Node* n1;
-	posit p2;
-	unsigned int prior;
-	while ((n1 = treap1.get_top()) != nullptr)
-	{
-		p1 = n1->getKey();
-		prior = n1->getPriority();
-		work1 = _image_slices[p1.pz].return_tissues(_active_tissuelayer);
-		work1[p1.pxy] = f;
-		if (p1.pxy % _width != 0)
-		{
-			if (work1[p1.pxy - 1] == set_to)
-			{
-				if (prior + subx <= totcount)
-				{
-					p2.pxy = p1.pxy - 1;
-					p2.pz = p1.pz;
-					Treap<posit, unsigned int>::Node* n = nullptr;
-					treap1.insert(n, p2, 1, prior + subx);
-					work1[p1.pxy - 1] = set_to2;
-				}
-			}
-			else if (work1[p1.pxy - 1] == set_to2)
-			{
-				p2.pxy = p1.pxy - 1;
-				p2.pz = p1.pz;
-				Treap<posit, unsigned int>::Node* n2 = treap1.lookup(p2);
-				if (n2->getPriority() > prior + subx)
-					treap1.update_priority(n2, prior + subx);
-			}
-		}
-		if ((p1.pxy + 1) % _width != 0)
-		{
-			if (work1[p1.pxy + 1] == set_to)
-			{
-				if (prior + subx <= totcount)
-				{
-					p2.pxy = p1.pxy + 1;
-					p2.pz = p1.pz;
-					Treap<posit, unsigned int>::Node* n = nullptr;
-					treap1.insert(n, p2, 1, prior + subx);
-					work1[p1.pxy + 1] = set_to2;
-				}
-			}
-			else if (work1[p1.pxy + 1] == set_to2)
-			{
-				p2.pxy = p1.pxy + 1;
-				p2.pz = p1.pz;
-				Treap<posit, unsigned int>::Node* n2 = treap1.lookup(p2);
-				if (n2->getPriority() > prior + subx)
-					treap1.update_priority(n2, prior + subx);
-			}
-		}
-		if (p1.pxy >= _width)
-		{
-			if (work1[p1.pxy - _width] == set_to)
-			{
-				if (prior + suby <= totcount)
-				{
-					p2.pxy = p1.pxy - _width;
-					p2.pz = p1.pz;
-					Treap<posit, unsigned int>::Node* n = nullptr;
-					treap1.insert(n, p2, 1, prior + suby);
-					work1[p1.pxy - _width] = set_to2;
-				}
-			}
-			else if (work1[p1.pxy - _width] == set_to2)
-			{
-				p2.pxy = p1.pxy - _width;
-				p2.pz = p1.pz;
-				Treap<posit, unsigned int>::Node* n2 = treap1.lookup(p2);
-				if (n2->getPriority() > prior + suby)
-					treap1.update_priority(n2, prior + suby);
-			}
-		}
-		if (p1.pxy < _area - _width)
-		{
-			if (work1[p1.pxy + _width] == set_to)
-			{
-				if (prior + suby <= totcount)
-				{
-					p2.pxy = p1.pxy + _width;
-					p2.pz = p1.pz;
-					Treap<posit, unsigned int>::Node* n = nullptr;
-					treap1.insert(n, p2, 1, prior + suby);
-					work1[p1.pxy + _width] = set_to2;
-				}
-			}
-			else if (work1[p1.pxy + _width] == set_to2)
-			{
-				p2.pxy = p1.pxy + _width;
-				p2.pz = p1.pz;
-				Treap<posit, unsigned int>::Node* n2 = treap1.lookup(p2);
-				if (n2->getPriority() > prior + suby)
-					treap1.update_priority(n2, prior + suby);
-			}
-		}
-		if (p1.pz > _startslice)
-		{
-			work2 = _image_slices[p1.pz - 1].return_tissues(_active_tissuelayer);
-			if (work2[p1.pxy] == set_to)
-			{
-				if (prior + subz <= totcount)
-				{
-					p2.pxy = p1.pxy;
-					p2.pz = p1.pz - 1;
-					Treap<posit, unsigned int>::Node* n = nullptr;
-					treap1.insert(n, p2, 1, prior + subz);
-					work2[p1.pxy] = set_to2;
-				}
-			}
-			else if (work2[p1.pxy] == set_to2)
-			{
-				p2.pxy = p1.pxy;
-				p2.pz = p1.pz - 1;
-				Treap<posit, unsigned int>::Node* n2 = treap1.lookup(p2);
-				if (n2->getPriority() > prior + subz)
-					treap1.update_priority(n2, prior + subz);
-			}
-		}
-		if (p1.pz + 1 < _endslice)
-		{
-			work2 = _image_slices[p1.pz + 1].return_tissues(_active_tissuelayer);
-			if (work2[p1.pxy] == set_to)
-			{
-				if (prior + subz <= totcount)
-				{
-					p2.pxy = p1.pxy;
-					p2.pz = p1.pz + 1;
-					Treap<posit, unsigned int>::Node* n = nullptr;
-					treap1.insert(n, p2, 1, prior + subz);
-					work2[p1.pxy] = set_to2;
-				}
-			}
-			else if (work2[p1.pxy] == set_to2)
-			{
-				p2.pxy = p1.pxy;
-				p2.pz = p1.pz + 1;
-				Treap<posit, unsigned int>::Node* n2 = treap1.lookup(p2);
-				if (n2->getPriority() > prior + subz)
-					treap1.update_priority(n2, prior + subz);
-			}
-		}
-
-		delete treap1.remove(n1);
-	}
-
-	for (unsigned short z = _startslice; z < _endslice; z++)
-	{
-		work = _image_slices[z].return_tissues(_active_tissuelayer);
-		for (unsigned i1 = 0; i1 < _area; i1++)
-			if (work[i1] == set_to)
-				work[i1] = 0;
-	}
-}
-
-float SlicesHandler::add_skin3D(int i1)
-{
-	Pair p;
-	get_range(&p);
-	float setto;
-	if (p.high <= 254.0f)
-		setto = 255.0f;
-	else if (p.low >= 1.0f)
-		setto = 0.0f;
-	else
-	{
-		setto = p.low;
-
-		for (unsigned short i = _startslice; i < _endslice; i++)
-		{
-			float* bits = _image_slices[i].return_work();
-			for (unsigned pos = 0; pos < _area; pos++)
-			{
-				if (bits[pos] != p.high)
-					setto = std::max(setto, bits[pos]);
-			}
-		}
-
-		setto = (setto + p.high) / 2;
-	}
-
-	add_skin3D(i1, i1, i1, setto);
-	return setto;
-}
-
-float SlicesHandler::add_skin3D(int ix, int iy, int iz)
-{
-	Pair p;
-	get_range(&p);
-	float setto;
-	if (p.high <= 254.0f)
-		setto = 255.0f;
-	else if (p.low >= 1.0f)
-		setto = 0.0f;
-	else
-	{
-		setto = p.low;
-
-		for (unsigned short i = _startslice; i < _endslice; i++)
-		{
-			float* bits = _image_slices[i].return_work();
-			for (unsigned pos = 0; pos < _area; pos++)
-			{
-				if (bits[pos] != p.high)
-					setto = std::max(setto, bits[pos]);
-			}
-		}
-
-		setto = (setto + p.high) / 2;
-	}
-
-	// ix,iy,iz are in pixels
-	add_skin3D(ix, iy, iz, setto);
-	return setto;
-}
-
-float SlicesHandler::add_skin3D_outside(int i1)
-{
-	Pair p;
-	get_range(&p);
-	float setto;
-	if (p.high <= 254.0f)
-		setto = 255.0f;
-	else if (p.low >= 1.0f)
-		setto = 0.0f;
-	else
-	{
-		setto = p.low;
-
-		for (unsigned short i = _startslice; i < _endslice; i++)
-		{
-			float* bits = _image_slices[i].return_work();
-			for (unsigned pos = 0; pos < _area; pos++)
-			{
-				if (bits[pos] != p.high)
-					setto = std::max(setto, bits[pos]);
-			}
-		}
-
-		setto = (setto + p.high) / 2;
-	}
-
-	add_skin3D_outside(i1, i1, i1, setto);
-	return setto;
-}
-
-float SlicesHandler::add_skin3D_outside2(int ix, int iy, int iz)
-{
-	Pair p;
-	get_range(&p);
-	float setto;
-	if (p.high <= 254.0f)
-		setto = 255.0f;
-	else if (p.low >= 1.0f)
-		setto = 0.0f;
-	else
-	{
-		setto = p.low;
-
-		for (unsigned short i = _startslice; i < _endslice; i++)
-		{
-			float* bits = _image_slices[i].return_work();
-			for (unsigned pos = 0; pos < _area; pos++)
-			{
-				if (bits[pos] != p.high)
-					setto = std::max(setto, bits[pos]);
-			}
-		}
-
-		setto = (setto + p.high) / 2;
-	}
-
-	add_skin3D_outside2(ix, iy, iz, setto);
-	return setto;
-}
-
-void SlicesHandler::add_skintissue3D(int ix, int iy, int iz, tissues_size_t f)
-{
-	tissues_size_t set_to = TISSUES_SIZE_MAX;
-	for (unsigned short z = _startslice; z < _endslice; z++)
-	{
-		_image_slices[z].flood_exteriortissue(_active_tissuelayer, set_to);
-	}
-
-	//Point p;
-	//unsigned position;
-	std::vector<posit> s;
-	posit p1;
-
-	//	p1.pxy=position;
-	p1.pz = _activeslice;
-
-	tissues_size_t* tissue1;
-	tissues_size_t* tissue2;
-	for (unsigned short z = _startslice; z + 1 < _endslice; z++)
-	{
-		tissue1 = _image_slices[z].return_tissues(_active_tissuelayer);
-		tissue2 = _image_slices[z + 1].return_tissues(_active_tissuelayer);
-		for (unsigned long i = 0; i < _area; i++)
-		{
-			if (tissue1[i] == 0 && tissue2[i] == set_to)
-			{
-				tissue1[i] = set_to;
-				p1.pxy = i;
-				p1.pz = z;
-				s.push_back(p1);
-			}
-		}
-	}
-	for (unsigned short z = _endslice - 1; z > _startslice; z--)
-	{
-		tissue1 = _image_slices[z].return_tissues(_active_tissuelayer);
-		tissue2 = _image_slices[z - 1].return_tissues(_active_tissuelayer);
-		for (unsigned long i = 0; i < _area; i++)
-		{
-			if (tissue1[i] == 0 && tissue2[i] == set_to)
-			{
-				tissue1[i] = set_to;
-				p1.pxy = i;
-				p1.pz = z;
-				s.push_back(p1);
-			}
-		}
-	}
-
-	posit i, j;
-	tissues_size_t* tissue;
-
-	while (!s.empty())
-	{
-		i = s.back();
-		s.pop_back();
-
-		tissue = _image_slices[i.pz].return_tissues(_active_tissuelayer);
-		if (i.pxy % _width != 0 && tissue[i.pxy - 1] == 0)
-		{
-			tissue[i.pxy - 1] = set_to;
-			j.pxy = i.pxy - 1;
-			j.pz = i.pz;
-			s.push_back(j);
-		}
-		if ((i.pxy + 1) % _width != 0 && tissue[i.pxy + 1] == 0)
-		{
-			tissue[i.pxy + 1] = set_to;
-			j.pxy = i.pxy + 1;
-			j.pz = i.pz;
-			s.push_back(j);
-		}
-		if (i.pxy >= _width && tissue[i.pxy - _width] == 0)
-		{
-			tissue[i.pxy - _width] = set_to;
-			j.pxy = i.pxy - _width;
-			j.pz = i.pz;
-			s.push_back(j);
-		}
-		if (i.pxy < _area - _width && tissue[i.pxy + _width] == 0)
-		{
-			tissue[i.pxy + _width] = set_to;
-			j.pxy = i.pxy + _width;
-			j.pz = i.pz;
-			s.push_back(j);
-		}
-		if (i.pz > _startslice)
-		{
-			tissue = _image_slices[i.pz - 1].return_tissues(_active_tissuelayer);
-			if (tissue[i.pxy] == 0)
-			{
-				tissue[i.pxy] = set_to;
-				j.pxy = i.pxy;
-				j.pz = i.pz - 1;
-				s.push_back(j);
-			}
-		}
-		if (i.pz + 1 < _endslice)
-		{
-			tissue = _image_slices[i.pz + 1].return_tissues(_active_tissuelayer);
-			if (tissue[i.pxy] == 0)
-			{
-				tissue[i.pxy] = set_to;
-				j.pxy = i.pxy;
-				j.pz = i.pz + 1;
-				s.push_back(j);
-			}
-		}
-	}
-
-	unsigned short x, y;
-	unsigned long pos;
-	unsigned short i1;
-	for (unsigned short z = _startslice; z < _endslice; z++)
-	{
-		tissue = _image_slices[z].return_tissues(_active_tissuelayer);
-
-		for (y = 0; y < _height; y++)
-		{
-			pos = y * _width;
-			i1 = 0;
-			while (pos < (unsigned long)(y + 1) * _width)
-			{
-				if (tissue[pos] == set_to)
-					i1 = ix;
-				else
-				{
-					if (i1 > 0 && (!TissueInfos::GetTissueLocked(tissue[pos])))
-					{
-						tissue[pos] = f;
-						i1--;
-					}
-				}
-				pos++;
-			}
-		}
-
-		for (y = 0; y < _height; y++)
-		{
-			pos = (y + 1) * _width - 1;
-			i1 = 0;
-			while (pos > (unsigned long)y * _width)
-			{
-				if (tissue[pos] == set_to)
-					i1 = ix;
-				else
-				{
-					if (i1 > 0)
-					{
-						if (!TissueInfos::GetTissueLocked(tissue[pos]))
-							tissue[pos] = f;
-						i1--;
-					}
-				}
-				pos--;
-			}
-			if (tissue[pos] == set_to)
-				i1 = ix;
-			else
-			{
-				if (i1 > 0)
-				{
-					if (!TissueInfos::GetTissueLocked(tissue[pos]))
-						tissue[pos] = f;
-					i1--;
-				}
-			}
-		}
-
-		for (x = 0; x < _width; x++)
-		{
-			pos = x;
-			i1 = 0;
-			while (pos < _area)
-			{
-				if (tissue[pos] == set_to)
-					i1 = iy;
-				else
-				{
-					if (i1 > 0)
-					{
-						if (!TissueInfos::GetTissueLocked(tissue[pos]))
-							tissue[pos] = f;
-						i1--;
-					}
-				}
-				pos += _width;
-			}
-		}
-
-		for (x = 0; x < _width; x++)
-		{
-			pos = _area + x - _width;
-			i1 = 0;
-			while (pos > _width)
-			{
-				if (tissue[pos] == set_to)
-					i1 = iy;
-				else
-				{
-					if (i1 > 0)
-					{
-						if (!TissueInfos::GetTissueLocked(tissue[pos]))
-							tissue[pos] = f;
-						i1--;
-					}
-				}
-				pos -= _width;
-			}
-			if (tissue[pos] == set_to)
-				i1 = iy;
-			else
-			{
-				if (i1 > 0)
-				{
-					if (!TissueInfos::GetTissueLocked(tissue[pos]))
-						tissue[pos] = f;
-					i1--;
-				}
-			}
-		}
-	}
-
-	unsigned short* counter =
-			(unsigned short*)malloc(sizeof(unsigned short) * _area);
-	for (unsigned i1 = 0; i1 < _area; i1++)
-		counter[i1] = 0;
-	for (unsigned short z = _startslice; z < _endslice; z++)
-	{
-		tissue = _image_slices[z].return_tissues(_active_tissuelayer);
-		for (pos = 0; pos < _area; pos++)
-		{
-			if (tissue[pos] == set_to)
-				counter[pos] = iz;
-			else
-			{
-				if (counter[pos] > 0)
-				{
-					if (!TissueInfos::GetTissueLocked(tissue[pos]))
-						tissue[pos] = f;
-					counter[pos]--;
-				}
-			}
-		}
-	}
-	for (unsigned i1 = 0; i1 < _area; i1++)
-		counter[i1] = 0;
-	for (unsigned short z = _endslice - 1; z > _startslice; z--)
-	{
-		tissue = _image_slices[z].return_tissues(_active_tissuelayer);
-		for (pos = 0; pos < _area; pos++)
-		{
-			if (tissue[pos] == set_to)
-				counter[pos] = iz;
-			else
-			{
-				if (counter[pos] > 0)
-				{
-					if (!TissueInfos::GetTissueLocked(tissue[pos]))
-						tissue[pos] = f;
-					counter[pos]--;
-				}
-			}
-		}
-	}
-	tissue = _image_slices[_startslice].return_tissues(_active_tissuelayer);
-	for (pos = 0; pos < _area; pos++)
-	{
-		if (tissue[pos] == set_to)
-			counter[pos] = iz;
-		else
-		{
-			if (counter[pos] > 0)
-			{
-				if (!TissueInfos::GetTissueLocked(tissue[pos]))
-					tissue[pos] = f;
-				counter[pos]--;
-			}
-		}
-	}
-	free(counter);
-
-	for (unsigned short z = _startslice; z < _endslice; z++)
-	{
-		tissue = _image_slices[z].return_tissues(_active_tissuelayer);
-		for (unsigned i1 = 0; i1 < _area; i1++)
-			if (tissue[i1] == set_to)
-				tissue[i1] = 0;
-	}
-
-}
-
-void SlicesHandler::add_skintissue3D_outside(int ixyz, tissues_size_t f)
+void SlicesHandler::fill_skin_3d(int thicknessX, int thicknessY, int thicknessZ,
+		tissues_size_t backgroundID,
+		tissues_size_t skinID)
 {
-	tissues_size_t set_to = TISSUES_SIZE_MAX;
-	for (unsigned short z = _startslice; z < _endslice; z++)
-	{
-		_image_slices[z].flood_exteriortissue(_active_tissuelayer, set_to);
-	}
-
-	//Point p;
-	//unsigned position;
-	std::vector<posit> s;
-	std::vector<posit> s1;
-	std::vector<posit>* s2 = &s1;
-	std::vector<posit>* s3 = &s;
-	posit p1;
-
-	//	p1.pxy=position;
-	p1.pz = _activeslice;
-
-	tissues_size_t* tissue1;
-	tissues_size_t* tissue2;
-	for (unsigned short z = _startslice; z + 1 < _endslice; z++)
-	{
-		tissue1 = _image_slices[z].return_tissues(_active_tissuelayer);
-		tissue2 = _image_slices[z + 1].return_tissues(_active_tissuelayer);
-		for (unsigned long i = 0; i < _area; i++)
-		{
-			if (tissue1[i] == 0 && tissue2[i] == set_to)
-			{
-				tissue1[i] = set_to;
-				p1.pxy = i;
-				p1.pz = z;
-				s.push_back(p1);
-			}
-		}
-	}
-	for (unsigned short z = _endslice - 1; z > _startslice; z--)
-	{
-		tissue1 = _image_slices[z].return_tissues(_active_tissuelayer);
-		tissue2 = _image_slices[z - 1].return_tissues(_active_tissuelayer);
-		for (unsigned long i = 0; i < _area; i++)
-		{
-			if (tissue1[i] == 0 && tissue2[i] == set_to)
-			{
-				tissue1[i] = set_to;
-				p1.pxy = i;
-				p1.pz = z;
-				s.push_back(p1);
-			}
-		}
-	}
-
-	posit i, j;
-	tissues_size_t* tissue;
-
-	while (!s.empty())
-	{
-		i = s.back();
-		s.pop_back();
+	// fills the background, which is both within the thickness of the skin
+	// and of the other tissues, i.e. the gaps between skin and the inside
+	const float radius[3] = {float(thicknessX), float(thicknessY), float(thicknessZ)};
+	const float max_d = (thicknessX == 1) ? 1.75f : 1.2f;
+	const int n = _nrslices;
 
-		tissue = _image_slices[i.pz].return_tissues(_active_tissuelayer);
-		if (i.pxy % _width != 0 && tissue[i.pxy - 1] == 0)
-		{
-			tissue[i.pxy - 1] = set_to;
-			j.pxy = i.pxy - 1;
-			j.pz = i.pz;
-			s.push_back(j);
-		}
-		if ((i.pxy + 1) % _width != 0 && tissue[i.pxy + 1] == 0)
-		{
-			tissue[i.pxy + 1] = set_to;
-			j.pxy = i.pxy + 1;
-			j.pz = i.pz;
-			s.push_back(j);
-		}
-		if (i.pxy >= _width && tissue[i.pxy - _width] == 0)
-		{
-			tissue[i.pxy - _width] = set_to;
-			j.pxy = i.pxy - _width;
-			j.pz = i.pz;
-			s.push_back(j);
-		}
-		if (i.pxy <= _area - _width && tissue[i.pxy + _width] == 0)
-		{
-			tissue[i.pxy + _width] = set_to;
-			j.pxy = i.pxy + _width;
-			j.pz = i.pz;
-			s.push_back(j);
-		}
-		if (i.pz > _startslice)
-		{
-			tissue = _image_slices[i.pz - 1].return_tissues(_active_tissuelayer);
-			if (tissue[i.pxy] == 0)
-			{
-				tissue[i.pxy] = set_to;
-				j.pxy = i.pxy;
-				j.pz = i.pz - 1;
-				s.push_back(j);
-			}
-		}
-		if (i.pz + 1 < _endslice)
-		{
-			tissue = _image_slices[i.pz + 1].return_tissues(_active_tissuelayer);
-			if (tissue[i.pxy] == 0)
-			{
-				tissue[i.pxy] = set_to;
-				j.pxy = i.pxy;
-				j.pz = i.pz + 1;
-				s.push_back(j);
-			}
-		}
-	}
+	auto dist_skin = scaled_distance2(_width, _height, n, radius, [this, skinID](int z, unsigned i) {
+		return const_slice(z).return_tissues(0)[i] == skinID;
+	});
+	auto dist_tissue = scaled_distance2(_width, _height, n, radius, [this, skinID, backgroundID](int z, unsigned i) {
+		tissues_size_t value = const_slice(z).return_tissues(0)[i];
+		return value != skinID && value != backgroundID;
+	});
 
-	for (unsigned short z = _startslice; z + 1 < _endslice; z++)
+#pragma omp parallel for
+	for (int z = 0; z < n; z++)
 	{
-		tissue1 = _image_slices[z].return_tissues(_active_tissuelayer);
-		tissue2 = _image_slices[z + 1].return_tissues(_active_tissuelayer);
-		for (unsigned long i = 0; i < _area; i++)
+		const tissues_size_t* tissue = const_slice(z).return_tissues(0);
+		float* work = _image_slices[z].return_work();
+		const float* ds = dist_skin[z].data();
+		const float* dt = dist_tissue[z].data();
+		for (unsigned i = 0; i < _area; i++)
 		{
-			if (tissue1[i] == set_to)
-			{
-				if (tissue2[i] != set_to)
-				{
-					p1.pxy = i;
-					p1.pz = z + 1;
-					(*s2).push_back(p1);
-				}
-			}
+			if (tissue[i] == backgroundID && ds[i] < max_d * max_d && dt[i] < max_d * max_d)
+				work[i] = 255.0f;
 			else
-			{
-				if (tissue2[i] == set_to)
-				{
-					p1.pxy = i;
-					p1.pz = z;
-					(*s2).push_back(p1);
-				}
-			}
-		}
-	}
-
-	for (unsigned short z = _startslice; z < _endslice; z++)
-	{
-		tissue1 = _image_slices[z].return_tissues(_active_tissuelayer);
-		unsigned long i = 0;
-		for (unsigned short y = 0; y < _height; y++)
-		{
-			for (unsigned short x = 0; x + 1 < _width; x++)
-			{
-				if (tissue1[i] == set_to)
-				{
-					if (tissue1[i + 1] != set_to)
-					{
-						p1.pxy = i + 1;
-						p1.pz = z;
-						(*s2).push_back(p1);
-					}
-				}
-				else
-				{
-					if (tissue1[i + 1] == set_to)
-					{
-						p1.pxy = i;
-						p1.pz = z;
-						(*s2).push_back(p1);
-					}
-				}
-				i++;
-			}
-			i++;
-		}
-		i = 0;
-		for (unsigned short y = 0; y + 1 < _height; y++)
-		{
-			for (unsigned short x = 0; x < _width; x++)
-			{
-				if (tissue1[i] == set_to)
-				{
-					if (tissue1[i + _width] != set_to)
-					{
-						p1.pxy = i + _width;
-						p1.pz = z;
-						(*s2).push_back(p1);
-					}
-				}
-				else
-				{
-					if (tissue1[i + _width] == set_to)
-					{
-						p1.pxy = i;
-						p1.pz = z;
-						(*s2).push_back(p1);
-					}
-				}
-				i++;
-			}
-		}
-	}
-
-	for (int i4 = 0; i4 < ixyz; i4++)
-	{
-		while (!(*s2).empty())
-		{
-			i = (*s2).back();
-			(*s2).pop_back();
-
-			tissue = _image_slices[i.pz].return_tissues(_active_tissuelayer);
-			if (i.pxy % _width != 0 && tissue[i.pxy - 1] == set_to)
-			{
-				tissue[i.pxy - 1] = f;
-				j.pxy = i.pxy - 1;
-				j.pz = i.pz;
-				(*s3).push_back(j);
-			}
-			if ((i.pxy + 1) % _width != 0 && tissue[i.pxy + 1] == set_to)
-			{
-				tissue[i.pxy + 1] = f;
-				j.pxy = i.pxy + 1;
-				j.pz = i.pz;
-				(*s3).push_back(j);
-			}
-			if (i.pxy >= _width && tissue[i.pxy - _width] == set_to)
-			{
-				tissue[i.pxy - _width] = f;
-				j.pxy = i.pxy - _width;
-				j.pz = i.pz;
-				(*s3).push_back(j);
-			}
-			if (i.pxy < _area - _width && tissue[i.pxy + _width] == set_to)
-			{
-				tissue[i.pxy + _width] = f;
-				j.pxy = i.pxy + _width;
-				j.pz = i.pz;
-				(*s3).push_back(j);
-			}
-			if (i.pz > _startslice)
-			{
-				tissue =
-						_image_slices[i.pz - 1].return_tissues(_active_tissuelayer);
-				if (tissue[i.pxy] == set_to)
-				{
-					tissue[i.pxy] = f;
-					j.pxy = i.pxy;
-					j.pz = i.pz - 1;
-					(*s3).push_back(j);
-				}
-			}
-			if (i.pz + 1 < _endslice)
-			{
-				tissue =
-						_image_slices[i.pz + 1].return_tissues(_active_tissuelayer);
-				if (tissue[i.pxy] == set_to)
-				{
-					tissue[i.pxy] = f;
-					j.pxy = i.pxy;
-					j.pz = i.pz + 1;
-					(*s3).push_back(j);
-				}
-			}
+				work[i] = 0;
 		}
-		std::vector<posit>* sdummy = s2;
-		s2 = s3;
-		s3 = sdummy;
-	}
-
-	while (!(*s2).empty())
-	{
-		(*s2).pop_back();
-	}
-
-	for (unsigned short z = _startslice; z < _endslice; z++)
-	{
-		tissue = _image_slices[z].return_tissues(_active_tissuelayer);
-		for (unsigned i1 = 0; i1 < _area; i1++)
-			if (tissue[i1] == set_to)
-				tissue[i1] = 0;
+		_image_slices[z].set_mode(2, false);
 	}
-
 }
 
-void SlicesHandler::fill_skin_3d(int thicknessX, int thicknessY, int thicknessZ,
-		tissues_size_t backgroundID,
-		tissues_size_t skinID)
+void SlicesHandler::watershed_sobel(WatershedMergeTree& tree, bool connectivity)
 {
-	int numTasks = _nrslices;
-	QProgressDialog progress("Fill Skin in progress...", "Cancel", 0, numTasks);
-	progress.show();
-	progress.setWindowModality(Qt::WindowModal);
-	progress.setModal(true);
-	progress.setValue(0);
-
-	int skinThick = thicknessX;
-
-	std::vector<int> dims;
-	dims.push_back(_width);
-	dims.push_back(_height);
-	dims.push_back(_nrslices);
-
-	double max_d = skinThick == 1 ? 1.75 * skinThick : 1.2 * skinThick;
-
-	//Create the relative neighborhood
-	std::vector<std::vector<int>> offsetsSlices;
-	for (int z = -skinThick; z <= skinThick; z++)
+	// gradient magnitude of the slices from startslice to endslice, the work images are preserved
+	const unsigned short n = _endslice - _startslice;
+	std::vector<float> gradient(static_cast<size_t>(n) * _area);
+	std::vector<float> work(_area);
+	std::vector<const float*> slices(n);
+	for (unsigned short z = 0; z < n; z++)
 	{
-		std::vector<int> offsets;
-		for (int y = -skinThick; y <= skinThick; y++)
-		{
-			for (int x = -skinThick; x <= skinThick; x++)
-			{
-				if (sqrt(x * x + y * y + z * z) < max_d)
-				{
-					int shift = x + y * dims[0];
-					if (shift != 0)
-					{
-						offsets.push_back(shift);
-					}
-				}
-			}
-		}
-		offsetsSlices.push_back(offsets);
+		bmphandler& slice = _image_slices[_startslice + z];
+		unsigned char mode = slice.return_mode(false);
+		std::copy(slice.return_work(), slice.return_work() + _area, work.begin());
+		slice.sobel();
+		std::copy(slice.return_work(), slice.return_work() + _area, gradient.begin() + static_cast<size_t>(z) * _area);
+		std::copy(work.begin(), work.end(), slice.return_work());
+		slice.set_mode(mode, false);
+		slices[z] = gradient.data() + static_cast<size_t>(z) * _area;
 	}
 
-	struct changesToMakeStruct
-	{
-		size_t sliceNumber;
-		int positionConvert;
-
-		bool operator==(const changesToMakeStruct& m) const
-		{
-			return ((m.sliceNumber == sliceNumber) &&
-							(m.positionConvert == positionConvert));
-		}
-	};
-
-	bool thereIsBG = false;
-	bool thereIsSkin = false;
-	//unsigned long bgPixels=0;
-	//unsigned long skinPixels=0;
-	for (int i = 0; i < dims[2]; i++)
-	{
-		tissues_size_t* tissuesMain = _image_slices[i].return_tissues(0);
-		for (int j = 0; j < _area && (!thereIsBG || !thereIsSkin); j++)
-		{
-			tissues_size_t value = tissuesMain[j];
-			if (value == backgroundID)
-				//bgPixels++;
-				thereIsBG = true;
-			else if (value == skinID)
-				//skinPixels++;
-				thereIsSkin = true;
-		}
-		if (thereIsSkin && thereIsBG)
-			break;
-	}
+	tree.build(slices, _width, _height, connectivity);
+}
 
-	if (!thereIsBG || !thereIsSkin)
-	{
-		progress.setValue(numTasks);
+void SlicesHandler::construct_regions(const WatershedMergeTree& tree, unsigned h)
+{
+	if (tree.empty())
 		return;
-	}
-
-	std::vector<tissues_size_t*> tissuesVector;
-	for (int i = 0; i < _image_slices.size(); i++)
-		tissuesVector.push_back(_image_slices[i].return_tissues(0));
 
-	for (int i = 0; i < dims[2]; i++)
+	std::vector<WatershedMergeTree::marker_type> markers;
+	unsigned maxim = 1;
+	for (unsigned short z = _startslice; z < _endslice; z++)
 	{
-		float* bmp1 = _image_slices[i].return_bmp();
-
-		tissues_size_t* tissue1 = _image_slices[i].return_tissues(0);
-		_image_slices[i].pushstack_bmp();
-
-		for (unsigned int j = 0; j < _area; j++)
+		std::vector<Mark>* marks = _image_slices[z].return_marks();
+		for (auto& m : *marks)
 		{
-			bmp1[j] = (float)tissue1[j];
+			size_t i = static_cast<size_t>(z - _startslice) * _area + m.p.px + m.p.py * static_cast<size_t>(_width);
+			markers.push_back(std::make_pair(i, m.mark));
+			maxim = std::max(maxim, m.mark);
 		}
-
-		_image_slices[i].dead_reckoning((float)0);
-		bmp1 = _image_slices[i].return_work();
-	}
-
-#ifdef NO_OPENMP_SUPPORT
-	const int numberThreads = 1;
-#else
-	const int numberThreads = omp_get_max_threads();
-#endif
-	int sliceCounter = 0;
-	std::vector<std::vector<changesToMakeStruct>> partialChangesThreads;
-
-	for (int i = 0; i < numberThreads; i++)
-	{
-		changesToMakeStruct sample;
-		sample.sliceNumber = -1;
-		sample.positionConvert = -1;
-		std::vector<changesToMakeStruct> samplePerThread;
-		samplePerThread.push_back(sample);
-		partialChangesThreads.push_back(samplePerThread);
 	}
 
-	//if(skinPixels<bgPixels/neighbors)
+	std::vector<float*> target;
+	for (unsigned short z = _startslice; z < _endslice; z++)
 	{
-#pragma omp parallel for
-		for (int k = skinThick; k < dims[2] - skinThick; k++)
-		{
-			std::vector<changesToMakeStruct> partialChanges;
-
-			Point p;
-			for (int j = skinThick; j < dims[1] - skinThick; j++)
-			{
-				for (int i = skinThick; i < dims[0] - skinThick; i++)
-				{
-					int pos = i + j * dims[0];
-					if (tissuesVector[k][pos] == skinID)
-					{
-						for (int z = 0; z < offsetsSlices.size(); z++)
-						{
-							size_t neighborSlice = z - ((offsetsSlices.size() - 1) / 2);
-
-							//iterate through neighbors of pixel
-							//if any of these are not
-							for (int l = 0; l < offsetsSlices[z].size(); l++)
-							{
-								int idx = pos + offsetsSlices[z][l];
-								assert(idx >= 0 && idx < _area);
-								p.px = i;
-								p.py = j;
-								tissues_size_t value = tissuesVector[k + neighborSlice][idx];
-								if (value == backgroundID)
-								{
-									for (int y = 0; y < offsetsSlices.size(); y++)
-									{
-										size_t neighborSlice2 = y - ((offsetsSlices.size() - 1) / 2);
-
-										//iterate through neighbors of pixel
-										//if any of these are not
-										for (int m = 0; m < offsetsSlices[y].size(); m++)
-										{
-											int idx2 = idx + offsetsSlices[y][m];
-											assert(idx2 >= 0 && idx2 < _area);
-											if (k + neighborSlice + neighborSlice2 < dims[2]) // && k + neighborSlice + neighborSlice2 >= 0 (always true)
-											{
-												tissues_size_t value2 = tissuesVector[k + neighborSlice + neighborSlice2][idx2];
-												if (value2 != backgroundID && value2 != skinID)
-												{
-													changesToMakeStruct changes;
-													changes.sliceNumber = k + neighborSlice;
-													changes.positionConvert = idx;
-													if (std::find(partialChanges.begin(), partialChanges.end(), changes) == partialChanges.end())
-														partialChanges.push_back(changes);
-													//image_slices[k+neighborSlice].return_work()[idx]=255.0f;
-													break;
-												}
-											}
-										}
-									}
-								}
-							}
-						}
-					}
-				}
-			}
-
-#ifdef NO_OPENMP_SUPPORT
-			int thread_id = 0;
-#else
-			int thread_id = omp_get_thread_num();
-#endif
-
-			for (int i = 0; i < partialChanges.size(); i++)
-			{
-				partialChangesThreads[thread_id].push_back(partialChanges[i]);
-			}
-
-			if (0 == thread_id)
-			{
-				sliceCounter++;
-				progress.setValue(numberThreads * sliceCounter);
-			}
-		}
+		target.push_back(_image_slices[z].return_work());
 	}
+	tree.apply(tree.relabel(h, markers), target, 255.0f / maxim);
 
-	for (int i = 0; i < partialChangesThreads.size(); i++)
-	{
-		for (int j = 0; j < partialChangesThreads[i].size(); j++)
-		{
-			if (partialChangesThreads[i][j].sliceNumber != -1)
-			{
-				size_t slice = partialChangesThreads[i][j].sliceNumber;
-				int pos = partialChangesThreads[i][j].positionConvert;
-				_image_slices[slice].return_work()[pos] = 255.0f;
-			}
-		}
-	}
-	for (int i = dims[2] - 1; i >= 0; i--)
+	for (unsigned short z = _startslice; z < _endslice; z++)
 	{
-		float* bmp1 = _image_slices[i].return_bmp();
-
-		for (unsigned k = 0; k < _area; k++)
-		{
-			if (bmp1[k] < 0)
-				bmp1[k] = 0;
-			else
-				bmp1[k] = 255.0f;
-		}
-
-		_image_slices[i].set_mode(2, false);
-		_image_slices[i].popstack_bmp();
+		_image_slices[z].set_mode(2, false);
 	}
-
-	progress.setValue(numTasks);
 }
 
 float SlicesHandler::calculate_volume(Point p, unsigned short slicenr)
@@ -10937,6 +9327,7 @@ float SlicesHandler::calculate_tissuevolume(Point p, unsigned short slicenr)
 	Pair p1 = get_pixelsize();
 	unsigned long count = 0;
 	tissues_size_t c = get_tissue_pt(p, slicenr);
+	build_tissue_indices(_startslice, _endslice);
 	for (unsigned short j = _startslice; j < _endslice; j++)
 		count += _image_slices[j].return_tissuepixelcount(_active_tissuelayer, c);
 	return get_slicethickness() * p1.high * p1.low * count;
@@ -11125,8 +9516,8 @@ void SlicesHandler::regrow(unsigned short sourceslicenr,
 			(tissues_size_t*)malloc(sizeof(tissues_size_t) * _area);
 	tissues_size_t* results2 =
 			(tissues_size_t*)malloc(sizeof(tissues_size_t) * _area);
-	tissues_size_t* tissues1 =
-			_image_slices[sourceslicenr].return_tissues(_active_tissuelayer);
+	const tissues_size_t* tissues1 =
+			const_slice(sourceslicenr).return_tissues(_active_tissuelayer);
 	for (unsigned int i = 0; i < _area; i++)
 	{
 		if (tissues1[i] == 0)
@@ -39,6 +39,7 @@ class TissueHiearchy;
 class ColorLookupTable;
 class bmphandler;
 class ProgressInfo;
+class WatershedMergeTree;
 
 class SlicesHandler : public SlicesHandlerInterface
 {
@@ -105,6 +106,7 @@ public:
 			unsigned short dx, unsigned short dy);
 	int ReadRawOverlay(const char* filename, unsigned bitdepth, unsigned short slicenr);
 	int SaveRaw_resized(const char* filename, int dxm, int dxp, int dym, int dyp, int dzm, int dzp, bool work);
+	bool resize(int dxm, int dxp, int dym, int dyp, int dzm, int dzp);
 	int SaveTissuesRaw_resized(const char* filename, int dxm, int dxp, int dym, int dyp, int dzm, int dzp);
 	bool SwapXY();
 	bool SwapYZ();
@@ -193,6 +195,8 @@ public:
 	std::vector<tissues_size_t> tissue_selection() const override;
 
 	boost::signals2::signal<void(const std::vector<tissues_size_t>& sel)> on_tissue_selection_changed;
+	/// emitted after the data in sel (sliceNr or allSlices) has been modified, e.g. by an edit or undo/redo
+	boost::signals2::signal<void(const DataSelection& sel)> on_data_modified;
 	void set_tissue_selection(const std::vector<tissues_size_t>& sel) override;
 
 	bool has_colors() const override { return _color_lookup_table != 0; }
@@ -291,12 +295,15 @@ public:
 			const std::string initCentersFile = "");
 	void em(unsigned short slicenr, short nrtissues, unsigned int iternr,
 			unsigned int converge);
-	void extract_contours(int minsize, std::vector<tissues_size_t>& tissuevec);
-	void extract_contours2_xmirrored(int minsize,
-			std::vector<tissues_size_t>& tissuevec);
-	void extract_contours2_xmirrored(int minsize,
+	/// the slices are traced in parallel, returns false if canceled
+	bool extract_contours(int minsize, std::vector<tissues_size_t>& tissuevec,
+			ProgressInfo* progress = nullptr);
+	bool extract_contours2_xmirrored(int minsize,
 			std::vector<tissues_size_t>& tissuevec,
-			float epsilon);
+			ProgressInfo* progress = nullptr);
+	bool extract_contours2_xmirrored(int minsize,
+			std::vector<tissues_size_t>& tissuevec,
+			float epsilon, ProgressInfo* progress = nullptr);
 	void extractinterpolatesave_contours(int minsize,
 			std::vector<tissues_size_t>& tissuevec,
 			unsigned short between, bool dp,
@@ -399,7 +406,7 @@ public:
 	unsigned pushstack_help();
 	void removestack(unsigned i);
 	void clear_stack();
-	float* getstack(unsigned i, unsigned char& mode);
+	bool getstack(unsigned i, float* bits, unsigned char& mode);
 	void getstack_bmp(unsigned i);
 	void getstack_bmp(unsigned int slice, unsigned i);
 	void getstack_work(unsigned i);
@@ -436,6 +443,8 @@ public:
 	bool tissuevalue_at_boundary3D(tissues_size_t value);
 	void fill_skin_3d(int thicknessX, int thicknessY, int thicknessZ,
 			tissues_size_t backgroundID, tissues_size_t skinID);
+	void watershed_sobel(WatershedMergeTree& tree, bool connectivity);
+	void construct_regions(const WatershedMergeTree& tree, unsigned h);
 	void gamma_mhd(unsigned short slicenr, short nrtissues, short dim,
 			std::vector<std::string> mhdfiles, float* weights,
 			float** centers, float* tol_f, float* tol_d);
@@ -520,6 +529,19 @@ public:
 	void mergetissues(tissues_size_t tissuetype);
 
 private:
+	void detach_slices(std::vector<float*>& bmp, std::vector<float*>& work, std::vector<tissues_size_t*>& tissues);
+	void attach_slices(unsigned short w, unsigned short h, const std::vector<float*>& bmp, const std::vector<float*>& work,
+			const std::vector<tissues_size_t*>& tissues, unsigned char mode1, unsigned char mode2);
+	bool transpose_volume(int axis1, int axis2);
+	/// read-only access to a slice
+	const bmphandler& const_slice(unsigned short slicenr) const { return _image_slices[slicenr]; }
+	void build_tissue_indices(unsigned short startslice, unsigned short endslice) const;
+	bool trace_contours(const std::vector<tissues_size_t>& tissuevec, ProgressInfo* progress,
+			const std::function<void(unsigned short, tissues_size_t, std::vector<std::vector<Point>>*, std::vector<std::vector<Point>>*)>& trace);
+	void hysteresis(float seed_low, float seed_high, float grow_low,
+			float grow_high, bool connectivity, bool grow_across_slices,
+			float set_to);
+
 	unsigned short _activeslice;
 	std::vector<bmphandler> _image_slices;
 	short unsigned _width;
@@ -0,0 +1,258 @@
+/*
+* Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+*
+* This file is part of iSEG
+* (see https://github.com/ITISFoundation/osparc-iseg).
+*
+* This software is released under the MIT License.
+*  https://opensource.org/licenses/MIT
+*/
+#include "Precompiled.h"
+
+#include "SurfaceBrickCache.h"
+
+#include <vtkAppendPolyData.h>
+#include <vtkCleanPolyData.h>
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+#include <vtkPolyData.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+namespace iseg {
+
+namespace {
+
+/// FNV-1a hash of the voxel buffer, also reports if all voxels have the same value
+uint64_t hash_voxels(const unsigned char* data, size_t num_values, size_t value_size, bool& uniform)
+{
+	uint64_t h = 14695981039346656037ULL;
+	const size_t n = num_values * value_size;
+	for (size_t i = 0; i < n; ++i)
+	{
+		h ^= data[i];
+		h *= 1099511628211ULL;
+	}
+
+	uniform = true;
+	for (size_t i = 1; i < num_values && uniform; ++i)
+	{
+		uniform = (std::memcmp(data, data + i * value_size, value_size) == 0);
+	}
+	return h;
+}
+
+} // namespace
+
+SurfaceBrickCache::SurfaceBrickCache()
+{
+	std::fill_n(_dims, 3, 0);
+	std::fill_n(_spacing, 3, 0.0);
+	std::fill_n(_num_bricks, 3, 0);
+	_append = vtkSmartPointer<vtkAppendPolyData>::New();
+
+	// the brick meshes keep their boundary vertices, so the seam points coincide exactly
+	_clean = vtkSmartPointer<vtkCleanPolyData>::New();
+	_clean->SetInputConnection(_append->GetOutputPort());
+	_clean->PointMergingOn();
+	_clean->ToleranceIsAbsoluteOn();
+	_clean->SetAbsoluteTolerance(0.0);
+	_clean->ConvertLinesToPointsOff();
+	_clean->ConvertPolysToLinesOff();
+	_clean->ConvertStripsToPolysOff();
+}
+
+SurfaceBrickCache::~SurfaceBrickCache() {}
+
+void SurfaceBrickCache::set_geometry(const int dims[3], const double spacing[3])
+{
+	if (std::equal(dims, dims + 3, _dims) && std::equal(spacing, spacing + 3, _spacing))
+	{
+		return;
+	}
+
+	std::copy(dims, dims + 3, _dims);
+	std::copy(spacing, spacing + 3, _spacing);
+
+	for (int k = 0; k < 3; ++k)
+	{
+		_num_bricks[k] = std::max(1, (_dims[k] - 1 + k_brick_size - 1) / k_brick_size);
+	}
+
+	_bricks.clear();
+	_bricks.resize(static_cast<size_t>(_num_bricks[0]) * _num_bricks[1] * _num_bricks[2]);
+
+	size_t idx = 0;
+	for (int bz = 0; bz < _num_bricks[2]; ++bz)
+	{
+		for (int by = 0; by < _num_bricks[1]; ++by)
+		{
+			for (int bx = 0; bx < _num_bricks[0]; ++bx, ++idx)
+			{
+				int b[3] = {bx, by, bz};
+				auto& brick = _bricks[idx];
+				for (int k = 0; k < 3; ++k)
+				{
+					// one voxel overlap with the next brick
+					brick.extent[2 * k] = b[k] * k_brick_size;
+					brick.extent[2 * k + 1] = std::min(b[k] * k_brick_size + k_brick_size, std::max(_dims[k] - 1, 0));
+				}
+			}
+		}
+	}
+}
+
+void SurfaceBrickCache::invalidate_all()
+{
+	for (auto& brick : _bricks)
+	{
+		brick.dirty = true;
+	}
+}
+
+void SurfaceBrickCache::invalidate_slice(unsigned short slice)
+{
+	const size_t bricks_per_layer = static_cast<size_t>(_num_bricks[0]) * _num_bricks[1];
+	for (int bz = 0; bz < _num_bricks[2]; ++bz)
+	{
+		auto& front = _bricks[bz * bricks_per_layer];
+		if (slice >= front.extent[4] && slice <= front.extent[5])
+		{
+			for (size_t i = 0; i < bricks_per_layer; ++i)
+			{
+				_bricks[bz * bricks_per_layer + i].dirty = true;
+			}
+		}
+	}
+}
+
+void SurfaceBrickCache::remesh_all()
+{
+	for (auto& brick : _bricks)
+	{
+		brick.remesh = true;
+	}
+}
+
+vtkSmartPointer<vtkImageData> SurfaceBrickCache::read_brick(const Brick& brick, int scalar_type, const fill_function& fill) const
+{
+	auto image = vtkSmartPointer<vtkImageData>::New();
+	image->SetExtent(const_cast<int*>(brick.extent));
+	image->SetSpacing(const_cast<double*>(_spacing));
+	image->AllocateScalars(scalar_type, 1);
+	fill(brick.extent, image);
+	return image;
+}
+
+void SurfaceBrickCache::refresh(int scalar_type, const fill_function& fill)
+{
+	std::vector<size_t> dirty;
+	for (size_t i = 0; i < _bricks.size(); ++i)
+	{
+		if (_bricks[i].dirty || _bricks[i].scalar_type != scalar_type)
+		{
+			dirty.push_back(i);
+		}
+	}
+
+	const int n = static_cast<int>(dirty.size());
+#pragma omp parallel for schedule(dynamic)
+	for (int i = 0; i < n; ++i)
+	{
+		auto& brick = _bricks[dirty[i]];
+		auto image = read_brick(brick, scalar_type, fill);
+
+		const size_t num_values = static_cast<size_t>(image->GetNumberOfPoints());
+		bool uniform = false;
+		uint64_t hash = hash_voxels(static_cast<const unsigned char*>(image->GetScalarPointer()),
+				num_values, image->GetScalarSize(), uniform);
+
+		if (hash != brick.hash || num_values != brick.num_values || scalar_type != brick.scalar_type)
+		{
+			brick.remesh = true;
+		}
+		brick.hash = hash;
+		brick.num_values = num_values;
+		brick.scalar_type = scalar_type;
+		brick.uniform = uniform;
+		image->GetPointData()->GetScalars()->GetRange(brick.range);
+
+		// keep the voxels for re-meshing, so they are not read twice
+		brick.image = brick.remesh ? image : nullptr;
+		brick.dirty = false;
+	}
+}
+
+void SurfaceBrickCache::value_range(double range[2]) const
+{
+	range[0] = std::numeric_limits<double>::max();
+	range[1] = std::numeric_limits<double>::lowest();
+	for (auto& brick : _bricks)
+	{
+		range[0] = std::min(range[0], brick.range[0]);
+		range[1] = std::max(range[1], brick.range[1]);
+	}
+	if (_bricks.empty())
+	{
+		range[0] = range[1] = 0.0;
+	}
+}
+
+size_t SurfaceBrickCache::update(int scalar_type, const fill_function& fill, const extract_function& extract)
+{
+	refresh(scalar_type, fill);
+
+	std::vector<size_t> remesh;
+	for (size_t i = 0; i < _bricks.size(); ++i)
+	{
+		if (_bricks[i].remesh)
+		{
+			remesh.push_back(i);
+		}
+	}
+
+	const int n = static_cast<int>(remesh.size());
+#pragma omp parallel for schedule(dynamic)
+	for (int i = 0; i < n; ++i)
+	{
+		auto& brick = _bricks[remesh[i]];
+		// a constant brick has no iso-surface or label boundary
+		if (brick.uniform)
+		{
+			brick.mesh = nullptr;
+		}
+		else
+		{
+			brick.mesh = extract(brick.image ? brick.image.GetPointer() : read_brick(brick, scalar_type, fill).GetPointer());
+		}
+		brick.image = nullptr;
+		brick.remesh = false;
+	}
+
+	_append->RemoveAllInputs();
+	for (auto& brick : _bricks)
+	{
+		if (brick.mesh && brick.mesh->GetNumberOfCells() > 0)
+		{
+			_append->AddInputData(brick.mesh);
+		}
+	}
+	if (_append->GetNumberOfInputConnections(0) == 0)
+	{
+		_append->AddInputData(vtkSmartPointer<vtkPolyData>::New());
+	}
+	_clean->Update();
+
+	return remesh.size();
+}
+
+vtkPolyData* SurfaceBrickCache::output() const
+{
+	return _clean->GetOutput();
+}
+
+} // namespace iseg
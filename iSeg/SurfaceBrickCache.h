@@ -0,0 +1,101 @@
+/*
+* Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+*
+* This file is part of iSEG
+* (see https://github.com/ITISFoundation/osparc-iseg).
+*
+* This software is released under the MIT License.
+*  https://opensource.org/licenses/MIT
+*/
+#pragma once
+
+#include <vtkSmartPointer.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class vtkAppendPolyData;
+class vtkCleanPolyData;
+class vtkImageData;
+class vtkPolyData;
+
+namespace iseg {
+
+/** \brief Caches one surface mesh per brick of the volume
+
+	The volume is split into bricks of k_brick_size^3 cells. Neighboring bricks
+	share one layer of voxels, so each marching cubes cell belongs to exactly one
+	brick and the union of the brick meshes equals the surface of the whole volume.
+
+	Only bricks marked as dirty are read again. Their value range is updated, and
+	they are re-meshed if the voxel content changed (64-bit hash, number of values
+	and scalar type differ) or if all meshes were invalidated, e.g. because the
+	iso-value changed. The brick meshes must keep their boundary vertices, so the
+	seams can be merged exactly after appending.
+*/
+class SurfaceBrickCache
+{
+public:
+	enum { k_brick_size = 32 };
+
+	/// copies the voxels of the (inclusive) point extent into the brick image
+	using fill_function = std::function<void(const int extent[6], vtkImageData* brick)>;
+	/// computes the surface of a brick image, must be thread-safe
+	using extract_function = std::function<vtkSmartPointer<vtkPolyData>(vtkImageData* brick)>;
+
+	SurfaceBrickCache();
+	~SurfaceBrickCache();
+
+	/// resets the cache if the dimensions or spacing differ from the cached ones
+	void set_geometry(const int dims[3], const double spacing[3]);
+
+	/// marks the voxels of all bricks as possibly modified
+	void invalidate_all();
+	/// marks the voxels of the bricks containing the slice as possibly modified
+	void invalidate_slice(unsigned short slice);
+	/// re-meshes all bricks on the next update, the voxels are only read if dirty
+	void remesh_all();
+
+	/// reads the dirty bricks in parallel, updates their value range and flags the changed ones for re-meshing
+	void refresh(int scalar_type, const fill_function& fill);
+
+	/// value range of all bricks, valid after refresh
+	void value_range(double range[2]) const;
+
+	/// re-extracts the flagged bricks in parallel and re-assembles the output, returns number of re-meshed bricks
+	size_t update(int scalar_type, const fill_function& fill, const extract_function& extract);
+
+	/// merged surface of all bricks
+	vtkPolyData* output() const;
+
+	size_t number_of_bricks() const { return _bricks.size(); }
+
+private:
+	struct Brick
+	{
+		int extent[6];
+		bool dirty = true;
+		bool remesh = true;
+		uint64_t hash = 0;
+		size_t num_values = 0;
+		int scalar_type = -1;
+		double range[2] = {0.0, 0.0};
+		bool uniform = true;
+		/// voxels read by refresh, kept until the brick is re-meshed
+		vtkSmartPointer<vtkImageData> image;
+		vtkSmartPointer<vtkPolyData> mesh;
+	};
+
+	vtkSmartPointer<vtkImageData> read_brick(const Brick& brick, int scalar_type, const fill_function& fill) const;
+
+	int _dims[3];
+	double _spacing[3];
+	int _num_bricks[3];
+	std::vector<Brick> _bricks;
+	vtkSmartPointer<vtkAppendPolyData> _append;
+	vtkSmartPointer<vtkCleanPolyData> _clean;
+};
+
+} // namespace iseg
@@ -10,6 +10,7 @@
 #include "Precompiled.h"
 
 #include "SlicesHandler.h"
+#include "SurfaceBrickCache.h"
 #include "SurfaceViewerWidget.h"
 #include "TissueInfos.h"
 
@@ -21,7 +22,6 @@
 #include <QMenu>
 #include <QResizeEvent>
 
-#include <vtkBitArray.h>
 #include <vtkCellData.h>
 #include <vtkDiscreteFlyingEdges3D.h>
 #include <vtkFlyingEdges3D.h>
@@ -40,6 +40,8 @@
 #include <vtkRenderWindow.h>
 #include <vtkRenderer.h>
 
+#include <algorithm>
+
 #include <vtkAutoInit.h>
 #ifdef ISEG_VTK_OPENGL2
 VTK_MODULE_INIT(vtkRenderingOpenGL2);
@@ -55,26 +57,40 @@ namespace iseg {
 namespace {
 
 template<typename TIn, typename TOut, typename TMap>
-void transform_slices(const std::vector<TIn*>& slices, size_t slice_size, TOut* out, const TMap& map)
+void transform_brick(const std::vector<TIn*>& slices, size_t width, const int extent[6], vtkImageData* brick, const TMap& map)
 {
-	for (auto slice : slices)
+	auto out = static_cast<TOut*>(brick->GetScalarPointer());
+	for (int z = extent[4]; z <= extent[5]; ++z)
 	{
-		std::transform(slice, slice + slice_size, out, map);
-		std::advance(out, slice_size);
+		for (int y = extent[2]; y <= extent[3]; ++y)
+		{
+			const TIn* row = slices[z] + y * width;
+			out = std::transform(row + extent[0], row + extent[1] + 1, out, map);
+		}
 	}
 }
 
-template<typename TIn, typename TArray, typename TMap>
-void transform_slices_vtk(const std::vector<TIn*>& slices, size_t slice_size, TArray* out, const TMap& map)
+vtkSmartPointer<vtkPolyData> decimate_surface(vtkPolyDataAlgorithm* surface, double target_reduction)
 {
-	size_t idx = 0, i;
-	for (auto& slice : slices)
+	auto output = vtkSmartPointer<vtkPolyData>::New();
+	if (target_reduction > 0.0)
 	{
-		for (i = 0; i < slice_size; ++i)
-		{
-			out->SetValue(idx++, map(slice[i]));
-		}
+		auto decimate = vtkSmartPointer<vtkDecimatePro>::New();
+		decimate->PreserveTopologyOn();
+		// pins the vertices on the brick seams, so they can be merged after appending
+		decimate->BoundaryVertexDeletionOff();
+		decimate->SplittingOff();
+		decimate->SetTargetReduction(target_reduction);
+		decimate->SetInputConnection(surface->GetOutputPort());
+		decimate->Update();
+		output->ShallowCopy(decimate->GetOutput());
 	}
+	else
+	{
+		surface->Update();
+		output->ShallowCopy(surface->GetOutput());
+	}
+	return output;
 }
 
 enum eActions {
@@ -166,7 +182,7 @@ SurfaceViewerWidget::SurfaceViewerWidget(SlicesHandler* hand3D1, eInputType inpu
 	connect(sl_trans, SIGNAL(sliderReleased()), this, SLOT(transp_changed()));
 	connect(bt_update, SIGNAL(clicked()), this, SLOT(reload()));
 	connect(bt_connectivity, SIGNAL(clicked()), this, SLOT(split_surface()));
-	connect(reduction, SIGNAL(editingFinished()), this, SLOT(reduction_changed));
+	connect(reduction, SIGNAL(editingFinished()), this, SLOT(reduction_changed()));
 
 	// setup vtk scene
 	ren3D = vtkSmartPointer<vtkRenderer>::New();
@@ -192,15 +208,28 @@ SurfaceViewerWidget::SurfaceViewerWidget(SlicesHandler* hand3D1, eInputType inpu
 	connections->Connect(vtkWidget->GetRenderWindow()->GetInteractor(), vtkCommand::RightButtonPressEvent,
 			this, SLOT(popup(vtkObject*, unsigned long, void*, void*, vtkCommand*)), popup_actions, 1.0);
 
-	// copy input data and setup VTK pipeline
+	// surface is extracted per brick, only edited bricks are re-meshed on reload
 	input = vtkSmartPointer<vtkImageData>::New();
-	discreteCubes = vtkSmartPointer<vtkDiscreteFlyingEdges3D>::New();
-	cubes = vtkSmartPointer<vtkFlyingEdges3D>::New();
-	decimate = vtkSmartPointer<vtkDecimatePro>::New();
-	decimate->PreserveTopologyOn();
-	decimate->BoundaryVertexDeletionOff();
-	decimate->SplittingOff();
-	decimate->SetTargetReduction(reduction->text().toDouble() / 100.0);
+	brick_cache.reset(new SurfaceBrickCache);
+	iso_value = 0.0;
+	target_reduction = reduction->text().toDouble() / 100.0;
+
+	data_modified_connection = hand3D->on_data_modified.connect([this](const DataSelection& sel) {
+		bool relevant = (input_type == kSource && sel.bmp) ||
+										(input_type == kTarget && sel.work) ||
+										(input_type == kSelectedTissues && sel.tissues);
+		if (relevant)
+		{
+			if (sel.allSlices)
+			{
+				brick_cache->invalidate_all();
+			}
+			else
+			{
+				brick_cache->invalidate_slice(sel.sliceNr);
+			}
+		}
+	});
 
 	load();
 
@@ -221,41 +250,68 @@ void SurfaceViewerWidget::load()
 {
 	auto tissue_selection = hand3D->tissue_selection();
 	auto spacing = hand3D->spacing();
-	size_t slice_size = static_cast<size_t>(hand3D->width()) * hand3D->height();
+	size_t width = hand3D->width();
 
+	// geometry only, the voxels are copied brick by brick
 	input->SetExtent(0, (int)hand3D->width() - 1, 0,
 			(int)hand3D->height() - 1, 0,
 			(int)hand3D->num_slices() - 1);
 	input->SetSpacing(spacing[0], spacing[1], spacing[2]);
 
+	int dims[3] = {(int)hand3D->width(), (int)hand3D->height(), (int)hand3D->num_slices()};
+	double brick_spacing[3] = {spacing[0], spacing[1], spacing[2]};
+	brick_cache->set_geometry(dims, brick_spacing);
+
+	if (input_type == kSelectedTissues && tissue_selection != brick_tissue_selection)
+	{
+		brick_tissue_selection = tissue_selection;
+		brick_cache->remesh_all();
+	}
+
 	index_tissue_map.clear();
 
+	int scalar_type = VTK_UNSIGNED_CHAR;
+	SurfaceBrickCache::fill_function fill;
+	range[0] = range[1] = 0.0;
+
 	if (input_type == kSource) // iso-surface
 	{
 		auto slices = hand3D->source_slices();
-		input->AllocateScalars(VTK_FLOAT, 1);
-		auto field = (float*)input->GetScalarPointer();
-		transform_slices(slices, slice_size, field, [](float v) { return v; });
+		scalar_type = VTK_FLOAT;
+		fill = [slices, width](const int extent[6], vtkImageData* brick) {
+			transform_brick<float, float>(slices, width, extent, brick, [](float v) { return v; });
+		};
+
+		// only the value ranges of the edited bricks are recomputed
+		brick_cache->refresh(scalar_type, fill);
+		brick_cache->value_range(range);
 	}
 	else if (input_type == kTarget) // foreground
 	{
 		auto slices = hand3D->target_slices();
-		input->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
-		auto field = vtkUnsignedCharArray::SafeDownCast(input->GetPointData()->GetScalars());
-		transform_slices_vtk(slices, slice_size, field, [](float v) { return v > 0.f ? 1 : 0; });
+		range[1] = 1.0;
+
+		fill = [slices, width](const int extent[6], vtkImageData* brick) {
+			transform_brick<float, unsigned char>(slices, width, extent, brick, [](float v) { return v > 0.f ? 1 : 0; });
+		};
 	}
 	else if (tissue_selection.size() > 254) // all tissues
 	{
 		auto slices = hand3D->tissue_slices(0);
-		input->AllocateScalars(VTK_UNSIGNED_SHORT, 1);
-		auto field = static_cast<tissues_size_t*>(input->GetScalarPointer());
 
 		std::vector<tissues_size_t> tissue_index_map(TissueInfos::GetTissueCount() + 1, 0);
 		for (auto tissue_type : tissue_selection)
 		{
 			tissue_index_map[tissue_type] = tissue_type;
+			range[1] = std::max<double>(range[1], tissue_type);
 		}
-		transform_slices(slices, slice_size, field, [tissue_index_map](tissues_size_t v) { return tissue_index_map.at(v); });
+
+		scalar_type = VTK_UNSIGNED_SHORT;
+		fill = [slices, width, tissue_index_map](const int extent[6], vtkImageData* brick) {
+			transform_brick<tissues_size_t, tissues_size_t>(slices, width, extent, brick, [&tissue_index_map](tissues_size_t v) {
+				return v < tissue_index_map.size() ? tissue_index_map[v] : 0;
+			});
+		};
 	}
 	else if (tissue_selection.size() >= 1) // [1, 254]
 	{
@@ -266,29 +322,24 @@ void SurfaceViewerWidget::load()
 			index_tissue_map[count] = tissue_type;
 			tissue_index_map[tissue_type] = count++;
 		}
+		range[1] = count - 1;
 
 		auto slices = hand3D->tissue_slices(0);
-		input->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
-		auto field = static_cast<unsigned char*>(input->GetScalarPointer());
-		try
-		{
-			transform_slices(slices, slice_size, field, [tissue_index_map](tissues_size_t v) { return tissue_index_map.at(v); });
-		}
-		catch (std::exception& e)
-		{
-			ISEG_ERROR("bad tissue index map " << e.what());
-			std::fill_n(field, slices.size() * slice_size, 0);
-		}
+		fill = [slices, width, tissue_index_map](const int extent[6], vtkImageData* brick) {
+			transform_brick<tissues_size_t, unsigned char>(slices, width, extent, brick, [&tissue_index_map](tissues_size_t v) {
+				return v < tissue_index_map.size() ? tissue_index_map[v] : 0;
+			});
+		};
 	}
 	else
 	{
-		input->AllocateScalars(VTK_BIT, 1);
-		auto field = vtkBitArray::SafeDownCast(input->GetPointData()->GetScalars());
-		field->FillComponent(0, 0);
+		fill = [](const int extent[6], vtkImageData* brick) {
+			auto field = static_cast<unsigned char*>(brick->GetScalarPointer());
+			std::fill_n(field, brick->GetNumberOfPoints(), 0);
+		};
 	}
 
 	// Define all of the variables
-	input->GetScalarRange(range);
 	startLabel = range[0];
 	endLabel = range[1];
 	startLabel = 1;
@@ -296,28 +347,45 @@ void SurfaceViewerWidget::load()
 	mapper = vtkSmartPointer<vtkPolyDataMapper>::New();
 	actor = vtkSmartPointer<vtkQuadricLODActor>::New();
 
+	double reduction = target_reduction;
+	SurfaceBrickCache::extract_function extract;
 	if (input_type == kSource)
 	{
-		cubes->SetInputData(input);
-		cubes->SetValue(0, range[0] + 0.01 * (range[1] - range[0]) * sl_thresh->value());
-
-		decimate->SetInputConnection(cubes->GetOutputPort());
+		double value = range[0] + 0.01 * (range[1] - range[0]) * sl_thresh->value();
+		if (value != iso_value)
+		{
+			iso_value = value;
+			brick_cache->remesh_all();
+		}
 
-		mapper->SetInputConnection(decimate->GetOutputPort());
-		mapper->ScalarVisibilityOff();
+		extract = [value, reduction](vtkImageData* brick) {
+			auto cubes = vtkSmartPointer<vtkFlyingEdges3D>::New();
+			cubes->SetInputData(brick);
+			cubes->SetValue(0, value);
+			return decimate_surface(cubes, reduction);
+		};
 	}
 	else
 	{
-		discreteCubes->SetInputData(input);
-		discreteCubes->GenerateValues(endLabel - startLabel + 1, startLabel, endLabel);
+		unsigned int start = startLabel, end = endLabel;
+		extract = [start, end, reduction](vtkImageData* brick) {
+			auto cubes = vtkSmartPointer<vtkDiscreteFlyingEdges3D>::New();
+			cubes->SetInputData(brick);
+			cubes->GenerateValues(end - start + 1, start, end);
+			return decimate_surface(cubes, reduction);
+		};
+	}
 
-		// if split surface
-		// merge duplicate points (check if necessary)
-		// connectivity filter & set random colors
-		// mapper set input to connectivity output
-		decimate->SetInputConnection(discreteCubes->GetOutputPort());
+	auto num_remeshed = brick_cache->update(scalar_type, fill, extract);
+	ISEG_INFO("Re-meshed " << num_remeshed << " of " << brick_cache->number_of_bricks() << " surface bricks");
 
-		mapper->SetInputConnection(decimate->GetOutputPort());
+	mapper->SetInputData(brick_cache->output());
+	if (input_type == kSource)
+	{
+		mapper->ScalarVisibilityOff();
+	}
+	else
+	{
 		if (input_type == kTarget)
 		{
 			mapper->ScalarVisibilityOff();
@@ -339,8 +407,9 @@ void SurfaceViewerWidget::load()
 
 void SurfaceViewerWidget::split_surface()
 {
+	// the brick seams are already merged by the brick cache
 	auto connectivity = vtkSmartPointer<vtkPolyDataConnectivityFilter>::New();
-	connectivity->SetInputConnection(mapper->GetInputConnection(0, 0));
+	connectivity->SetInputData(brick_cache->output());
 	connectivity->SetExtractionModeToAllRegions();
 	connectivity->ScalarConnectivityOff();
 	connectivity->ColorRegionsOn();
@@ -532,19 +601,13 @@ void SurfaceViewerWidget::build_lookuptable()
 
 void SurfaceViewerWidget::pixelsize_changed(Pair p)
 {
-	input->SetSpacing(p.high, p.low, hand3D->get_slicethickness());
-	input->Modified();
-
-	vtkWidget->GetRenderWindow()->Render();
+	// the brick cache is reset, since the spacing changed
+	reload();
 }
 
 void SurfaceViewerWidget::thickness_changed(float thick)
 {
-	Pair p = hand3D->get_pixelsize();
-	input->SetSpacing(p.high, p.low, thick);
-	input->Modified();
-
-	vtkWidget->GetRenderWindow()->Render();
+	reload();
 }
 
 void SurfaceViewerWidget::reload()
@@ -553,8 +616,6 @@ void SurfaceViewerWidget::reload()
 
 	load();
 
-	input->Modified();
-
 	vtkWidget->GetRenderWindow()->Render();
 }
 
@@ -575,25 +636,25 @@ void SurfaceViewerWidget::thresh_changed()
 {
 	if (input_type == kSource)
 	{
-		cubes->SetValue(0, range[0] + 0.01 * (range[1] - range[0]) * sl_thresh->value());
-
-		vtkWidget->GetRenderWindow()->Render();
+		// new iso-value invalidates all bricks
+		reload();
 	}
 }
 
 void SurfaceViewerWidget::reduction_changed()
 {
-	decimate->SetTargetReduction(reduction->text().toDouble() / 100.0);
+	target_reduction = reduction->text().toDouble() / 100.0;
+	brick_cache->remesh_all();
 
-	vtkWidget->GetRenderWindow()->Render();
+	reload();
 }
 
 int SurfaceViewerWidget::get_picked_tissue() const
 {
 	double* worldPosition = picker->GetPickPosition();
-	if (discreteCubes)
+	if (input_type != kSource)
 	{
-		auto surface = discreteCubes->GetOutput();
+		auto surface = brick_cache->output();
 		vtkIdType pointId = surface->FindPoint(worldPosition);
 
 		if (pointId != -1)
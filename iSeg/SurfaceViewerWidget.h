@@ -18,7 +18,13 @@
 
 #include <vtkSmartPointer.h>
 
+#ifndef Q_MOC_RUN
+#	include <boost/signals2.hpp>
+#endif
+
 #include <map>
+#include <memory>
+#include <vector>
 
 class QVTKWidget;
 class QVTKInteractor;
@@ -31,9 +37,7 @@ class QCheckBox;
 class vtkActor;
 class vtkInteractorStyleTrackballCamera;
 class vtkImageData;
-class vtkFlyingEdges3D;
-class vtkDiscreteFlyingEdges3D;
-class vtkDecimatePro;
+class vtkPolyData;
 class vtkPolyDataMapper;
 class vtkRenderer;
 class vtkEventQtSlotConnect;
@@ -45,6 +49,7 @@ class vtkLookupTable;
 namespace iseg {
 
 class SlicesHandler;
+class SurfaceBrickCache;
 
 class SurfaceViewerWidget : public QWidget
 {
@@ -104,13 +109,16 @@ private:
 	vtkSmartPointer<vtkImageData> input;
 	vtkSmartPointer<vtkRenderer> ren3D;
 	vtkSmartPointer<vtkInteractorStyleTrackballCamera> style;
-	vtkSmartPointer<vtkDiscreteFlyingEdges3D> discreteCubes;
-	vtkSmartPointer<vtkFlyingEdges3D> cubes;
-	vtkSmartPointer<vtkDecimatePro> decimate;
 	vtkSmartPointer<vtkPolyDataMapper> mapper;
 	vtkSmartPointer<vtkActor> actor;
 	vtkSmartPointer<vtkLookupTable> lut;
 
+	std::unique_ptr<SurfaceBrickCache> brick_cache;
+	boost::signals2::scoped_connection data_modified_connection;
+	std::vector<tissues_size_t> brick_tissue_selection;
+	double iso_value;
+	double target_reduction;
+
 	double range[2];
 	std::map<int, tissues_size_t> index_tissue_map;
 	unsigned int startLabel;
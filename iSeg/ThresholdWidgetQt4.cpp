@@ -830,12 +830,17 @@ void ThresholdWidgetQt4::on_mExecutePushButton_clicked()
 	else
 	{
 		//		EM em;
+		std::vector<std::vector<float>> stack_bits(ui.mKMeansDimsSpinBox->value());
 		for (int i = 0; i < ui.mKMeansDimsSpinBox->value(); i++)
 		{
 			if (bits1[i] == 0)
 				bits[i] = handler3D->get_activebmphandler()->return_bmp();
 			else
-				bits[i] = handler3D->get_activebmphandler()->getstack(bits1[i], modedummy);
+			{
+				stack_bits[i].resize(handler3D->return_area());
+				handler3D->get_activebmphandler()->getstack(bits1[i], stack_bits[i].data(), modedummy);
+				bits[i] = stack_bits[i].data();
+			}
 		}
 
 		if (ui.mAllSlicesCheckBox->isChecked())
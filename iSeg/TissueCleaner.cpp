@@ -12,16 +12,14 @@
 #include "TissueCleaner.h"
 #include "TissueInfos.h"
 
-#include <cstdlib>
+#include <algorithm>
+#include <limits>
+#include <new>
 
 namespace iseg {
 
-int TissueCleaner::base_connection(int c)
-{
-	if (c == map[c])
-		return c;
-	else
-		return map[c] = base_connection(map[c]);
+namespace {
+const size_t max_slabs = 64;
 }
 
 TissueCleaner::TissueCleaner(tissues_size_t** slices1, unsigned short n1,
@@ -31,287 +29,259 @@ TissueCleaner::TissueCleaner(tissues_size_t** slices1, unsigned short n1,
 	nrslices = static_cast<size_t>(n1);
 	width = static_cast<size_t>(width1);
 	height = static_cast<size_t>(height1);
-	volume = nullptr;
-	map.clear();
 }
 
-TissueCleaner::~TissueCleaner() { free(volume); }
-
-bool TissueCleaner::Allocate()
+size_t TissueCleaner::run_end(const tissues_size_t* row, size_t x) const
 {
-	volume = (int*)malloc(sizeof(int) * width * height * nrslices);
-	if (volume == nullptr)
-		return false;
-	return true;
+	const tissues_size_t value = row[x];
+	while (++x < width && row[x] == value)
+	{
+	}
+	return x;
 }
 
-void TissueCleaner::ConnectedComponents()
+unsigned TissueCleaner::find_root(unsigned c)
 {
-	map.clear();
-	int newest = 0;
-
-	size_t offset[4];
-	offset[0] = 1;
-	offset[1] = width;
-	offset[2] = width * height;
-	offset[3] = offset[2] * nrslices;
+	// path halving, parents always have a smaller index
+	while (map[c] != c)
+	{
+		map[c] = map[map[c]];
+		c = map[c];
+	}
+	return c;
+}
 
-	size_t i1 = 0;
-	size_t i2 = 0;
+void TissueCleaner::unite(unsigned c1, unsigned c2)
+{
+	c1 = find_root(c1);
+	c2 = find_root(c2);
+	if (c1 < c2)
+		map[c2] = c1;
+	else if (c2 < c1)
+		map[c1] = c2;
+}
 
-	// init first pixel
-	map.push_back(newest);
-	tissuemap.push_back(slices[0][i1]);
-	volume[i1] = newest;
-	newest++;
-	i1++;
-	// init first row
-	for (unsigned short k = 1; k < width; k++)
+void TissueCleaner::connect_rows(const tissues_size_t* row1, size_t run1, const tissues_size_t* row2, size_t run2)
+{
+	// walk both rows run by run, the current runs always overlap
+	size_t x1 = 0, x2 = 0;
+	size_t end1 = run_end(row1, 0), end2 = run_end(row2, 0);
+	while (true)
 	{
-		if (slices[0][i1] == slices[0][i1 - 1])
+		if (row1[x1] == row2[x2])
+			unite(static_cast<unsigned>(run1), static_cast<unsigned>(run2));
+
+		if (end1 == end2)
 		{
-			volume[i1] = base_connection(volume[i1 - 1]);
+			if (end1 == width)
+				break;
+			x1 = x2 = end1;
+			end1 = run_end(row1, x1);
+			end2 = run_end(row2, x2);
+			run1++;
+			run2++;
 		}
-		else
+		else if (end1 < end2)
 		{
-			map.push_back(newest);
-			tissuemap.push_back(slices[0][i1]);
-			volume[i1] = newest;
-			newest++;
-		}
-		i1++;
-	}
-	// init first slice
-	for (unsigned short j = 1; j < height; j++)
-	{
-		if (slices[0][i1] == slices[0][i1 - width])
-		{
-			volume[i1] = base_connection(volume[i1 - width]);
+			x1 = end1;
+			end1 = run_end(row1, x1);
+			run1++;
 		}
 		else
 		{
-			map.push_back(newest);
-			tissuemap.push_back(slices[0][i1]);
-			volume[i1] = newest;
-			newest++;
-		}
-		i1++;
-		for (unsigned short k = 1; k < width; k++)
-		{
-			if (slices[0][i1] == slices[0][i1 - 1])
-			{
-				volume[i1] = base_connection(volume[i1 - 1]);
-				if (slices[0][i1] == slices[0][i1 - width])
-				{
-					map[(int)base_connection(volume[i1 - width])] = volume[i1];
-				}
-			}
-			else
-			{
-				if (slices[0][i1] == slices[0][i1 - width])
-				{
-					volume[i1] = base_connection(volume[i1 - width]);
-				}
-				else
-				{
-					map.push_back(newest);
-					tissuemap.push_back(slices[0][i1]);
-					volume[i1] = newest;
-					newest++;
-				}
-			}
-			i1++;
+			x2 = end2;
+			end2 = run_end(row2, x2);
+			run2++;
 		}
 	}
-	// for each slice >= 1
-	for (unsigned short i = 1; i < nrslices; i++)
+}
+
+bool TissueCleaner::Allocate()
+{
+	if (width == 0 || height == 0)
+		return false;
+
+	try
 	{
-		i2 = 0;
-		if (slices[i][i2] == slices[i - 1][i2])
-			volume[i1] = base_connection(volume[i1 - offset[2]]);
-		else
-		{
-			map.push_back(newest);
-			tissuemap.push_back(slices[i][i2]);
-			volume[i1] = newest;
-			newest++;
-		}
-		i1++;
-		i2++;
-		for (unsigned short k = 1; k < width; k++)
+		// index of the first run of each row
+		row_runs.assign(nrslices * height + 1, 0);
+		const int n = static_cast<int>(nrslices);
+#pragma omp parallel for
+		for (int i = 0; i < n; i++)
 		{
-			if (slices[i][i2] == slices[i][i2 - 1])
-			{
-				volume[i1] = base_connection(volume[i1 - 1]);
-				if (slices[i][i2] == slices[i - 1][i2])
-				{
-					map[(int)base_connection(volume[i1 - offset[2]])] =
-							volume[i1];
-				}
-			}
-			else
+			for (size_t j = 0; j < height; j++)
 			{
-				if (slices[i][i2] == slices[i - 1][i2])
-					volume[i1] = base_connection(volume[i1 - offset[2]]);
-				else
+				const tissues_size_t* row = slices[i] + j * width;
+				size_t count = 1;
+				for (size_t k = 1; k < width; k++)
 				{
-					map.push_back(newest);
-					tissuemap.push_back(slices[i][i2]);
-					volume[i1] = newest;
-					newest++;
+					if (row[k] != row[k - 1])
+						count++;
 				}
+				row_runs[i * height + j + 1] = count;
 			}
-			i1++;
-			i2++;
 		}
-		for (unsigned short j = 1; j < height; j++)
+		for (size_t r = 1; r < row_runs.size(); r++)
+			row_runs[r] += row_runs[r - 1];
+
+		if (row_runs.back() > std::numeric_limits<unsigned>::max())
+			return false;
+		map.resize(row_runs.back());
+	}
+	catch (std::bad_alloc&)
+	{
+		return false;
+	}
+	return true;
+}
+
+void TissueCleaner::ConnectedComponents()
+{
+	if (map.empty())
+		return;
+
+	const int n = static_cast<int>(nrslices);
+#pragma omp parallel for
+	for (int i = 0; i < n; i++)
+	{
+		for (size_t c = first_run(i, 0); c < first_run(i + 1, 0); c++)
+			map[c] = static_cast<unsigned>(c);
+	}
+
+	const int nrslabs = static_cast<int>(std::min(nrslices, max_slabs));
+	slabs.resize(nrslabs + 1);
+	for (int s = 0; s <= nrslabs; s++)
+		slabs[s] = s * nrslices / nrslabs;
+
+	// label the slabs independently, the unions only touch runs of the slab
+#pragma omp parallel for schedule(dynamic)
+	for (int s = 0; s < nrslabs; s++)
+	{
+		for (size_t i = slabs[s]; i < slabs[s + 1]; i++)
 		{
-			if (slices[i][i2] == slices[i][i2 - width])
+			for (size_t j = 0; j < height; j++)
 			{
-				volume[i1] = base_connection(volume[i1 - width]);
-				if (slices[i][i2] == slices[i - 1][i2])
-				{
-					map[(int)base_connection(volume[i1 - offset[2]])] =
-							volume[i1];
-				}
-			}
-			else
-			{
-				if (slices[i][i2] == slices[i - 1][i2])
-					volume[i1] = base_connection(volume[i1 - offset[2]]);
-				else
-				{
-					map.push_back(newest);
-					tissuemap.push_back(slices[i][i2]);
-					volume[i1] = newest;
-					newest++;
-				}
-			}
-			i1++;
-			i2++;
-			for (unsigned short k = 1; k < width; k++)
-			{
-				if (slices[i][i2] == slices[i][i2 - 1])
-				{
-					volume[i1] = base_connection(volume[i1 - 1]);
-					if (slices[i][i2] == slices[i][i2 - width])
-					{
-						map[(int)base_connection(volume[i1 - width])] =
-								volume[i1];
-					}
-					if (slices[i][i2] == slices[i - 1][i2])
-					{
-						map[(int)base_connection(volume[i1 - offset[2]])] =
-								volume[i1];
-					}
-				}
-				else
-				{
-					if (slices[i][i2] == slices[i][i2 - width])
-					{
-						volume[i1] = base_connection(volume[i1 - width]);
-						if (slices[i][i2] == slices[i - 1][i2])
-						{
-							map[(int)base_connection(volume[i1 - offset[2]])] =
-									volume[i1];
-						}
-					}
-					else
-					{
-						if (slices[i][i2] == slices[i - 1][i2])
-							volume[i1] =
-									base_connection(volume[i1 - offset[2]]);
-						else
-						{
-							map.push_back(newest);
-							tissuemap.push_back(slices[i][i2]);
-							volume[i1] = newest;
-							newest++;
-						}
-					}
-				}
-				i1++;
-				i2++;
+				const tissues_size_t* row = slices[i] + j * width;
+				if (j > 0)
+					connect_rows(row, first_run(i, j), row - width, first_run(i, j - 1));
+				if (i > slabs[s])
+					connect_rows(row, first_run(i, j), slices[i - 1] + j * width, first_run(i - 1, j));
 			}
 		}
 	}
 
-	// map connected regions to single ID
-	for (size_t i = 0; i < offset[3]; i++)
-		volume[i] = base_connection(volume[i]);
+	// join the slabs
+	for (int s = 1; s < nrslabs; s++)
+	{
+		const size_t i = slabs[s];
+		for (size_t j = 0; j < height; j++)
+			connect_rows(slices[i] + j * width, first_run(i, j), slices[i - 1] + j * width, first_run(i - 1, j));
+	}
+
+	// each root is the first run of its component, so a single forward pass
+	// replaces the parents by consecutive component labels
+	slab_labels.resize(nrslabs + 1);
+	unsigned next = 0;
+	for (int s = 0; s < nrslabs; s++)
+	{
+		slab_labels[s] = next;
+		for (size_t c = first_run(slabs[s], 0); c < first_run(slabs[s + 1], 0); c++)
+			map[c] = (map[c] == c) ? next++ : map[map[c]];
+	}
+	slab_labels[nrslabs] = next;
 }
 
 void TissueCleaner::MakeStat()
 {
 	for (unsigned i = 0; i < TISSUES_SIZE_MAX + 1; i++)
 		totvolumes[i] = 0;
-	volumes.resize(map.size(), 0);
-	if (volume == nullptr)
+	if (slab_labels.empty())
 		return;
-	size_t maxi = nrslices * (size_t)width * size_t(height);
-	for (unsigned long long i = 0; i < maxi; i++)
-	{
-		volumes[volume[i]]++;
-	}
-	for (size_t i = 0; i < map.size(); i++)
+
+	volumes.assign(slab_labels.back(), 0);
+	tissuemap.assign(slab_labels.back(), 0);
+	unsigned* vol = volumes.data();
+
+	const int nrslabs = static_cast<int>(slabs.size()) - 1;
+#pragma omp parallel for schedule(dynamic)
+	for (int s = 0; s < nrslabs; s++)
 	{
-		if (map[i] == i)
-			totvolumes[tissuemap[i]] += volumes[i];
+		for (size_t i = slabs[s]; i < slabs[s + 1]; i++)
+		{
+			for (size_t j = 0; j < height; j++)
+			{
+				const tissues_size_t* row = slices[i] + j * width;
+				size_t c = first_run(i, j);
+				for (size_t k = 0; k < width; c++)
+				{
+					const size_t end = run_end(row, k);
+					const unsigned label = map[c];
+					// only the slab holding the root writes the tissue of a component
+					if (label >= slab_labels[s] && label < slab_labels[s + 1])
+						tissuemap[label] = row[k];
+#pragma omp atomic
+					vol[label] += static_cast<unsigned>(end - k);
+					k = end;
+				}
+			}
+		}
 	}
+
+	for (size_t i = 0; i < volumes.size(); i++)
+		totvolumes[tissuemap[i]] += volumes[i];
 }
 
 void TissueCleaner::Clean(float ratio, unsigned minsize)
 {
-	if (volume == nullptr)
+	if (map.empty())
 		return;
-	std::vector<bool> erasemap;
-	erasemap.resize(map.size(), false);
-	for (size_t i = 0; i < map.size(); i++)
+
+	std::vector<unsigned char> erasemap(volumes.size(), 0);
+	for (size_t i = 0; i < volumes.size(); i++)
 	{
 		if (volumes[i] < minsize && volumes[i] < ratio * totvolumes[tissuemap[i]])
 		{
 			// only remove small components if tissue is NOT locked!
 			if (!TissueInfos::GetTissueLocked(tissuemap[i]))
 			{
-				erasemap[i] = true;
+				erasemap[i] = 1;
 			}
 		}
 	}
 
-	tissues_size_t curchar = 0;
-	size_t postot = 0;
-	for (unsigned short i = 0; i < nrslices; i++)
+	// erased runs take the tissue of the preceding kept run in the row, or
+	// of the first kept run if there is none; rows without kept runs stay
+	const int n = static_cast<int>(nrslices);
+#pragma omp parallel for
+	for (int i = 0; i < n; i++)
 	{
-		size_t pos = 0;
-		for (unsigned short j = 0; j < height; j++)
+		for (size_t j = 0; j < height; j++)
 		{
-			unsigned short k = 0;
-			while (k < width && erasemap[volume[postot]])
+			tissues_size_t* row = slices[i] + j * width;
+			size_t c = first_run(i, j);
+			size_t k = 0;
+			while (k < width && erasemap[map[c]])
 			{
-				postot++;
-				k++;
+				k = run_end(row, k);
+				c++;
 			}
 			if (k == width)
+				continue;
+
+			tissues_size_t curchar = row[k];
+			std::fill(row, row + k, curchar);
+			while (k < width)
 			{
-				pos += width;
-				//xxxa I should treat this case, but it is unlikely and I am tired...
-			}
-			else
-			{
-				size_t pos1 = pos + k;
-				curchar = slices[i][pos1];
-				for (; pos < pos1; pos++)
-					slices[i][pos] = curchar;
-				for (; k < width; k++, pos++, postot++)
-				{
-					if (erasemap[volume[postot]])
-						slices[i][pos] = curchar;
-					else
-						curchar = slices[i][pos];
-				}
+				const size_t end = run_end(row, k);
+				if (erasemap[map[c]])
+					std::fill(row + k, row + end, curchar);
+				else
+					curchar = row[k];
+				k = end;
+				c++;
 			}
 		}
 	}
 }
 
-}// namespace iseg
\ No newline at end of file
+} // namespace iseg
@@ -15,24 +15,36 @@
 
 namespace iseg {
 
+/** \brief Removes small connected components of each tissue
+
+	Components are 6-connected and labeled per run of equal tissue along
+	x, so only one label per run is stored. The slices are labeled in
+	parallel slabs which are joined afterwards.
+*/
 class TissueCleaner
 {
 public:
 	TissueCleaner(tissues_size_t** slices1, unsigned short n1,
 			unsigned short width1, unsigned short height1);
-	~TissueCleaner();
 	bool Allocate();
 	void ConnectedComponents();
 	void Clean(float ratio, unsigned minsize);
 	void MakeStat();
 
 private:
-	int base_connection(int c);
-	std::vector<int> map;
+	size_t run_end(const tissues_size_t* row, size_t x) const;
+	unsigned find_root(unsigned c);
+	void unite(unsigned c1, unsigned c2);
+	void connect_rows(const tissues_size_t* row1, size_t run1, const tissues_size_t* row2, size_t run2);
+	size_t first_run(size_t slice, size_t row) const { return row_runs[slice * height + row]; }
+
+	std::vector<unsigned> map;
+	std::vector<size_t> row_runs;
+	std::vector<size_t> slabs;
+	std::vector<unsigned> slab_labels;
 	std::vector<tissues_size_t> tissuemap;
 	std::vector<unsigned> volumes;
 	unsigned totvolumes[TISSUES_SIZE_MAX + 1];
-	int* volume;
 	tissues_size_t** slices;
 	size_t width, height;
 	size_t nrslices;
@@ -15,6 +15,7 @@
 #include <q3vbox.h>
 #include <qbuttongroup.h>
 #include <qcheckbox.h>
+#include <qcombobox.h>
 #include <qdialog.h>
 #include <qlabel.h>
 #include <qlayout.h>
@@ -45,6 +46,7 @@ TransformWidget::TransformWidget(SlicesHandler* hand3D, QWidget* parent,
 	vBoxTransforms = new Q3VBox(hBoxOverall);
 	vBoxParams = new Q3VBox(hBoxOverall);
 	hBoxSelectData = new Q3HBox(vBoxParams);
+	hBoxInterpolation = new Q3HBox(vBoxParams);
 	hBoxSlider1 = new Q3HBox(vBoxParams);
 	hBoxSlider2 = new Q3HBox(vBoxParams);
 	hBoxFlip = new Q3HBox(vBoxParams);
@@ -77,6 +79,14 @@ TransformWidget::TransformWidget(SlicesHandler* hand3D, QWidget* parent,
 	transformTargetCheckBox->setChecked(TRUE);
 	transformTissuesCheckBox->setChecked(TRUE);
 
+	// Interpolation of source and target, tissues use nearest neighbor
+	interpolationLabel = new QLabel("Interpolation ", hBoxInterpolation);
+	interpolationComboBox = new QComboBox(hBoxInterpolation);
+	interpolationComboBox->insertItem(SliceResampler::kNearest, QString("Nearest"));
+	interpolationComboBox->insertItem(SliceResampler::kLinear, QString("Linear"));
+	interpolationComboBox->insertItem(SliceResampler::kCubic, QString("Cubic"));
+	interpolationComboBox->setCurrentIndex(SliceResampler::kNearest);
+
 	// Axis selection radio buttons
 	xAxisRadioButton = new QRadioButton(QString("x axis "), hBoxAxisSelection);
 	yAxisRadioButton = new QRadioButton(QString("y axis "), hBoxAxisSelection);
@@ -128,6 +138,7 @@ TransformWidget::TransformWidget(SlicesHandler* hand3D, QWidget* parent,
 	vBoxTransforms->setFixedSize(vBoxTransforms->sizeHint());
 	vBoxParams->setFixedSize(vBoxParams->sizeHint());
 	hBoxSelectData->setFixedSize(hBoxSelectData->sizeHint());
+	hBoxInterpolation->setFixedSize(hBoxInterpolation->sizeHint());
 	hBoxSlider1->setFixedSize(hBoxSlider1->sizeHint());
 	hBoxSlider2->setFixedSize(hBoxSlider2->sizeHint());
 	hBoxFlip->setFixedSize(hBoxFlip->sizeHint());
@@ -140,6 +151,7 @@ TransformWidget::TransformWidget(SlicesHandler* hand3D, QWidget* parent,
 	lineEdit2->setFixedSize(lineEdit2->sizeHint());
 
 	hBoxSelectData->show();
+	hBoxInterpolation->show();
 	hBoxSlider1->show();
 	hBoxSlider2->show();
 	hBoxFlip->hide();
@@ -156,6 +168,8 @@ TransformWidget::TransformWidget(SlicesHandler* hand3D, QWidget* parent,
 			SLOT(SelectTargetChanged(int)));
 	QObject::connect(transformTissuesCheckBox, SIGNAL(stateChanged(int)), this,
 			SLOT(SelectTissuesChanged(int)));
+	QObject::connect(interpolationComboBox, SIGNAL(activated(int)), this,
+			SLOT(InterpolationChanged(int)));
 
 	QObject::connect(slider1, SIGNAL(valueChanged(int)), this,
 			SLOT(Slider1Changed(int)));
@@ -480,6 +494,20 @@ void TransformWidget::SelectTargetChanged(int state)
 	emit end_datachange(this, iseg::NoUndo);
 }
 
+void TransformWidget::InterpolationChanged(int index)
+{
+	iseg::DataSelection dataSelection;
+	dataSelection.sliceNr = handler3D->active_slice();
+	dataSelection.bmp = transformSourceCheckBox->isChecked();
+	dataSelection.work = transformTargetCheckBox->isChecked();
+	emit begin_datachange(dataSelection, this, false);
+
+	sliceTransform->SetInterpolation(static_cast<SliceResampler::eInterpolation>(index));
+
+	// Signal data change
+	emit end_datachange(this, iseg::NoUndo);
+}
+
 void TransformWidget::SelectTissuesChanged(int state)
 {
 	iseg::DataSelection dataSelection;
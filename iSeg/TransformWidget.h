@@ -16,6 +16,7 @@
 #include <q3vbox.h>
 #include <qbuttongroup.h>
 #include <qcheckbox.h>
+#include <qcombobox.h>
 #include <qlabel.h>
 #include <qlayout.h>
 #include <qlineedit.h>
@@ -82,6 +83,7 @@ private:
 	Q3VBox* vBoxTransforms;
 	Q3VBox* vBoxParams;
 	Q3HBox* hBoxSelectData;
+	Q3HBox* hBoxInterpolation;
 	Q3HBox* hBoxSlider1;
 	Q3HBox* hBoxSlider2;
 	Q3HBox* hBoxFlip;
@@ -93,6 +95,9 @@ private:
 	QCheckBox* transformTargetCheckBox;
 	QCheckBox* transformTissuesCheckBox;
 
+	QLabel* interpolationLabel;
+	QComboBox* interpolationComboBox;
+
 	QCheckBox* allSlicesCheckBox;
 	QPushButton* executePushButton;
 	QPushButton* cancelPushButton;
@@ -144,6 +149,7 @@ private slots:
 	void SelectSourceChanged(int state);
 	void SelectTargetChanged(int state);
 	void SelectTissuesChanged(int state);
+	void InterpolationChanged(int index);
 	void FlipPushButtonClicked();
 };
 
@@ -13,6 +13,8 @@
 #include "WatershedWidget.h"
 #include "bmp_read_1.h"
 
+#include "Core/WatershedMergeTree.h"
+
 #include <QFormLayout>
 #include <QHBoxLayout>
 
@@ -30,7 +32,9 @@ WatershedWidget::WatershedWidget(SlicesHandler* hand3D, QWidget* parent,
 			"calculated. High values are interpreted as mountains and "
 			"low values as valleys. Subsequently, a flooding with water is "
 			"simulated resulting in thousands of basins. "
-			"Higher water causes adjacent basins to merge. "));
+			"Higher water causes adjacent basins to merge. "
+			"With 'All slices' the basins are computed in 3D and "
+			"the flooding height can be changed without recomputing them."));
 
 	activeslice = handler3D->active_slice();
 	bmphand = handler3D->get_activebmphandler();
@@ -45,6 +49,9 @@ WatershedWidget::WatershedWidget(SlicesHandler* hand3D, QWidget* parent,
 	sb_h->setValue(40);
 	sbh_old = sb_h->value();
 
+	all_slices = new QCheckBox;
+	all_slices->setChecked(false);
+
 	btn_exec = new QPushButton("Execute");
 
 	// layout
@@ -54,6 +61,7 @@ WatershedWidget::WatershedWidget(SlicesHandler* hand3D, QWidget* parent,
 
 	auto layout = new QFormLayout;
 	layout->addRow(tr("Flooding height (h)"), height_hbox);
+	layout->addRow(tr("All slices"), all_slices);
 	layout->addRow(btn_exec);
 
 	setLayout(layout);
@@ -87,24 +95,39 @@ void WatershedWidget::hsb_changed(int value)
 	sbh_old = sbh_new;
 }
 
-void WatershedWidget::execute()
+void WatershedWidget::free_results()
 {
 	if (usp != nullptr)
 	{
 		free(usp);
 		usp = nullptr;
 	}
+	tree3d.reset();
+}
 
-	usp = bmphand->watershed_sobel(false);
+void WatershedWidget::execute()
+{
+	free_results();
+
+	if (all_slices->isChecked())
+	{
+		tree3d.reset(new WatershedMergeTree);
+		handler3D->watershed_sobel(*tree3d, false);
+	}
+	else
+	{
+		usp = bmphand->watershed_sobel(false);
+	}
 
 	recalc();
 }
 
 void WatershedWidget::recalc()
 {
-	if (usp != nullptr)
+	if (usp != nullptr || tree3d)
 	{
 		iseg::DataSelection dataSelection;
+		dataSelection.allSlices = (tree3d != nullptr);
 		dataSelection.sliceNr = handler3D->active_slice();
 		dataSelection.work = true;
 		emit begin_datachange(dataSelection, this);
@@ -117,9 +140,10 @@ void WatershedWidget::recalc()
 
 void WatershedWidget::marks_changed()
 {
-	if (usp != nullptr)
+	if (usp != nullptr || tree3d)
 	{
 		iseg::DataSelection dataSelection;
+		dataSelection.allSlices = (tree3d != nullptr);
 		dataSelection.sliceNr = handler3D->active_slice();
 		dataSelection.work = true;
 		emit begin_datachange(dataSelection, this);
@@ -132,10 +156,14 @@ void WatershedWidget::marks_changed()
 
 void WatershedWidget::recalc1()
 {
-	if (usp != nullptr)
+	auto h = (unsigned int)(sb_h->value() * sl_h->value() * 0.005f);
+	if (tree3d)
+	{
+		handler3D->construct_regions(*tree3d, h);
+	}
+	else if (usp != nullptr)
 	{
-		bmphand->construct_regions(
-				(unsigned int)(sb_h->value() * sl_h->value() * 0.005f), usp);
+		bmphand->construct_regions(h, usp);
 	}
 }
 
@@ -152,6 +180,7 @@ void WatershedWidget::on_slicenr_changed()
 
 void WatershedWidget::bmphand_changed(bmphandler* bmph)
 {
+	// the 3D basins remain valid when browsing through the slices
 	if (usp != nullptr)
 	{
 		free(usp);
@@ -169,11 +198,7 @@ void WatershedWidget::init()
 
 void WatershedWidget::newloaded()
 {
-	if (usp != nullptr)
-	{
-		free(usp);
-		usp = nullptr;
-	}
+	free_results();
 
 	activeslice = handler3D->active_slice();
 	bmphand = handler3D->get_activebmphandler();
@@ -182,6 +207,7 @@ void WatershedWidget::newloaded()
 void WatershedWidget::slider_pressed()
 {
 	iseg::DataSelection dataSelection;
+	dataSelection.allSlices = (tree3d != nullptr);
 	dataSelection.sliceNr = handler3D->active_slice();
 	dataSelection.work = true;
 	emit begin_datachange(dataSelection, this);
@@ -11,14 +11,18 @@
 
 #include "Interface/WidgetInterface.h"
 
+#include <qcheckbox.h>
 #include <qpushbutton.h>
 #include <qslider.h>
 #include <qspinbox.h>
 
+#include <memory>
+
 namespace iseg {
 
 class SlicesHandler;
 class bmphandler;
+class WatershedMergeTree;
 
 class WatershedWidget : public WidgetInterface
 {
@@ -38,8 +42,10 @@ private:
 	void on_slicenr_changed() override;
 
 	void recalc1();
+	void free_results();
 
 	unsigned int* usp;
+	std::unique_ptr<WatershedMergeTree> tree3d;
 	int sbh_old;
 	bmphandler* bmphand;
 	SlicesHandler* handler3D;
@@ -47,6 +53,7 @@ private:
 
 	QSpinBox* sb_h;
 	QSlider* sl_h;
+	QCheckBox* all_slices;
 	QPushButton* btn_exec;
 
 public slots:
@@ -21,20 +21,22 @@ namespace iseg {
 World::World()
 {
 	_isValid = false;
-	nodes = nullptr;
 }
 World::~World() { clear(); }
 
 //----------------------------------------------------------------------------------
-//! Deletes "nodes".
+//! Releases the voxel state.
 //----------------------------------------------------------------------------------
 void World::clear()
 {
-	if (nodes)
-	{
-		delete[] nodes;
-		nodes = nullptr;
-	}
+	queue.reset();
+	std::vector<float>().swap(intens);
+	std::vector<float>().swap(fcost);
+	std::vector<int>().swap(bricknode);
+	std::vector<unsigned>().swap(reachedbricks);
+	std::vector<float>().swap(cost);
+	std::vector<unsigned>().swap(prev);
+	std::vector<bool>().swap(computed);
 	_isValid = false;
 }
 //----------------------------------------------------------------------------------
@@ -47,9 +49,6 @@ bool World::init(Vec3 bbStart, Vec3 bbEnd, SlicesHandler* handler3D)
 
 	//	ml::TimeCounter time2;
 
-	solvingarea = false;
-	times = 0;
-	activelistlowintsize = 0;
 	firstseedexpanded = false;
 
 	_bbStart = bbStart;
@@ -76,19 +75,20 @@ bool World::init(Vec3 bbStart, Vec3 bbEnd, SlicesHandler* handler3D)
 			  << " Length:" << length << std::endl;
 
 	unsigned total = width * height * length;
+	bricksx = (width + kBrickSize - 1) / kBrickSize;
+	bricksy = (height + kBrickSize - 1) / kBrickSize;
+	int bricksz = (length + kBrickSize - 1) / kBrickSize;
 
-	Node* nodes2 = nullptr;
 	try
 	{
-		nodes2 = new Node[total];
+		intens.resize(total);
+		fcost.resize(total);
+		bricknode.assign(bricksx * bricksy * bricksz, -1);
+		queue.reset(new IndexPriorityQueue(0, nullptr));
 	}
-	catch (std::bad_alloc error)
-	{
-		nodes2 = nullptr;
-	}
-
-	if (nodes2 == nullptr)
+	catch (std::bad_alloc&)
 	{
+		clear();
 		std::cerr << "Memory allocation error!" << std::endl;
 		//		exit(1); // terminate the program
 		return false;
@@ -97,7 +97,7 @@ bool World::init(Vec3 bbStart, Vec3 bbEnd, SlicesHandler* handler3D)
 
 	float px, py, pz;
 	float gradient, fgradient;
-	float intens, fintens;
+	float fintens;
 
 	for (unsigned o = 0; o < total; o++)
 	{
@@ -113,27 +113,22 @@ bool World::init(Vec3 bbStart, Vec3 bbEnd, SlicesHandler* handler3D)
 		p.px = (short)(i + bbStart[0]);
 		p.py = (short)(j + bbStart[1]);
 		unsigned short slicenr = (unsigned short)(k + bbStart[2]);
-		intens = _handler3D->get_bmp_pt(p, slicenr);
+		intens[o] = _handler3D->get_bmp_pt(p, slicenr);
 
-		if (intens > 1250 && intens < 1300)
+		if (intens[o] > 1250 && intens[o] < 1300)
 			fintens = 100;
-		else if (intens > 1150 && intens <= 1250)
+		else if (intens[o] > 1150 && intens[o] <= 1250)
 			fintens = 10000;
-		else if (intens > 1000 && intens <= 1150)
+		else if (intens[o] > 1000 && intens[o] <= 1150)
 			fintens = 1000000;
-		else if (intens <= 1000)
+		else if (intens[o] <= 1000)
 			fintens = 10000000000.;
 		else
 		{
-			intens = 1300;
+			intens[o] = 1300;
 			fintens = 0;
 		}
 
-		//initialize nodes
-		Node nt(o, intens);
-		//std::cout << "Node size: " << sizeof(Node) << std::endl;
-		nodes2[o] = nt;
-
 		//gradient
 		if (i > 0 && j > 0 && k > 0)
 		{
@@ -141,9 +136,9 @@ bool World::init(Vec3 bbStart, Vec3 bbEnd, SlicesHandler* handler3D)
 			unsigned o3 = i + (j - 1) * width + k * width * height;
 			unsigned o4 = i + j * width + (k - 1) * width * height;
 
-			px = fabs(nodes2[o].intens - nodes2[o2].intens);
-			py = fabs(nodes2[o].intens - nodes2[o3].intens);
-			pz = fabs(nodes2[o].intens - nodes2[o4].intens);
+			px = fabs(intens[o] - intens[o2]);
+			py = fabs(intens[o] - intens[o3]);
+			pz = fabs(intens[o] - intens[o4]);
 			gradient = sqrt(px * px + py * py + pz * pz);
 
 			if (gradient > 170)
@@ -154,16 +149,65 @@ bool World::init(Vec3 bbStart, Vec3 bbEnd, SlicesHandler* handler3D)
 		}
 		else
 			fgradient = 1;
-		nodes2[o].fcost = (fgradient * 0.8f + fintens * 0.2f);
+		fcost[o] = (fgradient * 0.8f + fintens * 0.2f);
 	}
 
-	this->nodes = nodes2;
 	//	std::cout << "TIME for initialization: " << time2.getRunningTime() << std::endl;
 
 	_isValid = true;
 	return true;
 }
 //----------------------------------------------------------------------------------
+//! Resets the search state. Only the bricks reached by the previous search
+//  are visited, so the cost does not grow with the size of the volume.
+//----------------------------------------------------------------------------------
+void World::resetsearch()
+{
+	for (auto b : reachedbricks)
+	{
+		bricknode[b] = -1;
+	}
+	reachedbricks.clear();
+	queue->clear();
+	cost.clear();
+	prev.clear();
+	computed.clear();
+}
+//----------------------------------------------------------------------------------
+//! Returns the band node of a voxel. The search state is only kept for the
+//  bricks reached by the search, so its memory grows with the searched band
+//  and not with the bounding box.
+//----------------------------------------------------------------------------------
+unsigned World::node(int i, int j, int k)
+{
+	unsigned b = i / kBrickSize + bricksx * (j / kBrickSize + bricksy * (k / kBrickSize));
+	if (bricknode[b] < 0)
+	{
+		const unsigned size = cost.size() + kBrickSize * kBrickSize * kBrickSize;
+		bricknode[b] = (int)cost.size();
+		reachedbricks.push_back(b);
+		cost.resize(size, 0);
+		prev.resize(size, 0);
+		computed.resize(size, false);
+		queue->grow(size, cost.data());
+	}
+	return bricknode[b] + i % kBrickSize +
+		   kBrickSize * (j % kBrickSize + kBrickSize * (k % kBrickSize));
+}
+//----------------------------------------------------------------------------------
+//! Returns the bounding box offset of a band node.
+//----------------------------------------------------------------------------------
+unsigned World::offset(unsigned n) const
+{
+	const unsigned volume = kBrickSize * kBrickSize * kBrickSize;
+	unsigned b = reachedbricks[n / volume];
+	unsigned l = n % volume;
+	unsigned i = (b % bricksx) * kBrickSize + l % kBrickSize;
+	unsigned j = ((b / bricksx) % bricksy) * kBrickSize + (l / kBrickSize) % kBrickSize;
+	unsigned k = (b / (bricksx * bricksy)) * kBrickSize + l / (kBrickSize * kBrickSize);
+	return i + j * width + k * width * height;
+}
+//----------------------------------------------------------------------------------
 //! Modified livewire algorithm.
 //----------------------------------------------------------------------------------
 void World::dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
@@ -187,7 +231,7 @@ void World::dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
 	endpoint[1] = end[1] - offy;
 	endpoint[2] = end[2] - offz;
 
-	unsigned off = n_x + n_y * width + n_z * width * height;
+	unsigned off;
 	unsigned short int cross_x;
 	unsigned short int cross_y;
 	unsigned short int cross_z;
@@ -204,49 +248,29 @@ void World::dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
 	//Declaring variables
 
 	bool redfound = false;
-	bool first = false;
 	bool endt = false;
 	bool ends = false;
 	bool firstfound = false;
 	bool morethanoneseed = true;
-	int min;
 	int counter = 0;
-	bool largearea = false;
-	int largeareatimes = 0;
-	typedef std::list<Node*>::iterator li;
 	float tmp;
-	bool alreadyinlist, alreadyinlistlowint;
 	int parentintens;
 	int k, j, i;
 
 	//Initializing first node to expand (first seed)
 
-	nodes[off].cost = 0;
-	activelist.push_back(&nodes[off]);
+	resetsearch();
+	queue->insert(node(n_x, n_y, n_z), 0);
 	std::cout << "Expanding seed " << 1 << std::endl;
 
 	//----------------------------------------------------------------------------------
 	//@ Main loop
 	//----------------------------------------------------------------------------------
 
-	while ((activelist.size() != 0 || solvingarea == true) && !endt)
+	while (!queue->empty() && !endt)
 	{
-		if (activelist.size() == 0)
-		{
-			std::cout << "Activelist empty!!" << std::endl;
-			off = solvelargearea2();
-			activelist.push_back(&nodes[off]);
-		}
-
-		//Reducing activelist if it is too large
-		if (activelist.size() > 3000 && largearea == false)
-		{
-			reduceactivelist();
-			//std::cout << "Reducing activelist" << std::endl;
-		}
-
 		//Skipping seed if it is lasting too much to find the path
-		if (counter > 150000)
+		if (counter > kMaxExpansions)
 		{
 			std::cerr << "Troubles finding the path for seed "
 					  << seeds.size() - seedsleft + 1 << std::endl;
@@ -254,15 +278,7 @@ void World::dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
 			seedsleft = seedsleft - 1;
 			if (seedsleft > 0)
 			{
-				int total = width * height * length;
 				int pos = seeds.size() - seedsleft;
-				for (int o5 = 0; o5 < total; o5++)
-				{
-					if (nodes[o5].computed == true)
-					{
-						nodes[o5].computed = false;
-					}
-				}
 				//std::cout << "Counter: " << counter << std::endl;
 				std::cout << "Expanding seed " << pos + 1 << std::endl;
 
@@ -270,26 +286,16 @@ void World::dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
 				n_y = (unsigned short)(seeds[pos][1] - offy);
 				n_z = (unsigned short)(seeds[pos][2] - offz);
 
-				unsigned off5 = n_x + n_y * width + n_z * width * height;
-				std::list<Node*> activelist2;
-				activelist = activelist2;
-				activelist.push_back(&nodes[off5]);
+				resetsearch();
+				queue->insert(node(n_x, n_y, n_z), 0);
 
 				redfound = false;
 				counter = 0;
-				solvingarea = false;
-				largearea = false;
-				first = false;
-				largeareatimes = 0;
-				times = 0;
 			}
 			else
 			{
-				solvingarea = false;
 				firstseedexpanded = false;
-				times = 0;
-				activelist.clear();
-				activelistlowint.clear();
+				resetsearch();
 				if (firstfound == true)
 					storingtree(children, rootOne);
 				paths.clear();
@@ -340,17 +346,6 @@ void World::dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
 			}
 			paint(seeds, cross[pos - 2], seedsleft);
 
-			//Set all the nodes to computed=false
-
-			int total = width * height * length;
-			for (int o5 = 0; o5 < total; o5++)
-			{
-				if (nodes[o5].computed == true)
-				{
-					nodes[o5].computed = false;
-					nodes[o5].first = true;
-				}
-			}
 			std::cout << "Counter: " << counter << std::endl;
 			std::cout << "Expanding seed " << pos + 1 << std::endl;
 
@@ -358,19 +353,11 @@ void World::dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
 			n_y = (unsigned short)(seeds[pos][1] - offy);
 			n_z = (unsigned short)(seeds[pos][2] - offz);
 
-			unsigned off5 = n_x + n_y * width + n_z * width * height;
-			std::list<Node*> activelist2;
-			activelist = activelist2;
-			activelistlowint = activelist2;
-			activelist.push_back(&nodes[off5]);
+			resetsearch();
+			queue->insert(node(n_x, n_y, n_z), 0);
 
 			redfound = false;
 			counter = 0;
-			solvingarea = false;
-			largearea = false;
-			first = false;
-			largeareatimes = 0;
-			times = 0;
 		}
 
 		//When the first path has been tracked...
@@ -383,17 +370,6 @@ void World::dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
 			rootOne->setStartVox(seeds[pos - 1]);
 			rootOne->setEndVox(end);
 
-			//Set all the nodes to computed=false
-			int total = width * height * length;
-
-			for (int o5 = 0; o5 < total; o5++)
-			{
-				if (nodes[o5].computed == true)
-				{
-					nodes[o5].computed = false;
-					nodes[o5].first = true;
-				}
-			}
 			std::cout << "Counter: " << counter << std::endl;
 			std::cout << "Expanding seed " << pos + 1 << std::endl;
 
@@ -403,97 +379,20 @@ void World::dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
 			n_y = (unsigned short)(seeds[pos][1] - offy);
 			n_z = (unsigned short)(seeds[pos][2] - offz);
 
-			unsigned off5 = n_x + n_y * width + n_z * width * height;
-			std::list<Node*> activelist2;
-			activelist = activelist2;
-			activelist.push_back(&nodes[off5]);
+			resetsearch();
+			queue->insert(node(n_x, n_y, n_z), 0);
 
 			ends = false;
 			firstfound = true;
 			counter = 0;
-			solvingarea = false;
-			largearea = false;
-			largeareatimes = 0;
-			times = 0;
 			firstseedexpanded = true;
 		}
 
-		//Dealing with large structures...
-
-		/*if(solvingarea==true){ 
-			if (activelistlowint.size()>0){
-			
-				off=solvelargearea2();
-		
-			}
-			else{
-				//std::cout << "Times:" << times << std::endl;
-				solvingarea=false;
-				if (times<70){
-					off=solvelargearea2();
-					times++;
-				}
-			}
-		}*/
-
-		//std::cout << activelist.size() << std::endl;
-
-		min = -1;
-		li todel;
-
-		//Looking for the node with the mininum cost in activelist
-
-		if (solvingarea == false)
-		{
-			for (li ii = activelist.begin(); ii != activelist.end(); ++ii)
-			{
-				Node* e = *ii;
-				if (min == -1 || min > e->cost)
-				{
-					min = (int)e->cost;
-					off = e->offset;
-					todel = ii;
-				}
-			}
-			activelist.erase(todel);
-		}
-
-		if (nodes[off].computed == true)
-			std::cout << "Node to expand already expanded!!" << std::endl;
-
-		//Dealing with large structures
-
-		//		if (activelist.size()>1 && largeareatimes<1){
-		//			unsigned o7=nodes[off].prev->offset;
-		//			if (checkdiameter(off, o7)){
-		//				largearea=true;
-		//				std::cout << "Large structure found" << std::endl;
-		//				solvelargearea();
-		/*largeareatimes++;
-				//if(largeareatimes==20){
-					times++;
-					if(times==1) solvelargearea();
-					off=solvelargearea2();	
-					li ia;
-					Node* e;
-					unsigned o8;
-					
-					for(ia=activelistlowint.begin();ia!=activelistlowint.end();++ia){
-						e=*ia;
-						o8=e->offset;
-						int z8 = o8 / (width * height);
-						int y8 = (o8 - (z8 * width * height)) / width;
-						int x8 = o8 - (y8 * width) - (z8 * width * height);
-						//std::cout << "NODE: " << "nx:" << x8 << " ny:" << y8 << " nz:" << z8 << std::endl;
-						//vOutVol->setVoxel(ml::Vector(x8+offx, y8+offy, z8+offz, 0, 0, 0), 4000);
-					}
-				}*/
-		//			}
-		//		}
-
-		//Expanding the chosen node
+		//Taking the node with the minimum cost from the queue and expanding it
 
-		nodes[off].computed = true;
+		unsigned n = queue->pop();
+		computed[n] = true;
+		off = offset(n);
 
 		n_z = off / (width * height);
 		n_y = (off - (n_z * width * height)) / width;
@@ -514,19 +413,20 @@ void World::dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
 				{
 					unsigned o = i + j * width +
 								 k * width * height; //offset of the neighbor
-					unsigned o2 =
-						n_x + n_y * width +
-						n_z * width *
-							height; //offset of the node that is being expanded
+					unsigned o2 = off; //offset of the node that is being expanded
 					//std::cout << "Node to expand: " << "x:" << i << " y:" << j << " z:" << k << " o: " << o << " o2: " << o2 << std::endl;
 
-					if (i > -1 && j > -1 && k > -1 && i < width && j < height &&
-						k < length && !nodes[o].computed)
+					if (i < 0 || j < 0 || k < 0 || i >= width || j >= height ||
+						k >= length)
+						continue;
+
+					unsigned m = node(i, j, k); //band node of the neighbor
+					if (!computed[m])
 					{
-						if (nodes[o].intens > 3900 && !endt && !redfound)
+						if (intens[o] > 3900 && !endt && !redfound)
 						{ //if the node belongs to a previously painted path
 
-							parentintens = (int)nodes[o].intens;
+							parentintens = (int)intens[o];
 							seedsleft = seedsleft - 1;
 
 							if (seedsleft == 0)
@@ -556,29 +456,9 @@ void World::dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
 									  << " o:" << o << std::endl;
 						}
 
-						//Dealing with large structures...
-
-						/*if(solvingarea==true){
-							if(nodes[o].first==false) changeintens(o);
-							else{
-								int z1 = o / (width * height);
-								int y1 = (o - (z1 * width * height)) / width;
-								int x1 = o - (y1 * width) - (z1 * width * height);
-								vOutVol->setVoxel(ml::Vector(x1+offx, y1+offy, z1+offz, 0, 0, 0), 4000);
-								std::cout << "RootOne area found: " << "x:" << x1 << " y:" << y1 << " z:" << z1 << " Intens:" << nodes[o].intens << " Fcost:" << nodes[o].fcost << " Cost:" << nodes[o].cost << " First:" << nodes[o].first << std::endl; 
-								first=true;
-								solvingarea=false;
-							}
-						}*/
-
 						//Tmp=cost of the neighbor + cost of the path from the seed to the current node
 
-						tmp = nodes[o].fcost + nodes[o2].cost;
-
-						//Restarting variables
-
-						alreadyinlist = false;
-						alreadyinlistlowint = false;
+						tmp = fcost[o] + cost[n];
 
 						//First path is found when the endpoint is found
 
@@ -604,59 +484,25 @@ void World::dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
 							}
 						}
 
-						//Checking if it is in activelistlowint
+						//If it is already in the queue and the new cost is lower, update it
 
-						li p = activelistlowint.begin();
-						if (solvingarea == true)
+						if (queue->in_queue(m))
 						{
-							while (!alreadyinlistlowint &&
-								   p != activelistlowint.end())
+							if (cost[m] > tmp + 10)
 							{
-								Node* e = *p;
-								if (e->offset == o)
-								{
-									alreadyinlistlowint = true;
-									//activelistlowint.erase(p);
-								}
-								p++;
-							}
-						}
-
-						//Checking if the neighbour is already in activelist
-
-						li l = activelist.begin();
-						while (!alreadyinlist && l != activelist.end())
-						{
-							Node* e = *l;
-							if (e->offset == o)
-							{
-								alreadyinlist = true;
+								queue->make_smaller(m, tmp + 10);
+								prev[m] = o2;
 							}
-							l++;
 						}
 
-						//If it was in one of the activelists and the new cost is lower, update it
-
-						if (alreadyinlist || alreadyinlistlowint)
-						{
-							if (nodes[o].cost > tmp + 10)
-							{
-								//activelist.erase(activelist.begin()+todel);
-								//alreadyinlist=false;
-								nodes[o].cost = tmp + 10;
-								nodes[o].prev = &nodes[o2];
-							}
-						}
-
-						//Otherwise, save the cost, the path, and put the node in activelist
+						//Otherwise, save the cost, the path, and put the node in the queue
 
 						else
 						{
-							if (nodes[o].intens > 1000)
+							if (intens[o] > 1000)
 							{
-								nodes[o].cost = tmp + 10;
-								nodes[o].prev = &nodes[o2];
-								activelist.push_back(&nodes[o]);
+								prev[m] = o2;
+								queue->insert(m, tmp + 10);
 							}
 						}
 					}
@@ -704,14 +550,11 @@ void World::dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
 		paint(seeds, endpoint, seedsleft); //if there was only one seed
 	}
 
-	//Clearing lists, restarting variables.
+	//Clearing queue, restarting variables.
 
 	std::cout << "Counter: " << counter << std::endl;
-	solvingarea = false;
 	firstseedexpanded = false;
-	times = 0;
-	activelist.clear();
-	activelistlowint.clear();
+	resetsearch();
 	storingtree(children, rootOne);
 	paths.clear();
 	seedsfailed.clear();
@@ -736,7 +579,6 @@ void World::paint(std::vector<Vec3> seeds, Vec3 cross,
 
 	std::cout << "Painting path " << pos + 1 << ": x: " << n_x << " y: " << n_y
 			  << " z: " << n_z << std::endl;
-	std::cout << "Activelistsize: " << activelist.size() << std::endl;
 	std::cout << "Seedsleft: " << seedsleft << std::endl;
 	int counter = 0;
 	std::vector<PathElement> newpath;
@@ -747,7 +589,7 @@ void World::paint(std::vector<Vec3> seeds, Vec3 cross,
 			n_z == seeds[pos][2] - offz)
 		{
 			endp2 = true;
-			nodes[o2].intens = (float)(4000 - pos);
+			intens[o2] = (float)(4000 - pos);
 
 			PathElement pathelement(o2);
 			newpath.push_back(pathelement);
@@ -770,11 +612,11 @@ void World::paint(std::vector<Vec3> seeds, Vec3 cross,
 			//_handler3D->set_work_pt(p,slicenr,4000-pos);xxxa
 			_handler3D->set_work_pt(p, slicenr, 4000);
 
-			//std::cout << "Path node: " << "x:" << n_x << " y:" << n_y << " z:" << n_z << " Offset:" << o3 << " Intens:" << nodes[o3].intens << " Fcost:" << nodes[o3].fcost << " Cost:" << nodes[o3].cost << " First:" << nodes[o3].first << std::endl;
-			nodes[o3].intens = (float)(4000 - pos);
+			//std::cout << "Path node: " << "x:" << n_x << " y:" << n_y << " z:" << n_z << " Offset:" << o3 << " Intens:" << intens[o3] << " Fcost:" << fcost[o3] << " Cost:" << cost[o3] << std::endl;
+			intens[o3] = (float)(4000 - pos);
 			if (!firstseedexpanded)
 				rootOneintens = 4000 - pos;
-			o2 = nodes[o3].prev->offset;
+			o2 = prev[node(t_x, t_y, t_z)];
 			counter++;
 
 			n_z = o2 / (width * height);
@@ -1229,485 +1071,6 @@ int World::whoistheparent(std::vector<Vec3> seeds, int parentintens)
 	return (parent);
 }
 //----------------------------------------------------------------------------------
-//! Reduce size of activelist by removing every second node
-//----------------------------------------------------------------------------------
-void World::reduceactivelist()
-{
-	typedef std::list<Node*>::iterator li;
-	std::list<Node*> activelistempty;
-	Node* e;
-	unsigned off;
-
-	int par = 0;
-	for (li ia = activelist.begin(); ia != activelist.end(); ++ia)
-	{
-		e = *ia;
-		off = e->offset;
-		if (!(par % 2))
-		{
-			if (nodes[off].intens < 3900)
-			{
-				nodes[off].computed = true;
-				//int z = off / (width * height);
-				//int y = (off - (z * width * height)) / width;
-				//int x = off - (y * width) - (z * width * height);
-				//vOutVol->setVoxel(ml::Vector(x+offx, y+offy, z+offz, 0, 0, 0), 4000);
-			}
-		}
-		else
-		{
-			activelistempty.push_back(&nodes[off]);
-		}
-		par++;
-	}
-	activelist = activelistempty;
-}
-//----------------------------------------------------------------------------------
-//! Reassigns costs to intensities
-//----------------------------------------------------------------------------------
-void World::changeintens(unsigned o)
-{
-	//int z = o / (width * height);
-	//int y = (o - (z * width * height)) / width;
-	//int x = o - (y * width) - (z * width * height);
-	if (nodes[o].intens > 1000 && nodes[o].intens <= 1150)
-	{
-		nodes[o].fcost = 10;
-		//if(nodes[o].computed==true) std::cout << "Node already computed!!" << std::endl;
-		//std::cout << "NODE: " << "x:" << x << " y:" << y << " z:" << z << " Computed: " << nodes[off].computed << std::endl;
-	}
-	else if (nodes[o].intens > 1150 && nodes[o].intens <= 1230)
-	{
-		if (nodes[o].cost == 0 && nodes[o].first == false)
-			nodes[o].fcost = nodes[o].fcost + nodes[o].fcost * 10;
-	}
-	else
-	{
-		if (nodes[o].cost == 0 && nodes[o].first == false)
-			nodes[o].fcost = 100000;
-		//nodes[o].cost=nodes[o].cost+nodes[o].fcost;
-	}
-}
-
-//----------------------------------------------------------------------------------
-//! Checks the diameter of the structure at each step
-//----------------------------------------------------------------------------------
-bool World::checkdiameter(unsigned coff, unsigned poff)
-{
-	bool largearea = false;
-
-	int z = coff / (width * height);
-	int y = (coff - (z * width * height)) / width;
-	int x = coff - (y * width) - (z * width * height);
-
-	int pz = poff / (width * height);
-	int py = (poff - (pz * width * height)) / width;
-	int px = poff - (py * width) - (pz * width * height);
-
-	bool comput = false;
-
-	int v1x = x - px;
-	int v1y = y - py;
-	int v1z = z - pz;
-	int v2x = 0;
-	int v2y = 0;
-	int v2z = 0;
-
-	if (v1z == 0)
-	{
-		v2z = 0;
-		if (v1y == 0)
-		{
-			v2x = 0;
-			v2y = 1;
-		}
-		else if (v1x == 0)
-		{
-			v2x = 1;
-			v2y = 0;
-		}
-		else if (v1x == v1y)
-		{
-			v2x = v1x;
-			v2y = -v1y;
-		}
-		else
-		{
-			v2x = v1y;
-			v2y = v1y;
-		}
-	}
-	else if (v1x == 0 && v1y == 0)
-	{
-		v2x = 0;
-		v2y = 1;
-		v2z = 0;
-	}
-	else if (v1x == 0)
-	{
-		v2x = 1;
-		v2y = 0;
-		v2z = 0;
-	}
-	else if (v1y == 0)
-	{
-		v2x = 0;
-		v2y = 1;
-		v2z = 0;
-	}
-	else if (v1x != 0 && v1y != 0)
-	{
-		v2z = 0;
-		if (v1x == v1y)
-		{
-			v2x = v1x;
-			v2y = -v1y;
-		}
-		else
-		{
-			v2x = v1y;
-			v2y = v1y;
-		}
-	}
-	else
-		std::cout << "Unconsidered case!" << std::endl;
-
-	int nx = x;
-	int ny = y;
-	int nz = z;
-
-	int diameter1 = 0;
-	int diameter2 = 0;
-	int diameter3 = 0;
-	int diameter4 = 0;
-
-	do
-	{
-		unsigned o = nx + ny * width + nz * width * height;
-		if (nx > -1 && ny > -1 && nz > -1 && nx < width && ny < height &&
-			nz < length)
-		{
-			//std::cout << "Diameter node: " << "x:" << nx << " y:" << ny << " z:" << nz << " o: " << o << std::endl;
-			if (nodes[o].intens > 1150)
-			{
-				diameter1++;
-				comput = true;
-				nx = nx + v2x;
-				ny = ny + v2y;
-				nz = nz + v2z;
-			}
-			else
-			{
-				comput = false;
-			}
-		}
-		else
-			comput = false;
-	} while (comput);
-
-	nx = x;
-	ny = y;
-	nz = z;
-
-	do
-	{
-		unsigned o = nx + ny * width + nz * width * height;
-		if (nx > -1 && ny > -1 && nz > -1 && nx < width && ny < height &&
-			nz < length)
-		{
-			//std::cout << "Diameter node: " << "x:" << nx << " y:" << ny << " z:" << nz << " o: " << o << std::endl;
-			if (nodes[o].intens > 1150)
-			{
-				diameter2++;
-				comput = true;
-				nx = nx - v2x;
-				ny = ny - v2y;
-				nz = nz - v2z;
-			}
-			else
-			{
-				comput = false;
-			}
-		}
-		else
-			comput = false;
-	} while (comput);
-
-	if (diameter1 > 15 && diameter2 > 15)
-	{
-		int nxf = nx;
-		int nyf = ny;
-		int nzf = nz;
-
-		//std::cout << "Diameter: " << diameter << " Comput: " << comput << std::endl;
-		//std::cout << "Diameter node: " << "x:" << x << " y:" << y << " z:" << z << std::endl;
-		//std::cout << "Current node: " << "x:" << x << " y:" << y << " z:" << z << " o: " << coff << std::endl;
-		//std::cout << "Previous node: " << "x:" << px << " y:" << py << " z:" << pz << " o: " << poff << std::endl;
-		//std::cout << "Difference: " << "x:" << cx << " y:" << cy << " z:" << cz << std::endl;
-
-		int nv2x = v1x;
-		int nv2y = v1y;
-		int nv2z = v1z;
-
-		nx = x;
-		ny = y;
-		nz = z;
-
-		do
-		{
-			unsigned o2 = nx + ny * width + nz * width * height;
-			if (nx > -1 && ny > -1 && nz > -1 && nx < width && ny < height &&
-				nz < length)
-			{
-				//std::cout << "Diameter node: " << "x:" << nx << " y:" << ny << " z:" << nz << " o: " << o << std::endl;
-				if (nodes[o2].intens > 1150)
-				{
-					diameter3++;
-					comput = true;
-					nx = nx + nv2x;
-					ny = ny + nv2y;
-					nz = nz + nv2z;
-				}
-				else
-				{
-					comput = false;
-				}
-			}
-			else
-				comput = false;
-		} while (comput);
-
-		nx = x;
-		ny = y;
-		nz = z;
-
-		do
-		{
-			unsigned o2 = nx + ny * width + nz * width * height;
-			if (nx > -1 && ny > -1 && nz > -1 && nx < width && ny < height &&
-				nz < length)
-			{
-				//std::cout << "Diameter node: " << "x:" << nx << " y:" << ny << " z:" << nz << " o: " << o << std::endl;
-				if (nodes[o2].intens > 1150)
-				{
-					diameter4++;
-					comput = true;
-					nx = nx - nv2x;
-					ny = ny - nv2y;
-					nz = nz - nv2z;
-				}
-				else
-				{
-					comput = false;
-				}
-			}
-			else
-				comput = false;
-		} while (comput);
-
-		if (diameter3 > 15 && diameter4 > 15)
-		{
-			//std::cout << "Diameter: " << diameter << " Comput: " << comput << std::endl;
-			//std::cout << "Diameter 2 node: " << "x:" << nx << " y:" << ny << " z:" << nz << std::endl;
-			//std::cout << "Current node: " << "x:" << x << " y:" << y << " z:" << z << " o: " << coff << std::endl;
-			//std::cout << "Previous node: " << "x:" << px << " y:" << py << " z:" << pz << " o: " << poff << std::endl;
-			//std::cout << "Difference: " << "x:" << cx << " y:" << cy << " z:" << cz << std::endl;
-			//std::cout << "New difference: " << "x:" << ncx << " y:" << ncy << " z:" << ncz << std::endl;
-			//std::cout << "LARGE AREA FOUND" << std::endl;
-			//std::cout << "1: " << diameter1 << " 2: " << diameter2 << " 3: " << diameter3 << " 4: " << diameter4 << std::endl;
-			largearea = true;
-			//zarea=nz;
-
-			//if(times<1){
-
-			for (int i = 0; i < diameter1 + diameter2; i++)
-			{
-				Point p;
-				p.px = (short)(nxf + i * v2x + offx);
-				p.py = (short)(nyf + i * v2y + offy);
-				unsigned short slicenr = (unsigned short)nzf + i * v2z + offz;
-				_handler3D->set_work_pt(p, slicenr, 4000);
-				//if(nzf+offz==75) std::cout << "v2: " << "x:" << v2x << " y:" << v2y << " z:" << v2z << std::endl;
-			}
-
-			for (int j = 0; j < diameter3 + diameter4; j++)
-			{
-				Point p;
-				p.px = (short)(nx + j * nv2x + offx);
-				p.py = (short)(ny + j * nv2y + offy);
-				unsigned short slicenr = (unsigned short)nz + j * nv2z + offz;
-				_handler3D->set_work_pt(p, slicenr, 4000);
-				//if(nz+offz==75) std::cout << "nv2: " << "x:" << nv2x << " ny:" << nv2y << " nz:" << nv2z << std::endl;
-			}
-			//}
-		}
-	}
-	return (largearea);
-}
-//----------------------------------------------------------------------------------
-//! Deals when the situation when a large structure is found
-//	Returns the offset of the node that is going to be expanded (a new node selected trying to skip the large structure)
-//----------------------------------------------------------------------------------
-unsigned World::solvelargearea2()
-{
-	typedef std::list<Node*>::iterator li;
-	unsigned newoff;
-	unsigned off;
-	Node* e;
-	li ie, todel;
-	int min = -1;
-
-	if (solvingarea == false)
-	{
-		activelistlowint.clear();
-		for (ie = activelist.begin(); ie != activelist.end(); ++ie)
-		{
-			e = *ie;
-			off = e->offset;
-			if (e->intens > 1000 && e->intens <= 1150)
-			{
-				nodes[off].cost = nodes[off].cost - nodes[off].fcost + 10;
-				nodes[off].fcost = 10;
-				if (nodes[off].computed == true)
-					std::cout << "Node already computed!!" << std::endl;
-				activelistlowint.push_back(&nodes[off]);
-			}
-			else
-			{
-				//todel=iu;
-				//nodes[off].cost=nodes[off].cost+10000000;
-				if (nodes[off].first == false)
-				{
-					nodes[off].computed = true;
-					//vOutVol->setVoxel(ml::Vector(x+offx, y+offy, z+offz, 0, 0, 0), 4000);
-				}
-			}
-		}
-		solvingarea = true;
-		activelist.clear();
-
-		//std::cout << "Activelistsizelowint: " << activelistlowint.size() << std::endl;
-
-		/*for(li ia=activelistlowint.begin();ia!=activelistlowint.end();++ia){
-			e=*ia;
-			unsigned o8=e->offset;
-			int z8 = o8 / (width * height);
-			int y8 = (o8 - (z8 * width * height)) / width;
-			int x8 = o8 - (y8 * width) - (z8 * width * height);
-			//std::cout << "NODE: " << "nx:" << x8 << " ny:" << y8 << " nz:" << z8 << " Computed: " << nodes[o8].computed << std::endl;
-			vOutVol->setVoxel(ml::Vector(x8+offx, y8+offy, z8+offz, 0, 0, 0), 4000);
-		}*/
-
-		/*if(activelistlowint.size()>1500){
-			activelist.clear();
-			activelist=activelistlowint;
-			activelistlowint.clear();
-			//std::cout << "Reducing activelistlowint" << std::endl;
-			int par=0;
-			for(li ia=activelist.begin();ia!=activelist.end();++ia){
-				e=*ia;
-				off=e->offset;
-				if(!(par%2)){
-					if(nodes[off].first==false){
-						nodes[off].computed=true;
-						//vOutVol->setVoxel(ml::Vector(x+offx, y+offy, z+offz, 0, 0, 0), 4000);
-					}
-				}else{
-					activelistlowint.push_back(&nodes[off]);
-				}
-				par++;
-			}
-		}*/
-		//std::cout << "Activelistsizelowint: " << activelistlowint.size() << std::endl;
-		activelist.clear();
-		activelistlowintsize = activelistlowint.size();
-
-		for (li ii = activelistlowint.begin(); ii != activelistlowint.end();
-			 ++ii)
-		{
-			Node* e = *ii;
-			if (min == -1 || min > e->cost)
-			{
-				min = (int)e->cost;
-				newoff = e->offset;
-				todel = ii;
-			}
-		}
-
-		activelistlowint.erase(todel);
-		activelist = activelistlowint;
-		return (newoff);
-	}
-	else
-	{
-		//std::cout << "Activelistlowint size: " << activelistlowint.size() << std::endl;
-		if (activelistlowint.size() == 0)
-		{
-			std::cout << "Activelistlowint empty" << std::endl;
-		}
-
-		for (li ii = activelistlowint.begin(); ii != activelistlowint.end();
-			 ++ii)
-		{
-			e = *ii;
-			//unsigned o8=e->offset;
-			//int z8 = o8 / (width * height);
-			//int y8 = (o8 - (z8 * width * height)) / width;
-			//int x8 = o8 - (y8 * width) - (z8 * width * height);
-			//std::cout << "NODE: " << "nx:" << x8 << " ny:" << y8 << " nz:" << z8 << " Computed: " << nodes[o8].computed << std::endl;
-			//vOutVol->setVoxel(ml::Vector(x8+offx, y8+offy, z8+offz, 0, 0, 0), 4000);
-
-			if (min == -1 || min > e->cost)
-			{
-				min = (int)e->cost;
-				newoff = e->offset;
-				todel = ii;
-			}
-		}
-
-		activelistlowint.erase(todel);
-		//std::cout << "Activelistsizelowint: " << activelistlowint.size() << std::endl;
-
-		bool found = false;
-		li p = activelist.begin();
-		while (!found && p != activelist.end())
-		{
-			Node* e = *p;
-			if (e->offset == newoff)
-			{
-				found = true;
-				todel = p;
-			}
-			p++;
-		}
-		activelist.erase(todel);
-
-		//std::cout << "Newoff: " << newoff << std::endl;
-		//std::cout << "Largeareatimes: " << largeareatimes << std::endl;
-		return (newoff);
-	}
-}
-//----------------------------------------------------------------------------------
-//! Diminish cost of dark nodes previously found when a large structure is found
-//----------------------------------------------------------------------------------
-void World::solvelargearea()
-{
-	int total = width * height * length;
-	std::cout << "Solvelargearea1" << std::endl;
-
-	for (int o = 0; o < total; o++)
-	{
-		if (nodes[o].computed == true)
-		{
-			if (nodes[o].intens > 1000 && nodes[o].intens < 1150)
-			{
-				nodes[o].cost = nodes[o].cost - nodes[o].fcost;
-				nodes[o].fcost = 20;
-			}
-		}
-	}
-}
-//----------------------------------------------------------------------------------
 //! Prints the hierarchical information of the tree
 //----------------------------------------------------------------------------------
 // ESRA
@@ -1756,16 +1119,6 @@ void World::set3dslicehandler(SlicesHandler* handler3D)
 	_handler3D = handler3D;
 }
 
-Node::Node(unsigned offset, float intens)
-{
-	this->offset = offset;
-	this->intens = intens;
-
-	computed = false;
-	first = false;
-}
-Node::~Node() {}
-
 PathElement::PathElement(unsigned offset)
 {
 	this->offset = offset;
@@ -17,35 +17,20 @@
 #include "Data/Vec3.h"
 
 #include "Core/BranchTree.h"
+#include "Core/IndexPriorityQueue.h"
 
 #include <iostream>
-#include <list>
+#include <memory>
 #include <vector>
 
 namespace iseg {
 
-class Node
-{
-public:
-	unsigned offset;
-	float intens;
-	float cost;
-	float fcost;
-	bool computed;
-	bool first;
-	Node* prev;
-	Node(unsigned offset, float intens);
-	Node() {}
-	~Node();
-};
-
 class PathElement
 {
 public:
 	unsigned offset;
 	bool cross;
 	bool seed;
-	Node* prev;
 	PathElement(unsigned offset);
 	PathElement() {}
 	~PathElement();
@@ -53,23 +38,28 @@ public:
 
 class World
 {
-	Node* nodes;
-	std::list<Node*>
-			activelist; //list with the active nodes (the ones that have been "touched" but not expanded yet)
-	std::list<Node*> activelistlowint;
+	// per voxel state of the bounding box
+	std::vector<float> intens; // intensity, or 4000-i for voxels on path i
+	std::vector<float> fcost;  // cost of stepping onto the voxel
+	// search state of the bricks reached by the current search (growing band), indexed by band node
+	std::vector<int> bricknode; // first band node of each brick of the bounding box, -1 if not reached
+	std::vector<unsigned> reachedbricks;
+	std::vector<float> cost;	// cost of the path from the seed
+	std::vector<unsigned> prev; // bounding box offset of the predecessor
+	std::vector<bool> computed;
+	std::unique_ptr<IndexPriorityQueue> queue; // the nodes which have been "touched" but not expanded yet
 	std::vector<std::vector<PathElement>> paths;
 	int width;
 	int height;
 	int length;
+	int bricksx;
+	int bricksy;
 	unsigned offx;
 	unsigned offy;
 	unsigned offz;
-	bool solvingarea;
-	int times;
 	std::vector<int> seedsfailed;
 	int rootOneintens;
 	bool firstseedexpanded;
-	int activelistlowintsize;
 	//		ml::TVirtualVolume<MLuint16>* vInVol;
 	//		ml::TVirtualVolume<MLuint16>* vOutVol;
 
@@ -90,11 +80,6 @@ public:
 	void dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree);
 	void paint(std::vector<Vec3> seeds, Vec3 cross,
 			unsigned short int numofseeds);
-	bool checkdiameter(unsigned currentoff, unsigned prevoff);
-	void solvelargearea();
-	unsigned solvelargearea2();
-	void changeintens(unsigned o);
-	void reduceactivelist();
 	int whoistheparent(std::vector<Vec3> seeds, int parentintens);
 	void outputBranchTree(BranchItem* branchItem, std::string prefix,
 			FILE*& fp);
@@ -102,6 +87,17 @@ public:
 	void set3dslicehandler(SlicesHandler* handler3D);
 
 private:
+	void resetsearch();
+	// band node of a voxel, its brick is added to the band when it is first reached
+	unsigned node(int i, int j, int k);
+	// bounding box offset of a band node
+	unsigned offset(unsigned n) const;
+
+	// number of expanded nodes after which a seed is skipped
+	static const int kMaxExpansions = 150000;
+	// edge length of the bricks by which the search band grows
+	static const int kBrickSize = 16;
+
 	SlicesHandler* _handler3D;
 	// start of bounding box
 	Vec3 _bbStart;
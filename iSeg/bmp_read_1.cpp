@@ -14,7 +14,9 @@
 
 #include "Data/addLine.h"
 
+#include "Core/DistanceTransform.h"
 #include "Core/ExpectationMaximization.h"
+#include "Core/HysteresisThreshold.h"
 #include "Core/ImageForestingTransform.h"
 #include "Core/ImageReader.h"
 #include "Core/KMeans.h"
@@ -37,6 +39,7 @@
 #include <qimage.h>
 #include <qmessagebox.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cerrno>
 #include <cmath>
@@ -44,6 +47,7 @@
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <list>
 #include <queue>
 #include <stack>
@@ -115,10 +119,8 @@ inline void swap_maps(T const*& Tp1, T const*& Tp2)
 	return;
 }
 
-std::list<unsigned> bmphandler::stackindex;
 unsigned bmphandler::stackcounter;
-std::list<float*> bmphandler::bits_stack;
-std::list<unsigned char> bmphandler::mode_stack;
+SliceStackStore bmphandler::bits_stack;
 //bool bmphandler::lockedtissues[TISSUES_SIZE_MAX+1];
 
 bmphandler::bmphandler()
@@ -174,11 +176,7 @@ bmphandler::~bmphandler()
 
 void bmphandler::clear_stack()
 {
-	for (auto& b : bits_stack)
-		sliceprovide->take_back(b);
 	bits_stack.clear();
-	stackindex.clear();
-	mode_stack.clear();
 	stackcounter = 1;
 }
 
@@ -263,6 +261,7 @@ void bmphandler::set_work(float* bits, unsigned char mode)
 
 void bmphandler::set_tissue(tissuelayers_size_t idx, tissues_size_t* bits)
 {
+	tissues_changed(idx);
 	if (loaded)
 	{
 		if (tissuelayers[idx] != bits)
@@ -289,6 +288,7 @@ float* bmphandler::swap_work_pointer(float* bits)
 
 tissues_size_t* bmphandler::swap_tissues_pointer(tissuelayers_size_t idx, tissues_size_t* bits)
 {
+	tissues_changed(idx);
 	tissues_size_t* tmp = tissuelayers[idx];
 	tissuelayers[idx] = bits;
 	return tmp;
@@ -331,6 +331,7 @@ void bmphandler::copy2work(float* bits, bool* mask, unsigned char mode)
 void bmphandler::copy2tissue(tissuelayers_size_t idx, tissues_size_t* bits,
 		bool* mask)
 {
+	tissues_changed(idx);
 	if (loaded)
 	{
 		tissues_size_t* tissues = tissuelayers[idx];
@@ -344,6 +345,7 @@ void bmphandler::copy2tissue(tissuelayers_size_t idx, tissues_size_t* bits,
 
 void bmphandler::copy2tissue(tissuelayers_size_t idx, tissues_size_t* bits)
 {
+	tissues_changed(idx);
 	if (loaded)
 	{
 		tissues_size_t* tissues = tissuelayers[idx];
@@ -552,6 +554,7 @@ void bmphandler::copy_tissue(tissuelayers_size_t idx, tissues_size_t* output)
 
 void bmphandler::newbmp(unsigned short width1, unsigned short height1, bool init)
 {
+	tissues_changed();
 	unsigned areanew = unsigned(width1) * height1;
 	width = width1;
 	height = height1;
@@ -611,6 +614,7 @@ void bmphandler::newbmp(unsigned short width1, unsigned short height1, bool init
 void bmphandler::newbmp(unsigned short width1, unsigned short height1,
 		float* bits)
 {
+	tissues_changed();
 	unsigned areanew = unsigned(width1) * height1;
 	width = width1;
 	height = height1;
@@ -656,8 +660,27 @@ void bmphandler::newbmp(unsigned short width1, unsigned short height1,
 	clear_limits();
 }
 
+void bmphandler::newbmp(unsigned short width1, unsigned short height1,
+		float* bmp, float* work, tissues_size_t* tissues)
+{
+	// takes over the buffers, which must be allocated with malloc
+	freebmp();
+
+	width = width1;
+	height = height1;
+	area = unsigned(width1) * height1;
+	sliceprovide = sliceprovide_installer->install(area);
+	bmp_bits = bmp;
+	work_bits = work;
+	help_bits = sliceprovide->give_me();
+	tissuelayers.push_back(tissues);
+
+	loaded = true;
+}
+
 void bmphandler::freebmp()
 {
+	tissues_changed();
 	if (loaded)
 	{
 		clear_stack();
@@ -730,6 +753,7 @@ void bmphandler::SetConverterFactors(int newRedFactor, int newGreenFactor,
 
 int bmphandler::LoadDIBitmap(const char* filename) /* I - File to load */
 {
+	tissues_changed();
 	FILE* fp; /* Open file pointer */
 	unsigned char* bits_tmp;
 	unsigned int bitsize;		 /* Size of bitmap */
@@ -969,6 +993,7 @@ int bmphandler::LoadDIBitmap(const char* filename) /* I - File to load */
 int bmphandler::LoadDIBitmap(const char* filename, Point p, unsigned short dx,
 		unsigned short dy) /* I - File to load */
 {
+	tissues_changed();
 	FILE* fp; /* Open file pointer */
 	unsigned char* bits_tmp;
 	unsigned int bitsize;		 /* Size of bitmap */
@@ -1583,6 +1608,7 @@ int bmphandler::CheckPNGDepth(const char* filename)
 
 int bmphandler::LoadPNGBitmap(const char* filename)
 {
+	tissues_changed();
 	unsigned char* bits_tmp;
 	unsigned int bitsize; /* Size of bitmap */
 
@@ -1716,6 +1742,7 @@ int bmphandler::LoadPNGBitmap(const char* filename)
 
 bool bmphandler::LoadArray(float* bits, unsigned short w1, unsigned short h1)
 {
+	tissues_changed();
 	width = w1;
 	height = h1;
 
@@ -1818,6 +1845,7 @@ bool bmphandler::LoadArray(float* bits, unsigned short w1, unsigned short h1)
 bool bmphandler::LoadArray(float* bits, unsigned short w, unsigned short h,
 		Point p, unsigned short dx, unsigned short dy)
 {
+	tissues_changed();
 	if (p.px > w)
 	{
 		p.px = 0;
@@ -1982,6 +2010,7 @@ bool bmphandler::ReloadArray(float* bits, unsigned short w1, unsigned short h1,
 
 bool bmphandler::LoadDICOM(const char* filename)
 {
+	tissues_changed();
 	DicomReader dcmread;
 
 	if (!dcmread.opendicom(filename))
@@ -2105,6 +2134,7 @@ bool bmphandler::LoadDICOM(const char* filename)
 bool bmphandler::LoadDICOM(const char* filename, Point p, unsigned short dx,
 		unsigned short dy)
 {
+	tissues_changed();
 	DicomReader dcmread;
 	dcmread.opendicom(filename);
 
@@ -2438,28 +2468,29 @@ FILE* bmphandler::save_stack(FILE* fp)
 	{
 		fwrite(&stackcounter, 1, sizeof(unsigned), fp);
 
+		const auto& stackindex = bits_stack.handles();
 		int size = -int(stackindex.size()) - 1;
 		fwrite(&size, 1, sizeof(int), fp);
 		int stackVersion = 1;
 		fwrite(&stackVersion, 1, sizeof(int), fp);
-		for (std::list<unsigned>::iterator it = stackindex.begin();
-				 it != stackindex.end(); it++)
+		for (auto it = stackindex.begin(); it != stackindex.end(); it++)
 		{
 			fwrite(&(*it), 1, sizeof(unsigned), fp);
 		}
 
-		size = int(bits_stack.size());
+		size = int(stackindex.size());
 		fwrite(&size, 1, sizeof(int), fp);
-		for (std::list<float*>::iterator it = bits_stack.begin();
-				 it != bits_stack.end(); it++)
+		std::vector<float> bits(area);
+		std::vector<unsigned char> mode_stack(stackindex.size(), 0);
+		for (size_t i = 0; i < stackindex.size(); i++)
 		{
-			fwrite(*it, 1, sizeof(float) * area, fp);
+			bits_stack.get(stackindex[i], bits.data(), area, mode_stack[i]);
+			fwrite(bits.data(), 1, sizeof(float) * area, fp);
 		}
 
 		size = int(mode_stack.size());
 		fwrite(&size, 1, sizeof(int), fp);
-		for (std::list<unsigned char>::iterator it = mode_stack.begin();
-				 it != mode_stack.end(); it++)
+		for (auto it = mode_stack.begin(); it != mode_stack.end(); it++)
 		{
 			fwrite(&(*it), 1, sizeof(unsigned char), fp);
 		}
@@ -2469,6 +2500,7 @@ FILE* bmphandler::save_stack(FILE* fp)
 
 FILE* bmphandler::load_proj(FILE* fp, int tissuesVersion, bool inclpics, bool init)
 {
+	tissues_changed();
 	unsigned short width1, height1;
 	fread(&width1, sizeof(unsigned short), 1, fp);
 	fread(&height1, sizeof(unsigned short), 1, fp);
@@ -2589,7 +2621,7 @@ FILE* bmphandler::load_stack(FILE* fp)
 		//		if(stackVersion<1) fseek(fp,-1, SEEK_CUR);
 	}
 
-	stackindex.clear();
+	std::vector<unsigned> stackindex;
 	unsigned dummy;
 	for (int i = 0; i < size1; i++)
 	{
@@ -2600,23 +2632,27 @@ FILE* bmphandler::load_stack(FILE* fp)
 	int size;
 	fread(&size, sizeof(int), 1, fp);
 	bits_stack.clear();
-	float* f;
+	std::vector<float> f(area);
 	for (int i = 0; i < size; i++)
 	{
-		f = sliceprovide->give_me();
-		fread(f, sizeof(float) * area, 1, fp);
-		bits_stack.push_back(f);
+		fread(f.data(), sizeof(float) * area, 1, fp);
+		if (i < size1)
+		{
+			bits_stack.push(stackindex[i], f.data(), area, 1);
+		}
 	}
 
 	if (stackVersion > 0)
 	{
 		fread(&size, sizeof(int), 1, fp);
-		mode_stack.clear();
 		unsigned char dummymode;
 		for (int i = 0; i < size; i++)
 		{
 			fread(&dummymode, sizeof(unsigned char), 1, fp);
-			mode_stack.push_back(dummymode);
+			if (i < size1)
+			{
+				bits_stack.set_mode(stackindex[i], dummymode);
+			}
 		}
 	}
 
@@ -3100,6 +3136,7 @@ int bmphandler::SaveWorkBitmap(const char* filename)
 
 int bmphandler::ReadAvw(const char* filename, short unsigned slicenr)
 {
+	tissues_changed();
 	unsigned int bitsize; /* Size of bitmap */
 
 	unsigned short w, h;
@@ -3248,6 +3285,7 @@ int bmphandler::ReadRaw(const char* filename, short unsigned w,
 		short unsigned h, unsigned bitdepth,
 		unsigned short slicenr)
 {
+	tissues_changed();
 	FILE* fp;							/* Open file pointer */
 	unsigned int bitsize; /* Size of bitmap */
 
@@ -3492,6 +3530,7 @@ int bmphandler::ReadRaw(const char* filename, short unsigned w,
 		unsigned short slicenr, Point p, unsigned short dx,
 		unsigned short dy)
 {
+	tissues_changed();
 	FILE* fp;							/* Open file pointer */
 	unsigned int bitsize; /* Size of bitmap */
 
@@ -3742,6 +3781,7 @@ int bmphandler::ReadRaw(const char* filename, short unsigned w,
 int bmphandler::ReadRawFloat(const char* filename, short unsigned w,
 		short unsigned h, unsigned short slicenr)
 {
+	tissues_changed();
 	FILE* fp;							/* Open file pointer */
 	unsigned int bitsize; /* Size of bitmap */
 
@@ -3879,6 +3919,7 @@ int bmphandler::ReadRawFloat(const char* filename, short unsigned w,
 		short unsigned h, unsigned short slicenr, Point p,
 		unsigned short dx, unsigned short dy)
 {
+	tissues_changed();
 	FILE* fp;							/* Open file pointer */
 	unsigned int bitsize; /* Size of bitmap */
 
@@ -4308,6 +4349,7 @@ int bmphandler::ReloadRawFloat(const char* filename, unsigned slicenr)
 float* bmphandler::ReadRawFloat(const char* filename, unsigned slicenr,
 		unsigned int area)
 {
+	tissues_changed();
 	FILE* fp; /* Open file pointer */
 
 	if ((fp = fopen(filename, "rb")) == nullptr)
@@ -4402,6 +4444,7 @@ int bmphandler::ReloadRawFloat(const char* filename, short unsigned w,
 
 int bmphandler::ReloadRawTissues(const char* filename, unsigned bitdepth, unsigned slicenr)
 {
+	tissues_changed();
 	if (!loaded)
 		return 0;
 
@@ -4509,6 +4552,7 @@ int bmphandler::ReloadRawTissues(const char* filename, short unsigned w,
 		short unsigned h, unsigned bitdepth,
 		unsigned slicenr, Point p)
 {
+	tissues_changed();
 	if (!loaded)
 		return 0;
 
@@ -4778,7 +4822,12 @@ void bmphandler::set_bmp_pt(Point p, float f)
 
 void bmphandler::set_tissue_pt(tissuelayers_size_t idx, Point p, tissues_size_t f)
 {
-	tissuelayers[idx][width * p.py + p.px] = f;
+	tissues_size_t& value = tissuelayers[idx][width * p.py + p.px];
+	if (idx < tissue_index.size())
+	{
+		tissue_index[idx].replace(p.px, p.py, value, f);
+	}
+	value = f;
 }
 
 float bmphandler::bmp_pt(Point p) { return bmp_bits[width * p.py + p.px]; }
@@ -4917,22 +4966,7 @@ void bmphandler::print_histogram()
 
 void bmphandler::threshold(float* thresholds)
 {
-	const short unsigned n = (short unsigned)thresholds[0];
-
-	if (n > 0)
-	{
-		const float leveldiff = 255.0f / n;
-
-		short unsigned j;
-
-		for (unsigned int i = 0; i < area; i++)
-		{
-			j = 0;
-			while (j < n && bmp_bits[i] > thresholds[j + 1])
-				j++;
-			work_bits[i] = j * leveldiff;
-		}
-	}
+	HysteresisThreshold::threshold(bmp_bits, work_bits, area, thresholds);
 
 	mode2 = 2;
 }
@@ -4986,6 +5020,7 @@ void bmphandler::bmp2work()
 
 void bmphandler::work2tissue(tissuelayers_size_t idx)
 {
+	tissues_changed(idx);
 	tissues_size_t* tissues = tissuelayers[idx];
 	for (unsigned int i = 0; i < area; i++)
 	{
@@ -5000,6 +5035,7 @@ void bmphandler::work2tissue(tissuelayers_size_t idx)
 
 void bmphandler::mergetissue(tissues_size_t tissuetype, tissuelayers_size_t idx)
 {
+	tissues_changed(idx);
 	tissues_size_t* tissues = tissuelayers[idx];
 	for (unsigned int i = 0; i < area; i++)
 	{
@@ -8172,6 +8208,7 @@ void bmphandler::fill_gaps(short unsigned n, bool connectivity)
 void bmphandler::fill_gapstissue(tissuelayers_size_t idx, short unsigned n,
 		bool connectivity)
 {
+	tissues_changed(idx);
 	unsigned char dummymode1 = mode1;
 	unsigned char dummymode2 = mode2;
 
@@ -8921,6 +8958,9 @@ void bmphandler::get_tissuecontours2_xmirrored(
 
 	std::vector<Point> vec_pt;
 	std::vector<unsigned> vec_meetings;
+	// simplification buffers are reused for all contours of the slice
+	Contour2 cc2;
+	std::vector<Point> vec_simp;
 	float vol;
 
 	tissues_size_t* tissues = tissuelayers[idx];
@@ -9476,8 +9516,6 @@ void bmphandler::get_tissuecontours2_xmirrored(
 				{
 					vec_meetings.push_back(0);
 				}
-				Contour2 cc2;
-				std::vector<Point> vec_simp;
 				cc2.doug_peuck(disttol * 2, &vec_pt, &vec_meetings, &vec_simp);
 				if (vec_simp.size() > 2)
 				{
@@ -9977,216 +10015,70 @@ void bmphandler::distance_map(bool connectivity, float f,
 	return;
 }
 
-unsigned* bmphandler::dead_reckoning(float f)
+namespace {
+/// exact Euclidean distance to the feature pixels, which are 0 on input and infinity otherwise
+void distance_to_features(float* bits, unsigned short width, unsigned short height, unsigned* nearest, bool squared, float none)
 {
-	unsigned char dummymode = mode1;
-	unsigned* P = (unsigned*)malloc(area * sizeof(unsigned));
+	squared_distance_transform(bits, width, height, nearest);
 
+	const unsigned area = unsigned(width) * height;
 	for (unsigned i = 0; i < area; i++)
 	{
-		work_bits[i] = float((width + height) * (width + height));
-		P[i] = area;
+		if (bits[i] == std::numeric_limits<float>::infinity())
+			bits[i] = none;
+		else if (!squared)
+			bits[i] = std::sqrt(bits[i]);
 	}
+}
+} // namespace
+
+unsigned* bmphandler::contour_distance(float f, bool squared)
+{
+	unsigned char dummymode = mode1;
+	unsigned* P = (unsigned*)malloc(area * sizeof(unsigned));
 
 	std::vector<std::vector<Point>> vo, vi;
-	std::vector<unsigned>::iterator vuit;
 	std::vector<Point>::iterator vpit;
 
 	swap_bmpwork();
 	get_contours(f, &vo, &vi, 0);
 	swap_bmpwork();
 
+	std::fill(work_bits, work_bits + area, std::numeric_limits<float>::infinity());
 	for (unsigned i = 0; i < (unsigned)vo.size(); i++)
 	{
 		for (vpit = vo[i].begin(); vpit != vo[i].end(); vpit++)
-		{
 			work_bits[pt2coord(*vpit)] = 0;
-			P[pt2coord(*vpit)] = pt2coord(*vpit);
-		}
-		//		cout << ";"<<vo[i].size();
 	}
 	for (unsigned i = 0; i < (unsigned)vi.size(); i++)
 	{
 		for (vpit = vi[i].begin(); vpit != vi[i].end(); vpit++)
-		{
 			work_bits[pt2coord(*vpit)] = 0;
-			P[pt2coord(*vpit)] = pt2coord(*vpit);
-		}
-		//		cout << "."<<vi[i].size();
 	}
 
-	unsigned j = 0;
-
-	float d1 = 1;
-	float d2 = sqrt(2.0f);
-
-	for (unsigned short k = 0; k < height; k++)
-	{
-		for (unsigned short l = 0; l < width; l++)
-		{
-			if (k > 0)
-			{
-				if (l > 0 && work_bits[j - 1 - width] + d2 < work_bits[j])
-				{
-					P[j] = P[j - 1 - width];
-					work_bits[j] =
-							sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-												 (k - P[j] / width) * (k - P[j] / width)));
-				}
-
-				if (work_bits[j - width] + d1 < work_bits[j])
-				{
-					P[j] = P[j - width];
-					work_bits[j] =
-							sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-												 (k - P[j] / width) * (k - P[j] / width)));
-				}
-
-				if ((l + 1) != width &&
-						work_bits[j + 1 - width] + d2 < work_bits[j])
-				{
-					P[j] = P[j + 1 - width];
-					work_bits[j] =
-							sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-												 (k - P[j] / width) * (k - P[j] / width)));
-				}
-			}
-
-			if (l > 0 && work_bits[j - 1] + d1 < work_bits[j])
-			{
-				P[j] = P[j - 1];
-				work_bits[j] =
-						sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-											 (k - P[j] / width) * (k - P[j] / width)));
-			}
-
-			j++;
-		}
-	}
-
-	j = area - 1;
-
-	for (int k = height - 1; k >= 0; k--)
-	{
-		for (int l = width - 1; l >= 0; l--)
-		{
-			if ((l + 1) != width && work_bits[j + 1] + d1 < work_bits[j])
-			{
-				P[j] = P[j + 1];
-				work_bits[j] =
-						sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-											 (k - P[j] / width) * (k - P[j] / width)));
-			}
-
-			if ((k + 1) != height)
-			{
-				if (l > 0 && work_bits[j - 1 + width] + d2 < work_bits[j])
-				{
-					P[j] = P[j - 1 + width];
-					work_bits[j] =
-							sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-												 (k - P[j] / width) * (k - P[j] / width)));
-				}
-
-				if (work_bits[j + width] + d1 < work_bits[j])
-				{
-					P[j] = P[j + width];
-					work_bits[j] =
-							sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-												 (k - P[j] / width) * (k - P[j] / width)));
-				}
-
-				if ((l + 1) != width &&
-						work_bits[j + 1 + width] + d2 < work_bits[j])
-				{
-					P[j] = P[j + 1 + width];
-					work_bits[j] =
-							sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-												 (k - P[j] / width) * (k - P[j] / width)));
-				}
-			}
-
-			j--;
-		}
-	}
-
-	j = 0;
-
-	for (unsigned short k = 0; k < height; k++)
-	{
-		for (unsigned short l = 0; l < width; l++)
-		{
-			if (k > 0)
-			{
-				if (l > 0 && work_bits[j - 1 - width] + d2 < work_bits[j])
-				{
-					P[j] = P[j - 1 - width];
-					work_bits[j] =
-							sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-												 (k - P[j] / width) * (k - P[j] / width)));
-				}
-
-				if (work_bits[j - width] + d1 < work_bits[j])
-				{
-					P[j] = P[j - width];
-					work_bits[j] =
-							sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-												 (k - P[j] / width) * (k - P[j] / width)));
-				}
-
-				if ((l + 1) != width &&
-						work_bits[j + 1 - width] + d2 < work_bits[j])
-				{
-					P[j] = P[j + 1 - width];
-					work_bits[j] =
-							sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-												 (k - P[j] / width) * (k - P[j] / width)));
-				}
-			}
-
-			if (l > 0 && work_bits[j - 1] + d1 < work_bits[j])
-			{
-				P[j] = P[j - 1];
-				work_bits[j] =
-						sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-											 (k - P[j] / width) * (k - P[j] / width)));
-			}
-
-			j++;
-		}
-	}
+	distance_to_features(work_bits, width, height, P, squared, float((width + height) * (width + height)));
 
 	for (unsigned i = 0; i < area; i++)
 		if (bmp_bits[i] != f)
 			work_bits[i] = -work_bits[i];
 
-	/*	for(unsigned i=0;i<(unsigned)vo.size();i++)
-		for(vpit=vo[i].begin();vpit!=vo[i].end();vpit++) {
-			work_bits[pt2coord(*vpit)]=255;
-			P[pt2coord(*vpit)]=pt2coord(*vpit);
-		}
-	for(unsigned i=0;i<(unsigned)vi.size();i++)
-		for(vpit=vi[i].begin();vpit!=vi[i].end();vpit++) {
-			work_bits[pt2coord(*vpit)]=255;
-			P[pt2coord(*vpit)]=pt2coord(*vpit);
-		}*/
-
 	mode1 = dummymode;
 	mode2 = 1;
 
 	return P;
 }
 
+unsigned* bmphandler::dead_reckoning(float f)
+{
+	return contour_distance(f, false);
+}
+
 void bmphandler::dead_reckoning()
 {
 	unsigned char dummymode = mode1;
-	unsigned* P = (unsigned*)malloc(area * sizeof(unsigned));
 
-	for (unsigned i = 0; i < area; i++)
-	{
-		work_bits[i] = float((width + height) * (width + height));
-		P[i] = area;
-	}
+	// both pixels of each 4-neighbor pair with different values are features
+	std::fill(work_bits, work_bits + area, std::numeric_limits<float>::infinity());
 
 	unsigned i1 = 0;
 	for (unsigned short h = 0; h < height - 1; h++)
@@ -10196,8 +10088,6 @@ void bmphandler::dead_reckoning()
 			if (bmp_bits[i1] != bmp_bits[i1 + width])
 			{
 				work_bits[i1] = work_bits[i1 + width] = 0;
-				P[i1] = i1;
-				P[i1 + width] = i1 + width;
 			}
 			i1++;
 		}
@@ -10211,371 +10101,69 @@ void bmphandler::dead_reckoning()
 			if (bmp_bits[i1] != bmp_bits[i1 + 1])
 			{
 				work_bits[i1] = work_bits[i1 + 1] = 0;
-				P[i1] = i1;
-				P[i1 + 1] = i1 + 1;
 			}
 			i1++;
 		}
 		i1++;
 	}
 
-	unsigned j = 0;
-
-	float d1 = 1;
-	float d2 = sqrt(2.0f);
-
-	for (unsigned short k = 0; k < height; k++)
-	{
-		for (unsigned short l = 0; l < width; l++)
-		{
-			if (k > 0)
-			{
-				if (l > 0 && work_bits[j - 1 - width] + d2 < work_bits[j])
-				{
-					P[j] = P[j - 1 - width];
-					work_bits[j] =
-							sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-												 (k - P[j] / width) * (k - P[j] / width)));
-				}
-
-				if (work_bits[j - width] + d1 < work_bits[j])
-				{
-					P[j] = P[j - width];
-					work_bits[j] =
-							sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-												 (k - P[j] / width) * (k - P[j] / width)));
-				}
-
-				if ((l + 1) != width &&
-						work_bits[j + 1 - width] + d2 < work_bits[j])
-				{
-					P[j] = P[j + 1 - width];
-					work_bits[j] =
-							sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-												 (k - P[j] / width) * (k - P[j] / width)));
-				}
-			}
-
-			if (l > 0 && work_bits[j - 1] + d1 < work_bits[j])
-			{
-				P[j] = P[j - 1];
-				work_bits[j] =
-						sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-											 (k - P[j] / width) * (k - P[j] / width)));
-			}
-
-			j++;
-		}
-	}
-
-	j = area - 1;
-
-	for (int k = height - 1; k >= 0; k--)
-	{
-		for (int l = width - 1; l >= 0; l--)
-		{
-			if ((l + 1) != width && work_bits[j + 1] + d1 < work_bits[j])
-			{
-				P[j] = P[j + 1];
-				work_bits[j] =
-						sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-											 (k - P[j] / width) * (k - P[j] / width)));
-			}
-
-			if ((k + 1) != height)
-			{
-				if (l > 0 && work_bits[j - 1 + width] + d2 < work_bits[j])
-				{
-					P[j] = P[j - 1 + width];
-					work_bits[j] =
-							sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-												 (k - P[j] / width) * (k - P[j] / width)));
-				}
-
-				if (work_bits[j + width] + d1 < work_bits[j])
-				{
-					P[j] = P[j + width];
-					work_bits[j] =
-							sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-												 (k - P[j] / width) * (k - P[j] / width)));
-				}
-
-				if ((l + 1) != width &&
-						work_bits[j + 1 + width] + d2 < work_bits[j])
-				{
-					P[j] = P[j + 1 + width];
-					work_bits[j] =
-							sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-												 (k - P[j] / width) * (k - P[j] / width)));
-				}
-			}
-
-			j--;
-		}
-	}
-
-	j = 0;
-
-	for (unsigned short k = 0; k < height; k++)
-	{
-		for (unsigned short l = 0; l < width; l++)
-		{
-			if (k > 0)
-			{
-				if (l > 0 && work_bits[j - 1 - width] + d2 < work_bits[j])
-				{
-					P[j] = P[j - 1 - width];
-					work_bits[j] =
-							sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-												 (k - P[j] / width) * (k - P[j] / width)));
-				}
-
-				if (work_bits[j - width] + d1 < work_bits[j])
-				{
-					P[j] = P[j - width];
-					work_bits[j] =
-							sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-												 (k - P[j] / width) * (k - P[j] / width)));
-				}
-
-				if ((l + 1) != width &&
-						work_bits[j + 1 - width] + d2 < work_bits[j])
-				{
-					P[j] = P[j + 1 - width];
-					work_bits[j] =
-							sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-												 (k - P[j] / width) * (k - P[j] / width)));
-				}
-			}
-
-			if (l > 0 && work_bits[j - 1] + d1 < work_bits[j])
-			{
-				P[j] = P[j - 1];
-				work_bits[j] =
-						sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-											 (k - P[j] / width) * (k - P[j] / width)));
-			}
-
-			j++;
-		}
-	}
-
-	//	for(unsigned i=0;i<area;i++)
-	//		if(bmp_bits[i]==0) work_bits[i]=-work_bits[i];
+	distance_to_features(work_bits, width, height, nullptr, false, float((width + height) * (width + height)));
 
 	mode1 = dummymode;
 	mode2 = 1;
 
-	free(P);
 	return;
 }
 
 unsigned* bmphandler::dead_reckoning_squared(float f)
 {
-	unsigned char dummymode = mode1;
-	unsigned* P = (unsigned*)malloc(area * sizeof(unsigned));
-
-	for (unsigned i = 0; i < area; i++)
-	{
-		work_bits[i] = float((width + height) * (width + height));
-		P[i] = area;
-	}
-
-	std::vector<std::vector<Point>> vo, vi;
-	std::vector<Point>::iterator vpit;
-
-	swap_bmpwork();
-	get_contours(f, &vo, &vi, 0);
-	swap_bmpwork();
-
-	for (unsigned i = 0; i < (unsigned)vo.size(); i++)
-	{
-		for (vpit = vo[i].begin(); vpit != vo[i].end(); vpit++)
-		{
-			work_bits[pt2coord(*vpit)] = 0;
-			P[pt2coord(*vpit)] = pt2coord(*vpit);
-		}
-	}
-	for (unsigned i = 0; i < (unsigned)vi.size(); i++)
-	{
-		for (vpit = vi[i].begin(); vpit != vi[i].end(); vpit++)
-		{
-			work_bits[pt2coord(*vpit)] = 0;
-			P[pt2coord(*vpit)] = pt2coord(*vpit);
-		}
-	}
+	return contour_distance(f, true);
+}
 
-	unsigned j = 0;
+void bmphandler::IFT_distance1(float f)
+{
+	unsigned char dummymode = mode1;
 
-	float d1 = 1;
-	float d2 = sqrt(2.0f);
+	// the pixel with value f of each 4-neighbor pair with different values is a feature
+	std::fill(work_bits, work_bits + area, std::numeric_limits<float>::infinity());
 
-	for (unsigned short k = 0; k < height; k++)
+	unsigned i = 0;
+	unsigned i1 = width;
+	for (unsigned short j = 0; j + 1 < height; j++)
 	{
-		for (unsigned short l = 0; l < width; l++)
+		for (unsigned short k = 0; k < width; k++)
 		{
-			if (k > 0)
-			{
-				if (l > 0 && work_bits[j - 1 - width] + d2 < work_bits[j])
-				{
-					P[j] = P[j - 1 - width];
-					work_bits[j] =
-							(float((l - P[j] % width) * (l - P[j] % width) +
-										 (k - P[j] / width) * (k - P[j] / width)));
-				}
-
-				if (work_bits[j - width] + d1 < work_bits[j])
-				{
-					P[j] = P[j - width];
-					work_bits[j] =
-							(float((l - P[j] % width) * (l - P[j] % width) +
-										 (k - P[j] / width) * (k - P[j] / width)));
-				}
-
-				if ((l + 1) != width &&
-						work_bits[j + 1 - width] + d2 < work_bits[j])
-				{
-					P[j] = P[j + 1 - width];
-					work_bits[j] =
-							(float((l - P[j] % width) * (l - P[j] % width) +
-										 (k - P[j] / width) * (k - P[j] / width)));
-				}
-			}
-
-			if (l > 0 && work_bits[j - 1] + d1 < work_bits[j])
-			{
-				P[j] = P[j - 1];
-				work_bits[j] = (float((l - P[j] % width) * (l - P[j] % width) +
-															(k - P[j] / width) * (k - P[j] / width)));
-			}
-
-			j++;
+			if (bmp_bits[i] == f && bmp_bits[i1] != f)
+				work_bits[i] = 0;
+			else if (bmp_bits[i1] == f && bmp_bits[i] != f)
+				work_bits[i1] = 0;
+			i++;
+			i1++;
 		}
 	}
-
-	j = area - 1;
-
-	for (int k = height - 1; k >= 0; k--)
+	i = 0;
+	i1 = 1;
+	for (unsigned short j = 0; j < height; j++)
 	{
-		for (int l = width - 1; l >= 0; l--)
+		for (unsigned short k = 0; k + 1 < width; k++)
 		{
-			if ((l + 1) != width && work_bits[j + 1] + d1 < work_bits[j])
-			{
-				P[j] = P[j + 1];
-				work_bits[j] = (float((l - P[j] % width) * (l - P[j] % width) +
-															(k - P[j] / width) * (k - P[j] / width)));
-			}
-
-			if ((k + 1) != height)
-			{
-				if (l > 0 && work_bits[j - 1 + width] + d2 < work_bits[j])
-				{
-					P[j] = P[j - 1 + width];
-					work_bits[j] =
-							(float((l - P[j] % width) * (l - P[j] % width) +
-										 (k - P[j] / width) * (k - P[j] / width)));
-				}
-
-				if (work_bits[j + width] + d1 < work_bits[j])
-				{
-					P[j] = P[j + width];
-					work_bits[j] =
-							(float((l - P[j] % width) * (l - P[j] % width) +
-										 (k - P[j] / width) * (k - P[j] / width)));
-				}
-
-				if ((l + 1) != width &&
-						work_bits[j + 1 + width] + d2 < work_bits[j])
-				{
-					P[j] = P[j + 1 + width];
-					work_bits[j] =
-							(float((l - P[j] % width) * (l - P[j] % width) +
-										 (k - P[j] / width) * (k - P[j] / width)));
-				}
-			}
-
-			j--;
+			if (bmp_bits[i] == f && bmp_bits[i1] != f)
+				work_bits[i] = 0;
+			else if (bmp_bits[i1] == f && bmp_bits[i] != f)
+				work_bits[i1] = 0;
+			i++;
+			i1++;
 		}
+		i++;
+		i1++;
 	}
 
-	j = 0;
+	distance_to_features(work_bits, width, height, nullptr, false, 1E10f);
 
-	for (unsigned short k = 0; k < height; k++)
+	for (i = 0; i < area; i++)
 	{
-		for (unsigned short l = 0; l < width; l++)
-		{
-			if (k > 0)
-			{
-				if (l > 0 && work_bits[j - 1 - width] + d2 < work_bits[j])
-				{
-					P[j] = P[j - 1 - width];
-					work_bits[j] =
-							(float((l - P[j] % width) * (l - P[j] % width) +
-										 (k - P[j] / width) * (k - P[j] / width)));
-				}
-
-				if (work_bits[j - width] + d1 < work_bits[j])
-				{
-					P[j] = P[j - width];
-					work_bits[j] =
-							(float((l - P[j] % width) * (l - P[j] % width) +
-										 (k - P[j] / width) * (k - P[j] / width)));
-				}
-
-				if ((l + 1) != width &&
-						work_bits[j + 1 - width] + d2 < work_bits[j])
-				{
-					P[j] = P[j + 1 - width];
-					work_bits[j] =
-							(float((l - P[j] % width) * (l - P[j] % width) +
-										 (k - P[j] / width) * (k - P[j] / width)));
-				}
-			}
-
-			if (l > 0 && work_bits[j - 1] + d1 < work_bits[j])
-			{
-				P[j] = P[j - 1];
-				work_bits[j] = (float((l - P[j] % width) * (l - P[j] % width) +
-															(k - P[j] / width) * (k - P[j] / width)));
-			}
-
-			j++;
-		}
-	}
-
-	for (unsigned i = 0; i < area; i++)
 		if (bmp_bits[i] != f)
 			work_bits[i] = -work_bits[i];
-
-	/*	for(unsigned i=0;i<(unsigned)vo.size();i++)
-		for(vpit=vo[i].begin();vpit!=vo[i].end();vpit++) {
-			work_bits[pt2coord(*vpit)]=255;
-			P[pt2coord(*vpit)]=pt2coord(*vpit);
-		}
-	for(unsigned i=0;i<(unsigned)vi.size();i++)
-		for(vpit=vi[i].begin();vpit!=vi[i].end();vpit++) {
-			work_bits[pt2coord(*vpit)]=255;
-			P[pt2coord(*vpit)]=pt2coord(*vpit);
-		}*/
-
-	mode1 = dummymode;
-	mode2 = 1;
-
-	return P;
-}
-
-void bmphandler::IFT_distance1(float f)
-{
-	unsigned char dummymode = mode1;
-	ImageForestingTransformDistance IFTdist;
-	IFTdist.distance_init(width, height, f, bmp_bits);
-	float* f1 = IFTdist.return_pf();
-	for (unsigned i = 0; i < area; i++)
-	{
-		if (bmp_bits[i] == f)
-			work_bits[i] = f1[i];
-		else
-			work_bits[i] = -f1[i];
 	}
 	mode1 = dummymode;
 	mode2 = 1;
@@ -11011,6 +10599,7 @@ void bmphandler::add_skin_outside(unsigned i4, float setto)
 void bmphandler::add_skintissue(tissuelayers_size_t idx, unsigned i4,
 		tissues_size_t setto)
 {
+	tissues_changed(idx);
 	std::vector<int> s;
 	float* results = (float*)malloc(sizeof(float) * (area + 2 * width + 2 * height + 4));
 
@@ -11183,6 +10772,7 @@ void bmphandler::add_skintissue(tissuelayers_size_t idx, unsigned i4,
 void bmphandler::add_skintissue_outside(tissuelayers_size_t idx, unsigned i4,
 		tissues_size_t setto)
 {
+	tissues_changed(idx);
 	std::vector<int> s;
 	std::vector<int> s1;
 	float* results = (float*)malloc(sizeof(float) * (area + 2 * width + 2 * height + 4));
@@ -11386,6 +10976,7 @@ float bmphandler::add_skin_outside(unsigned i)
 void bmphandler::fill_skin(int thicknessX, int thicknessY,
 		tissues_size_t backgroundID, tissues_size_t skinID)
 {
+	tissues_changed();
 	//BL recommendation
 	int skinThick = thicknessX;
 
@@ -11431,7 +11022,7 @@ void bmphandler::fill_skin(int thicknessX, int thicknessY,
 		{
 			bmp1[i] = (float)tissue1[i];
 		}
-		this->dead_reckoning((float)0);
+		free(this->dead_reckoning((float)0));
 		bmp1 = this->return_work();
 
 		for (int j = skinThick; j + skinThick < dims[1]; j++)
@@ -11597,6 +11188,7 @@ void bmphandler::flood_exterior(float setto)
 void bmphandler::flood_exteriortissue(tissuelayers_size_t idx,
 		tissues_size_t setto)
 {
+	tissues_changed(idx);
 	unsigned char dummymode1 = mode1;
 	unsigned char dummymode2 = mode2;
 	std::vector<int> s;
@@ -11793,6 +11385,7 @@ void bmphandler::fill_unassigned(float setto)
 void bmphandler::fill_unassignedtissue(tissuelayers_size_t idx,
 		tissues_size_t setto)
 {
+	tissues_changed(idx);
 	std::vector<int> s;
 	float* results =
 			(float*)malloc(sizeof(float) * (area + 2 * width + 2 * height + 4));
@@ -12251,7 +11844,7 @@ void bmphandler::cannylevelset(float* initlev, float f, float sigma,
 	swap_bmpwork();
 	//	dead_reckoning_squared(255.0f);
 	//	IFT_distance1(255.0f);
-	dead_reckoning(255.0f);
+	free(dead_reckoning(255.0f));
 	dummy = tmp;
 	tmp = bmp_bits;
 	bmp_bits = dummy;
@@ -12341,48 +11934,23 @@ void bmphandler::threshlevelset(float thresh_low, float thresh_high,
 
 unsigned bmphandler::pushstack_bmp()
 {
-	float* bits = sliceprovide->give_me();
-
-	for (unsigned i = 0; i < area; ++i)
-	{
-		bits[i] = bmp_bits[i];
-	}
-
-	bits_stack.push_back(bits);
-	stackindex.push_back(stackcounter);
-	mode_stack.push_back(mode1);
+	bits_stack.push(stackcounter, bmp_bits, area, mode1);
 
 	return stackcounter++;
 }
 
 unsigned bmphandler::pushstack_work()
 {
-	float* bits = sliceprovide->give_me();
-
-	for (unsigned i = 0; i < area; ++i)
-	{
-		bits[i] = work_bits[i];
-	}
-
-	bits_stack.push_back(bits);
-	stackindex.push_back(stackcounter);
-	mode_stack.push_back(mode2);
+	bits_stack.push(stackcounter, work_bits, area, mode2);
 
 	return stackcounter++;
 }
 
 bool bmphandler::savestack(unsigned i, const char* filename)
 {
-	std::list<float*>::iterator it = bits_stack.begin();
-	std::list<unsigned>::iterator it1 = stackindex.begin();
-	std::list<unsigned char>::iterator it2 = mode_stack.begin();
-	while (it != bits_stack.end() && (*it1) != i)
-	{
-		it++;
-		it1++;
-		it2++;
-	}
-	if (it != bits_stack.end())
+	std::vector<float> bits(area);
+	unsigned char mode;
+	if (bits_stack.get(i, bits.data(), area, mode))
 	{
 		FILE* fp = fopen(filename, "wb");
 		if (fp == nullptr)
@@ -12400,12 +11968,12 @@ bool bmphandler::savestack(unsigned i, const char* filename)
 			return false;
 		}
 		unsigned int bitsize = width * (unsigned)height * sizeof(float);
-		if (fwrite(*it, 1, bitsize, fp) < bitsize)
+		if (fwrite(bits.data(), 1, bitsize, fp) < bitsize)
 		{
 			fclose(fp);
 			return false;
 		}
-		if (fwrite(&(*it2), 1, sizeof(unsigned char), fp) <
+		if (fwrite(&mode, 1, sizeof(unsigned char), fp) <
 				sizeof(unsigned char))
 		{
 			fclose(fp);
@@ -12440,8 +12008,8 @@ unsigned bmphandler::loadstack(const char* filename)
 		return 123456;
 	}
 	unsigned int bitsize = width * (unsigned)height * sizeof(float);
-	float* bits = sliceprovide->give_me();
-	if (fread(bits, 1, bitsize, fp) < bitsize)
+	std::vector<float> bits(area);
+	if (fread(bits.data(), 1, bitsize, fp) < bitsize)
 	{
 		fclose(fp);
 		return 123456;
@@ -12453,9 +12021,7 @@ unsigned bmphandler::loadstack(const char* filename)
 		return 123456;
 	}
 
-	bits_stack.push_back(bits);
-	stackindex.push_back(stackcounter);
-	mode_stack.push_back(mode1);
+	bits_stack.push(stackcounter, bits.data(), area, mode1);
 
 	fclose(fp);
 	return stackcounter++;
@@ -12475,126 +12041,56 @@ unsigned bmphandler::pushstack_tissue(tissuelayers_size_t idx,
 			bits[i] = 0;
 	}
 
-	bits_stack.push_back(bits);
-	stackindex.push_back(stackcounter);
-	mode_stack.push_back(2);
+	bits_stack.push(stackcounter, bits, area, 2);
+	sliceprovide->take_back(bits);
 
 	return stackcounter++;
 }
 
 unsigned bmphandler::pushstack_help()
 {
-	float* bits = sliceprovide->give_me();
-
-	for (unsigned i = 0; i < area; ++i)
-	{
-		bits[i] = help_bits[i];
-	}
-
-	bits_stack.push_back(bits);
-	stackindex.push_back(stackcounter);
-	mode_stack.push_back(0);
+	bits_stack.push(stackcounter, help_bits, area, 0);
 
 	return stackcounter++;
 }
 
 void bmphandler::removestack(unsigned i)
 {
-	/*	if(i<bits_stack.size()){
-		std::list<float *>::iterator it=bits_stack.begin();
-		std::list<unsigned>::iterator it1=stackindex.begin();
-		while(i>0) {it++; it1++; i--;}
-		bits_stack.erase(it);
-		stackindex.erase(it1);
-	}*/
-
-	std::list<float*>::iterator it = bits_stack.begin();
-	std::list<unsigned>::iterator it1 = stackindex.begin();
-	std::list<unsigned char>::iterator it2 = mode_stack.begin();
-	while (it != bits_stack.end() && (*it1) != i)
-	{
-		it++;
-		it1++;
-		it2++;
-	}
-	if (it != bits_stack.end())
-	{
-		sliceprovide->take_back(*it);
-		bits_stack.erase(it);
-		stackindex.erase(it1);
-		mode_stack.erase(it2);
-	}
+	bits_stack.remove(i);
 }
 
 void bmphandler::getstack_bmp(unsigned i)
 {
-	//	sliceprovide->take_back(bmp_bits);
-
-	std::list<float*>::iterator it = bits_stack.begin();
-	std::list<unsigned>::iterator it1 = stackindex.begin();
-	std::list<unsigned char>::iterator it2 = mode_stack.begin();
-
-	while (it != bits_stack.end() && (*it1) != i)
-	{
-		it++;
-		it1++;
-		it2++;
-	}
-	if (it != bits_stack.end())
+	unsigned char mode;
+	if (bits_stack.get(i, bmp_bits, area, mode))
 	{
-		//		bmp_bits=*it;
-		for (unsigned i = 0; i < area; i++)
-			bmp_bits[i] = (*it)[i];
+		mode1 = mode;
 	}
-
-	mode1 = (*it2);
 }
 
 void bmphandler::getstack_work(unsigned i)
 {
-	std::list<float*>::iterator it = bits_stack.begin();
-	std::list<unsigned>::iterator it1 = stackindex.begin();
-	std::list<unsigned char>::iterator it2 = mode_stack.begin();
-
-	while (it != bits_stack.end() && (*it1) != i)
+	unsigned char mode;
+	if (bits_stack.get(i, work_bits, area, mode))
 	{
-		it++;
-		it1++;
-		it2++;
-	}
-	if (it != bits_stack.end())
-	{
-		//		work_bits=*it;
-		for (unsigned i = 0; i < area; i++)
-			work_bits[i] = (*it)[i];
+		mode2 = mode;
 	}
-
-	mode2 = (*it2);
 }
 
 void bmphandler::getstack_tissue(tissuelayers_size_t idx, unsigned i,
 		tissues_size_t tissuenr, bool override)
 {
-	//	sliceprovide->take_back(work_bits);
-
-	std::list<float*>::iterator it = bits_stack.begin();
-	std::list<unsigned>::iterator it1 = stackindex.begin();
-	std::list<unsigned char>::iterator it2 = mode_stack.begin();
-
-	while (it != bits_stack.end() && (*it1) != i)
-	{
-		it++;
-		it1++;
-		it2++;
-	}
-	tissues_size_t* tissues = tissuelayers[idx];
-	if (it != bits_stack.end())
+	tissues_changed(idx);
+	float* bits = sliceprovide->give_me();
+	unsigned char mode;
+	if (bits_stack.get(i, bits, area, mode))
 	{
+		tissues_size_t* tissues = tissuelayers[idx];
 		if (override)
 		{
 			for (unsigned i = 0; i < area; i++)
 			{
-				if (((*it)[i] != 0) &&
+				if ((bits[i] != 0) &&
 						(!TissueInfos::GetTissueLocked(tissues[i])))
 					tissues[i] = tissuenr;
 			}
@@ -12603,119 +12099,67 @@ void bmphandler::getstack_tissue(tissuelayers_size_t idx, unsigned i,
 		{
 			for (unsigned i = 0; i < area; i++)
 			{
-				if (((*it)[i] != 0) && (tissues[i] == 0))
+				if ((bits[i] != 0) && (tissues[i] == 0))
 					tissues[i] = tissuenr;
 			}
 		}
 	}
+	sliceprovide->take_back(bits);
 }
 
 void bmphandler::getstack_help(unsigned i)
 {
-	//	sliceprovide->take_back(help_bits);
-
-	std::list<float*>::iterator it = bits_stack.begin();
-	std::list<unsigned>::iterator it1 = stackindex.begin();
-
-	while (it != bits_stack.end() && (*it1) != i)
-	{
-		it++;
-		it1++;
-	}
-	if (it != bits_stack.end())
-	{
-		//		help_bits=*it;
-		for (unsigned i = 0; i < area; i++)
-			help_bits[i] = (*it)[i];
-	}
+	unsigned char mode;
+	bits_stack.get(i, help_bits, area, mode);
 }
 
-float* bmphandler::getstack(unsigned i, unsigned char& mode)
+bool bmphandler::getstack(unsigned i, float* bits, unsigned char& mode)
 {
-	std::list<float*>::iterator it = bits_stack.begin();
-	std::list<unsigned>::iterator it1 = stackindex.begin();
-	std::list<unsigned char>::iterator it2 = mode_stack.begin();
-
-	while (it != bits_stack.end() && (*it1) != i)
-	{
-		it++;
-		it1++;
-		it2++;
-	}
-
-	if (it != bits_stack.end())
-	{
-		mode = *it2;
-		return *it;
-	}
-	else
-	{
-		return 0;
-	}
+	return bits_stack.get(i, bits, area, mode);
 }
 
 void bmphandler::popstack_bmp()
 {
-	if (!bits_stack.empty())
+	unsigned char mode;
+	if (bits_stack.pop_back(bmp_bits, area, mode))
 	{
-		sliceprovide->take_back(bmp_bits);
-		bmp_bits = bits_stack.back();
-		mode1 = mode_stack.back();
-		bits_stack.pop_back();
-		stackindex.pop_back();
-		mode_stack.pop_back();
+		mode1 = mode;
 	}
 }
 
 void bmphandler::popstack_work()
 {
-	if (!bits_stack.empty())
+	unsigned char mode;
+	if (bits_stack.pop_back(work_bits, area, mode))
 	{
-		sliceprovide->take_back(work_bits);
-		work_bits = bits_stack.back();
-		mode2 = mode_stack.back();
-		bits_stack.pop_back();
-		stackindex.pop_back();
-		mode_stack.pop_back();
+		mode2 = mode;
 	}
 }
 
 void bmphandler::popstack_help()
 {
-	if (!bits_stack.empty())
-	{
-		sliceprovide->take_back(help_bits);
-		help_bits = bits_stack.back();
-		bits_stack.pop_back();
-		stackindex.pop_back();
-		mode_stack.pop_back();
-	}
+	unsigned char mode;
+	bits_stack.pop_back(help_bits, area, mode);
 }
 
 bool bmphandler::isloaded() { return loaded; }
 
 void bmphandler::clear_tissue(tissuelayers_size_t idx)
 {
+	tissues_changed(idx);
 	tissues_size_t* tissues = tissuelayers[idx];
 	std::fill(tissues, tissues + area, 0);
 }
 
 bool bmphandler::has_tissue(tissuelayers_size_t idx, tissues_size_t tissuetype)
 {
-	tissues_size_t* tissues = tissuelayers[idx];
-	for (unsigned int i = 0; i < area; i++)
-	{
-		if (tissues[i] == tissuetype)
-		{
-			return true;
-		}
-	}
-	return false;
+	return return_tissueindex(idx).contains(tissuetype);
 }
 
 void bmphandler::add2tissue(tissuelayers_size_t idx, tissues_size_t tissuetype,
 		float f, bool override)
 {
+	tissues_changed(idx);
 	tissues_size_t* tissues = tissuelayers[idx];
 	if (override)
 	{
@@ -12740,6 +12184,7 @@ void bmphandler::add2tissue(tissuelayers_size_t idx, tissues_size_t tissuetype,
 void bmphandler::add2tissue(tissuelayers_size_t idx, tissues_size_t tissuetype,
 		bool* mask, bool override)
 {
+	tissues_changed(idx);
 	tissues_size_t* tissues = tissuelayers[idx];
 	if (override)
 	{
@@ -12762,6 +12207,7 @@ void bmphandler::add2tissue(tissuelayers_size_t idx, tissues_size_t tissuetype,
 
 void bmphandler::add2tissue_connected(tissuelayers_size_t idx, tissues_size_t tissuetype, Point p, bool override)
 {
+	tissues_changed(idx);
 	unsigned position = pt2coord(p);
 	float f = work_bits[position];
 	float* results = (float*)malloc(sizeof(float) * (area + 2 * width + 2 * height + 4));
@@ -12843,6 +12289,7 @@ void bmphandler::add2tissue_connected(tissuelayers_size_t idx, tissues_size_t ti
 
 void bmphandler::add2tissue(tissuelayers_size_t idx, tissues_size_t tissuetype, Point p, bool override)
 {
+	tissues_changed(idx);
 	float f = work_pt(p);
 	tissues_size_t* tissues = tissuelayers[idx];
 	if (override)
@@ -12862,6 +12309,7 @@ void bmphandler::add2tissue(tissuelayers_size_t idx, tissues_size_t tissuetype,
 void bmphandler::add2tissue_thresh(tissuelayers_size_t idx,
 		tissues_size_t tissuetype, Point p)
 {
+	tissues_changed(idx);
 	float f = work_pt(p);
 	tissues_size_t* tissues = tissuelayers[idx];
 	for (unsigned int i = 0; i < area; i++)
@@ -12872,6 +12320,7 @@ void bmphandler::add2tissue_thresh(tissuelayers_size_t idx,
 void bmphandler::subtract_tissue(tissuelayers_size_t idx,
 		tissues_size_t tissuetype, Point p)
 {
+	tissues_changed(idx);
 	float f = work_pt(p);
 	subtract_tissue(idx, tissuetype, f);
 }
@@ -12879,6 +12328,7 @@ void bmphandler::subtract_tissue(tissuelayers_size_t idx,
 void bmphandler::subtract_tissue_connected(tissuelayers_size_t idx,
 		tissues_size_t tissuetype, Point p)
 {
+	tissues_changed(idx);
 	unsigned position = pt2coord(p);
 	std::vector<int> s;
 
@@ -12961,6 +12411,7 @@ void bmphandler::subtract_tissue_connected(tissuelayers_size_t idx,
 
 void bmphandler::subtract_tissue(tissuelayers_size_t idx, tissues_size_t tissuetype, float f)
 {
+	tissues_changed(idx);
 	tissues_size_t* tissues = tissuelayers[idx];
 	for (unsigned int i = 0; i < area; i++)
 		if (work_bits[i] == f && tissues[i] == tissuetype)
@@ -13050,6 +12501,7 @@ void bmphandler::change2mask_connectedwork(bool* mask, Point p, bool addorsub)
 
 void bmphandler::change2mask_connectedtissue(tissuelayers_size_t idx, bool* mask, Point p, bool addorsub)
 {
+	tissues_changed(idx);
 	unsigned position = pt2coord(p);
 	std::vector<int> s;
 
@@ -13154,6 +12606,7 @@ void bmphandler::tissue2work(tissuelayers_size_t idx)
 
 void bmphandler::cleartissue(tissuelayers_size_t idx, tissues_size_t tissuetype)
 {
+	tissues_changed(idx);
 	tissues_size_t* tissues = tissuelayers[idx];
 	for (unsigned int i = 0; i < area; i++)
 	{
@@ -13164,6 +12617,7 @@ void bmphandler::cleartissue(tissuelayers_size_t idx, tissues_size_t tissuetype)
 
 void bmphandler::cap_tissue(tissues_size_t maxval)
 {
+	tissues_changed();
 	for (tissuelayers_size_t idx = 0; idx < tissuelayers.size(); ++idx)
 	{
 		tissues_size_t* tissues = tissuelayers[idx];
@@ -13177,6 +12631,7 @@ void bmphandler::cap_tissue(tissues_size_t maxval)
 
 void bmphandler::cleartissues(tissuelayers_size_t idx)
 {
+	tissues_changed(idx);
 	tissues_size_t* tissues = tissuelayers[idx];
 	for (unsigned int i = 0; i < area; i++)
 	{
@@ -13186,6 +12641,7 @@ void bmphandler::cleartissues(tissuelayers_size_t idx)
 
 void bmphandler::cleartissuesall()
 {
+	tissues_changed();
 	for (tissuelayers_size_t idx = 0; idx < tissuelayers.size(); ++idx)
 	{
 		tissues_size_t* tissues = tissuelayers[idx];
@@ -13207,6 +12663,7 @@ void bmphandler::erasework(bool* mask)
 
 void bmphandler::erasetissue(tissuelayers_size_t idx, bool* mask)
 {
+	tissues_changed(idx);
 	tissues_size_t* tissues = tissuelayers[idx];
 	for (unsigned int i = 0; i < area; i++)
 	{
@@ -13328,6 +12785,7 @@ void bmphandler::floodwork(bool* mask)
 
 void bmphandler::floodtissue(tissuelayers_size_t idx, bool* mask)
 {
+	tissues_changed(idx);
 	unsigned position;
 	std::queue<unsigned int> s;
 
@@ -13758,6 +13216,7 @@ void bmphandler::correct_outlinetissue(tissuelayers_size_t idx,
 		tissues_size_t f1,
 		std::vector<Point>* newline)
 {
+	tissues_changed(idx);
 	unsigned char dummymode1 = mode1;
 	unsigned char dummymode2 = mode2;
 	float f = float(f1);
@@ -14142,6 +13601,7 @@ void bmphandler::brush(float f, Point p, float radius, float dx, float dy, bool
 void bmphandler::brushtissue(tissuelayers_size_t idx, tissues_size_t f, Point p,
 		int radius, bool draw, tissues_size_t f1)
 {
+	tissues_changed(idx);
 	_brush(tissuelayers[idx], f, p, radius, draw, f1,
 			[](tissues_size_t v) { return TissueInfos::GetTissueLocked(v); });
 }
@@ -14150,6 +13610,7 @@ void bmphandler::brushtissue(tissuelayers_size_t idx, tissues_size_t f, Point p,
 		float radius, float dx, float dy, bool draw,
 		tissues_size_t f1)
 {
+	tissues_changed(idx);
 	_brush(tissuelayers[idx], f, p, radius, dx, dy, draw, f1,
 			[](tissues_size_t v) { return TissueInfos::GetTissueLocked(v); });
 }
@@ -14402,6 +13863,7 @@ void bmphandler::fill_holes(float f, int minsize)
 void bmphandler::fill_holestissue(tissuelayers_size_t idx, tissues_size_t f,
 		int minsize)
 {
+	tissues_changed(idx);
 	std::vector<std::vector<Point>> inner_line;
 	minsize = 2 * minsize;
 	float bubble_size;
@@ -14960,6 +14422,7 @@ void bmphandler::remove_islands(float f, int minsize)
 void bmphandler::remove_islandstissue(tissuelayers_size_t idx, tissues_size_t f,
 		int minsize)
 {
+	tissues_changed(idx);
 	std::vector<std::vector<Point>> outer_line;
 	minsize = 2 * minsize;
 	float bubble_size;
@@ -15474,6 +14937,7 @@ void bmphandler::copy2limits(std::vector<std::vector<Point>>* limits1)
 
 void bmphandler::map_tissue_indices(const std::vector<tissues_size_t>& indexMap)
 {
+	tissues_changed();
 	for (tissuelayers_size_t idx = 0; idx < tissuelayers.size(); ++idx)
 	{
 		tissues_size_t* tissues = tissuelayers[idx];
@@ -15486,6 +14950,7 @@ void bmphandler::map_tissue_indices(const std::vector<tissues_size_t>& indexMap)
 
 void bmphandler::remove_tissue(tissues_size_t tissuenr)
 {
+	tissues_changed();
 	for (tissuelayers_size_t idx = 0; idx < tissuelayers.size(); ++idx)
 	{
 		tissues_size_t* tissues = tissuelayers[idx];
@@ -15507,6 +14972,7 @@ void bmphandler::group_tissues(tissuelayers_size_t idx,
 		std::vector<tissues_size_t>& olds,
 		std::vector<tissues_size_t>& news)
 {
+	tissues_changed(idx);
 	tissues_size_t crossref[TISSUES_SIZE_MAX + 1];
 	for (int i = 0; i < TISSUES_SIZE_MAX + 1; i++)
 		crossref[i] = (tissues_size_t)i;
@@ -15591,6 +15057,7 @@ bool bmphandler::print_vtkbinary_slice(tissuelayers_size_t idx,
 
 void bmphandler::shifttissue()
 {
+	tissues_changed();
 	int x, y;
 
 	FILE* fp;
@@ -15764,19 +15231,7 @@ unsigned long bmphandler::return_workpixelcount(float f)
 unsigned long bmphandler::return_tissuepixelcount(tissuelayers_size_t idx,
 		tissues_size_t c)
 {
-	unsigned long pos = 0;
-	unsigned long counter = 0;
-	tissues_size_t* tissues = tissuelayers[idx];
-	for (int j = 0; j < height; j++)
-	{
-		for (int k = 0; k < width; k++)
-		{
-			if (tissues[pos] == c)
-				counter++;
-			pos++;
-		}
-	}
-	return counter;
+	return return_tissueindex(idx).count(c);
 }
 
 bool bmphandler::get_extent(tissuelayers_size_t idx, tissues_size_t tissuenr,
@@ -15785,57 +15240,32 @@ bool bmphandler::get_extent(tissuelayers_size_t idx, tissues_size_t tissuenr,
 	if (area == 0)
 		return false;
 
-	bool found = false;
-	unsigned long pos = 0;
-	tissues_size_t* tissues = tissuelayers[idx];
-	while (!found && pos < area)
-	{
-		if (tissues[pos] == tissuenr)
-			found = true;
-		pos++;
-	}
-	if (!found)
-		return false;
-	else
+	return return_tissueindex(idx).extent(tissuenr, extent);
+}
+
+const TissueIndex& bmphandler::return_tissueindex(tissuelayers_size_t idx) const
+{
+	if (tissue_index.size() < tissuelayers.size())
 	{
-		pos--;
-		extent[1][0] = pos / width;
-		extent[0][0] = pos % width;
+		tissue_index.resize(tissuelayers.size());
 	}
-	while (pos < (unsigned long)(extent[1][0] + 1) * width)
+	if (!tissue_index[idx].valid())
 	{
-		if (tissues[pos] == tissuenr)
-			extent[0][1] = pos % width;
-		pos++;
+		tissue_index[idx].build(tissuelayers[idx], width, height);
 	}
-	found = false;
-	pos = area;
-	while (!found && pos > 0)
-	{
-		pos--;
-		if (tissues[pos] == tissuenr)
-			found = true;
-	}
-	extent[1][1] = pos / width;
-	for (unsigned short i = extent[1][0] + 1; i <= extent[1][1]; i++)
+	return tissue_index[idx];
+}
+
+void bmphandler::tissues_changed(tissuelayers_size_t idx)
+{
+	if (idx < tissue_index.size())
 	{
-		pos = (unsigned long)(i)*width;
-		for (unsigned short j = 0; j < extent[0][0]; j++, pos++)
-		{
-			if (tissues[pos] == tissuenr)
-				extent[0][0] = j;
-		}
-		pos = (unsigned long)(i + 1) * width - 1;
-		for (unsigned short j = width - 1; j > extent[0][1]; j--, pos--)
-		{
-			if (tissues[pos] == tissuenr)
-				extent[0][1] = j;
-		}
+		tissue_index[idx].invalidate();
 	}
-
-	return true;
 }
 
+void bmphandler::tissues_changed() { tissue_index.clear(); }
+
 void bmphandler::swap(bmphandler& bmph)
 {
 	Contour contourd;
@@ -15877,6 +15307,7 @@ void bmphandler::swap(bmphandler& bmph)
 		tissuelayers[idx] = bmph.tissuelayers[idx];
 		bmph.tissuelayers[idx] = tissuesd;
 	}
+	tissue_index.swap(bmph.tissue_index);
 	wshed_obj wshedobjd;
 	wshedobjd = wshedobj;
 	wshedobj = bmph.wshedobj;
@@ -15901,14 +15332,6 @@ void bmphandler::swap(bmphandler& bmph)
 	fextractd = fextract;
 	fextract = bmph.fextract;
 	bmph.fextract = fextractd;
-	std::list<float*> bits_stackd;
-	bits_stackd = bits_stack;
-	bits_stack = bmph.bits_stack;
-	bmph.bits_stack = bits_stackd;
-	std::list<unsigned char> mode_stackd;
-	mode_stackd = mode_stack;
-	mode_stack = bmph.mode_stack;
-	bmph.mode_stack = mode_stackd;
 	SliceProvider* sliceprovided;
 	sliceprovided = sliceprovide;
 	sliceprovide = bmph.sliceprovide;
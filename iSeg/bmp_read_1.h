@@ -15,6 +15,8 @@
 #include "Core/Contour.h"
 #include "Core/FeatureExtractor.h"
 #include "Core/Pair.h"
+#include "Core/SliceStackStore.h"
+#include "Core/TissueIndex.h"
 
 #include <list>
 #include <set>
@@ -69,6 +71,7 @@ public:
 	const float* return_bmp() const;
 	float* return_work();
 	const float* return_work() const;
+	/// for writing, the tissue index is invalidated once the change is reported (see tissues_changed)
 	tissues_size_t* return_tissues(tissuelayers_size_t idx);
 	const tissues_size_t* return_tissues(tissuelayers_size_t idx) const;
 	float* return_help();
@@ -130,6 +133,7 @@ public:
 	void transparent_add(float* pict2);
 	void newbmp(unsigned short width1, unsigned short height1, bool init = true);
 	void newbmp(unsigned short width1, unsigned short height1, float* bits);
+	void newbmp(unsigned short width1, unsigned short height1, float* bmp, float* work, tissues_size_t* tissues);
 	void freebmp();
 	static int CheckBMPDepth(const char* filename);
 	void SetConverterFactors(int redFactor, int greenFactor, int blueFactor);
@@ -233,11 +237,17 @@ public:
 	void thresholded_growinglimit(Point p, float thresh_low, float thresh_high, bool connectivity, float set_to);
 	void thresholded_growing(Point p, float threshfactor_low, float threshfactor_high, bool connectivity, float set_to, Pair* tp);
 	void thresholded_growing(float thresh_low, float thresh_high, bool connectivity, float* mask, float f, float set_to);
+	/// grey value propagation, each 4- (or 8-) neighbor step lowers the value by one
 	void distance_map(bool connectivity);
+	/// city-block (or chessboard) distance in steps from the contour of value f, not Euclidean
 	void distance_map(bool connectivity, float f, short unsigned levlset); //0:outside,1:inside,2:both
+	/// exact Euclidean distance to the boundaries between different values
 	void dead_reckoning();
+	/// exact signed Euclidean distance to the contour of value f (positive inside), returns the nearest contour pixel, to be freed by the caller
 	unsigned* dead_reckoning(float f);
+	/// as dead_reckoning(f), but with squared distances
 	unsigned* dead_reckoning_squared(float f);
+	/// exact signed Euclidean distance to the boundary pixels of value f (positive inside)
 	void IFT_distance1(float f);
 	void erosion(int n, bool connectivity);
 	void erosion1(int n, bool connectivity);
@@ -336,7 +346,7 @@ public:
 	bool savestack(unsigned i, const char* filename);
 	unsigned loadstack(const char* filename);
 	void removestack(unsigned i);
-	float* getstack(unsigned i, unsigned char& mode);
+	bool getstack(unsigned i, float* bits, unsigned char& mode);
 	void getstack_bmp(unsigned i);
 	void getstack_work(unsigned i);
 	void getstack_help(unsigned i);
@@ -397,6 +407,11 @@ public:
 	unsigned long return_tissuepixelcount(tissuelayers_size_t idx, tissues_size_t c);
 	void swap(bmphandler& bmph);
 	bool get_extent(tissuelayers_size_t idx, tissues_size_t tissuenr, unsigned short extent[2][2]);
+	/// per-slice tissue counts and extents, rebuilt on demand after the tissues changed
+	const TissueIndex& return_tissueindex(tissuelayers_size_t idx) const;
+	/// marks the tissue index as stale, to be called after writing through return_tissues
+	void tissues_changed(tissuelayers_size_t idx);
+	void tissues_changed();
 	bool unwrap(float jumpratio, float range = 0, float shift = 0);
 
 	int ConvertImageTo8BitBMP(const char* filename, unsigned char*& bits_tmp);
@@ -407,7 +422,6 @@ public:
 	void mergetissue(tissues_size_t tissuetype, tissuelayers_size_t idx);
 
 protected:
-	static std::list<unsigned> stackindex;
 	static unsigned stackcounter;
 	Contour contour;
 	std::vector<Mark> marks;
@@ -436,19 +450,21 @@ protected:
 	void _brush(T* data, T f, Point p, float radius, float dx, float dy, bool draw, T f1, F);
 
 private:
+	unsigned* contour_distance(float f, bool squared);
+
 	unsigned int histogram[256];
 	float* bmp_bits;
 	float* work_bits;
 	float* help_bits;
 	std::vector<tissues_size_t*> tissuelayers;
+	mutable std::vector<TissueIndex> tissue_index;
 	wshed_obj wshedobj;
 	bool bmp_is_grey;
 	bool work_is_grey;
 	bool loaded;
 	bool ownsliceprovider;
 	FeatureExtractor fextract;
-	static std::list<float*> bits_stack;
-	static std::list<unsigned char> mode_stack;
+	static SliceStackStore bits_stack;
 	SliceProvider* sliceprovide;
 	SliceProviderInstaller* sliceprovide_installer;
 	std::vector<std::vector<Mark>> vvm;